@@ -19,12 +19,20 @@
 #include <QDebug>
 #include <QtDBus/QDBusConnection>
 #include <QSslCertificate>
+#include <QTimer>
 #include <glog/logging.h>
 #include "ubuntu/transfers/system/application.h"
+#include "ubuntu/transfers/system/content_cache.h"
 #include "ubuntu/transfers/system/logger.h"
+#include "ubuntu/transfers/system/metrics.h"
+#include "ubuntu/transfers/system/process_queue.h"
+#include "ubuntu/transfers/system/request_factory.h"
+#include "ubuntu/transfers/system/retry_policy.h"
+#include "ubuntu/transfers/system/timeline.h"
 #include "ubuntu/transfers/system/timer.h"
 #include "adaptor_factory.h"
 #include "manager_factory.h"
+#include "metrics_adaptor.h"
 #include "base_daemon.h"
 
 
@@ -33,7 +41,20 @@ namespace {
     const QString SELFSIGNED_CERT = "-self-signed-certs";
     const QString STOPPABLE =  "-stoppable";
     const QString LOG_DIR= "-log-dir";
+    const QString POST_PROCESSING_JOBS = "-post-processing-jobs";
+    const QString POST_PROCESSING_TIMEOUT = "-post-processing-timeout";
+    const QString MAX_RETRIES = "-max-retries";
+    const QString STALL_TIMEOUT = "-stall-timeout";
+    const QString STALL_SPEED = "-stall-speed";
+    const QString CACHE_SIZE = "-cache-size";
+    const QString CACHE_DIR = "-cache-dir";
+    const QString NETWORK_THREADS = "-network-threads";
+    const QString SYNC_LOGGING = "-sync-logging";
+    const QString TRACE_TIMELINE = "-trace-timeline";
+    const QString TRACE_DIR = "-trace-dir";
+    const QString METRICS_FILE = "-metrics-file";
     const int DEFAULT_TIMEOUT = 30000;
+    const int METRICS_DUMP_INTERVAL = 60000;
 }
 
 namespace Ubuntu {
@@ -71,7 +92,11 @@ BaseDaemon::BaseDaemon(ManagerFactory* managerFactory,
 }
 
 BaseDaemon::~BaseDaemon() {
-    // no need to delete the adaptor because the interface is its parent
+    // leave the last values for the scraper
+    if (!_metricsFile.isEmpty()) {
+        Metrics::instance()->dump(_metricsFile);
+    }
+    // no need to delete the adaptors because the interface is their parent
     delete _app;
     delete _manager;
     delete _shutDownTimer;
@@ -117,6 +142,8 @@ BaseDaemon::start(const QString& path) {
     TRACE;
     _path = path;
     _managerAdaptor = _adaptorFactory->createAdaptor(_manager);
+    // the metrics of the daemon are exported with the manager
+    new MetricsAdaptor(_manager);
     bool ret = _conn->registerObject("/", _manager);
     if (ret) {
         LOG(INFO) << "Service registered to" << _path;
@@ -153,6 +180,11 @@ BaseDaemon::onTimeout() {
     _app->exit(0);
 }
 
+void
+BaseDaemon::onMetricsTimeout() {
+    Metrics::instance()->dump(_metricsFile);
+}
+
 void
 BaseDaemon::onSizeChanged(int size) {
     TRACE << size;
@@ -174,7 +206,9 @@ BaseDaemon::parseCommandLine() {
     QStringList args = _app->arguments();
     int index;
 
-    // set logging
+    // set logging, the messages are written by a background thread unless
+    // the user wants them to be written by the thread that logs them
+    Logger::setAsync(!args.contains(SYNC_LOGGING));
     if (args.contains(LOG_DIR)) {
         index = args.indexOf(LOG_DIR);
         if (args.count() > index + 1) {
@@ -200,6 +234,131 @@ BaseDaemon::parseCommandLine() {
             LOG(ERROR) << "Missing certs path.";
         }
     }  // certs
+
+    if (args.contains(POST_PROCESSING_JOBS)) {
+        index = args.indexOf(POST_PROCESSING_JOBS);
+        bool ok = false;
+        int jobs = (args.count() > index + 1)?args[index + 1].toInt(&ok):0;
+        if (ok && jobs > 0) {
+            ProcessQueue::instance()->setMaxConcurrency(jobs);
+            LOG(INFO) << "Post processing jobs:" << jobs;
+        } else {
+            LOG(ERROR) << "Missing or invalid post processing jobs.";
+        }
+    }
+
+    if (args.contains(POST_PROCESSING_TIMEOUT)) {
+        index = args.indexOf(POST_PROCESSING_TIMEOUT);
+        bool ok = false;
+        int timeout = (args.count() > index + 1)?args[index + 1].toInt(&ok):0;
+        if (ok && timeout >= 0) {
+            // passed in seconds, the queue works in msecs
+            ProcessQueue::instance()->setTimeout(timeout * 1000);
+            LOG(INFO) << "Post processing timeout:" << timeout << "secs";
+        } else {
+            LOG(ERROR) << "Missing or invalid post processing timeout.";
+        }
+    }
+
+    if (args.contains(MAX_RETRIES)) {
+        index = args.indexOf(MAX_RETRIES);
+        bool ok = false;
+        int retries = (args.count() > index + 1)?args[index + 1].toInt(&ok):0;
+        if (ok && retries >= 0) {
+            RetryPolicy::instance()->setMaxAttempts(retries);
+            LOG(INFO) << "Max retries:" << retries;
+        } else {
+            LOG(ERROR) << "Missing or invalid max retries.";
+        }
+    }
+
+    if (args.contains(STALL_TIMEOUT)) {
+        index = args.indexOf(STALL_TIMEOUT);
+        bool ok = false;
+        int timeout = (args.count() > index + 1)?args[index + 1].toInt(&ok):0;
+        if (ok && timeout >= 0) {
+            // passed in seconds, the policy works in msecs
+            RetryPolicy::instance()->setStallTimeout(timeout * 1000);
+            LOG(INFO) << "Stall timeout:" << timeout << "secs";
+        } else {
+            LOG(ERROR) << "Missing or invalid stall timeout.";
+        }
+    }
+
+    if (args.contains(STALL_SPEED)) {
+        index = args.indexOf(STALL_SPEED);
+        bool ok = false;
+        qulonglong speed = (args.count() > index + 1)?
+            args[index + 1].toULongLong(&ok):0;
+        if (ok) {
+            RetryPolicy::instance()->setStallSpeed(speed);
+            LOG(INFO) << "Stall speed:" << speed << "bytes/sec";
+        } else {
+            LOG(ERROR) << "Missing or invalid stall speed.";
+        }
+    }
+
+    if (args.contains(CACHE_DIR)) {
+        index = args.indexOf(CACHE_DIR);
+        if (args.count() > index + 1) {
+            ContentCache::instance()->setPath(args[index + 1]);
+            LOG(INFO) << "Cache dir:" << args[index + 1];
+        } else {
+            LOG(ERROR) << "Missing cache dir.";
+        }
+    }
+
+    if (args.contains(CACHE_SIZE)) {
+        index = args.indexOf(CACHE_SIZE);
+        bool ok = false;
+        qulonglong size = (args.count() > index + 1)?
+            args[index + 1].toULongLong(&ok):0;
+        if (ok) {
+            // passed in MiB, the cache works in bytes
+            ContentCache::instance()->setMaxSize(size * 1024 * 1024);
+            LOG(INFO) << "Cache size:" << size << "MiB";
+        } else {
+            LOG(ERROR) << "Missing or invalid cache size.";
+        }
+    }
+    if (args.contains(NETWORK_THREADS)) {
+        index = args.indexOf(NETWORK_THREADS);
+        bool ok = false;
+        int threads = (args.count() > index + 1)?args[index + 1].toInt(&ok):0;
+        if (ok && threads >= 0) {
+            RequestFactory::setNetworkThreads(threads);
+            LOG(INFO) << "Network threads:" << threads;
+        } else {
+            LOG(ERROR) << "Missing or invalid network threads.";
+        }
+    }
+    // the timelines of the transfers are only recorded when asked for,
+    // with a dir they are saved as chrome traces once they are done
+    if (args.contains(TRACE_TIMELINE)) {
+        Timeline::setEnabled(true);
+        LOG(INFO) << "Tracing the timelines of the transfers";
+    }
+    if (args.contains(TRACE_DIR)) {
+        index = args.indexOf(TRACE_DIR);
+        if (args.count() > index + 1) {
+            Timeline::setEnabled(true);
+            Timeline::setTraceDir(args[index + 1]);
+            LOG(INFO) << "Trace dir is" << args[index + 1];
+        } else {
+            LOG(ERROR) << "Missing trace dir path.";
+        }
+    }
+    // the metrics are always collected, the file is for the scrapers
+    // that cannot talk to the daemon over D-Bus
+    if (args.contains(METRICS_FILE)) {
+        index = args.indexOf(METRICS_FILE);
+        if (args.count() > index + 1) {
+            _metricsFile = args[index + 1];
+            LOG(INFO) << "Metrics file is" << _metricsFile;
+        } else {
+            LOG(ERROR) << "Missing metrics file path.";
+        }
+    }
     _isTimeoutEnabled = !args.contains(DISABLE_TIMEOUT);
     LOG(INFO) << "Timeout is enabled: " << _isTimeoutEnabled;
     _stoppable = args.contains(STOPPABLE);
@@ -218,6 +377,14 @@ BaseDaemon::init() {
         _shutDownTimer->start(DEFAULT_TIMEOUT);
     }
 
+    if (!_metricsFile.isEmpty()) {
+        _metricsTimer = new QTimer(this);
+        CHECK(connect(_metricsTimer, &QTimer::timeout,
+            this, &BaseDaemon::onMetricsTimeout))
+                << "Could not connect to signal";
+        _metricsTimer->start(METRICS_DUMP_INTERVAL);
+    }
+
     _manager = _managerFactory->createManager(
         _app, _conn, _stoppable, this);
 
@@ -24,6 +24,7 @@
 #include <ubuntu/transfers/system/dbus_connection.h>
 
 class QSslCertificate;
+class QTimer;
 
 namespace Ubuntu {
 
@@ -79,6 +80,7 @@ class BaseDaemon : public QObject {
     void init();
     void parseCommandLine();
     void onTimeout();
+    void onMetricsTimeout();
     void onSizeChanged(int);
 
  private:
@@ -93,6 +95,8 @@ class BaseDaemon : public QObject {
     AdaptorFactory* _adaptorFactory = nullptr;
     BaseManager* _manager = nullptr;
     QObject* _managerAdaptor = nullptr;
+    QString _metricsFile;
+    QTimer* _metricsTimer = nullptr;  // only used with a metrics file
 };
 
 }  // General
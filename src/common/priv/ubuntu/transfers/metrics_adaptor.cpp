@@ -0,0 +1,49 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "ubuntu/transfers/system/metrics.h"
+#include "metrics_adaptor.h"
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+using namespace System;
+
+MetricsAdaptor::MetricsAdaptor(QObject* parent)
+    : QDBusAbstractAdaptor(parent) {
+}
+
+MetricsAdaptor::~MetricsAdaptor() {
+}
+
+QVariantMap
+MetricsAdaptor::samples() {
+    // handle method call com.canonical.applications.Metrics.samples
+    return Metrics::instance()->samples();
+}
+
+QString
+MetricsAdaptor::text() {
+    // handle method call com.canonical.applications.Metrics.text
+    return Metrics::instance()->text();
+}
+
+}  // Transfers
+
+}  // Ubuntu
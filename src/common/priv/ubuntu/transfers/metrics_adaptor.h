@@ -0,0 +1,60 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef UBUNTU_GENERAL_METRICS_ADAPTOR_H
+#define UBUNTU_GENERAL_METRICS_ADAPTOR_H
+
+#include <QtCore/QObject>
+#include <QtDBus/QtDBus>
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+// Adaptor for the interface com.canonical.applications.Metrics, it is
+// added to the object of the manager so that it is exported with it but
+// the samples are always the ones of the daemon.
+class MetricsAdaptor : public QDBusAbstractAdaptor {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.canonical.applications.Metrics")
+    Q_CLASSINFO("D-Bus Introspection", ""
+"  <interface name=\"com.canonical.applications.Metrics\">\n"
+"    <method name=\"samples\">\n"
+"      <annotation value=\"QVariantMap\" name=\"org.qtproject.QtDBus.QtTypeName.Out0\"/>\n"
+"      <arg direction=\"out\" type=\"a{sv}\" name=\"samples\"/>\n"
+"    </method>\n"
+"    <method name=\"text\">\n"
+"      <arg direction=\"out\" type=\"s\" name=\"text\"/>\n"
+"    </method>\n"
+"  </interface>\n"
+        "")
+
+ public:
+    explicit MetricsAdaptor(QObject* parent);
+    virtual ~MetricsAdaptor();
+
+ public Q_SLOTS:  // NOLINT(whitespace/indent)
+    QVariantMap samples();
+    QString text();
+};
+
+}  // Transfers
+
+}  // Ubuntu
+
+#endif  // UBUNTU_GENERAL_METRICS_ADAPTOR_H
@@ -17,22 +17,41 @@
  */
 
 #include <QSignalMapper>
+#include <QTimer>
 #include <glog/logging.h>
 
+#include "ubuntu/transfers/system/file_manager.h"
 #include "ubuntu/transfers/system/logger.h"
+#include "ubuntu/transfers/system/metrics.h"
 #include "ubuntu/transfers/system/network_session.h"
 #include "queue.h"
 
+namespace {
+    const qulonglong DEFAULT_SPACE_WATERMARK = 50 * 1024 * 1024;
+    const int SPACE_CHECK_INTERVAL = 30000;
+    const QString TRANSFERS_METRIC = "udm_transfers";
+    const QString STATE_LABEL = "state";
+    const QString ACTIVE_STATE = "active";
+    const QString QUEUED_STATE = "queued";
+}
+
 namespace Ubuntu {
 
 namespace Transfers {
 
 Queue::Queue(QObject* parent)
-    : QObject(parent) {
+    : QObject(parent),
+      _spaceWatermark(DEFAULT_SPACE_WATERMARK) {
     CHECK(connect(NetworkSession::instance(),
         &NetworkSession::sessionTypeChanged,
         this, &Queue::onSessionTypeChanged))
             << "Could not connect to signal";
+
+    _spaceTimer = new QTimer(this);
+    _spaceTimer->setInterval(SPACE_CHECK_INTERVAL);
+    CHECK(connect(_spaceTimer, &QTimer::timeout,
+        this, &Queue::checkWaitingForSpace))
+            << "Could not connect to signal";
 }
 
 void
@@ -57,6 +76,7 @@ Queue::add(Transfer* transfer) {
                 << "Could not connect to signal";
     }
 
+    updateMetrics();
     emit transferAdded(path);
 }
 
@@ -67,9 +87,17 @@ Queue::remove(const QString& path) {
     auto transfer = _transfers[path];
     _sortedPaths[transfer->transferAppId()]->removeOne(path);
     _transfers.remove(path);
+    _waitingForSpace.remove(path);
 
     transfer->deleteLater();
+    updateMetrics();
     emit transferRemoved(path);
+
+    // the space reserved by the transfer is free, check it once the
+    // current transfers have been updated
+    if (!_waitingForSpace.isEmpty()) {
+        QTimer::singleShot(0, this, SLOT(checkWaitingForSpace()));
+    }
 }
 
 QString
@@ -104,6 +132,49 @@ Queue::size() {
     return _transfers.size();
 }
 
+qulonglong
+Queue::spaceWatermark() const {
+    return _spaceWatermark;
+}
+
+void
+Queue::setSpaceWatermark(qulonglong bytes) {
+    _spaceWatermark = bytes;
+}
+
+qulonglong
+Queue::reservedSpace(const QString& path) {
+    return reservedSpaceIn(FileManager::instance()->fileSystemId(path));
+}
+
+qulonglong
+Queue::reservedSpaceIn(qulonglong fileSystem) {
+    qulonglong reserved = 0;
+    foreach(const QString& currentPath, _current.values()) {
+        if (currentPath.isEmpty() || !_transfers.contains(currentPath)) {
+            continue;
+        }
+        auto transfer = _transfers[currentPath];
+        auto fd = transfer->storageDescriptor();
+        if ((fd != -1 || !transfer->storagePath().isEmpty())
+                && fileSystemId(transfer) == fileSystem) {
+            reserved += transfer->requiredSpace();
+        }
+    }
+    return reserved;
+}
+
+qulonglong
+Queue::fileSystemId(Transfer* transfer) {
+    // the paths of the descriptors are in procfs, not in the file system
+    // that stores the data
+    auto fd = transfer->storageDescriptor();
+    if (fd != -1) {
+        return FileManager::instance()->fileSystemId(fd);
+    }
+    return FileManager::instance()->fileSystemId(transfer->storagePath());
+}
+
 void
 Queue::onManagedTransferStateChanged() {
     TRACE;
@@ -225,6 +296,10 @@ Queue::updateCurrentTransfer(const QString& appIdToUpdate) {
             if (transfer->canTransfer()
                     && (state == Transfer::START
                         || state == Transfer::RESUME)) {
+                if (!hasSpaceFor(transfer)) {
+                    waitForSpace(path, transfer, state);
+                    continue;
+                }
                 _current[appId] = path;
                 if (state == Transfer::START) {
                     transfer->startTransfer();
@@ -239,6 +314,96 @@ Queue::updateCurrentTransfer(const QString& appIdToUpdate) {
             emit currentChanged(appId, "");
         }
     }
+    updateMetrics();
+}
+
+bool
+Queue::hasSpaceFor(Transfer* transfer) {
+    auto fileManager = FileManager::instance();
+    auto fd = transfer->storageDescriptor();
+    auto path = transfer->storagePath();
+    qint64 available = -1;
+    qulonglong fileSystem = 0;
+    if (fd != -1) {
+        available = fileManager->bytesAvailable(fd);
+        fileSystem = fileManager->fileSystemId(fd);
+    } else if (!path.isEmpty()) {
+        available = fileManager->bytesAvailable(path);
+        fileSystem = fileManager->fileSystemId(path);
+    } else {
+        // the transfer does not store data
+        return true;
+    }
+
+    if (available < 0) {
+        return true;
+    }
+
+    auto required = transfer->requiredSpace();
+    auto reserved = reservedSpaceIn(fileSystem);
+    if (static_cast<qulonglong>(available)
+            < required + reserved + _spaceWatermark) {
+        LOG_RATE_LIMITED(WARNING, transfer) << "Not enough space in "
+            << path << ": requires "
+            << required << " bytes, " << reserved << " reserved and "
+            << available << " available";
+        return false;
+    }
+    return true;
+}
+
+void
+Queue::waitForSpace(const QString& path,
+                    Transfer* transfer,
+                    Transfer::State state) {
+    TRACE << path;
+    _waitingForSpace[path] = state;
+    transfer->setState(Transfer::WAITING_FOR_SPACE);
+    if (!_spaceTimer->isActive()) {
+        _spaceTimer->start();
+    }
+}
+
+void
+Queue::checkWaitingForSpace() {
+    TRACE;
+    foreach(const QString& path, _waitingForSpace.keys()) {
+        auto state = _waitingForSpace[path];
+        auto transfer = _transfers.value(path, nullptr);
+        if (transfer == nullptr
+                || transfer->state() != Transfer::WAITING_FOR_SPACE) {
+            // the client paused or canceled the transfer meanwhile
+            _waitingForSpace.remove(path);
+            continue;
+        }
+
+        if (hasSpaceFor(transfer)) {
+            LOG(INFO) << "Space available for " << path;
+            _waitingForSpace.remove(path);
+            // the state change lets the q schedule the transfer
+            transfer->setState(state);
+        }
+    }
+
+    if (_waitingForSpace.isEmpty()) {
+        _spaceTimer->stop();
+    }
+}
+
+void
+Queue::updateMetrics() {
+    // the current transfers are the active ones, the rest wait for them
+    int active = 0;
+    foreach(const QString& path, _current.values()) {
+        if (!path.isEmpty() && _transfers.contains(path)) {
+            active++;
+        }
+    }
+    auto metrics = Metrics::instance();
+    metrics->setGauge(TRANSFERS_METRIC, {{STATE_LABEL, ACTIVE_STATE}},
+        active);
+    metrics->setGauge(TRANSFERS_METRIC, {{STATE_LABEL, QUEUED_STATE}},
+        _transfers.size() - active);
 }
 
 }  // Transfers
@@ -28,6 +28,8 @@
 #include "ubuntu/transfers/system/network_session.h"
 #include "transfer.h"
 
+class QTimer;
+
 namespace Ubuntu {
 
 namespace Transfers {
@@ -48,6 +50,14 @@ class Queue : public QObject {
     virtual QHash<QString, Transfer*> transfers();
     virtual int size();
 
+    // bytes that are always left free in a file system, transfers that
+    // would use them wait for space
+    virtual qulonglong spaceWatermark() const;
+    virtual void setSpaceWatermark(qulonglong bytes);
+    // bytes that the current transfers still need in the file system
+    // of the given path
+    virtual qulonglong reservedSpace(const QString& path);
+
  signals:
     // signals raised when things happens within the q
     void transferAdded(QString path);
@@ -60,11 +70,24 @@ class Queue : public QObject {
     void onSessionTypeChanged(QNetworkConfiguration::BearerType type);
     void remove(const QString& path);
     void updateCurrentTransfer(const QString& appIdToUpdate = "");
+    bool hasSpaceFor(Transfer* transfer);
+    qulonglong fileSystemId(Transfer* transfer);
+    qulonglong reservedSpaceIn(qulonglong fileSystem);
+    void waitForSpace(const QString& path, Transfer* transfer,
+                      Transfer::State state);
+    void updateMetrics();
+
+ private slots:  // NOLINT(whitespace/indent)
+    void checkWaitingForSpace();
 
  private:
     QHash<QString, QString> _current;
     QHash<QString, Transfer*> _transfers;  // quick for access
     QHash<QString, QStringList*> _sortedPaths;  // keep the order
+    qulonglong _spaceWatermark;
+    QTimer* _spaceTimer = nullptr;
+    // the state to go back to once there is space
+    QHash<QString, Transfer::State> _waitingForSpace;
 };
 
 }  // Transfers
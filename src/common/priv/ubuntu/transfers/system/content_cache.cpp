@@ -0,0 +1,348 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QScopedPointer>
+#include <QSettings>
+#include <QStandardPaths>
+#include <glog/logging.h>
+#include <ubuntu/transfers/system/logger.h>
+#include "cryptographic_hash.h"
+#include "file_manager.h"
+#include "content_cache.h"
+
+namespace {
+    const QString CACHE_DIR = "ubuntu-download-manager/content";
+    const QString INDEX_FILE = "index.ini";
+    const QString PART_EXTENSION = ".part";
+    const QString DEFAULT_ALGO = "sha256";
+    const QString CONTENT_KEY = "content";
+    const QString ETAG_KEY = "etag";
+    const QString LAST_MODIFIED_KEY = "lastModified";
+
+    // the algo and the digest are provided by the clients and are used
+    // as a path, do not allow them to point outside of the cache
+    QString contentName(const QString& algo, const QString& digest) {
+        static QRegularExpression algoRegex("^[a-z0-9]+$");
+        static QRegularExpression digestRegex("^[0-9a-f]+$");
+        auto algoName = algo.toLower();
+        auto digestName = digest.toLower();
+        if (!algoRegex.match(algoName).hasMatch()
+                || !digestRegex.match(digestName).hasMatch()) {
+            return QString();
+        }
+        return algoName + "/" + digestName;
+    }
+}
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+ContentCache* ContentCache::_instance = nullptr;
+QMutex ContentCache::_mutex;
+
+ContentCache::ContentCache(QObject* parent)
+    : QObject(parent) {
+    _path = QStandardPaths::writableLocation(
+        QStandardPaths::GenericCacheLocation) + "/" + CACHE_DIR;
+}
+
+bool
+ContentCache::isEnabled() const {
+    return _maxSize > 0 && !_path.isEmpty();
+}
+
+QString
+ContentCache::path() const {
+    return _path;
+}
+
+void
+ContentCache::setPath(const QString& path) {
+    _path = path;
+    // the entries of the old dir are meaningless
+    _entries.clear();
+    _size = 0;
+    _loaded = false;
+}
+
+qulonglong
+ContentCache::maxSize() const {
+    return _maxSize;
+}
+
+void
+ContentCache::setMaxSize(qulonglong size) {
+    _maxSize = size;
+    if (_loaded && isEnabled()) {
+        evict();
+    }
+}
+
+qulonglong
+ContentCache::size() {
+    load();
+    return _size;
+}
+
+QString
+ContentCache::findContent(const QString& algo, const QString& digest) {
+    if (!isEnabled()) {
+        return QString();
+    }
+
+    auto content = contentName(algo, digest);
+    if (content.isEmpty()) {
+        return QString();
+    }
+
+    load();
+    if (!_entries.contains(content)) {
+        return QString();
+    }
+
+    auto path = contentPath(content);
+    if (!QFile::exists(path)) {
+        // removed behind our back
+        _size -= _entries.take(content).size;
+        return QString();
+    }
+    touch(content);
+    return path;
+}
+
+QString
+ContentCache::findResponse(const QString& request,
+                           QByteArray& etag,
+                           QByteArray& lastModified) {
+    if (!isEnabled() || request.isEmpty()) {
+        return QString();
+    }
+
+    load();
+    QSettings index(indexPath(), QSettings::IniFormat);
+    index.beginGroup(request);
+    auto content = index.value(CONTENT_KEY).toString();
+    if (content.isEmpty()) {
+        return QString();
+    }
+
+    auto path = contentPath(content);
+    if (!_entries.contains(content) || !QFile::exists(path)) {
+        // the data was evicted, the validators are useless
+        index.remove("");
+        return QString();
+    }
+
+    etag = index.value(ETAG_KEY).toByteArray();
+    lastModified = index.value(LAST_MODIFIED_KEY).toByteArray();
+    touch(content);
+    return path;
+}
+
+bool
+ContentCache::insert(const QString& filePath,
+                     const QString& algo,
+                     const QString& digest,
+                     const QString& request,
+                     const QByteArray& etag,
+                     const QByteArray& lastModified) {
+    TRACE << filePath << algo << digest << request;
+    if (!isEnabled()) {
+        return false;
+    }
+
+    QFileInfo info(filePath);
+    if (!info.isFile() || static_cast<qulonglong>(info.size()) > _maxSize) {
+        return false;
+    }
+
+    auto content = contentName(algo, digest);
+    if (digest.isEmpty()) {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        // addData is smart enough to not load the entire file in memory
+        CryptographicHash hash(QCryptographicHash::Sha256);
+        hash.addData(&file);
+        content = contentName(DEFAULT_ALGO, hash.result().toHex());
+    }
+
+    if (content.isEmpty()) {
+        return false;
+    }
+
+    load();
+    if (_entries.contains(content)) {
+        touch(content);
+    } else {
+        auto path = contentPath(content);
+        auto partPath = path + PART_EXTENSION;
+        if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+            LOG(WARNING) << "Could not create the cache dir for" << path;
+            return false;
+        }
+
+        // reflinks make the copy free in the file systems that support
+        // them, the data is only published once it was fully copied
+        QScopedPointer<File> file(
+            FileManager::instance()->createFile(partPath));
+        auto copied = file->open(QIODevice::WriteOnly)
+            && file->copyFrom(filePath);
+        file->close();
+        if (!copied || !QFile::rename(partPath, path)) {
+            LOG(WARNING) << "Could not copy" << filePath << "to the cache";
+            QFile::remove(partPath);
+            return false;
+        }
+
+        Entry entry;
+        entry.size = info.size();
+        entry.lastUsed = QDateTime::currentMSecsSinceEpoch();
+        _entries[content] = entry;
+        _size += entry.size;
+    }
+
+    if (!request.isEmpty() && (!etag.isEmpty() || !lastModified.isEmpty())) {
+        QSettings index(indexPath(), QSettings::IniFormat);
+        index.beginGroup(request);
+        index.setValue(CONTENT_KEY, content);
+        index.setValue(ETAG_KEY, etag);
+        index.setValue(LAST_MODIFIED_KEY, lastModified);
+        index.endGroup();
+        index.sync();
+    }
+
+    evict();
+    return true;
+}
+
+void
+ContentCache::load() {
+    if (_loaded) {
+        return;
+    }
+    _loaded = true;
+
+    // the mtime of the data is used as the last time it was used so that
+    // the lru order survives restarts
+    QDir root(_path);
+    foreach(const QString& algo, root.entryList(
+            QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QDir dir(root.filePath(algo));
+        foreach(const QFileInfo& info, dir.entryInfoList(QDir::Files)) {
+            if (info.fileName().endsWith(PART_EXTENSION)) {
+                // left behind by a crash
+                QFile::remove(info.absoluteFilePath());
+                continue;
+            }
+            Entry entry;
+            entry.size = info.size();
+            entry.lastUsed = info.lastModified().toMSecsSinceEpoch();
+            _entries[algo + "/" + info.fileName()] = entry;
+            _size += entry.size;
+        }
+    }
+}
+
+void
+ContentCache::touch(const QString& content) {
+    _entries[content].lastUsed = QDateTime::currentMSecsSinceEpoch();
+    utimensat(AT_FDCWD, QFile::encodeName(contentPath(content)).constData(),
+        nullptr, 0);
+}
+
+void
+ContentCache::evict() {
+    if (_size <= _maxSize) {
+        return;
+    }
+
+    auto contents = _entries.keys();
+    std::sort(contents.begin(), contents.end(),
+        [this](const QString& a, const QString& b) {
+            return _entries[a].lastUsed < _entries[b].lastUsed;
+        });
+
+    foreach(const QString& content, contents) {
+        if (_size <= _maxSize) {
+            break;
+        }
+        LOG(INFO) << "Evicting" << content << "from the cache";
+        QFile::remove(contentPath(content));
+        _size -= _entries.take(content).size;
+    }
+}
+
+QString
+ContentCache::contentPath(const QString& content) const {
+    return _path + "/" + content;
+}
+
+QString
+ContentCache::indexPath() const {
+    return _path + "/" + INDEX_FILE;
+}
+
+ContentCache*
+ContentCache::instance() {
+    if(_instance == nullptr) {
+        _mutex.lock();
+        if(_instance == nullptr)
+            _instance = new ContentCache();
+        _mutex.unlock();
+    }
+    return _instance;
+}
+
+void
+ContentCache::setInstance(ContentCache* instance) {
+    _instance = instance;
+}
+
+void
+ContentCache::deleteInstance() {
+    if(_instance != nullptr) {
+        _mutex.lock();
+        if(_instance != nullptr) {
+            delete _instance;
+            _instance = nullptr;
+        }
+        _mutex.unlock();
+    }
+}
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
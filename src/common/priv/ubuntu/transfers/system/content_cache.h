@@ -0,0 +1,114 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_CONTENT_CACHE_H
+#define DOWNLOADER_LIB_CONTENT_CACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+// Local copy of the data of finished transfers so that repeated downloads
+// do not hit the network. The data is addressed by its digest and the
+// validators of the response (ETag and Last-Modified) are kept per request
+// so that unchanged resources can be revalidated with a conditional GET.
+// The least recently used data is evicted once the size cap is reached.
+class ContentCache : public QObject {
+    Q_OBJECT
+
+ public:
+    explicit ContentCache(QObject* parent = 0);
+
+    // the cache is opt-in, it is disabled until it is given a size
+    virtual bool isEnabled() const;
+
+    virtual QString path() const;
+    virtual void setPath(const QString& path);
+
+    // max number of bytes stored in the cache, 0 disables it
+    virtual qulonglong maxSize() const;
+    virtual void setMaxSize(qulonglong size);
+
+    // number of bytes currently stored in the cache
+    virtual qulonglong size();
+
+    // path of the cached data with the given digest, empty if none
+    virtual QString findContent(const QString& algo, const QString& digest);
+
+    // path of the data of the last response of the request, empty if none,
+    // the validators of the response are returned so that they can be used
+    // to revalidate it
+    virtual QString findResponse(const QString& request,
+                                 QByteArray& etag,
+                                 QByteArray& lastModified);
+
+    // copies the file in the cache, when the digest is empty a sha256 one
+    // is calculated, the request is optional
+    virtual bool insert(const QString& filePath,
+                        const QString& algo,
+                        const QString& digest,
+                        const QString& request = QString(),
+                        const QByteArray& etag = QByteArray(),
+                        const QByteArray& lastModified = QByteArray());
+
+    static ContentCache* instance();
+
+    // only used for testing so that we can inject a fake
+    static void setInstance(ContentCache* instance);
+    static void deleteInstance();
+
+ private:
+    struct Entry {
+        qulonglong size = 0;
+        qint64 lastUsed = 0;  // msecs since epoch
+    };
+
+    void load();
+    void touch(const QString& content);
+    void evict();
+    QString contentPath(const QString& content) const;
+    QString indexPath() const;
+
+ private:
+    // used for the singleton
+    static ContentCache* _instance;
+    static QMutex _mutex;
+
+    QString _path;
+    qulonglong _maxSize = 0;
+    qulonglong _size = 0;
+    bool _loaded = false;
+    // keyed by "algo/digest" which is also the path of the data in the dir
+    QHash<QString, Entry> _entries;
+};
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_CONTENT_CACHE_H
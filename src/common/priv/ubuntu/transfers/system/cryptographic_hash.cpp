@@ -16,34 +16,285 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <QScopedPointer>
 #include "cryptographic_hash.h"
 
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+#define EVP_MD_CTX_new EVP_MD_CTX_create
+#define EVP_MD_CTX_free EVP_MD_CTX_destroy
+#endif
+
+namespace {
+    // large reads keep the number of syscalls low, the digests are
+    // updated while the data is in the cache of the cpu
+    const qint64 READ_CHUNK_SIZE = 1024 * 1024;
+    // below this size the buffered reads of the device are as fast
+    const qint64 PREAD_THRESHOLD = 16 * 1024 * 1024;
+    // the file is never mapped, a client can truncate its own file while
+    // it is hashed and reading a mapping past the end raises SIGBUS
+    const qint64 PREAD_BLOCK_SIZE = 4 * 1024 * 1024;
+
+    QString evpName(QCryptographicHash::Algorithm algorithm) {
+        switch (algorithm) {
+            case QCryptographicHash::Md5:
+                return "md5";
+            case QCryptographicHash::Sha1:
+                return "sha1";
+            case QCryptographicHash::Sha224:
+                return "sha224";
+            case QCryptographicHash::Sha256:
+                return "sha256";
+            case QCryptographicHash::Sha384:
+                return "sha384";
+            case QCryptographicHash::Sha512:
+                return "sha512";
+            default:
+                // md4 and sha3 are left to Qt
+                return QString();
+        }
+    }
+
+    const EVP_MD* evpDigest(const QString& name) {
+        if (name.isEmpty()) {
+            return nullptr;
+        }
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+        // newer versions load the digests on their own
+        static bool loaded = (OpenSSL_add_all_digests(), true);
+        Q_UNUSED(loaded);
+#endif
+        return EVP_get_digestbyname(name.toLatin1().constData());
+    }
+}
+
 namespace Ubuntu {
 
 namespace Transfers {
 
 namespace System {
 
+struct CryptographicHash::Digest {
+    EVP_MD_CTX* context = nullptr;
+    QCryptographicHash* fallback = nullptr;
+
+    ~Digest() {
+        if (context != nullptr) {
+            EVP_MD_CTX_free(context);
+        }
+        delete fallback;
+    }
+};
+
 CryptographicHashFactory* CryptographicHashFactory::_instance = nullptr;
 QMutex CryptographicHashFactory::_mutex;
 
 CryptographicHash::CryptographicHash(QCryptographicHash::Algorithm method,
                                      QObject* parent)
-    : QObject(parent),
-      _hash(method) {
+    : QObject(parent) {
+    addDigest(evpName(method), method);
+}
+
+CryptographicHash::CryptographicHash(
+        const QList<QCryptographicHash::Algorithm>& methods,
+        QObject* parent)
+    : QObject(parent) {
+    foreach(QCryptographicHash::Algorithm method, methods) {
+        addDigest(evpName(method), method);
+    }
+}
+
+CryptographicHash::CryptographicHash(const QStringList& names,
+                                     QObject* parent)
+    : QObject(parent) {
+    foreach(const QString& name, names) {
+        if (!isSupported(name)) {
+            _isValid = false;
+            continue;
+        }
+        addDigest(name, QCryptographicHash::Md5);
+    }
+}
+
+CryptographicHash::~CryptographicHash() {
+    qDeleteAll(_digests);
+}
+
+void
+CryptographicHash::addDigest(const QString& name,
+                             QCryptographicHash::Algorithm fallback) {
+    auto digest = new Digest();
+    auto md = evpDigest(name);
+    if (md != nullptr) {
+        digest->context = EVP_MD_CTX_new();
+        if (EVP_DigestInit_ex(digest->context, md, nullptr) != 1) {
+            EVP_MD_CTX_free(digest->context);
+            digest->context = nullptr;
+        }
+    }
+    if (digest->context == nullptr) {
+        digest->fallback = new QCryptographicHash(fallback);
+    }
+    _digests.append(digest);
+}
+
+void
+CryptographicHash::update(const char* data, qint64 size) {
+    foreach(Digest* digest, _digests) {
+        if (digest->context != nullptr) {
+            EVP_DigestUpdate(digest->context, data, size);
+        } else {
+            digest->fallback->addData(data, size);
+        }
+    }
+}
+
+bool
+CryptographicHash::addData(QIODevice* device) {
+    auto file = qobject_cast<QFileDevice*>(device);
+    if (file != nullptr && file->handle() >= 0 && !file->isSequential()
+            && file->size() - file->pos() >= PREAD_THRESHOLD) {
+        return addFile(file);
+    }
+    return addStream(device);
+}
+
+bool
+CryptographicHash::addStream(QIODevice* device) {
+    if (!device->isReadable()) {
+        return false;
+    }
+
+    QByteArray buffer(READ_CHUNK_SIZE, Qt::Uninitialized);
+    qint64 read = 0;
+    while (!isCanceled()
+            && (read = device->read(buffer.data(), buffer.size())) > 0) {
+        update(buffer.constData(), read);
+    }
+    return !isCanceled() && device->atEnd();
+}
+
+bool
+CryptographicHash::addFile(QFileDevice* file) {
+    if (!file->isReadable() || file->handle() < 0) {
+        return false;
+    }
+
+    // data written through the device must reach the fd before it is read
+    if (file->isWritable()) {
+        file->flush();
+    }
+
+    auto fd = file->handle();
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        return false;
+    }
+
+    qint64 offset = file->pos();
+    qint64 size = info.st_size;
+    posix_fadvise(fd, offset, size - offset, POSIX_FADV_SEQUENTIAL);
+    // a file that shrinks while it is read fails the hash
+    if (!readBlocks(fd, offset, size)) {
+        return false;
+    }
+
+    // leave the device as if it was read
+    return file->seek(size);
+}
+
+bool
+CryptographicHash::readBlocks(int fd, qint64 offset, qint64 size) {
+    QByteArray buffer(PREAD_BLOCK_SIZE, Qt::Uninitialized);
+    while (offset < size) {
+        if (isCanceled()) {
+            return false;
+        }
+        auto read = pread(fd, buffer.data(),
+            qMin(PREAD_BLOCK_SIZE, size - offset), offset);
+        if (read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read <= 0) {
+            return false;
+        }
+        update(buffer.constData(), read);
+        offset += read;
+    }
+    return true;
+}
+
+void
+CryptographicHash::addBytes(const QByteArray& data) {
+    update(data.constData(), data.size());
 }
 
+void
+CryptographicHash::setCancelFlag(const QAtomicInt* flag) {
+    _cancelFlag = flag;
+}
 
 bool
-CryptographicHash::addData(QIODevice * device) {
-    return _hash.addData(device);
+CryptographicHash::isCanceled() const {
+    return _cancelFlag != nullptr && _cancelFlag->loadAcquire() != 0;
 }
 
 QByteArray
 CryptographicHash::result() const {
-    return _hash.result();
+    auto all = results();
+    return (all.isEmpty())? QByteArray() : all.first();
+}
+
+QList<QByteArray>
+CryptographicHash::results() const {
+    QList<QByteArray> digests;
+    foreach(Digest* digest, _digests) {
+        if (digest->fallback != nullptr) {
+            digests.append(digest->fallback->result());
+            continue;
+        }
+
+        // finalize a copy so that more data can be added afterwards, as
+        // with QCryptographicHash
+        unsigned char value[EVP_MAX_MD_SIZE];
+        unsigned int size = 0;
+        auto copy = EVP_MD_CTX_new();
+        if (EVP_MD_CTX_copy_ex(copy, digest->context) == 1
+                && EVP_DigestFinal_ex(copy, value, &size) == 1) {
+            digests.append(QByteArray(reinterpret_cast<char*>(value), size));
+        } else {
+            digests.append(QByteArray());
+        }
+        EVP_MD_CTX_free(copy);
+    }
+    return digests;
+}
+
+bool
+CryptographicHash::isValid() const {
+    return _isValid;
 }
 
+QStringList
+CryptographicHash::extraAlgorithms() {
+    QStringList names;
+    foreach(const QString& name, QStringList() << "blake2b512"
+            << "blake2s256" << "sha512-256" << "sha3-256" << "sha3-512") {
+        if (isSupported(name)) {
+            names << name;
+        }
+    }
+    return names;
+}
+
+bool
+CryptographicHash::isSupported(const QString& name) {
+    return evpDigest(name) != nullptr;
+}
 
 CryptographicHashFactory::CryptographicHashFactory(QObject* parent)
     : QObject(parent) {
@@ -56,6 +307,13 @@ CryptographicHashFactory::createCryptographicHash(
     return new CryptographicHash(method, parent);
 }
 
+CryptographicHash*
+CryptographicHashFactory::createMultiHash(
+                         const QList<QCryptographicHash::Algorithm>& methods,
+                         QObject* parent) {
+    return new CryptographicHash(methods, parent);
+}
+
 CryptographicHashFactory*
 CryptographicHashFactory::instance() {
     if(_instance == nullptr) {
@@ -19,10 +19,14 @@
 #ifndef DOWNLOADER_LIB_CRYPTOGRAPHIC_HASH_H
 #define DOWNLOADER_LIB_CRYPTOGRAPHIC_HASH_H
 
+#include <QAtomicInt>
 #include <QByteArray>
 #include <QCryptographicHash>
+#include <QFileDevice>
+#include <QList>
 #include <QMutex>
 #include <QIODevice>
+#include <QStringList>
 
 namespace Ubuntu {
 
@@ -30,16 +34,57 @@ namespace Transfers {
 
 namespace System {
 
+// Hashes data using the OpenSSL implementation of the algorithms, which
+// selects at run time the code that uses the instructions of the cpu
+// (SHA-NI, ARMv8 crypto extensions, AVX2...). The algorithms that OpenSSL
+// does not provide are calculated by Qt. Several digests can be calculated
+// with a single pass over the data.
 class CryptographicHash : public QObject {
 
  public:
     CryptographicHash(QCryptographicHash::Algorithm method,
                       QObject* parent = 0);
+    CryptographicHash(const QList<QCryptographicHash::Algorithm>& methods,
+                      QObject* parent = 0);
+    // algorithms by their OpenSSL name, for example "blake2b512"
+    CryptographicHash(const QStringList& names, QObject* parent = 0);
+    virtual ~CryptographicHash();
+
+    // large files are hashed with addFile, the rest with addStream
     virtual bool addData(QIODevice* device);
+    // reads the device through its own buffered reads
+    bool addStream(QIODevice* device);
+    // hashes the file from its current position with large preads on its
+    // descriptor, fails if the file is truncated while it is read
+    bool addFile(QFileDevice* file);
+    void addBytes(const QByteArray& data);
+    // the add methods stop reading and return false once the flag is set,
+    // it is checked before each chunk so other threads can set it
+    void setCancelFlag(const QAtomicInt* flag);
+    // digest of the first algorithm
     virtual QByteArray result() const;
+    // digests in the order of the algorithms
+    QList<QByteArray> results() const;
+    // false if one of the named algorithms is not supported
+    bool isValid() const;
+
+    // names of the algorithms other than the Qt ones that can be used
+    static QStringList extraAlgorithms();
+    static bool isSupported(const QString& name);
+
+ private:
+    struct Digest;
+
+    void addDigest(const QString& name,
+                   QCryptographicHash::Algorithm fallback);
+    void update(const char* data, qint64 size);
+    bool readBlocks(int fd, qint64 offset, qint64 size);
+    bool isCanceled() const;
 
  private:
-    QCryptographicHash _hash;
+    QList<Digest*> _digests;
+    bool _isValid = true;
+    const QAtomicInt* _cancelFlag = nullptr;
 };
 
 class CryptographicHashFactory : public QObject {
@@ -49,6 +94,9 @@ class CryptographicHashFactory : public QObject {
     virtual CryptographicHash* createCryptographicHash(
                                        QCryptographicHash::Algorithm method,
                                        QObject* parent = 0);
+    virtual CryptographicHash* createMultiHash(
+                         const QList<QCryptographicHash::Algorithm>& methods,
+                         QObject* parent = 0);
 
     static CryptographicHashFactory* instance();
 
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <unistd.h>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <glog/logging.h>
+#include <ubuntu/transfers/system/logger.h>
+#include "file_copier.h"
+#include "file_manager.h"
+
+namespace {
+    // copies are io bound, more workers would only compete for the disk
+    const int MAX_CONCURRENCY = 2;
+
+    using Ubuntu::Transfers::System::CopyJob;
+
+    class CopyTask : public QRunnable {
+     public:
+        explicit CopyTask(CopyJob* job)
+            : _job(job) {
+        }
+
+        void run() override {
+            _job->run();
+        }
+
+     private:
+        CopyJob* _job;
+    };
+}
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+CopyJob::CopyJob(int source, const QString& destination, QObject* parent)
+    : QObject(parent),
+      _source(source),
+      _destination(destination) {
+}
+
+CopyJob::~CopyJob() {
+    if (_source >= 0) {
+        ::close(_source);
+    }
+}
+
+void
+CopyJob::run() {
+    bool released = false;
+    {
+        // the copier can no longer take the job out of the pool
+        QMutexLocker locker(&_mutex);
+        _task = nullptr;
+        released = _released;
+    }
+
+    if (!released) {
+        QElapsedTimer timer;
+        timer.start();
+        auto copied = File::copy(_source, _destination);
+        LOG(INFO) << "Copied the data to " << _destination << " in "
+            << timer.elapsed() << " msecs";
+        emit finished(copied);
+    }
+
+    {
+        QMutexLocker locker(&_mutex);
+        _done = true;
+        released = _released;
+    }
+    if (released) {
+        // nothing else uses the job
+        deleteLater();
+    }
+}
+
+void
+CopyJob::release() {
+    {
+        QMutexLocker locker(&_mutex);
+        if (!_done) {
+            // the worker deletes the job once it returns
+            _released = true;
+            return;
+        }
+    }
+    deleteLater();
+}
+
+FileCopier* FileCopier::_instance = nullptr;
+QMutex FileCopier::_mutex;
+
+FileCopier::FileCopier(QObject* parent)
+    : QObject(parent) {
+    _pool.setMaxThreadCount(MAX_CONCURRENCY);
+}
+
+FileCopier::~FileCopier() {
+    _pool.waitForDone();
+}
+
+void
+FileCopier::copy(CopyJob* job) {
+    TRACE << job->_destination;
+    auto task = new CopyTask(job);
+    {
+        // set before the pool can hand the task to a worker
+        QMutexLocker locker(&job->_mutex);
+        job->_task = task;
+    }
+    _pool.start(task);
+}
+
+void
+FileCopier::cancel(CopyJob* job) {
+    {
+        // the worker clears the task with the lock held, a task that is
+        // still set cannot have been deleted by the pool
+        QMutexLocker locker(&job->_mutex);
+        if (job->_task != nullptr && _pool.tryTake(job->_task)) {
+            delete job->_task;
+            job->_task = nullptr;
+            job->_done = true;
+        }
+    }
+    job->release();
+}
+
+FileCopier*
+FileCopier::instance() {
+    if(_instance == nullptr) {
+        _mutex.lock();
+        if(_instance == nullptr)
+            _instance = new FileCopier();
+        _mutex.unlock();
+    }
+    return _instance;
+}
+
+void
+FileCopier::setInstance(FileCopier* instance) {
+    _instance = instance;
+}
+
+void
+FileCopier::deleteInstance() {
+    if(_instance != nullptr) {
+        _mutex.lock();
+        if(_instance != nullptr) {
+            delete _instance;
+            _instance = nullptr;
+        }
+        _mutex.unlock();
+    }
+}
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_FILE_COPIER_H
+#define DOWNLOADER_LIB_FILE_COPIER_H
+
+#include <QMutex>
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+#include <QThreadPool>
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+// Copy of an open file that runs in the pool of the copier. The signal is
+// emitted from the worker, connections made with a context object that
+// lives in another thread are therefore queued.
+class CopyJob : public QObject {
+    Q_OBJECT
+    friend class FileCopier;
+
+ public:
+    // takes the ownership of the source descriptor, the data is read from
+    // it so the file can be moved or removed once the job is created
+    CopyJob(int source, const QString& destination, QObject* parent = 0);
+    virtual ~CopyJob();
+
+    // copies the data, executed by the worker
+    void run();
+    // the copy is skipped if no worker started it yet, the job deletes
+    // itself once the worker is done with it
+    void release();
+
+ signals:
+    void finished(bool success);
+
+ private:
+    QMutex _mutex;
+    bool _done = false;
+    bool _released = false;
+    QRunnable* _task = nullptr;  // cleared once a worker took the job
+    int _source;
+    QString _destination;
+};
+
+// Bounded pool used to copy the data shared between downloads so that
+// large files do not block the event loop of the daemon.
+class FileCopier : public QObject {
+    Q_OBJECT
+
+ public:
+    explicit FileCopier(QObject* parent = 0);
+    virtual ~FileCopier();
+
+    // queues the job, its signal must be connected before calling this
+    // method
+    virtual void copy(CopyJob* job);
+    // takes the job out of the queue when no worker started it, in any
+    // case the job is released and must not be used anymore
+    virtual void cancel(CopyJob* job);
+
+    static FileCopier* instance();
+
+    // only used for testing so that we can inject a fake
+    static void setInstance(FileCopier* instance);
+    static void deleteInstance();
+
+ private:
+    // used for the singleton
+    static FileCopier* _instance;
+    static QMutex _mutex;
+
+    QThreadPool _pool;
+};
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_FILE_COPIER_H
@@ -16,11 +16,89 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 #include <QFile>
 #include <QFileInfo>
 #include <QTemporaryFile>
+#include <glog/logging.h>
+#include <ubuntu/transfers/system/logger.h>
 #include "file_manager.h"
 
+// older kernel headers do not provide the following
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE (1 << 0)
+#endif
+
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+namespace {
+
+    int renameNoReplace(const char* oldPath, const char* newPath) {
+#ifdef SYS_renameat2
+        return syscall(SYS_renameat2, AT_FDCWD, oldPath, AT_FDCWD, newPath,
+            RENAME_NOREPLACE);
+#else
+        errno = ENOSYS;
+        return -1;
+#endif
+    }
+
+    ssize_t copyFileRange(int in, int out, size_t len) {
+#ifdef SYS_copy_file_range
+        return syscall(SYS_copy_file_range, in, nullptr, out, nullptr, len, 0);
+#else
+        errno = ENOSYS;
+        return -1;
+#endif
+    }
+
+    // copies the data in the kernel, cloning the extents when the
+    // file system supports it
+    bool copyData(int in, int out, off_t size) {
+        if (ioctl(out, FICLONE, in) == 0) {
+            return true;
+        }
+
+        bool useCopyRange = true;
+        off_t copied = 0;
+        while (copied < size) {
+            ssize_t result = -1;
+            if (useCopyRange) {
+                result = copyFileRange(in, out, size - copied);
+                if (result < 0 && (errno == ENOSYS || errno == EXDEV
+                        || errno == EINVAL || errno == EOPNOTSUPP)) {
+                    // older kernels do not copy between file systems
+                    useCopyRange = false;
+                    continue;
+                }
+            } else {
+                result = sendfile(out, in, nullptr, size - copied);
+            }
+
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                return false;
+            }
+            copied += result;
+        }
+        return true;
+    }
+
+}
+
 namespace Ubuntu {
 
 namespace Transfers {
@@ -35,8 +113,16 @@ File::File(QFile* file)
     : _file(file) {
 }
 
+File::File(int fd)
+    : _fd(fd) {
+    _file = new QFile();
+}
+
 File::~File() {
     delete _file;
+    if (_fd != -1) {
+        ::close(_fd);
+    }
 }
 
 void
@@ -61,6 +147,12 @@ File::flush() {
 
 bool
 File::open(QIODevice::OpenMode mode) {
+    if (_fd != -1) {
+        // the QFile closes the descriptor from now on
+        auto fd = _fd;
+        _fd = -1;
+        return _file->open(fd, mode, QFileDevice::AutoCloseHandle);
+    }
     return _file->open(mode);
 }
 
@@ -71,6 +163,10 @@ File::readAll() {
 
 bool
 File::remove() {
+    if (_file->fileName().isEmpty() && _file->isOpen()) {
+        // files backed by a descriptor cannot be unlinked, drop the data
+        return _file->resize(0);
+    }
     return _file->remove();
 }
 
@@ -95,6 +191,94 @@ File::device() {
     return _file;
 }
 
+bool
+File::allocate(qint64 size) {
+    auto fd = _file->handle();
+    if (fd == -1 || size <= 0) {
+        return true;
+    }
+
+    // keep the size so that the progress and the range used to resume
+    // the download are still calculated with the written data
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size) == 0) {
+        return true;
+    }
+
+    if (errno == EOPNOTSUPP || errno == ENOSYS) {
+        // the file system cannot reserve the space, at least ensure that
+        // there is enough of it at this point
+        struct statvfs stats;
+        if (fstatvfs(fd, &stats) != 0) {
+            return true;
+        }
+        auto available = static_cast<qint64>(stats.f_bavail) * stats.f_frsize;
+        return available >= size - _file->size();
+    }
+    return errno != ENOSPC && errno != EDQUOT && errno != EFBIG;
+}
+
+bool
+File::sync() {
+    if (!_file->flush()) {
+        return false;
+    }
+    auto fd = _file->handle();
+    if (fd == -1) {
+        return true;
+    }
+    int result;
+    do {
+        result = fdatasync(fd);
+    } while (result != 0 && errno == EINTR);
+    return result == 0;
+}
+
+bool
+File::truncate(qint64 size) {
+    if (size < 0 || size >= _file->size()) {
+        return true;
+    }
+    return _file->resize(size);
+}
+
+bool
+File::copyFrom(const QString& path) {
+    if (!_file->flush()) {
+        return false;
+    }
+
+    int in = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+
+    auto copied = copy(in, _file->fileName());
+    ::close(in);
+    return copied;
+}
+
+bool
+File::copy(int in, const QString& destination) {
+    struct stat info;
+    if (fstat(in, &info) != 0) {
+        return false;
+    }
+
+    // the file is usually opened to append, which cannot be used to clone
+    // or to copy in the kernel, use a new descriptor for it
+    int out = ::open(QFile::encodeName(destination).constData(),
+        O_WRONLY | O_CLOEXEC);
+    if (out < 0) {
+        return false;
+    }
+
+    auto copied = ftruncate(out, 0) == 0 && copyData(in, out, info.st_size);
+    if (::close(out) != 0) {
+        copied = false;
+    }
+    return copied;
+}
+
 FileManager* FileManager::_instance = nullptr;
 QMutex FileManager::_mutex;
 
@@ -103,6 +287,12 @@ FileManager::createFile(const QString& name) {
     return new File(name);
 }
 
+File*
+FileManager::createFileFromDescriptor(int fd) {
+    // when the dup fails the file cannot be opened, as with a wrong path
+    return new File(fcntl(fd, F_DUPFD_CLOEXEC, 0));
+}
+
 File*
 FileManager::copyToTempFile(const QString& name) {
     // create a temp file, and copy the old name to the
@@ -125,7 +315,31 @@ FileManager::exists(const QString& path) {
 
 bool
 FileManager::rename(const QString& oldName, const QString& newName) {
-    return QFile::rename(oldName, newName);
+    auto oldPath = QFile::encodeName(oldName);
+    auto newPath = QFile::encodeName(newName);
+
+    if (renameNoReplace(oldPath.constData(), newPath.constData()) == 0) {
+        return true;
+    }
+
+    if (errno == EINVAL || errno == ENOSYS) {
+        // the file system does not support the flags, a hard link followed
+        // by an unlink provides the same guarantees
+        if (::link(oldPath.constData(), newPath.constData()) == 0) {
+            ::unlink(oldPath.constData());
+            return true;
+        }
+    }
+
+    if (errno == EXDEV) {
+        return moveAcrossDevices(oldName, newName);
+    }
+
+    if (errno != EEXIST) {
+        // let qt deal with any other corner case
+        return QFile::rename(oldName, newName);
+    }
+    return false;
 }
 
 bool
@@ -133,6 +347,95 @@ FileManager::isDir(const QString& path) {
     return QFileInfo(path).isDir();
 }
 
+qint64
+FileManager::bytesAvailable(const QString& path) {
+    QFileInfo info(path);
+    auto dir = (info.isDir())? info.absoluteFilePath() : info.absolutePath();
+    struct statvfs stats;
+    if (statvfs(QFile::encodeName(dir).constData(), &stats) != 0) {
+        return -1;
+    }
+    return static_cast<qint64>(stats.f_bavail) * stats.f_frsize;
+}
+
+qulonglong
+FileManager::fileSystemId(const QString& path) {
+    QFileInfo info(path);
+    auto dir = (info.isDir())? info.absoluteFilePath() : info.absolutePath();
+    struct stat stats;
+    if (stat(QFile::encodeName(dir).constData(), &stats) != 0) {
+        return 0;
+    }
+    return static_cast<qulonglong>(stats.st_dev);
+}
+
+qint64
+FileManager::bytesAvailable(int fd) {
+    struct statvfs stats;
+    if (fstatvfs(fd, &stats) != 0) {
+        return -1;
+    }
+    return static_cast<qint64>(stats.f_bavail) * stats.f_frsize;
+}
+
+qulonglong
+FileManager::fileSystemId(int fd) {
+    struct stat stats;
+    if (fstat(fd, &stats) != 0) {
+        return 0;
+    }
+    return static_cast<qulonglong>(stats.st_dev);
+}
+
+qulonglong
+FileManager::copyFallbacks() const {
+    return _copyFallbacks;
+}
+
+bool
+FileManager::moveAcrossDevices(const QString& oldName, const QString& newName) {
+    _copyFallbacks++;
+    LOG(WARNING) << "Copying" << oldName << "to" << newName
+        << "because they are in diff file systems";
+
+    auto oldPath = QFile::encodeName(oldName);
+    auto newPath = QFile::encodeName(newName);
+
+    int in = ::open(oldPath.constData(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(in, &info) != 0) {
+        ::close(in);
+        return false;
+    }
+
+    // O_EXCL keeps the no replace semantics of the rename
+    int out = ::open(newPath.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+        info.st_mode & 0777);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+
+    auto copied = copyData(in, out, info.st_size);
+    ::close(in);
+    if (::close(out) != 0) {
+        copied = false;
+    }
+
+    if (!copied) {
+        LOG(ERROR) << "Could not copy" << oldName << "to" << newName;
+        ::unlink(newPath.constData());
+        return false;
+    }
+
+    ::unlink(oldPath.constData());
+    return true;
+}
+
 FileManager* FileManager::instance() {
     if(_instance == nullptr) {
         _mutex.lock();
@@ -51,12 +51,34 @@ class File : public QObject {
     virtual qint64 write(const QByteArray& byteArray);
     virtual QIODevice* device();
 
+    // reserves the disk space for size bytes without changing the size
+    // of the file, returns false only when there is not enough space
+    virtual bool allocate(qint64 size);
+
+    // flushes the buffers and waits until the data is in the disk, the
+    // metadata that is not needed to read the data back is not synced
+    virtual bool sync();
+
+    // drops the data after size, used to discard data that the server
+    // did not send as a continuation of the file
+    virtual bool truncate(qint64 size);
+
+    // replaces the content of the file with the one of the given path,
+    // sharing the extents when the file system supports it
+    virtual bool copyFrom(const QString& path);
+    // copies the data of a descriptor at the start of its file, it does
+    // not use a File so that workers can call it
+    static bool copy(int in, const QString& destination);
+
  protected:
     explicit File(const QString& name);
     explicit File(QFile* file);
+    // takes ownership of the descriptor, which is used by open
+    explicit File(int fd);
 
  private:
     QFile* _file = nullptr;
+    int _fd = -1;
 
 };
 
@@ -65,11 +87,26 @@ class FileManager : public QObject {
 
  public:
     virtual File* createFile(const QString& name);
+    // creates a file that writes to a dup of the given descriptor,
+    // the caller keeps the ownership of fd
+    virtual File* createFileFromDescriptor(int fd);
     virtual File* copyToTempFile(const QString& name);
     virtual bool remove(const QString& path);
     virtual bool exists(const QString& path);
+    // atomically publishes the file without replacing an existing one,
+    // when the paths are in diff file systems the data is copied
     virtual bool rename(const QString& oldName, const QString& newName);
     virtual bool isDir(const QString& path);
+    // free bytes in the file system of the path, -1 if unknown
+    virtual qint64 bytesAvailable(const QString& path);
+    // id of the file system of the path, 0 if unknown
+    virtual qulonglong fileSystemId(const QString& path);
+    // same as above for the file system of an open descriptor
+    virtual qint64 bytesAvailable(int fd);
+    virtual qulonglong fileSystemId(int fd);
+
+    // number of renames that had to copy the data
+    virtual qulonglong copyFallbacks() const;
 
     static FileManager* instance();
 
@@ -80,11 +117,15 @@ class FileManager : public QObject {
  protected:
     explicit FileManager(QObject *parent = 0) : QObject(parent) {}
 
+ private:
+    bool moveAcrossDevices(const QString& oldName, const QString& newName);
+
  private:
     // used for the singleton
     static FileManager* _instance;
     static QMutex _mutex;
 
+    qulonglong _copyFallbacks = 0;
 };
 
 }  // System
@@ -0,0 +1,271 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <glog/logging.h>
+#include <ubuntu/transfers/system/hash_algorithm.h>
+#include <ubuntu/transfers/system/logger.h>
+#include "cryptographic_hash.h"
+#include "hash_verifier.h"
+#include "metrics.h"
+
+namespace {
+    // verification is mostly io bound, a couple of workers keep the
+    // device busy while several downloads finish at the same time
+    const int DEFAULT_MAX_CONCURRENCY = 2;
+    const QString HASH_METRIC = "udm_hash_seconds";
+    const QString ALGORITHM_LABEL = "algorithm";
+
+    using Ubuntu::Transfers::System::HashJob;
+
+    class HashTask : public QRunnable {
+     public:
+        HashTask(QIODevice* device,
+                 const QString& path,
+                 QCryptographicHash::Algorithm algorithm,
+                 HashJob* job)
+            : _device(device),
+              _path(path),
+              _algorithm(algorithm),
+              _job(job) {
+        }
+
+        void run() override {
+            if (_device != nullptr) {
+                _job->run(_device, _algorithm);
+            } else {
+                _job->run(_path, _algorithm);
+            }
+        }
+
+     private:
+        QIODevice* _device;
+        QString _path;
+        QCryptographicHash::Algorithm _algorithm;
+        HashJob* _job;
+    };
+}
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+HashJob::HashJob(QObject* parent)
+    : QObject(parent) {
+}
+
+void
+HashJob::run(QIODevice* device, QCryptographicHash::Algorithm algorithm) {
+    {
+        // the verifier can no longer take the job out of the pool
+        QMutexLocker locker(&_mutex);
+        _task = nullptr;
+    }
+
+    QByteArray digest;
+    if (!isCanceled()) {
+        emit started();
+        QElapsedTimer timer;
+        timer.start();
+
+        QScopedPointer<CryptographicHash> hash(
+            CryptographicHashFactory::instance()->createCryptographicHash(
+                algorithm));
+        hash->setCancelFlag(&_canceled);
+        // addData is smart enough to not load the entire file in memory
+        hash->addData(device);
+        digest = hash->result();
+
+        if (isCanceled()) {
+            LOG(INFO) << "Hashing canceled after " << timer.elapsed()
+                << " msecs";
+        } else {
+            LOG(INFO) << "Hashed the data in " << timer.elapsed() << " msecs";
+            Metrics::instance()->observe(HASH_METRIC,
+                {{ALGORITHM_LABEL, HashAlgorithm::getHashAlgo(algorithm)}},
+                timer.nsecsElapsed() / 1000000000.0);
+            emit finished(digest);
+        }
+    }
+
+    // the owner can delete the job once it is done
+    bool released = false;
+    {
+        QMutexLocker locker(&_mutex);
+        _digest = digest;
+        _done = true;
+        released = _released;
+        _doneCondition.wakeAll();
+    }
+    if (released) {
+        // nothing else uses the job
+        deleteLater();
+    }
+}
+
+void
+HashJob::run(const QString& path, QCryptographicHash::Algorithm algorithm) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        LOG(WARNING) << "Could not open " << path << " to hash it: "
+            << file.errorString();
+    }
+    run(&file, algorithm);
+}
+
+void
+HashJob::wait() {
+    QMutexLocker locker(&_mutex);
+    while (!_done) {
+        _doneCondition.wait(&_mutex);
+    }
+}
+
+bool
+HashJob::isDone() const {
+    QMutexLocker locker(&_mutex);
+    return _done;
+}
+
+bool
+HashJob::isCanceled() const {
+    return _canceled.loadAcquire() != 0;
+}
+
+void
+HashJob::release() {
+    _canceled.storeRelease(1);
+    {
+        QMutexLocker locker(&_mutex);
+        if (!_done) {
+            // the worker deletes the job once it returns
+            _released = true;
+            return;
+        }
+    }
+    deleteLater();
+}
+
+QByteArray
+HashJob::digest() const {
+    QMutexLocker locker(&_mutex);
+    return _digest;
+}
+
+HashVerifier* HashVerifier::_instance = nullptr;
+QMutex HashVerifier::_mutex;
+
+HashVerifier::HashVerifier(QObject* parent)
+    : QObject(parent) {
+    _pool.setMaxThreadCount(DEFAULT_MAX_CONCURRENCY);
+}
+
+HashVerifier::~HashVerifier() {
+    _pool.waitForDone();
+}
+
+void
+HashVerifier::hash(HashJob* job,
+                   QIODevice* device,
+                   QCryptographicHash::Algorithm algorithm) {
+    TRACE << algorithm;
+    start(job, new HashTask(device, QString(), algorithm, job));
+}
+
+void
+HashVerifier::hash(HashJob* job,
+                   const QString& path,
+                   QCryptographicHash::Algorithm algorithm) {
+    TRACE << path << algorithm;
+    start(job, new HashTask(nullptr, path, algorithm, job));
+}
+
+void
+HashVerifier::cancel(HashJob* job) {
+    {
+        // the worker clears the task with the lock held, a task that is
+        // still set cannot have been deleted by the pool
+        QMutexLocker locker(&job->_mutex);
+        if (job->_task != nullptr && _pool.tryTake(job->_task)) {
+            delete job->_task;
+            job->_task = nullptr;
+            job->_done = true;
+        }
+    }
+    job->release();
+}
+
+void
+HashVerifier::start(HashJob* job, QRunnable* task) {
+    {
+        // set before the pool can hand the task to a worker
+        QMutexLocker locker(&job->_mutex);
+        job->_task = task;
+    }
+    _pool.start(task);
+}
+
+int
+HashVerifier::maxConcurrency() const {
+    return _pool.maxThreadCount();
+}
+
+void
+HashVerifier::setMaxConcurrency(int max) {
+    _pool.setMaxThreadCount(qMax(1, max));
+}
+
+HashVerifier*
+HashVerifier::instance() {
+    if(_instance == nullptr) {
+        _mutex.lock();
+        if(_instance == nullptr)
+            _instance = new HashVerifier();
+        _mutex.unlock();
+    }
+    return _instance;
+}
+
+void
+HashVerifier::setInstance(HashVerifier* instance) {
+    _instance = instance;
+}
+
+void
+HashVerifier::deleteInstance() {
+    if(_instance != nullptr) {
+        _mutex.lock();
+        if(_instance != nullptr) {
+            delete _instance;
+            _instance = nullptr;
+        }
+        _mutex.unlock();
+    }
+}
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
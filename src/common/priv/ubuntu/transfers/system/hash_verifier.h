@@ -0,0 +1,127 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_HASH_VERIFIER_H
+#define DOWNLOADER_LIB_HASH_VERIFIER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QIODevice>
+#include <QMutex>
+#include <QObject>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+// Digest of a device that is calculated in the pool of the verifier. The
+// signals are emitted from the worker, connections made with a context
+// object that lives in another thread are therefore queued.
+class HashJob : public QObject {
+    Q_OBJECT
+    friend class HashVerifier;
+
+ public:
+    explicit HashJob(QObject* parent = 0);
+
+    // calculates the digest, executed by the worker
+    void run(QIODevice* device, QCryptographicHash::Algorithm algorithm);
+    // same as above reading the file through a descriptor of the worker
+    void run(const QString& path, QCryptographicHash::Algorithm algorithm);
+    // blocks until the worker no longer uses the device, the event loop
+    // of the daemon uses release instead
+    void wait();
+    bool isDone() const;
+    bool isCanceled() const;
+    // only valid once the job is done
+    QByteArray digest() const;
+    // the worker stops at the next chunk and finished is not emitted if
+    // it was not yet, the job deletes itself once the worker is done
+    void release();
+
+ signals:
+    // a worker started reading the device
+    void started();
+    void finished(const QByteArray& digest);
+
+ private:
+    mutable QMutex _mutex;
+    QWaitCondition _doneCondition;
+    bool _done = false;
+    bool _released = false;
+    QAtomicInt _canceled;
+    QRunnable* _task = nullptr;  // cleared once a worker took the job
+    QByteArray _digest;
+};
+
+// Bounded pool used to verify the data of the downloads so that large
+// files are read back without blocking the event loop of the daemon.
+class HashVerifier : public QObject {
+    Q_OBJECT
+
+ public:
+    explicit HashVerifier(QObject* parent = 0);
+    virtual ~HashVerifier();
+
+    // queues the job, its signals must be connected before calling this
+    // method and the device must not be used until the job is done
+    virtual void hash(HashJob* job,
+                      QIODevice* device,
+                      QCryptographicHash::Algorithm algorithm);
+    // queues the job, the worker opens the file on its own so the owner
+    // can keep using its device
+    virtual void hash(HashJob* job,
+                      const QString& path,
+                      QCryptographicHash::Algorithm algorithm);
+    // takes the job out of the queue when no worker started it, in any
+    // case the job is released and must not be used anymore
+    virtual void cancel(HashJob* job);
+
+    virtual int maxConcurrency() const;
+    virtual void setMaxConcurrency(int max);
+
+    static HashVerifier* instance();
+
+    // only used for testing so that we can inject a fake
+    static void setInstance(HashVerifier* instance);
+    static void deleteInstance();
+
+ private:
+    void start(HashJob* job, QRunnable* task);
+
+ private:
+    // used for the singleton
+    static HashVerifier* _instance;
+    static QMutex _mutex;
+
+    QThreadPool _pool;
+};
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_HASH_VERIFIER_H
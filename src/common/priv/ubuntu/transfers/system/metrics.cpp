@@ -0,0 +1,370 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QMetaEnum>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStringList>
+#include <glog/logging.h>
+#include <ubuntu/transfers/system/logger.h>
+#include "metrics.h"
+
+namespace {
+    const QString DBUS_CALL_METRIC = "udm_dbus_call_seconds";
+    const QString METHOD_LABEL = "method";
+    const QString BUCKET_LABEL = "le";
+    const QString INF_BUCKET = "+Inf";
+    const QString BUCKET_SUFFIX = "_bucket";
+    const QString SUM_SUFFIX = "_sum";
+    const QString COUNT_SUFFIX = "_count";
+    // from a fast D-Bus call to hashing a large file
+    const QVector<double> BUCKETS {0.001, 0.005, 0.01, 0.025, 0.05, 0.1,
+        0.25, 0.5, 1, 2.5, 5, 10, 30, 60};
+    const char* TYPE_NAMES[] = {"counter", "gauge", "histogram"};
+
+    QString escape(QString value) {
+        return value.replace("\\", "\\\\").replace("\"", "\\\"")
+            .replace("\n", "\\n");
+    }
+
+    QString formatValue(const QVariant& value) {
+        if (value.type() == QVariant::Double) {
+            return QString::number(value.toDouble(), 'g', 15);
+        }
+        return value.toString();
+    }
+}
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+Metrics* Metrics::_instance = nullptr;
+QMutex Metrics::_mutex;
+
+Metrics::Metrics() {
+}
+
+Metrics::~Metrics() {
+}
+
+void
+Metrics::increment(const QString& name,
+                   const MetricLabels& labels,
+                   qulonglong value) {
+    QMutexLocker locker(&_familiesMutex);
+    auto current = series(name, COUNTER, labels, true);
+    if (current != nullptr) {
+        current->count += value;
+    }
+}
+
+void
+Metrics::setGauge(const QString& name,
+                  const MetricLabels& labels,
+                  qlonglong value) {
+    QMutexLocker locker(&_familiesMutex);
+    auto current = series(name, GAUGE, labels, true);
+    if (current != nullptr) {
+        current->value = value;
+    }
+}
+
+void
+Metrics::observe(const QString& name,
+                 const MetricLabels& labels,
+                 double seconds) {
+    QMutexLocker locker(&_familiesMutex);
+    auto current = series(name, HISTOGRAM, labels, true);
+    if (current == nullptr) {
+        return;
+    }
+    if (current->buckets.isEmpty()) {
+        current->buckets.fill(0, BUCKETS.count());
+    }
+
+    current->count++;
+    current->sum += seconds;
+    for (int index = 0; index < BUCKETS.count(); index++) {
+        if (seconds <= BUCKETS[index]) {
+            current->buckets[index]++;
+            break;
+        }
+    }
+}
+
+qulonglong
+Metrics::counter(const QString& name, const MetricLabels& labels) {
+    QMutexLocker locker(&_familiesMutex);
+    auto current = series(name, COUNTER, labels, false);
+    return (current != nullptr) ? current->count : 0;
+}
+
+qlonglong
+Metrics::gauge(const QString& name, const MetricLabels& labels) {
+    QMutexLocker locker(&_familiesMutex);
+    auto current = series(name, GAUGE, labels, false);
+    return (current != nullptr) ? current->value : 0;
+}
+
+qulonglong
+Metrics::observations(const QString& name, const MetricLabels& labels) {
+    QMutexLocker locker(&_familiesMutex);
+    auto current = series(name, HISTOGRAM, labels, false);
+    return (current != nullptr) ? current->count : 0;
+}
+
+QVariantMap
+Metrics::samples() {
+    QMutexLocker locker(&_familiesMutex);
+    QVariantMap result;
+    foreach(const QString& name, _families.keys()) {
+        typedef QPair<QString, QVariant> Sample;
+        foreach(const Sample& sample, familySamples(name, _families[name])) {
+            result[sample.first] = sample.second;
+        }
+    }
+    return result;
+}
+
+QString
+Metrics::text() {
+    QMutexLocker locker(&_familiesMutex);
+    QStringList lines;
+    foreach(const QString& name, _families.keys()) {
+        auto family = _families[name];
+        lines << QString("# TYPE %1 %2").arg(name).arg(
+            TYPE_NAMES[family.type]);
+
+        typedef QPair<QString, QVariant> Sample;
+        foreach(const Sample& sample, familySamples(name, family)) {
+            lines << sample.first + " " + formatValue(sample.second);
+        }
+    }
+    return lines.isEmpty() ? QString() : lines.join("\n") + "\n";
+}
+
+bool
+Metrics::dump(const QString& path) {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        LOG(ERROR) << "Could not open the metrics file" << path << ":"
+            << file.errorString();
+        return false;
+    }
+    file.write(text().toUtf8());
+    if (!file.commit()) {
+        LOG(ERROR) << "Could not write the metrics file" << path << ":"
+            << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void
+Metrics::clear() {
+    QMutexLocker locker(&_familiesMutex);
+    _families.clear();
+}
+
+QVector<double>
+Metrics::buckets() {
+    return BUCKETS;
+}
+
+QString
+Metrics::bearerName(QNetworkConfiguration::BearerType type) {
+    switch (type) {
+        case QNetworkConfiguration::BearerEthernet:
+            return "ethernet";
+        case QNetworkConfiguration::BearerWLAN:
+            return "wlan";
+        case QNetworkConfiguration::Bearer2G:
+            return "2g";
+        case QNetworkConfiguration::BearerCDMA2000:
+            return "cdma2000";
+        case QNetworkConfiguration::BearerWCDMA:
+            return "wcdma";
+        case QNetworkConfiguration::BearerHSPA:
+            return "hspa";
+        case QNetworkConfiguration::BearerBluetooth:
+            return "bluetooth";
+        case QNetworkConfiguration::BearerWiMAX:
+            return "wimax";
+        case QNetworkConfiguration::BearerEVDO:
+            return "evdo";
+        case QNetworkConfiguration::BearerLTE:
+            return "lte";
+        case QNetworkConfiguration::Bearer3G:
+            return "3g";
+        case QNetworkConfiguration::Bearer4G:
+            return "4g";
+        default:
+            return "unknown";
+    }
+}
+
+QString
+Metrics::errorName(QNetworkReply::NetworkError code) {
+    auto metaObject = &QNetworkReply::staticMetaObject;
+    auto index = metaObject->indexOfEnumerator("NetworkError");
+    if (index >= 0) {
+        auto key = metaObject->enumerator(index).valueToKey(code);
+        if (key != nullptr) {
+            return QString::fromLatin1(key);
+        }
+    }
+    return QString::number(static_cast<int>(code));
+}
+
+Metrics::Series*
+Metrics::series(const QString& name,
+                Type type,
+                const MetricLabels& labels,
+                bool create) {
+    // the caller holds the lock of the families
+    if (!_families.contains(name)) {
+        if (!create) {
+            return nullptr;
+        }
+        _families[name].type = type;
+    }
+
+    auto& family = _families[name];
+    if (family.type != type) {
+        LOG(ERROR) << "Metric" << name << "is a"
+            << TYPE_NAMES[family.type] << "not a" << TYPE_NAMES[type];
+        return nullptr;
+    }
+
+    auto key = labelsText(labels);
+    if (!create && !family.series.contains(key)) {
+        return nullptr;
+    }
+    return &family.series[key];
+}
+
+QList<QPair<QString, QVariant>>
+Metrics::familySamples(const QString& name, const Family& family) {
+    QList<QPair<QString, QVariant>> result;
+    foreach(const QString& labels, family.series.keys()) {
+        auto current = family.series[labels];
+        switch (family.type) {
+            case COUNTER:
+                result << qMakePair(sampleKey(name, labels),
+                    QVariant(current.count));
+                break;
+            case GAUGE:
+                result << qMakePair(sampleKey(name, labels),
+                    QVariant(current.value));
+                break;
+            case HISTOGRAM: {
+                // the buckets of the exposition are cumulative
+                auto prefix = labels.isEmpty() ? labels : labels + ",";
+                qulonglong cumulative = 0;
+                for (int index = 0; index < BUCKETS.count(); index++) {
+                    cumulative += current.buckets.value(index);
+                    auto bucketLabels = QString("%1%2=\"%3\"").arg(prefix)
+                        .arg(BUCKET_LABEL).arg(BUCKETS[index]);
+                    result << qMakePair(
+                        sampleKey(name + BUCKET_SUFFIX, bucketLabels),
+                        QVariant(cumulative));
+                }
+                auto infLabels = QString("%1%2=\"%3\"").arg(prefix)
+                    .arg(BUCKET_LABEL).arg(INF_BUCKET);
+                result << qMakePair(sampleKey(name + BUCKET_SUFFIX, infLabels),
+                    QVariant(current.count));
+                result << qMakePair(sampleKey(name + SUM_SUFFIX, labels),
+                    QVariant(current.sum));
+                result << qMakePair(sampleKey(name + COUNT_SUFFIX, labels),
+                    QVariant(current.count));
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+QString
+Metrics::labelsText(const MetricLabels& labels) {
+    // QMap keeps the labels sorted, the same labels are the same series
+    QStringList pairs;
+    foreach(const QString& label, labels.keys()) {
+        pairs << QString("%1=\"%2\"").arg(label).arg(escape(labels[label]));
+    }
+    return pairs.join(",");
+}
+
+QString
+Metrics::sampleKey(const QString& name, const QString& labels) {
+    if (labels.isEmpty()) {
+        return name;
+    }
+    return name + "{" + labels + "}";
+}
+
+Metrics*
+Metrics::instance() {
+    if(_instance == nullptr) {
+        _mutex.lock();
+        if(_instance == nullptr)
+            _instance = new Metrics();
+        _mutex.unlock();
+    }
+    return _instance;
+}
+
+void
+Metrics::setInstance(Metrics* instance) {
+    _instance = instance;
+}
+
+void
+Metrics::deleteInstance() {
+    if(_instance != nullptr) {
+        _mutex.lock();
+        if(_instance != nullptr) {
+            delete _instance;
+            _instance = nullptr;
+        }
+        _mutex.unlock();
+    }
+}
+
+MetricsTimer::MetricsTimer(const QString& name, const MetricLabels& labels)
+    : _name(name),
+      _labels(labels) {
+    _timer.start();
+}
+
+MetricsTimer::~MetricsTimer() {
+    Metrics::instance()->observe(_name, _labels,
+        _timer.nsecsElapsed() / 1000000000.0);
+}
+
+DBusCallTimer::DBusCallTimer(const QString& method)
+    : MetricsTimer(DBUS_CALL_METRIC, {{METHOD_LABEL, method}}) {
+}
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
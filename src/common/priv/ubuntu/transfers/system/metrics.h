@@ -0,0 +1,149 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TRANSFERS_LIB_METRICS_H
+#define TRANSFERS_LIB_METRICS_H
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QMutex>
+#include <QNetworkConfiguration>
+#include <QNetworkReply>
+#include <QPair>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+typedef QMap<QString, QString> MetricLabels;
+
+// Counters, gauges and histograms of the daemon. The samples are exposed
+// over D-Bus and can be dumped using the text exposition format of
+// prometheus so that they can be scraped by the fleet tooling.
+class Metrics {
+
+ public:
+    Metrics();
+    virtual ~Metrics();
+
+    virtual void increment(const QString& name,
+                           const MetricLabels& labels = MetricLabels(),
+                           qulonglong value = 1);
+    virtual void setGauge(const QString& name,
+                          const MetricLabels& labels,
+                          qlonglong value);
+    // histograms are in seconds and all of them use the same buckets
+    virtual void observe(const QString& name,
+                         const MetricLabels& labels,
+                         double seconds);
+
+    virtual qulonglong counter(const QString& name,
+                               const MetricLabels& labels = MetricLabels());
+    virtual qlonglong gauge(const QString& name,
+                            const MetricLabels& labels = MetricLabels());
+    virtual qulonglong observations(const QString& name,
+                                    const MetricLabels& labels = MetricLabels());
+
+    // the values keyed by the series as they are written in the text
+    virtual QVariantMap samples();
+    virtual QString text();
+    // the file is replaced at once, a scraper never reads half a dump
+    virtual bool dump(const QString& path);
+    virtual void clear();
+
+    static QVector<double> buckets();
+    static QString bearerName(QNetworkConfiguration::BearerType type);
+    static QString errorName(QNetworkReply::NetworkError code);
+
+    static Metrics* instance();
+
+    // only used for testing so that we can inject a fake
+    static void setInstance(Metrics* instance);
+    static void deleteInstance();
+
+ private:
+    enum Type {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    struct Series {
+        qulonglong count = 0;  // value of counters, observations otherwise
+        qlonglong value = 0;
+        double sum = 0;
+        QVector<qulonglong> buckets;  // not cumulative
+    };
+
+    struct Family {
+        Type type = COUNTER;
+        QMap<QString, Series> series;  // keyed by the labels
+    };
+
+    Series* series(const QString& name,
+                   Type type,
+                   const MetricLabels& labels,
+                   bool create);
+    QList<QPair<QString, QVariant>> familySamples(const QString& name,
+                                                  const Family& family);
+
+    static QString labelsText(const MetricLabels& labels);
+    static QString sampleKey(const QString& name, const QString& labels);
+
+ private:
+    // used for the singleton
+    static Metrics* _instance;
+    static QMutex _mutex;
+
+    QMutex _familiesMutex;
+    QMap<QString, Family> _families;  // sorted so that dumps are stable
+};
+
+// Observes the seconds spent in the scope in a histogram.
+class MetricsTimer {
+
+ public:
+    MetricsTimer(const QString& name,
+                 const MetricLabels& labels = MetricLabels());
+    ~MetricsTimer();
+
+ private:
+    QString _name;
+    MetricLabels _labels;
+    QElapsedTimer _timer;
+};
+
+// Latency of a method called over D-Bus, used by the adaptors.
+class DBusCallTimer : public MetricsTimer {
+
+ public:
+    explicit DBusCallTimer(const QString& method);
+};
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
+
+#endif  // TRANSFERS_LIB_METRICS_H
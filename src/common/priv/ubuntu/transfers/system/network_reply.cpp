@@ -46,6 +46,12 @@ NetworkReply::NetworkReply(QNetworkReply* reply, QObject* parent)
         CHECK(connect(_reply, &QNetworkReply::sslErrors,
             this, &NetworkReply::sslErrors))
                 << "Could not connect to signal";
+        CHECK(connect(_reply, &QNetworkReply::encrypted,
+            this, &NetworkReply::encrypted))
+                << "Could not connect to signal";
+        CHECK(connect(_reply, &QNetworkReply::metaDataChanged,
+            this, &NetworkReply::metaDataChanged))
+                << "Could not connect to signal";
 	// because error is overloaded we need to help the compiler
 	CHECK(connect(_reply, static_cast<void(QNetworkReply::*)
 	    (QNetworkReply::NetworkError)>(&QNetworkReply::error),
@@ -55,7 +61,9 @@ NetworkReply::NetworkReply(QNetworkReply* reply, QObject* parent)
 }
 
 NetworkReply::~NetworkReply() {
-    _reply->deleteLater();
+    if (_reply != nullptr) {
+        _reply->deleteLater();
+    }
 }
 
 QByteArray
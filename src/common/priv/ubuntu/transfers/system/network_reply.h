@@ -55,6 +55,10 @@ class NetworkReply : public QObject {
     void error(QNetworkReply::NetworkError code);
     void finished();
     void sslErrors(const QList<QSslError>& errors);
+    // the tls handshake is done
+    void encrypted();
+    // the headers of the response arrived
+    void metaDataChanged();
 
  private:
     QList<QSslCertificate> _certs;
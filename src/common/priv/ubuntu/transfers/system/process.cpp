@@ -59,6 +59,12 @@ Process::start(const QString& program,
     _process->start(program, arguments, mode);
 }
 
+void
+Process::kill() {
+    LOG(INFO) << __FUNCTION__ << _process->program();
+    _process->kill();
+}
+
 QString
 Process::program() const {
     return _process->program();
@@ -38,6 +38,8 @@ class Process : public QObject {
                        const QStringList& arguments,
                        QProcess::OpenMode mode = QProcess::ReadWrite);
 
+    virtual void kill();
+
     virtual QStringList arguments() const;
     virtual QString program() const;
     virtual QByteArray readAllStandardOutput();
@@ -0,0 +1,242 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QTimer>
+#include <glog/logging.h>
+#include <ubuntu/transfers/system/logger.h>
+#include "process_queue.h"
+
+namespace {
+    // post processing is mostly io bound, a couple of processes keep the
+    // device busy without starving the rest of the system
+    const int DEFAULT_MAX_CONCURRENCY = 2;
+}
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+ProcessQueue* ProcessQueue::_instance = nullptr;
+QMutex ProcessQueue::_mutex;
+
+ProcessQueue::ProcessQueue(QObject* parent)
+    : QObject(parent),
+      _maxConcurrency(DEFAULT_MAX_CONCURRENCY) {
+    qRegisterMetaType<ProcessMetrics>("ProcessMetrics");
+}
+
+ProcessQueue::~ProcessQueue() {
+    qDeleteAll(_pending);
+    qDeleteAll(_running);
+}
+
+void
+ProcessQueue::enqueue(Process* process,
+                      const QString& program,
+                      const QStringList& arguments,
+                      int priority) {
+    TRACE << program << arguments << priority;
+    auto job = new Job();
+    job->process = process;
+    job->program = program;
+    job->arguments = arguments;
+    job->priority = priority;
+    job->clock.start();
+
+    CHECK(connect(process, &Process::finished,
+        this, &ProcessQueue::onProcessFinished))
+            << "Could not connect to signal";
+    CHECK(connect(process, &Process::error,
+        this, &ProcessQueue::onProcessError))
+            << "Could not connect to signal";
+    CHECK(connect(process, &QObject::destroyed,
+        this, &ProcessQueue::onProcessDestroyed))
+            << "Could not connect to signal";
+
+    // keep the jobs with the same priority in FIFO order
+    int index = 0;
+    while (index < _pending.count()
+            && _pending[index]->priority >= priority) {
+        index++;
+    }
+    _pending.insert(index, job);
+
+    startPending();
+}
+
+int
+ProcessQueue::maxConcurrency() const {
+    return _maxConcurrency;
+}
+
+void
+ProcessQueue::setMaxConcurrency(int max) {
+    _maxConcurrency = qMax(1, max);
+    startPending();
+}
+
+int
+ProcessQueue::timeout() const {
+    return _timeout;
+}
+
+void
+ProcessQueue::setTimeout(int msecs) {
+    _timeout = qMax(0, msecs);
+}
+
+int
+ProcessQueue::running() const {
+    return _running.count();
+}
+
+int
+ProcessQueue::pending() const {
+    return _pending.count();
+}
+
+void
+ProcessQueue::startPending() {
+    while (!_pending.isEmpty() && _running.count() < _maxConcurrency) {
+        auto job = _pending.takeFirst();
+        job->queueWait = job->clock.restart();
+        _running[job->process] = job;
+
+        if (_timeout > 0) {
+            job->timer = new QTimer(this);
+            job->timer->setSingleShot(true);
+            auto process = job->process;
+            CHECK(connect(job->timer, &QTimer::timeout, this,
+                [this, process]() {
+                    if (_running.contains(process)) {
+                        LOG(WARNING) << "Killing" << _running[process]->program
+                            << "after" << _timeout << "msecs";
+                        _running[process]->timedOut = true;
+                        process->kill();
+                    }
+                })) << "Could not connect to signal";
+            job->timer->start(_timeout);
+        }
+
+        LOG(INFO) << "Starting" << job->program << "after waiting"
+            << job->queueWait << "msecs," << _running.count() << "running"
+            << _pending.count() << "pending";
+        job->process->start(job->program, job->arguments);
+    }
+}
+
+void
+ProcessQueue::complete(Process* process, int exitCode) {
+    if (!_running.contains(process)) {
+        return;
+    }
+
+    auto job = _running.take(process);
+    disconnect(process, nullptr, this, nullptr);
+
+    ProcessMetrics metrics;
+    metrics.program = job->program;
+    metrics.priority = job->priority;
+    metrics.queueWait = job->queueWait;
+    metrics.runTime = job->clock.elapsed();
+    metrics.exitCode = exitCode;
+    metrics.timedOut = job->timedOut;
+
+    LOG(INFO) << "Process" << metrics.program << "exited with"
+        << metrics.exitCode << "queue wait" << metrics.queueWait
+        << "msecs run time" << metrics.runTime << "msecs";
+
+    if (job->timer != nullptr) {
+        job->timer->stop();
+        job->timer->deleteLater();
+    }
+    delete job;
+
+    emit processCompleted(metrics);
+    startPending();
+}
+
+void
+ProcessQueue::onProcessDestroyed(QObject* object) {
+    // the owner of the process can delete it at any point, ensure that we
+    // do not leak the slot nor start a deleted process
+    for (int index = 0; index < _pending.count(); index++) {
+        if (_pending[index]->process == object) {
+            delete _pending.takeAt(index);
+            return;
+        }
+    }
+
+    if (_running.contains(object)) {
+        auto job = _running.take(object);
+        if (job->timer != nullptr) {
+            job->timer->deleteLater();
+        }
+        delete job;
+        startPending();
+    }
+}
+
+void
+ProcessQueue::onProcessError(QProcess::ProcessError error) {
+    // all other errors are followed by the finished signal
+    if (error == QProcess::FailedToStart) {
+        complete(qobject_cast<Process*>(sender()), -1);
+    }
+}
+
+void
+ProcessQueue::onProcessFinished(int exitCode, QProcess::ExitStatus) {
+    complete(qobject_cast<Process*>(sender()), exitCode);
+}
+
+ProcessQueue*
+ProcessQueue::instance() {
+    if(_instance == nullptr) {
+        _mutex.lock();
+        if(_instance == nullptr)
+            _instance = new ProcessQueue();
+        _mutex.unlock();
+    }
+    return _instance;
+}
+
+void
+ProcessQueue::setInstance(ProcessQueue* instance) {
+    _instance = instance;
+}
+
+void
+ProcessQueue::deleteInstance() {
+    if(_instance != nullptr) {
+        _mutex.lock();
+        if(_instance != nullptr) {
+            delete _instance;
+            _instance = nullptr;
+        }
+        _mutex.unlock();
+    }
+}
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
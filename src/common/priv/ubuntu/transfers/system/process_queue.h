@@ -0,0 +1,120 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_PROCESS_QUEUE_H
+#define DOWNLOADER_LIB_PROCESS_QUEUE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMetaType>
+#include <QMutex>
+#include <QObject>
+#include <QProcess>
+#include <QStringList>
+#include "process.h"
+
+class QTimer;
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+struct ProcessMetrics {
+    QString program;
+    int priority = 0;
+    qint64 queueWait = 0;  // msecs between enqueue and start
+    qint64 runTime = 0;  // msecs between start and finish
+    int exitCode = 0;
+    bool timedOut = false;
+};
+
+// Bounded executor for the processes that are ran once a transfer is
+// completed. Processes are started in priority order, with the same
+// priority in FIFO order, never exceeding the max concurrency.
+class ProcessQueue : public QObject {
+    Q_OBJECT
+
+ public:
+    explicit ProcessQueue(QObject* parent = 0);
+    virtual ~ProcessQueue();
+
+    virtual void enqueue(Process* process,
+                         const QString& program,
+                         const QStringList& arguments,
+                         int priority = 0);
+
+    virtual int maxConcurrency() const;
+    virtual void setMaxConcurrency(int max);
+
+    // msecs a process is allowed to run, 0 means no timeout
+    virtual int timeout() const;
+    virtual void setTimeout(int msecs);
+
+    virtual int running() const;
+    virtual int pending() const;
+
+    static ProcessQueue* instance();
+
+    // only used for testing so that we can inject a fake
+    static void setInstance(ProcessQueue* instance);
+    static void deleteInstance();
+
+ signals:
+    void processCompleted(const ProcessMetrics& metrics);
+
+ private:
+    struct Job {
+        Process* process = nullptr;
+        QString program;
+        QStringList arguments;
+        int priority = 0;
+        qint64 queueWait = 0;
+        bool timedOut = false;
+        QElapsedTimer clock;
+        QTimer* timer = nullptr;
+    };
+
+    void startPending();
+    void complete(Process* process, int exitCode);
+    void onProcessDestroyed(QObject* object);
+    void onProcessError(QProcess::ProcessError error);
+    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+ private:
+    // used for the singleton
+    static ProcessQueue* _instance;
+    static QMutex _mutex;
+
+    int _maxConcurrency;
+    int _timeout = 0;
+    QList<Job*> _pending;
+    QHash<QObject*, Job*> _running;
+};
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
+
+Q_DECLARE_METATYPE(Ubuntu::Transfers::System::ProcessMetrics)
+
+#endif  // DOWNLOADER_LIB_PROCESS_QUEUE_H
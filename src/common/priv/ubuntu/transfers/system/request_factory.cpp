@@ -19,6 +19,7 @@
 #include <ubuntu/transfers/system/logger.h>
 #include <glog/logging.h>
 #include "request_factory.h"
+#include "threaded_request_factory.h"
 
 namespace Ubuntu {
 
@@ -28,6 +29,7 @@ namespace System {
 
 RequestFactory* RequestFactory::_instance = nullptr;
 bool RequestFactory::_isStoppable = false;
+int RequestFactory::_networkThreads = 0;
 QMutex RequestFactory::_mutex;
 
 RequestFactory::RequestFactory(bool stoppable, QObject* parent)
@@ -37,9 +39,7 @@ RequestFactory::RequestFactory(bool stoppable, QObject* parent)
 }
 
 NetworkReply*
-RequestFactory::buildRequest(QNetworkReply* qreply) {
-    NetworkReply* reply = new NetworkReply(qreply);
-
+RequestFactory::trackReply(NetworkReply* reply) {
     if (_certs.count() > 0) {
         reply->setAcceptedCertificates(_certs);
     }
@@ -66,19 +66,19 @@ RequestFactory::buildRequest(QNetworkReply* qreply) {
 NetworkReply*
 RequestFactory::get(const QNetworkRequest& request) {
     auto qreply = _nam->get(request);
-    return buildRequest(qreply);
+    return trackReply(new NetworkReply(qreply));
 }
 
 NetworkReply*
 RequestFactory::post(const QNetworkRequest& request, File* data) {
     auto qreply = _nam->post(request, data->device());
-    return buildRequest(qreply);
+    return trackReply(new NetworkReply(qreply));
 }
 
 NetworkReply*
 RequestFactory::put(const QNetworkRequest& request, File* data) {
     auto qreply = _nam->put(request, data->device());
-    return buildRequest(qreply);
+    return trackReply(new NetworkReply(qreply));
 }
 
 QList<QSslCertificate>
@@ -95,8 +95,14 @@ RequestFactory*
 RequestFactory::instance() {
     if(_instance == nullptr) {
         _mutex.lock();
-        if(_instance == nullptr)
-            _instance = new RequestFactory(_isStoppable);
+        if(_instance == nullptr) {
+            if (_networkThreads > 0) {
+                _instance = new ThreadedRequestFactory(_networkThreads,
+                    _isStoppable);
+            } else {
+                _instance = new RequestFactory(_isStoppable);
+            }
+        }
         _mutex.unlock();
     }
     return _instance;
@@ -107,6 +113,11 @@ RequestFactory::setStoppable(bool stoppable) {
     _isStoppable = stoppable;
 }
 
+void
+RequestFactory::setNetworkThreads(int threads) {
+    _networkThreads = qMax(0, threads);
+}
+
 void
 RequestFactory::setInstance(RequestFactory* instance) {
     _instance = instance;
@@ -131,11 +142,16 @@ RequestFactory::removeNetworkReply(NetworkReply* reply) {
         // stoppable is not really needed but is better check
         if (_stoppable && _replies.count() == 0) {
             LOG(INFO) << "Clearing the connections cache.";
-            _nam->clearAccessCache();
+            clearAccessCache();
         }
     }
 }
 
+void
+RequestFactory::clearAccessCache() {
+    _nam->clearAccessCache();
+}
+
 void
 RequestFactory::onError(QNetworkReply::NetworkError) {
     NetworkReply* senderObj = qobject_cast<NetworkReply*>(sender());
@@ -48,6 +48,9 @@ class RequestFactory : public QObject {
 
     static RequestFactory* instance();
     static void setStoppable(bool stoppable);
+    // number of threads used for the network io, 0 uses the main thread.
+    // Must be set before the instance is created.
+    static void setNetworkThreads(int threads);
 
     // only used for testing purposes
     static void setInstance(RequestFactory* instance);
@@ -56,9 +59,12 @@ class RequestFactory : public QObject {
  protected:
     RequestFactory(bool stoppable = false, QObject *parent = 0);
 
+    // configures the reply and keeps track of it when stoppable
+    NetworkReply* trackReply(NetworkReply* reply);
+    virtual void clearAccessCache();
+
  private:
     void removeNetworkReply(NetworkReply* reply);
-    NetworkReply* buildRequest(QNetworkReply* qreply);
 
  private slots:
     void onError(QNetworkReply::NetworkError);
@@ -73,6 +79,7 @@ class RequestFactory : public QObject {
     static RequestFactory* _instance;
     static QMutex _mutex;
     static bool _isStoppable;
+    static int _networkThreads;
 
     // instance vars
     bool _stoppable = false;
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QDateTime>
+#include <QLocale>
+#include <glog/logging.h>
+#include <ubuntu/transfers/system/logger.h>
+#include "retry_policy.h"
+
+namespace {
+    const int DEFAULT_MAX_ATTEMPTS = 5;
+    const int DEFAULT_BASE_DELAY = 1000;
+    const int DEFAULT_MAX_DELAY = 60000;
+    const int DEFAULT_STALL_TIMEOUT = 30000;
+    // do not let a server keep a download waiting for ever
+    const int MAX_RETRY_AFTER = 3600 * 1000;
+    const QString HTTP_DATE_FORMAT = "ddd, dd MMM yyyy hh:mm:ss 'GMT'";
+}
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+RetryPolicy* RetryPolicy::_instance = nullptr;
+QMutex RetryPolicy::_mutex;
+
+RetryPolicy::RetryPolicy(QObject* parent)
+    : QObject(parent),
+      _maxAttempts(DEFAULT_MAX_ATTEMPTS),
+      _baseDelay(DEFAULT_BASE_DELAY),
+      _maxDelay(DEFAULT_MAX_DELAY),
+      _stallTimeout(DEFAULT_STALL_TIMEOUT),
+      _random(std::random_device()()) {
+}
+
+int
+RetryPolicy::maxAttempts() const {
+    return _maxAttempts;
+}
+
+void
+RetryPolicy::setMaxAttempts(int attempts) {
+    _maxAttempts = qMax(0, attempts);
+}
+
+int
+RetryPolicy::baseDelay() const {
+    return _baseDelay;
+}
+
+void
+RetryPolicy::setBaseDelay(int msecs) {
+    _baseDelay = qMax(0, msecs);
+}
+
+int
+RetryPolicy::maxDelay() const {
+    return _maxDelay;
+}
+
+void
+RetryPolicy::setMaxDelay(int msecs) {
+    _maxDelay = qMax(0, msecs);
+}
+
+bool
+RetryPolicy::isTransient(QNetworkReply::NetworkError code,
+                         int httpStatus) const {
+    if (httpStatus > 0) {
+        switch (httpStatus) {
+            case 408:  // Request Timeout
+            case 429:  // Too Many Requests
+            case 502:  // Bad Gateway
+            case 503:  // Service Unavailable
+            case 504:  // Gateway Timeout
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    switch (code) {
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::NetworkSessionFailedError:
+        case QNetworkReply::ProxyTimeoutError:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int
+RetryPolicy::delay(int attempt, const QByteArray& retryAfter) {
+    auto serverDelay = parseRetryAfter(retryAfter);
+    if (serverDelay >= 0) {
+        return serverDelay;
+    }
+
+    // base * 2^attempt without overflowing, the jitter picks a value in
+    // the upper half so that the clients that failed at the same time
+    // do not retry at the same time
+    qint64 backoff = _baseDelay;
+    for (int index = 0; index < attempt && backoff < _maxDelay; index++) {
+        backoff *= 2;
+    }
+    backoff = qMin<qint64>(backoff, _maxDelay);
+
+    std::uniform_int_distribution<qint64> jitter(backoff / 2, backoff);
+    return static_cast<int>(jitter(_random));
+}
+
+int
+RetryPolicy::stallTimeout() const {
+    return _stallTimeout;
+}
+
+void
+RetryPolicy::setStallTimeout(int msecs) {
+    _stallTimeout = qMax(0, msecs);
+}
+
+qulonglong
+RetryPolicy::stallSpeed() const {
+    return _stallSpeed;
+}
+
+void
+RetryPolicy::setStallSpeed(qulonglong speed) {
+    _stallSpeed = speed;
+}
+
+bool
+RetryPolicy::isStalled(qulonglong received, int msecs,
+                       qulonglong throttle) const {
+    if (received == 0) {
+        return true;
+    }
+
+    // a throttled download is allowed to be as slow as the client asked
+    auto minSpeed = (throttle > 0)? qMin(throttle, _stallSpeed) : _stallSpeed;
+    auto speed = received * 1000 / qMax(1, msecs);
+    return speed < minSpeed;
+}
+
+int
+RetryPolicy::parseRetryAfter(const QByteArray& retryAfter) const {
+    auto value = retryAfter.trimmed();
+    if (value.isEmpty()) {
+        return -1;
+    }
+
+    // the header is either a number of secs or an http date
+    bool ok = false;
+    auto secs = value.toLongLong(&ok);
+    if (ok) {
+        return (secs < 0)? -1 : static_cast<int>(
+            qMin<qint64>(secs * 1000, MAX_RETRY_AFTER));
+    }
+
+    auto date = QLocale::c().toDateTime(QString::fromLatin1(value),
+        HTTP_DATE_FORMAT);
+    if (!date.isValid()) {
+        LOG(WARNING) << "Could not parse Retry-After value " << value;
+        return -1;
+    }
+    date.setTimeSpec(Qt::UTC);
+    auto msecs = QDateTime::currentDateTimeUtc().msecsTo(date);
+    return static_cast<int>(qBound<qint64>(0, msecs, MAX_RETRY_AFTER));
+}
+
+RetryPolicy*
+RetryPolicy::instance() {
+    if(_instance == nullptr) {
+        _mutex.lock();
+        if(_instance == nullptr)
+            _instance = new RetryPolicy();
+        _mutex.unlock();
+    }
+    return _instance;
+}
+
+void
+RetryPolicy::setInstance(RetryPolicy* instance) {
+    _instance = instance;
+}
+
+void
+RetryPolicy::deleteInstance() {
+    if(_instance != nullptr) {
+        _mutex.lock();
+        if(_instance != nullptr) {
+            delete _instance;
+            _instance = nullptr;
+        }
+        _mutex.unlock();
+    }
+}
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_RETRY_POLICY_H
+#define DOWNLOADER_LIB_RETRY_POLICY_H
+
+#include <random>
+#include <QByteArray>
+#include <QMutex>
+#include <QNetworkReply>
+#include <QObject>
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+// Decides which network errors are worth retrying and how long to wait
+// before each attempt using an exponential backoff with jitter, as well
+// as when a connection that does not report errors is stalled.
+class RetryPolicy : public QObject {
+    Q_OBJECT
+
+ public:
+    explicit RetryPolicy(QObject* parent = 0);
+
+    // max number of consecutive retries, 0 disables them
+    virtual int maxAttempts() const;
+    virtual void setMaxAttempts(int attempts);
+
+    // msecs used to calculate the backoff
+    virtual int baseDelay() const;
+    virtual void setBaseDelay(int msecs);
+    virtual int maxDelay() const;
+    virtual void setMaxDelay(int msecs);
+
+    // httpStatus is 0 when the error did not come from the server
+    virtual bool isTransient(QNetworkReply::NetworkError code,
+                             int httpStatus) const;
+
+    // msecs to wait before the given attempt (starting at 0), a valid
+    // Retry-After value sent by the server takes precedence
+    virtual int delay(int attempt,
+                      const QByteArray& retryAfter = QByteArray());
+
+    // msecs used to measure the progress of a connection, 0 disables the
+    // stall detection
+    virtual int stallTimeout() const;
+    virtual void setStallTimeout(int msecs);
+
+    // bytes per second under which a connection is stalled, 0 means
+    // that only connections that receive no data at all are
+    virtual qulonglong stallSpeed() const;
+    virtual void setStallSpeed(qulonglong speed);
+
+    // received is the number of bytes that arrived in the last msecs
+    virtual bool isStalled(qulonglong received, int msecs,
+                           qulonglong throttle) const;
+
+    static RetryPolicy* instance();
+
+    // only used for testing so that we can inject a fake
+    static void setInstance(RetryPolicy* instance);
+    static void deleteInstance();
+
+ private:
+    int parseRetryAfter(const QByteArray& retryAfter) const;
+
+ private:
+    // used for the singleton
+    static RetryPolicy* _instance;
+    static QMutex _mutex;
+
+    int _maxAttempts;
+    int _baseDelay;
+    int _maxDelay;
+    int _stallTimeout;
+    qulonglong _stallSpeed = 0;
+    std::mt19937 _random;
+};
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_RETRY_POLICY_H
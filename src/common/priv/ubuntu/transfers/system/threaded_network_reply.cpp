@@ -0,0 +1,342 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QFile>
+#include <glog/logging.h>
+#include <ubuntu/transfers/system/logger.h>
+#include "threaded_network_reply.h"
+
+namespace {
+    // attributes that the transfers query once the reply has data
+    const QList<QNetworkRequest::Attribute> FORWARDED_ATTRIBUTES {
+        QNetworkRequest::HttpStatusCodeAttribute,
+        QNetworkRequest::HttpReasonPhraseAttribute,
+        QNetworkRequest::RedirectionTargetAttribute,
+        QNetworkRequest::ConnectionEncryptedAttribute,
+        QNetworkRequest::SourceIsFromCacheAttribute,
+    };
+    const QString CANCELED_ERROR = "Operation canceled";
+    // data forwarded to the main thread and not read yet when the transfer
+    // does not limit its read buffer
+    const qint64 FORWARD_WINDOW = 1024 * 1024;
+}
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+ReplyForwarder::ReplyForwarder(QNetworkAccessManager* nam,
+                               QNetworkAccessManager::Operation operation,
+                               const QNetworkRequest& request,
+                               const QString& uploadPath,
+                               const QList<QSslError>& expectedSslErrors)
+    : QObject(),
+      _nam(nam),
+      _operation(operation),
+      _request(request),
+      _uploadPath(uploadPath),
+      _expectedSslErrors(expectedSslErrors) {
+}
+
+void
+ReplyForwarder::start() {
+    // the data of the uploads is read in this thread, not through the
+    // device used by the transfer
+    QIODevice* data = nullptr;
+    if (!_uploadPath.isEmpty()) {
+        data = new QFile(_uploadPath, this);
+        if (!data->open(QIODevice::ReadOnly)) {
+            LOG(ERROR) << "Could not open" << _uploadPath;
+        }
+    }
+
+    switch (_operation) {
+        case QNetworkAccessManager::PostOperation:
+            _reply = _nam->post(_request, data);
+            break;
+        case QNetworkAccessManager::PutOperation:
+            _reply = _nam->put(_request, data);
+            break;
+        default:
+            _reply = _nam->get(_request);
+    }
+    _reply->setParent(this);
+    _reply->setReadBufferSize(forwardWindow());
+
+    // the ssl errors are emitted in this thread and cannot wait for the
+    // transfer, the accepted certificates are ignored up front
+    if (!_expectedSslErrors.isEmpty()) {
+        _reply->ignoreSslErrors(_expectedSslErrors);
+    }
+
+    CHECK(connect(_reply, &QNetworkReply::metaDataChanged,
+        this, &ReplyForwarder::forwardMetaData))
+            << "Could not connect to signal";
+    CHECK(connect(_reply, &QNetworkReply::downloadProgress,
+        this, &ReplyForwarder::onDownloadProgress))
+            << "Could not connect to signal";
+    CHECK(connect(_reply, &QNetworkReply::uploadProgress,
+        this, &ReplyForwarder::uploadProgress))
+            << "Could not connect to signal";
+    CHECK(connect(_reply, &QNetworkReply::sslErrors,
+        this, &ReplyForwarder::sslErrors))
+            << "Could not connect to signal";
+    CHECK(connect(_reply, &QNetworkReply::encrypted,
+        this, &ReplyForwarder::encrypted))
+            << "Could not connect to signal";
+    CHECK(connect(_reply, &QNetworkReply::finished,
+        this, &ReplyForwarder::onFinished))
+            << "Could not connect to signal";
+    CHECK(connect(_reply, static_cast<void(QNetworkReply::*)
+        (QNetworkReply::NetworkError)>(&QNetworkReply::error),
+            this, &ReplyForwarder::onError))
+                << "Could not connect to signal";
+}
+
+void
+ReplyForwarder::abort() {
+    if (_reply != nullptr) {
+        // the reply in the main thread already emitted the signals
+        disconnect(_reply, nullptr, this, nullptr);
+        _reply->abort();
+    }
+}
+
+void
+ReplyForwarder::setReadBufferSize(qint64 size) {
+    _readBufferSize = size;
+    if (_reply != nullptr) {
+        _reply->setReadBufferSize(forwardWindow());
+        forwardPendingData();
+    }
+}
+
+void
+ReplyForwarder::dataRead(qint64 size) {
+    _inFlight -= size;
+    if (_reply != nullptr) {
+        forwardPendingData();
+    }
+}
+
+qint64
+ReplyForwarder::forwardWindow() const {
+    return (_readBufferSize > 0)? _readBufferSize : FORWARD_WINDOW;
+}
+
+bool
+ReplyForwarder::forwardData(qint64 size) {
+    size = qMin(size, _reply->bytesAvailable());
+    if (size <= 0) {
+        return false;
+    }
+    auto data = _reply->read(size);
+    if (data.isEmpty()) {
+        return false;
+    }
+    _inFlight += data.size();
+    emit dataAvailable(data);
+    return true;
+}
+
+void
+ReplyForwarder::forwardPendingData() {
+    // the transfer reads the data when the progress is notified, the data
+    // left in the reply is sent once it made room for it
+    if (forwardData(forwardWindow() - _inFlight)) {
+        emit downloadProgress(_bytesReceived, _bytesTotal);
+    }
+}
+
+void
+ReplyForwarder::forwardMetaData() {
+    ReplyMetaData metaData;
+    foreach(QNetworkRequest::Attribute code, FORWARDED_ATTRIBUTES) {
+        auto value = _reply->attribute(code);
+        if (value.isValid()) {
+            metaData.attributes[code] = value;
+        }
+    }
+    metaData.headers = _reply->rawHeaderPairs();
+    metaData.errorString = _reply->errorString();
+    emit metaDataChanged(metaData);
+}
+
+void
+ReplyForwarder::onDownloadProgress(qint64 bytesReceived,
+                                   qint64 bytesTotal) {
+    _bytesReceived = bytesReceived;
+    _bytesTotal = bytesTotal;
+    // the data must be in the main thread before the progress is
+    // notified, queued signals keep their order. Only the data that fits
+    // in the window is sent, the reply stops reading the socket once its
+    // own buffer is full
+    forwardData(forwardWindow() - _inFlight);
+    emit downloadProgress(bytesReceived, bytesTotal);
+}
+
+void
+ReplyForwarder::onError(QNetworkReply::NetworkError code) {
+    forwardMetaData();
+    emit error(code);
+}
+
+void
+ReplyForwarder::onFinished() {
+    // the reply only finishes once its buffer took the rest of the data,
+    // the transfers read all of it when the reply is finished
+    forwardData(_reply->bytesAvailable());
+    forwardMetaData();
+    emit finished();
+}
+
+ThreadedNetworkReply::ThreadedNetworkReply(ReplyForwarder* forwarder,
+                                           QObject* parent)
+    : NetworkReply(nullptr, parent),
+      _forwarder(forwarder) {
+    CHECK(connect(_forwarder, &ReplyForwarder::dataAvailable,
+        this, &ThreadedNetworkReply::onDataAvailable))
+            << "Could not connect to signal";
+    CHECK(connect(_forwarder, &ReplyForwarder::metaDataChanged,
+        this, &ThreadedNetworkReply::onMetaDataChanged))
+            << "Could not connect to signal";
+    CHECK(connect(_forwarder, &ReplyForwarder::downloadProgress,
+        this, &NetworkReply::downloadProgress))
+            << "Could not connect to signal";
+    CHECK(connect(_forwarder, &ReplyForwarder::uploadProgress,
+        this, &NetworkReply::uploadProgress))
+            << "Could not connect to signal";
+    CHECK(connect(_forwarder, &ReplyForwarder::sslErrors,
+        this, &NetworkReply::sslErrors))
+            << "Could not connect to signal";
+    CHECK(connect(_forwarder, &ReplyForwarder::encrypted,
+        this, &NetworkReply::encrypted))
+            << "Could not connect to signal";
+    CHECK(connect(_forwarder, &ReplyForwarder::error,
+        this, &NetworkReply::error))
+            << "Could not connect to signal";
+    CHECK(connect(_forwarder, &ReplyForwarder::finished,
+        this, &ThreadedNetworkReply::onFinished))
+            << "Could not connect to signal";
+}
+
+ThreadedNetworkReply::~ThreadedNetworkReply() {
+    // posted to the network thread, the pending reply is aborted there
+    _forwarder->deleteLater();
+}
+
+QByteArray
+ThreadedNetworkReply::readAll() {
+    QByteArray data;
+    data.swap(_data);
+    if (!data.isEmpty()) {
+        // the forwarder resumes once the data left the buffer
+        QMetaObject::invokeMethod(_forwarder, "dataRead",
+            Qt::QueuedConnection, Q_ARG(qint64, data.size()));
+    }
+    return data;
+}
+
+void
+ThreadedNetworkReply::abort() {
+    if (_isFinished) {
+        return;
+    }
+
+    // as QNetworkReply, the signals are emitted before abort returns and
+    // the data that is still on its way is dropped
+    _isFinished = true;
+    disconnect(_forwarder, nullptr, this, nullptr);
+    QMetaObject::invokeMethod(_forwarder, "abort", Qt::QueuedConnection);
+    _metaData.errorString = CANCELED_ERROR;
+    emit error(QNetworkReply::OperationCanceledError);
+    emit finished();
+}
+
+void
+ThreadedNetworkReply::setReadBufferSize(uint size) {
+    QMetaObject::invokeMethod(_forwarder, "setReadBufferSize",
+        Qt::QueuedConnection, Q_ARG(qint64, size));
+}
+
+QVariant
+ThreadedNetworkReply::attribute(QNetworkRequest::Attribute code) const {
+    return _metaData.attributes.value(code);
+}
+
+QString
+ThreadedNetworkReply::errorString() const {
+    return _metaData.errorString;
+}
+
+bool
+ThreadedNetworkReply::hasRawHeader(const QByteArray& headerName) const {
+    // header names are case insensitive
+    auto name = headerName.toLower();
+    foreach(const QNetworkReply::RawHeaderPair& header, _metaData.headers) {
+        if (header.first.toLower() == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QByteArray
+ThreadedNetworkReply::rawHeader(const QByteArray& headerName) const {
+    // as QNetworkReply, repeated headers are joined
+    auto name = headerName.toLower();
+    QList<QByteArray> values;
+    foreach(const QNetworkReply::RawHeaderPair& header, _metaData.headers) {
+        if (header.first.toLower() == name) {
+            values.append(header.second);
+        }
+    }
+    QByteArray result;
+    for (int index = 0; index < values.count(); index++) {
+        if (index > 0) {
+            result.append(", ");
+        }
+        result.append(values[index]);
+    }
+    return result;
+}
+
+void
+ThreadedNetworkReply::onDataAvailable(const QByteArray& data) {
+    _data.append(data);
+}
+
+void
+ThreadedNetworkReply::onMetaDataChanged(const ReplyMetaData& metaData) {
+    _metaData = metaData;
+    emit metaDataChanged();
+}
+
+void
+ThreadedNetworkReply::onFinished() {
+    _isFinished = true;
+    emit finished();
+}
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_THREADED_NETWORK_REPLY_H
+#define DOWNLOADER_LIB_THREADED_NETWORK_REPLY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMetaType>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QSslError>
+#include <QVariant>
+#include "network_reply.h"
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+// state of a reply that is copied from the network thread so that it can
+// be queried without locking
+struct ReplyMetaData {
+    QHash<int, QVariant> attributes;
+    QList<QNetworkReply::RawHeaderPair> headers;
+    QString errorString;
+};
+
+// Lives in a network thread and forwards the data and signals of the
+// QNetworkReply to the ThreadedNetworkReply in the main thread. All the
+// connections between both are queued.
+class ReplyForwarder : public QObject {
+    Q_OBJECT
+
+ public:
+    ReplyForwarder(QNetworkAccessManager* nam,
+                   QNetworkAccessManager::Operation operation,
+                   const QNetworkRequest& request,
+                   const QString& uploadPath = QString(),
+                   const QList<QSslError>& expectedSslErrors = QList<QSslError>());
+
+ public slots:  // NOLINT(whitespace/indent)
+    void start();
+    void abort();
+    void setReadBufferSize(qint64 size);
+    // the main thread read data that was forwarded
+    void dataRead(qint64 size);
+
+ signals:
+    void dataAvailable(const QByteArray& data);
+    void metaDataChanged(const ReplyMetaData& metaData);
+    void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void uploadProgress(qint64 bytesSent, qint64 bytesTotal);
+    void error(QNetworkReply::NetworkError code);
+    void finished();
+    void sslErrors(const QList<QSslError>& errors);
+    void encrypted();
+
+ private:
+    qint64 forwardWindow() const;
+    bool forwardData(qint64 size);
+    void forwardPendingData();
+    void forwardMetaData();
+    void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void onError(QNetworkReply::NetworkError code);
+    void onFinished();
+
+ private:
+    QNetworkAccessManager* _nam;
+    QNetworkAccessManager::Operation _operation;
+    QNetworkRequest _request;
+    QString _uploadPath;
+    QList<QSslError> _expectedSslErrors;
+    qint64 _readBufferSize = 0;
+    qint64 _inFlight = 0;  // forwarded and not read by the main thread
+    qint64 _bytesReceived = 0;
+    qint64 _bytesTotal = 0;
+    QNetworkReply* _reply = nullptr;
+};
+
+// Reply used by the transfers when the network io is done in a worker
+// thread. The data is buffered until it is read by the transfer, at most
+// the read buffer size of the transfer is buffered while it is running.
+class ThreadedNetworkReply : public NetworkReply {
+    Q_OBJECT
+
+ public:
+    explicit ThreadedNetworkReply(ReplyForwarder* forwarder,
+                                  QObject* parent = 0);
+    virtual ~ThreadedNetworkReply();
+
+    QByteArray readAll() override;
+    void abort() override;
+    void setReadBufferSize(uint size) override;
+    QVariant attribute(QNetworkRequest::Attribute code) const override;
+    QString errorString() const override;
+    bool hasRawHeader(const QByteArray& headerName) const override;
+    QByteArray rawHeader(const QByteArray& headerName) const override;
+
+ private:
+    void onDataAvailable(const QByteArray& data);
+    void onMetaDataChanged(const ReplyMetaData& metaData);
+    void onFinished();
+
+ private:
+    ReplyForwarder* _forwarder;
+    QByteArray _data;
+    ReplyMetaData _metaData;
+    bool _isFinished = false;
+};
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
+
+Q_DECLARE_METATYPE(Ubuntu::Transfers::System::ReplyMetaData)
+
+#endif  // DOWNLOADER_LIB_THREADED_NETWORK_REPLY_H
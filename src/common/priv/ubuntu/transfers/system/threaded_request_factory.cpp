@@ -0,0 +1,161 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <glog/logging.h>
+#include <ubuntu/transfers/system/logger.h>
+#include "threaded_network_reply.h"
+#include "threaded_request_factory.h"
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+NetworkWorker::NetworkWorker()
+    : QObject() {
+}
+
+QNetworkAccessManager*
+NetworkWorker::manager() const {
+    return _nam;
+}
+
+void
+NetworkWorker::init() {
+    // created here so that the manager and its sockets belong to the
+    // thread of the worker
+    _nam = new QNetworkAccessManager(this);
+}
+
+void
+NetworkWorker::clearAccessCache() {
+    _nam->clearAccessCache();
+}
+
+ThreadedRequestFactory::ThreadedRequestFactory(int threads,
+                                               bool stoppable,
+                                               QObject* parent)
+    : RequestFactory(stoppable, parent) {
+    qRegisterMetaType<ReplyMetaData>("ReplyMetaData");
+    qRegisterMetaType<QNetworkReply::NetworkError>(
+        "QNetworkReply::NetworkError");
+    qRegisterMetaType<QList<QSslError> >("QList<QSslError>");
+
+    for (int index = 0; index < qMax(1, threads); index++) {
+        auto thread = new QThread(this);
+        thread->setObjectName(QString("network-%1").arg(index));
+        auto worker = new NetworkWorker();
+        worker->moveToThread(thread);
+        CHECK(connect(thread, &QThread::finished,
+            worker, &QObject::deleteLater))
+                << "Could not connect to signal";
+        thread->start();
+        // the manager must exist before the first request is made
+        QMetaObject::invokeMethod(worker, "init",
+            Qt::BlockingQueuedConnection);
+
+        _threads.append(thread);
+        _workers.append(worker);
+        _activeReplies.append(0);
+    }
+    LOG(INFO) << "Using" << _threads.count() << "network threads";
+}
+
+ThreadedRequestFactory::~ThreadedRequestFactory() {
+    foreach(QThread* thread, _threads) {
+        thread->quit();
+        thread->wait();
+    }
+}
+
+NetworkReply*
+ThreadedRequestFactory::get(const QNetworkRequest& request) {
+    return createReply(QNetworkAccessManager::GetOperation, request);
+}
+
+NetworkReply*
+ThreadedRequestFactory::post(const QNetworkRequest& request, File* data) {
+    return createReply(QNetworkAccessManager::PostOperation, request,
+        data->fileName());
+}
+
+NetworkReply*
+ThreadedRequestFactory::put(const QNetworkRequest& request, File* data) {
+    return createReply(QNetworkAccessManager::PutOperation, request,
+        data->fileName());
+}
+
+int
+ThreadedRequestFactory::threads() const {
+    return _threads.count();
+}
+
+void
+ThreadedRequestFactory::clearAccessCache() {
+    foreach(NetworkWorker* worker, _workers) {
+        QMetaObject::invokeMethod(worker, "clearAccessCache",
+            Qt::QueuedConnection);
+    }
+}
+
+int
+ThreadedRequestFactory::leastLoadedWorker() const {
+    int selected = 0;
+    for (int index = 1; index < _activeReplies.count(); index++) {
+        if (_activeReplies[index] < _activeReplies[selected]) {
+            selected = index;
+        }
+    }
+    return selected;
+}
+
+NetworkReply*
+ThreadedRequestFactory::createReply(QNetworkAccessManager::Operation operation,
+                                    const QNetworkRequest& request,
+                                    const QString& uploadPath) {
+    auto index = leastLoadedWorker();
+    auto worker = _workers[index];
+    TRACE << request.url() << "on network thread" << index;
+
+    QList<QSslError> expectedErrors;
+    foreach(const QSslCertificate& certificate, acceptedCertificates()) {
+        expectedErrors.append(QSslError(QSslError::SelfSignedCertificate,
+            certificate));
+    }
+
+    auto forwarder = new ReplyForwarder(worker->manager(), operation,
+        request, uploadPath, expectedErrors);
+    forwarder->moveToThread(_threads[index]);
+    auto reply = new ThreadedNetworkReply(forwarder);
+
+    _activeReplies[index]++;
+    CHECK(connect(reply, &QObject::destroyed, this, [this, index]() {
+            _activeReplies[index]--;
+        })) << "Could not connect to signal";
+
+    // the signals are connected, the request can be made
+    QMetaObject::invokeMethod(forwarder, "start", Qt::QueuedConnection);
+    return trackReply(reply);
+}
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_THREADED_REQUEST_FACTORY_H
+#define DOWNLOADER_LIB_THREADED_REQUEST_FACTORY_H
+
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QObject>
+#include <QThread>
+#include "request_factory.h"
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+// Owns the QNetworkAccessManager of a network thread, its slots are
+// executed in that thread.
+class NetworkWorker : public QObject {
+    Q_OBJECT
+
+ public:
+    NetworkWorker();
+
+    QNetworkAccessManager* manager() const;
+
+ public slots:  // NOLINT(whitespace/indent)
+    void init();
+    void clearAccessCache();
+
+ private:
+    QNetworkAccessManager* _nam = nullptr;
+};
+
+// Request factory that shards the transfers across several network
+// threads, each one with its own access manager and event loop. The
+// replies returned live in the main thread so that the transfers, the
+// D-Bus adaptors and the db are still only used from it.
+class ThreadedRequestFactory : public RequestFactory {
+    Q_OBJECT
+
+ public:
+    explicit ThreadedRequestFactory(int threads,
+                                    bool stoppable = false,
+                                    QObject* parent = 0);
+    virtual ~ThreadedRequestFactory();
+
+    NetworkReply* get(const QNetworkRequest& request) override;
+    NetworkReply* post(const QNetworkRequest& request, File* data) override;
+    NetworkReply* put(const QNetworkRequest& request, File* data) override;
+
+    int threads() const;
+
+ protected:
+    void clearAccessCache() override;
+
+ private:
+    NetworkReply* createReply(QNetworkAccessManager::Operation operation,
+                              const QNetworkRequest& request,
+                              const QString& uploadPath = QString());
+    int leastLoadedWorker() const;
+
+ private:
+    QList<QThread*> _threads;
+    QList<NetworkWorker*> _workers;
+    QList<int> _activeReplies;  // per worker, used to balance the load
+};
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_THREADED_REQUEST_FACTORY_H
@@ -0,0 +1,247 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <chrono>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QVariantMap>
+#include <unistd.h>
+#include <glog/logging.h>
+#include <ubuntu/transfers/system/logger.h>
+#include "timeline.h"
+
+namespace {
+    // a download that keeps retrying must not grow without limits
+    const int MAX_SPANS = 1024;
+    const QString NAME_KEY = "name";
+    const QString START_KEY = "start";
+    const QString END_KEY = "end";
+    const QString BYTES_KEY = "bytes";
+    const QString ERROR_KEY = "error";
+    const QString CATEGORY = "transfer";
+
+    bool _enabled = false;
+    QString _traceDir;
+}
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+Timeline::Timeline(const QString& name)
+    : _name(name) {
+}
+
+QString
+Timeline::name() const {
+    return _name;
+}
+
+void
+Timeline::begin(const QString& span) {
+    if (_spans.count() >= MAX_SPANS) {
+        _dropped++;
+        return;
+    }
+    TimelineSpan timelineSpan;
+    timelineSpan.name = span;
+    timelineSpan.start = now();
+    _spans.append(timelineSpan);
+}
+
+void
+Timeline::end(const QString& span,
+              qulonglong bytes,
+              const QString& error) {
+    for (int index = _spans.count() - 1; index >= 0; index--) {
+        auto& timelineSpan = _spans[index];
+        if (timelineSpan.end < 0 && timelineSpan.name == span) {
+            timelineSpan.end = now();
+            timelineSpan.bytes = bytes;
+            timelineSpan.error = error;
+            return;
+        }
+    }
+}
+
+bool
+Timeline::isOpen(const QString& span) const {
+    foreach(const TimelineSpan& timelineSpan, _spans) {
+        if (timelineSpan.end < 0 && timelineSpan.name == span) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+Timeline::mark(const QString& span, const QString& error) {
+    begin(span);
+    end(span, 0, error);
+}
+
+void
+Timeline::endAll(const QString& error) {
+    auto current = now();
+    for (int index = 0; index < _spans.count(); index++) {
+        auto& timelineSpan = _spans[index];
+        if (timelineSpan.end < 0) {
+            timelineSpan.end = current;
+            timelineSpan.error = error;
+        }
+    }
+}
+
+QList<TimelineSpan>
+Timeline::spans() const {
+    return _spans;
+}
+
+int
+Timeline::dropped() const {
+    return _dropped;
+}
+
+QVariantList
+Timeline::toVariantList() const {
+    QVariantList result;
+    foreach(const TimelineSpan& span, _spans) {
+        QVariantMap data;
+        data[NAME_KEY] = span.name;
+        data[START_KEY] = span.start;
+        data[END_KEY] = span.end;
+        data[BYTES_KEY] = span.bytes;
+        data[ERROR_KEY] = span.error;
+        result.append(data);
+    }
+    return result;
+}
+
+QByteArray
+Timeline::toChromeTrace() const {
+    // all the spans of a transfer share a thread row named after it, the
+    // open ones are drawn up to now
+    auto pid = static_cast<int>(getpid());
+    auto current = now();
+    QJsonArray events;
+
+    QJsonObject threadName;
+    threadName["name"] = QString("thread_name");
+    threadName["ph"] = QString("M");
+    threadName["pid"] = pid;
+    threadName["tid"] = 1;
+    QJsonObject threadArgs;
+    threadArgs["name"] = _name;
+    threadName["args"] = threadArgs;
+    events.append(threadName);
+
+    foreach(const TimelineSpan& span, _spans) {
+        auto end = (span.end < 0)? current : span.end;
+        QJsonObject event;
+        event["name"] = span.name;
+        event["cat"] = CATEGORY;
+        event["pid"] = pid;
+        event["tid"] = 1;
+        event["ts"] = static_cast<double>(span.start);
+        if (end == span.start) {
+            event["ph"] = QString("i");
+            event["s"] = QString("t");
+        } else {
+            event["ph"] = QString("X");
+            event["dur"] = static_cast<double>(end - span.start);
+        }
+
+        QJsonObject args;
+        if (span.bytes > 0) {
+            args[BYTES_KEY] = static_cast<double>(span.bytes);
+        }
+        if (!span.error.isEmpty()) {
+            args[ERROR_KEY] = span.error;
+        }
+        if (!args.isEmpty()) {
+            event["args"] = args;
+        }
+        events.append(event);
+    }
+
+    QJsonObject trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = QString("ms");
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
+
+bool
+Timeline::save(const QString& dir) const {
+    if (!QDir().mkpath(dir)) {
+        LOG(WARNING) << "Could not create the trace dir" << dir;
+        return false;
+    }
+
+    // the names of the transfers are D-Bus paths
+    auto fileName = _name;
+    fileName.replace('/', '_');
+    if (fileName.startsWith('_')) {
+        fileName.remove(0, 1);
+    }
+
+    QFile file(QDir(dir).filePath(fileName + ".json"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        LOG(WARNING) << "Could not write the trace" << file.fileName()
+            << file.errorString();
+        return false;
+    }
+    auto data = toChromeTrace();
+    return file.write(data) == data.size();
+}
+
+qint64
+Timeline::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool
+Timeline::isEnabled() {
+    return _enabled;
+}
+
+void
+Timeline::setEnabled(bool enabled) {
+    _enabled = enabled;
+}
+
+QString
+Timeline::traceDir() {
+    return _traceDir;
+}
+
+void
+Timeline::setTraceDir(const QString& dir) {
+    _traceDir = dir;
+}
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_TIMELINE_H
+#define DOWNLOADER_LIB_TIMELINE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QVariantList>
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+struct TimelineSpan {
+    QString name;
+    qint64 start = 0;  // usecs of the monotonic clock
+    qint64 end = -1;  // -1 while the span is open
+    qulonglong bytes = 0;  // bytes moved during the span
+    QString error;
+};
+
+// Spans of the work done for a transfer (connecting, receiving the data,
+// hashing it...) used to find where the time of a slow transfer went. The
+// transfers only create a timeline when tracing is enabled so that there
+// is no cost otherwise.
+class Timeline {
+ public:
+    explicit Timeline(const QString& name);
+
+    QString name() const;
+
+    void begin(const QString& span);
+    // closes the last open span with the given name, if any
+    void end(const QString& span,
+             qulonglong bytes = 0,
+             const QString& error = QString());
+    bool isOpen(const QString& span) const;
+    // span without duration
+    void mark(const QString& span, const QString& error = QString());
+    // closes the spans that are still open, used when the transfer is done
+    void endAll(const QString& error = QString());
+
+    QList<TimelineSpan> spans() const;
+    // spans that were not recorded because the timeline was full
+    int dropped() const;
+
+    // one a{sv} per span with the name, start, end, bytes and error
+    QVariantList toVariantList() const;
+    // Chrome trace event JSON that can be loaded in chrome://tracing
+    QByteArray toChromeTrace() const;
+    // writes the Chrome trace in the given dir, the file is named after
+    // the timeline
+    bool save(const QString& dir) const;
+
+    static qint64 now();
+
+    // tracing is disabled by default
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+    // dir where the timelines are saved once the transfer is done, empty
+    // if they are only kept in memory
+    static QString traceDir();
+    static void setTraceDir(const QString& dir);
+
+ private:
+    QString _name;
+    QList<TimelineSpan> _spans;
+    int _dropped = 0;
+};
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_TIMELINE_H
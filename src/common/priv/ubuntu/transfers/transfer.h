@@ -38,7 +38,8 @@ class Transfer : public QObject {
         CANCEL,
         UNCOLLECTED,
         FINISH,
-        ERROR
+        ERROR,
+        WAITING_FOR_SPACE  // held by the queue, not exposed to clients
     };
 
     Transfer(const QString& id,
@@ -69,6 +70,14 @@ class Transfer : public QObject {
     virtual void resumeTransfer() {}
     virtual void startTransfer() {}
 
+    // used by the queue to decide if there is enough space to run the
+    // transfer, those that do not store data return an empty path
+    virtual QString storagePath() { return QString(); }
+    // descriptor the data is written to, -1 when it is written to the
+    // storage path
+    virtual int storageDescriptor() { return -1; }
+    virtual qulonglong requiredSpace() { return 0; }
+
  public slots:  // NOLINT(whitespace/indent)
 
     virtual void setThrottle(qulonglong speed);
@@ -34,6 +34,16 @@ const QString Metadata::SHOW_IN_INDICATOR_KEY = "indicator-shown";
 const QString Metadata::CLICK_PACKAGE_KEY = "click-package";
 const QString Metadata::DEFLATE_KEY = "deflate";
 const QString Metadata::EXTRACT_KEY = "extract";
+const QString Metadata::POST_PROCESSING_PRIORITY_KEY = "post-download-priority";
+const QString Metadata::MIRRORS_KEY = "mirrors";
+const QString Metadata::MIRROR_MIN_SPEED_KEY = "mirror-min-speed";
+const QString Metadata::DELTA_CONTROL_KEY = "delta-control";
+const QString Metadata::DELTA_SEED_KEY = "delta-seed";
+const QString Metadata::METALINK_KEY = "metalink";
+const QString Metadata::SEQUENTIAL_KEY = "sequential";
+const QString Metadata::BYTE_RANGES_KEY = "byte-ranges";
+const QString Metadata::DURABILITY_KEY = "durability";
+const QString Metadata::DURABILITY_INTERVAL_KEY = "durability-interval";
 const QString Metadata::CUSTOM_PREFIX = "custom_";
 const QString Metadata::APP_ID = "app-id";
 
@@ -191,6 +201,166 @@ Metadata::hasExtract() const {
     return contains(Metadata::EXTRACT_KEY);
 }
 
+int
+Metadata::postProcessingPriority() const {
+    return (contains(Metadata::POST_PROCESSING_PRIORITY_KEY))?
+        value(Metadata::POST_PROCESSING_PRIORITY_KEY).toInt():0;
+}
+
+void
+Metadata::setPostProcessingPriority(int priority) {
+    insert(Metadata::POST_PROCESSING_PRIORITY_KEY, priority);
+}
+
+bool
+Metadata::hasPostProcessingPriority() const {
+    return contains(Metadata::POST_PROCESSING_PRIORITY_KEY);
+}
+
+QStringList
+Metadata::mirrors() const {
+    return (contains(Metadata::MIRRORS_KEY))?
+        value(Metadata::MIRRORS_KEY).toStringList():QStringList();
+}
+
+void
+Metadata::setMirrors(const QStringList& mirrors) {
+    insert(Metadata::MIRRORS_KEY, mirrors);
+}
+
+bool
+Metadata::hasMirrors() const {
+    return contains(Metadata::MIRRORS_KEY);
+}
+
+qulonglong
+Metadata::mirrorMinSpeed() const {
+    return (contains(Metadata::MIRROR_MIN_SPEED_KEY))?
+        value(Metadata::MIRROR_MIN_SPEED_KEY).toULongLong():0;
+}
+
+void
+Metadata::setMirrorMinSpeed(qulonglong speed) {
+    insert(Metadata::MIRROR_MIN_SPEED_KEY, speed);
+}
+
+bool
+Metadata::hasMirrorMinSpeed() const {
+    return contains(Metadata::MIRROR_MIN_SPEED_KEY);
+}
+
+QString
+Metadata::deltaControl() const {
+    return (contains(Metadata::DELTA_CONTROL_KEY))?
+        value(Metadata::DELTA_CONTROL_KEY).toString():"";
+}
+
+void
+Metadata::setDeltaControl(const QString& url) {
+    insert(Metadata::DELTA_CONTROL_KEY, url);
+}
+
+bool
+Metadata::hasDeltaControl() const {
+    return contains(Metadata::DELTA_CONTROL_KEY);
+}
+
+QString
+Metadata::deltaSeed() const {
+    return (contains(Metadata::DELTA_SEED_KEY))?
+        value(Metadata::DELTA_SEED_KEY).toString():"";
+}
+
+void
+Metadata::setDeltaSeed(const QString& path) {
+    insert(Metadata::DELTA_SEED_KEY, path);
+}
+
+bool
+Metadata::hasDeltaSeed() const {
+    return contains(Metadata::DELTA_SEED_KEY);
+}
+
+bool
+Metadata::metalink() const {
+    return (contains(Metadata::METALINK_KEY))?
+        value(Metadata::METALINK_KEY).toBool():false;
+}
+
+void
+Metadata::setMetalink(bool metalink) {
+    insert(Metadata::METALINK_KEY, metalink);
+}
+
+bool
+Metadata::hasMetalink() const {
+    return contains(Metadata::METALINK_KEY);
+}
+
+bool
+Metadata::sequential() const {
+    return (contains(Metadata::SEQUENTIAL_KEY))?
+        value(Metadata::SEQUENTIAL_KEY).toBool():false;
+}
+
+void
+Metadata::setSequential(bool sequential) {
+    insert(Metadata::SEQUENTIAL_KEY, sequential);
+}
+
+bool
+Metadata::hasSequential() const {
+    return contains(Metadata::SEQUENTIAL_KEY);
+}
+
+QStringList
+Metadata::byteRanges() const {
+    return (contains(Metadata::BYTE_RANGES_KEY))?
+        value(Metadata::BYTE_RANGES_KEY).toStringList():QStringList();
+}
+
+void
+Metadata::setByteRanges(const QStringList& ranges) {
+    insert(Metadata::BYTE_RANGES_KEY, ranges);
+}
+
+bool
+Metadata::hasByteRanges() const {
+    return contains(Metadata::BYTE_RANGES_KEY);
+}
+
+QString
+Metadata::durability() const {
+    return (contains(Metadata::DURABILITY_KEY))?
+        value(Metadata::DURABILITY_KEY).toString():"";
+}
+
+void
+Metadata::setDurability(const QString& policy) {
+    insert(Metadata::DURABILITY_KEY, policy);
+}
+
+bool
+Metadata::hasDurability() const {
+    return contains(Metadata::DURABILITY_KEY);
+}
+
+qulonglong
+Metadata::durabilityInterval() const {
+    return (contains(Metadata::DURABILITY_INTERVAL_KEY))?
+        value(Metadata::DURABILITY_INTERVAL_KEY).toULongLong():0;
+}
+
+void
+Metadata::setDurabilityInterval(qulonglong bytes) {
+    insert(Metadata::DURABILITY_INTERVAL_KEY, bytes);
+}
+
+bool
+Metadata::hasDurabilityInterval() const {
+    return contains(Metadata::DURABILITY_INTERVAL_KEY);
+}
+
 QString
 Metadata::destinationApp() const {
     return (contains(Metadata::APP_ID))?
@@ -41,6 +41,16 @@ class Metadata : public QVariantMap {
     static const QString CLICK_PACKAGE_KEY;
     static const QString DEFLATE_KEY;
     static const QString EXTRACT_KEY;
+    static const QString POST_PROCESSING_PRIORITY_KEY;
+    static const QString MIRRORS_KEY;
+    static const QString MIRROR_MIN_SPEED_KEY;
+    static const QString DELTA_CONTROL_KEY;
+    static const QString DELTA_SEED_KEY;
+    static const QString METALINK_KEY;
+    static const QString SEQUENTIAL_KEY;
+    static const QString BYTE_RANGES_KEY;
+    static const QString DURABILITY_KEY;
+    static const QString DURABILITY_INTERVAL_KEY;
     static const QString CUSTOM_PREFIX;
     static const QString APP_ID;
 
@@ -77,6 +87,57 @@ class Metadata : public QVariantMap {
     void setExtract(bool extract);
     bool hasExtract() const;
 
+    int postProcessingPriority() const;
+    void setPostProcessingPriority(int priority);
+    bool hasPostProcessingPriority() const;
+
+    // alternative urls of the same resource in the order they are tried
+    QStringList mirrors() const;
+    void setMirrors(const QStringList& mirrors);
+    bool hasMirrors() const;
+
+    // bytes per second under which the next mirror is used
+    qulonglong mirrorMinSpeed() const;
+    void setMirrorMinSpeed(qulonglong speed);
+    bool hasMirrorMinSpeed() const;
+
+    // url of the block checksums (zsync control file) of the data
+    QString deltaControl() const;
+    void setDeltaControl(const QString& url);
+    bool hasDeltaControl() const;
+
+    // local path of a previous version of the data whose blocks are reused
+    QString deltaSeed() const;
+    void setDeltaSeed(const QString& path);
+    bool hasDeltaSeed() const;
+
+    // the url of the download is a metalink document describing the data
+    bool metalink() const;
+    void setMetalink(bool metalink);
+    bool hasMetalink() const;
+
+    // the pieces of segmented downloads are downloaded in order so that
+    // the start of the file can be read as soon as possible
+    bool sequential() const;
+    void setSequential(bool sequential);
+    bool hasSequential() const;
+
+    // only the given ranges, in the "first-last" form, are downloaded and
+    // written at their offsets
+    QStringList byteRanges() const;
+    void setByteRanges(const QStringList& ranges);
+    bool hasByteRanges() const;
+
+    // when the data is synced to the disk: "none", "finish" or "periodic"
+    QString durability() const;
+    void setDurability(const QString& policy);
+    bool hasDurability() const;
+
+    // bytes written between syncs when the durability is periodic
+    qulonglong durabilityInterval() const;
+    void setDurabilityInterval(qulonglong bytes);
+    bool hasDurabilityInterval() const;
+
     QString destinationApp() const;
     void setOwner(const QString &id);
     bool hasOwner() const;
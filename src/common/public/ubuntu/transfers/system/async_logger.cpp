@@ -0,0 +1,289 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "async_logger.h"
+
+namespace {
+    // records are aligned so that the headers are never split in odd
+    // places of the buffer
+    const std::size_t ALIGNMENT = 8;
+    // the writer wakes up on its own from time to time in case a wake up
+    // was missed
+    const int IDLE_WAIT = 100;
+
+    std::size_t roundUpToPowerOfTwo(std::size_t value) {
+        std::size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    std::vector<Ubuntu::Transfers::System::AsyncLogger*> _installed;
+
+    // glog holds its log mutex when it fails, the loggers are flushed
+    // directly rather than with google::FlushLogFiles
+    void flushAsyncLoggers() {
+        for (auto logger : _installed) {
+            logger->Flush();
+        }
+    }
+
+    void failAfterFlush() {
+        // the fatal message has to reach the file before we abort
+        flushAsyncLoggers();
+        abort();
+    }
+}
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+AsyncLogger::AsyncLogger(google::base::Logger* wrapped,
+                         std::size_t capacity)
+    : _wrapped(wrapped),
+      _capacity(roundUpToPowerOfTwo(
+          std::max<std::size_t>(capacity, 2 * sizeof(Header)))),
+      _buffer(new char[_capacity]) {
+}
+
+AsyncLogger::~AsyncLogger() {
+    stop();
+    delete[] _buffer;
+}
+
+void
+AsyncLogger::start() {
+    if (_running) {
+        return;
+    }
+    _stopping = false;
+    _running = true;
+    _writer = std::thread(&AsyncLogger::run, this);
+}
+
+void
+AsyncLogger::stop() {
+    if (!_running) {
+        return;
+    }
+    // the writer drains the buffer before it exits
+    _stopping = true;
+    wake();
+    _writer.join();
+    // a message might have been added while the writer was exiting
+    while (writeNext()) {}
+    _running = false;
+}
+
+bool
+AsyncLogger::isRunning() const {
+    return _running;
+}
+
+unsigned long long
+AsyncLogger::dropped() const {
+    return _dropped;
+}
+
+std::size_t
+AsyncLogger::capacity() const {
+    return _capacity;
+}
+
+void
+AsyncLogger::Write(bool forceFlush,
+                   time_t timestamp,
+                   const char* message,
+                   int length) {
+    if (!_running || _stopping) {
+        _wrapped->Write(forceFlush, timestamp, message, length);
+        return;
+    }
+
+    // a message larger than the buffer is cut rather than blocking forever
+    auto maxLength = static_cast<int>(_capacity - sizeof(Header));
+    if (length > maxLength) {
+        length = maxLength;
+    }
+
+    auto size = recordSize(length);
+    auto head = _head.load(std::memory_order_relaxed);
+    while (_capacity - (head - _tail.load(std::memory_order_acquire)) < size) {
+        if (!forceFlush) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // warnings and errors are never lost, wait for the writer
+        wake();
+        std::this_thread::yield();
+    }
+
+    Header header;
+    header.timestamp = static_cast<long long>(timestamp);
+    header.length = length;
+    header.forceFlush = forceFlush;
+    copyIn(head, &header, sizeof(Header));
+    copyIn(head + sizeof(Header), message, length);
+    _head.store(head + size);
+
+    if (forceFlush || _sleeping) {
+        wake();
+    }
+}
+
+void
+AsyncLogger::Flush() {
+    if (_running && !_stopping
+            && std::this_thread::get_id() != _writer.get_id()) {
+        auto head = _head.load();
+        while (_written.load(std::memory_order_acquire) < head) {
+            wake();
+            std::this_thread::yield();
+        }
+    }
+    _wrapped->Flush();
+}
+
+google::uint32
+AsyncLogger::LogSize() {
+    return _wrapped->LogSize();
+}
+
+void
+AsyncLogger::install(std::size_t capacity) {
+    for (int severity = 0; severity < google::NUM_SEVERITIES; severity++) {
+        auto logger = new AsyncLogger(google::base::GetLogger(severity),
+            capacity);
+        logger->start();
+        google::base::SetLogger(severity, logger);
+        _installed.push_back(logger);
+    }
+    // the messages that are still in the buffers are written when the
+    // process exits
+    std::atexit(flushAsyncLoggers);
+    google::InstallFailureFunction(&failAfterFlush);
+}
+
+std::size_t
+AsyncLogger::recordSize(int length) const {
+    auto size = sizeof(Header) + static_cast<std::size_t>(length);
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+void
+AsyncLogger::copyIn(unsigned long long position,
+                    const void* data,
+                    std::size_t size) {
+    auto offset = static_cast<std::size_t>(position & (_capacity - 1));
+    auto first = std::min(size, _capacity - offset);
+    memcpy(_buffer + offset, data, first);
+    if (first < size) {
+        memcpy(_buffer, static_cast<const char*>(data) + first, size - first);
+    }
+}
+
+void
+AsyncLogger::copyOut(unsigned long long position,
+                     void* data,
+                     std::size_t size) {
+    auto offset = static_cast<std::size_t>(position & (_capacity - 1));
+    auto first = std::min(size, _capacity - offset);
+    memcpy(data, _buffer + offset, first);
+    if (first < size) {
+        memcpy(static_cast<char*>(data) + first, _buffer, size - first);
+    }
+}
+
+void
+AsyncLogger::wake() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _wakeUp.notify_one();
+}
+
+void
+AsyncLogger::reportDropped() {
+    auto dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped == _reported) {
+        return;
+    }
+    auto message = "Dropped " + std::to_string(dropped - _reported)
+        + " log messages, the log buffer was full.\n";
+    _reported = dropped;
+    _wrapped->Write(false, time(nullptr), message.c_str(),
+        static_cast<int>(message.size()));
+}
+
+bool
+AsyncLogger::writeNext() {
+    auto tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    Header header;
+    copyOut(tail, &header, sizeof(Header));
+    _message.resize(header.length);
+    copyOut(tail + sizeof(Header), &_message[0], header.length);
+    // free the space before the slow write
+    auto next = tail + recordSize(header.length);
+    _tail.store(next, std::memory_order_release);
+
+    _wrapped->Write(header.forceFlush != 0,
+        static_cast<time_t>(header.timestamp), _message.data(),
+        header.length);
+    _written.store(next, std::memory_order_release);
+    return true;
+}
+
+void
+AsyncLogger::run() {
+    while (true) {
+        if (writeNext()) {
+            continue;
+        }
+
+        reportDropped();
+        if (_stopping) {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _sleeping = true;
+        // the producer only wakes us when it sees that we sleep, check
+        // again once that is visible
+        if (_tail.load() == _head.load() && !_stopping) {
+            _wakeUp.wait_for(lock, std::chrono::milliseconds(IDLE_WAIT));
+        }
+        _sleeping = false;
+    }
+}
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
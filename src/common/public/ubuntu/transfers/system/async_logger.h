@@ -0,0 +1,119 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_ASYNC_LOGGER_H
+#define DOWNLOADER_LIB_ASYNC_LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <glog/logging.h>
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+// glog logger that copies the formatted messages in a ring buffer and
+// writes them to the wrapped logger from a background thread, so that the
+// threads that log never wait for the disk.
+//
+// glog calls Write with its log mutex held, there is a single producer at
+// a time and the buffer does not need locks. When the buffer is full the
+// INFO messages are dropped and reported once there is space again, the
+// messages that have to be flushed (WARNING and above) wait instead.
+class AsyncLogger : public google::base::Logger {
+ public:
+    static const std::size_t DEFAULT_CAPACITY = 1024 * 1024;
+
+    // the wrapped logger is not owned, the capacity is rounded up to a
+    // power of two
+    explicit AsyncLogger(google::base::Logger* wrapped,
+                         std::size_t capacity = DEFAULT_CAPACITY);
+    virtual ~AsyncLogger();
+
+    // while the writer is not running the messages are written right away
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    // number of messages that were dropped because the buffer was full
+    unsigned long long dropped() const;
+    std::size_t capacity() const;
+
+    void Write(bool forceFlush,
+               time_t timestamp,
+               const char* message,
+               int length) override;
+    // waits until the messages that were written are in the wrapped logger
+    void Flush() override;
+    google::uint32 LogSize() override;
+
+    // replaces the loggers of all the severities so that the whole process
+    // logs asynchronously, the loggers become owned by glog
+    static void install(std::size_t capacity = DEFAULT_CAPACITY);
+
+ private:
+    struct Header {
+        long long timestamp;
+        int length;
+        int forceFlush;
+    };
+
+    std::size_t recordSize(int length) const;
+    void copyIn(unsigned long long position, const void* data,
+                std::size_t size);
+    void copyOut(unsigned long long position, void* data, std::size_t size);
+    void wake();
+    void reportDropped();
+    bool writeNext();
+    void run();
+
+ private:
+    google::base::Logger* _wrapped;
+    std::size_t _capacity;
+    char* _buffer;
+    // positions grow forever, the offset in the buffer is the position
+    // masked with the capacity
+    std::atomic<unsigned long long> _head {0};
+    std::atomic<unsigned long long> _tail {0};
+    // position of the messages that are already in the wrapped logger
+    std::atomic<unsigned long long> _written {0};
+    std::atomic<unsigned long long> _dropped {0};
+    unsigned long long _reported = 0;
+    std::string _message;  // only used by the writer
+    std::atomic<bool> _running {false};
+    std::atomic<bool> _stopping {false};
+    std::atomic<bool> _sleeping {false};
+    std::mutex _mutex;
+    std::condition_variable _wakeUp;
+    std::thread _writer;
+};
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_ASYNC_LOGGER_H
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include "log_rate_limiter.h"
+
+namespace {
+    const int DEFAULT_INTERVAL = 1000;
+    // the entries of the objects that are gone are removed once there
+    // are this many of them
+    const int MAX_ENTRIES = 4096;
+
+    struct Site {
+        const void* object;
+        const char* file;
+        int line;
+
+        bool operator==(const Site& other) const {
+            return object == other.object && file == other.file
+                && line == other.line;
+        }
+    };
+
+    uint qHash(const Site& site, uint seed = 0) {
+        return ::qHash(site.object, seed) ^ ::qHash(site.file, seed)
+            ^ ::qHash(site.line, seed);
+    }
+
+    struct Entry {
+        qint64 last;
+        int skipped;
+    };
+
+    QMutex _mutex;
+    QHash<Site, Entry> _entries;
+    int _interval = DEFAULT_INTERVAL;
+
+    qint64 now() {
+        static QElapsedTimer clock;
+        if (!clock.isValid()) {
+            clock.start();
+        }
+        return clock.elapsed();
+    }
+}
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+int
+LogRateLimiter::acquire(const void* object, const char* file, int line) {
+    QMutexLocker locker(&_mutex);
+    auto current = now();
+    Site site = {object, file, line};
+
+    auto it = _entries.find(site);
+    if (it == _entries.end()) {
+        if (_entries.count() >= MAX_ENTRIES) {
+            auto entry = _entries.begin();
+            while (entry != _entries.end()) {
+                if (current - entry.value().last >= _interval) {
+                    entry = _entries.erase(entry);
+                } else {
+                    ++entry;
+                }
+            }
+        }
+        Entry entry = {current, 0};
+        _entries.insert(site, entry);
+        return 0;
+    }
+
+    if (current - it.value().last < _interval) {
+        it.value().skipped++;
+        return -1;
+    }
+
+    auto skipped = it.value().skipped;
+    it.value().last = current;
+    it.value().skipped = 0;
+    return skipped;
+}
+
+int
+LogRateLimiter::interval() {
+    QMutexLocker locker(&_mutex);
+    return _interval;
+}
+
+void
+LogRateLimiter::setInterval(int msecs) {
+    QMutexLocker locker(&_mutex);
+    _interval = qMax(0, msecs);
+}
+
+std::string
+LogRateLimiter::skipped(int count) {
+    if (count <= 0) {
+        return std::string();
+    }
+    return "(" + std::to_string(count) + " similar messages skipped) ";
+}
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
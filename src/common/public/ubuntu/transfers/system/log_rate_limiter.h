@@ -0,0 +1,53 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_LOG_RATE_LIMITER_H
+#define DOWNLOADER_LIB_LOG_RATE_LIMITER_H
+
+#include <string>
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+namespace System {
+
+// Limits the messages that are logged by a call site for a given object,
+// used for those messages that are repeated while a transfer is active
+// (progress, retries, stalls...) so that a single transfer cannot flood
+// the log.
+class LogRateLimiter {
+ public:
+    // returns -1 when the message has to be skipped, otherwise the number
+    // of messages of the same call site that were skipped before it
+    static int acquire(const void* object, const char* file, int line);
+
+    // msecs between two messages of the same call site and object
+    static int interval();
+    static void setInterval(int msecs);
+
+    static std::string skipped(int count);
+};
+
+}  // System
+
+}  // Transfers
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_LOG_RATE_LIMITER_H
@@ -29,6 +29,7 @@
 #include <QSslError>
 #include <sys/types.h>
 #include <unistd.h>
+#include "async_logger.h"
 #include "logger.h"
 
 std::ostream& operator<<(std::ostream &out, const QString& var) {
@@ -101,6 +102,7 @@ namespace Transfers {
 namespace System {
 
 static bool _init = false;
+static bool _async = true;
 
 void
 Logger::setupLogging(const QString logDir) {
@@ -139,9 +141,22 @@ Logger::setupLogging(const QString logDir) {
         google::SetLogDestination(google::WARNING, toStdString(path).c_str());
         google::SetLogDestination(google::INFO, toStdString(path).c_str());
         google::SetLogDestination(google::FATAL, toStdString(path).c_str());
+        if (_async) {
+            AsyncLogger::install();
+        }
     }
 }
 
+bool
+Logger::isAsync() {
+    return _async;
+}
+
+void
+Logger::setAsync(bool async) {
+    _async = async;
+}
+
 bool
 Logger::setLogLevel(QtMsgType level) {
     Q_UNUSED(level);
@@ -28,13 +28,30 @@
 #include <glog/logging.h>
 #include <iostream>
 #include <sstream>
+#include "log_rate_limiter.h"
 
 class QDBusError;
 class QStringList;
 class QSslError;
 class QUrl;
 
-#define TRACE DLOG(INFO) << __PRETTY_FUNCTION__
+// the trace messages are removed at compile time in the release builds or
+// when INFO is below the level configured with GOOGLE_STRIP_LOG, the
+// arguments are still type checked but never evaluated
+#if defined(NDEBUG) || GOOGLE_STRIP_LOG > 0
+#define TRACE true ? (void) 0 : google::LogMessageVoidify() & \
+    LOG(INFO) << __PRETTY_FUNCTION__
+#else
+#define TRACE LOG(INFO) << __PRETTY_FUNCTION__
+#endif
+
+// logs at most one message per second for the given call site and object,
+// the number of messages that were skipped is added to the next one
+#define LOG_RATE_LIMITED(LEVEL, OBJECT) \
+    for (int _skipped = Ubuntu::Transfers::System::LogRateLimiter::acquire( \
+            OBJECT, __FILE__, __LINE__); _skipped >= 0; _skipped = -1) \
+        LOG(LEVEL) << Ubuntu::Transfers::System::LogRateLimiter::skipped( \
+            _skipped)
 
 typedef QMap<QString, QString> StringMap;
 
@@ -60,6 +77,9 @@ class Logger : public QObject {
  public:
 
     static void setupLogging(const QString logDir= "");
+    // must be called before setupLogging, defaults to true
+    static bool isAsync();
+    static void setAsync(bool async);
     static bool setLogLevel(QtMsgType level);
     static QString getLogDir();
     static std::string toStdString(const QString& str);
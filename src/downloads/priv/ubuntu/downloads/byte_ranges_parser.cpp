@@ -0,0 +1,152 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "header_parser.h"
+#include "byte_ranges_parser.h"
+
+namespace {
+    // the headers of a part are tiny, do not let a broken server make us
+    // buffer the whole body looking for their end
+    const int MAX_HEADERS_SIZE = 8 * 1024;
+    const QByteArray HEADERS_END = "\r\n\r\n";
+    const QByteArray CLOSE_DELIMITER = "--";
+    const QString CONTENT_RANGE = "content-range:";
+}
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+ByteRangesParser::ByteRangesParser(const QString& boundary)
+    : _state(Boundary),
+      _delimiter("--" + boundary.toUtf8()) {
+}
+
+ByteRangesParser::ByteRangesParser(qint64 offset, qint64 length)
+    : _state(Data),
+      _offset(offset),
+      _remaining(length) {
+}
+
+bool
+ByteRangesParser::feed(const QByteArray& data, QList<Part>& parts) {
+    _buffer.append(data);
+
+    forever {
+        switch (_state) {
+            case Boundary: {
+                auto index = _buffer.indexOf(_delimiter);
+                if (index < 0) {
+                    // the delimiter might be split between two reads
+                    _buffer = _buffer.right(_delimiter.size());
+                    return true;
+                }
+                // need to know if it is the close delimiter
+                auto end = index + _delimiter.size();
+                if (_buffer.size() < end + CLOSE_DELIMITER.size()) {
+                    return true;
+                }
+                if (_buffer.mid(end, CLOSE_DELIMITER.size()) == CLOSE_DELIMITER) {
+                    _state = Done;
+                    break;
+                }
+                _buffer.remove(0, end);
+                _state = Headers;
+                break;
+            }
+            case Headers: {
+                auto index = _buffer.indexOf(HEADERS_END);
+                if (index < 0) {
+                    if (_buffer.size() > MAX_HEADERS_SIZE) {
+                        _lastError = "The headers of a part are too large.";
+                        return false;
+                    }
+                    return true;
+                }
+                if (!parseHeaders(_buffer.left(index))) {
+                    return false;
+                }
+                _buffer.remove(0, index + HEADERS_END.size());
+                _state = Data;
+                break;
+            }
+            case Data: {
+                if (_buffer.isEmpty()) {
+                    return true;
+                }
+                Part part;
+                part.offset = _offset;
+                part.data = _buffer.left(qMin<qint64>(_remaining,
+                    _buffer.size()));
+                _buffer.remove(0, part.data.size());
+                _offset += part.data.size();
+                _remaining -= part.data.size();
+                parts.append(part);
+
+                if (_remaining == 0) {
+                    _state = (_delimiter.isEmpty())? Done : Boundary;
+                }
+                break;
+            }
+            case Done:
+                // ignore the epilogue
+                _buffer.clear();
+                return true;
+        }
+    }
+}
+
+bool
+ByteRangesParser::isDone() const {
+    return _state == Done;
+}
+
+QString
+ByteRangesParser::lastError() const {
+    return _lastError;
+}
+
+bool
+ByteRangesParser::parseHeaders(const QByteArray& headers) {
+    foreach(const QByteArray& line, headers.split('\n')) {
+        auto header = QString(line).trimmed();
+        if (!header.toLower().startsWith(CONTENT_RANGE)) {
+            continue;
+        }
+        qint64 first = 0;
+        qint64 last = 0;
+        if (!HeaderParser::rangeFromContentRange(
+                header.mid(CONTENT_RANGE.size()), first, last)) {
+            _lastError = QString("Invalid Content-Range: '%1'").arg(header);
+            return false;
+        }
+        _offset = first;
+        _remaining = last - first + 1;
+        return true;
+    }
+    _lastError = "Part without a Content-Range.";
+    return false;
+}
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_BYTE_RANGES_PARSER_H
+#define DOWNLOADER_LIB_BYTE_RANGES_PARSER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+// Incremental parser of the body of a 206 response. The data of the
+// ranges is returned as soon as it arrives so that large ranges are never
+// fully kept in memory.
+class ByteRangesParser {
+ public:
+    struct Part {
+        qint64 offset = 0;
+        QByteArray data;
+    };
+
+    // multipart/byteranges body with the given boundary
+    explicit ByteRangesParser(const QString& boundary);
+    // body of a single range
+    ByteRangesParser(qint64 offset, qint64 length);
+
+    // returns false if the body is malformed
+    bool feed(const QByteArray& data, QList<Part>& parts);
+    bool isDone() const;
+    QString lastError() const;
+
+ private:
+    enum State {
+        Boundary,
+        Headers,
+        Data,
+        Done
+    };
+
+    bool parseHeaders(const QByteArray& headers);
+
+ private:
+    State _state;
+    QByteArray _delimiter;
+    QByteArray _buffer;
+    qint64 _offset = 0;
+    qint64 _remaining = 0;
+    QString _lastError;
+};
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_BYTE_RANGES_PARSER_H
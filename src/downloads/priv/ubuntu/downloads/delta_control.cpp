@@ -0,0 +1,339 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <climits>
+#include <cstring>
+#include <vector>
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QMap>
+#include <QMultiHash>
+#include "delta_control.h"
+
+namespace {
+    // zsync uses powers of two so that the rolling sum can use shifts
+    const qint64 MIN_BLOCK_SIZE = 16;
+    const qint64 MAX_BLOCK_SIZE = 1 << 20;
+    const quint32 FILTER_SIZE = 1 << 20;
+
+    quint32 bucket(quint32 weak) {
+        return (weak ^ (weak >> 16)) & (FILTER_SIZE - 1);
+    }
+}
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+bool
+DeltaControl::parse(const QByteArray& data) {
+    auto headersEnd = data.indexOf("\n\n");
+    if (headersEnd < 0) {
+        _lastError = "Missing the end of the headers.";
+        return false;
+    }
+
+    QMap<QByteArray, QByteArray> headers;
+    foreach(const QByteArray& line, data.left(headersEnd).split('\n')) {
+        auto separator = line.indexOf(':');
+        if (separator > 0) {
+            headers[line.left(separator).trimmed().toLower()] =
+                line.mid(separator + 1).trimmed();
+        }
+    }
+
+    if (!headers.contains("zsync")) {
+        _lastError = "Not a zsync control file.";
+        return false;
+    }
+
+    if (headers.contains("z-map2")) {
+        _lastError = "Compressed targets are not supported.";
+        return false;
+    }
+
+    bool ok = false;
+    _blockSize = headers.value("blocksize").toLongLong(&ok);
+    if (!ok || _blockSize < MIN_BLOCK_SIZE || _blockSize > MAX_BLOCK_SIZE
+            || (_blockSize & (_blockSize - 1)) != 0) {
+        _lastError = "Invalid block size.";
+        return false;
+    }
+    _blockShift = 0;
+    while ((1LL << _blockShift) < _blockSize) {
+        _blockShift++;
+    }
+
+    _length = headers.value("length").toLongLong(&ok);
+    if (!ok || _length < 0) {
+        _lastError = "Invalid length.";
+        return false;
+    }
+
+    auto lengths = headers.value("hash-lengths", "1,4,16").split(',');
+    if (lengths.count() != 3) {
+        _lastError = "Invalid hash lengths.";
+        return false;
+    }
+    _seqMatches = lengths[0].toInt();
+    _weakBytes = lengths[1].toInt();
+    _strongBytes = lengths[2].toInt();
+    if (_seqMatches < 1 || _seqMatches > 2 || _weakBytes < 1
+            || _weakBytes > 4 || _strongBytes < 3 || _strongBytes > 16) {
+        _lastError = "Invalid hash lengths.";
+        return false;
+    }
+    _weakMask = (_weakBytes == 4)? 0xffffffff
+        : (static_cast<quint32>(1) << (8 * _weakBytes)) - 1;
+    _sha1 = QString(headers.value("sha-1")).toLower();
+
+    qint64 blocks = (_length + _blockSize - 1) / _blockSize;
+    qint64 entrySize = _weakBytes + _strongBytes;
+    if (blocks > INT_MAX / entrySize
+            || data.size() - headersEnd - 2 < blocks * entrySize) {
+        _lastError = "Truncated block checksums.";
+        return false;
+    }
+
+    // the weak sums are stored as the last bytes of the big endian value
+    auto sums = reinterpret_cast<const uchar*>(data.constData())
+        + headersEnd + 2;
+    _weak.resize(blocks);
+    _strong.clear();
+    _strong.reserve(blocks * _strongBytes);
+    for (int block = 0; block < blocks; block++) {
+        auto entry = sums + block * entrySize;
+        quint32 weak = 0;
+        for (int index = 0; index < _weakBytes; index++) {
+            weak = (weak << 8) | entry[index];
+        }
+        _weak[block] = weak;
+        _strong.append(reinterpret_cast<const char*>(entry + _weakBytes),
+            _strongBytes);
+    }
+
+    _lastError.clear();
+    return true;
+}
+
+QString
+DeltaControl::lastError() const {
+    return _lastError;
+}
+
+qint64
+DeltaControl::blockSize() const {
+    return _blockSize;
+}
+
+qint64
+DeltaControl::length() const {
+    return _length;
+}
+
+int
+DeltaControl::blockCount() const {
+    return _weak.count();
+}
+
+QString
+DeltaControl::sha1() const {
+    return _sha1;
+}
+
+QList<DeltaSegment>
+DeltaControl::match(const QString& seedPath) const {
+    QVector<qint64> found(blockCount(), -1);
+
+    QFile seed(seedPath);
+    if (!seedPath.isEmpty() && seed.open(QIODevice::ReadOnly)
+            && seed.size() > 0) {
+        auto data = seed.map(0, seed.size());
+        if (data != nullptr) {
+            findBlocks(data, seed.size(), found);
+            seed.unmap(data);
+        }
+    }
+
+    // merge the contiguous blocks so that the copies and the ranges
+    // requested to the server are as large as possible
+    QList<DeltaSegment> segments;
+    for (int block = 0; block < found.count(); block++) {
+        DeltaSegment segment;
+        segment.offset = block * _blockSize;
+        segment.length = qMin(_blockSize, _length - segment.offset);
+        segment.seedOffset = found[block];
+
+        if (!segments.isEmpty()) {
+            auto& last = segments.last();
+            if (last.isRemote() && segment.isRemote()) {
+                last.length += segment.length;
+                continue;
+            }
+            if (!last.isRemote() && !segment.isRemote()
+                    && last.seedOffset + last.length == segment.seedOffset) {
+                last.length += segment.length;
+                continue;
+            }
+        }
+        segments.append(segment);
+    }
+    return segments;
+}
+
+void
+DeltaControl::findBlocks(const uchar* data,
+                         qint64 size,
+                         QVector<qint64>& found) const {
+    auto fullBlocks = static_cast<int>(_length / _blockSize);
+
+    // most of the positions of the seed do not match any block, a bitmap
+    // of the weak sums discards them without a hash lookup
+    std::vector<bool> filter(FILTER_SIZE, false);
+    QMultiHash<quint32, int> index;
+    index.reserve(fullBlocks);
+    for (int block = 0; block < fullBlocks; block++) {
+        index.insert(_weak[block], block);
+        filter[bucket(_weak[block])] = true;
+    }
+
+    if (fullBlocks > 0 && size >= _blockSize) {
+        auto sum = weakSum(data, _blockSize);
+        quint16 a = sum >> 16;
+        quint16 b = sum & 0xffff;
+        qint64 position = 0;
+
+        forever {
+            quint32 weak = ((static_cast<quint32>(a) << 16) | b) & _weakMask;
+            auto next = position + 1;
+
+            if (filter[bucket(weak)]) {
+                // the strong sum is only calculated once per position
+                QByteArray strong;
+                auto it = index.find(weak);
+                for (; it != index.end() && it.key() == weak; ++it) {
+                    auto block = it.value();
+                    if (found[block] >= 0) {
+                        continue;
+                    }
+                    if (strong.isEmpty()) {
+                        strong = strongSum(data + position, _blockSize,
+                            _blockSize);
+                    }
+                    if (!strongEquals(block, strong)) {
+                        continue;
+                    }
+                    if (_seqMatches > 1 && block + 1 < fullBlocks) {
+                        // the sums are too short to trust a single block,
+                        // the following one has to match as well
+                        if (position + 2 * _blockSize > size
+                                || !strongEquals(block + 1, strongSum(
+                                    data + position + _blockSize,
+                                    _blockSize, _blockSize))) {
+                            continue;
+                        }
+                        found[block + 1] = position + _blockSize;
+                        next = position + 2 * _blockSize;
+                    }
+                    found[block] = position;
+                    next = qMax(next, position + _blockSize);
+                }
+            }
+
+            if (next + _blockSize > size) {
+                break;
+            }
+
+            if (next == position + 1) {
+                uchar out = data[position];
+                uchar in = data[position + _blockSize];
+                a += in - out;
+                b += a - (out << _blockShift);
+            } else {
+                sum = weakSum(data + next, _blockSize);
+                a = sum >> 16;
+                b = sum & 0xffff;
+            }
+            position = next;
+        }
+    }
+
+    // the last block is padded with zeros, it is looked for at the same
+    // offset and at the end of the seed
+    auto lastLength = _length % _blockSize;
+    if (lastLength != 0) {
+        auto block = blockCount() - 1;
+        QList<qint64> positions;
+        positions << block * _blockSize << size - lastLength;
+        foreach(qint64 position, positions) {
+            if (found[block] >= 0 || position < 0
+                    || position + lastLength > size) {
+                continue;
+            }
+            QByteArray padded(_blockSize, '\0');
+            memcpy(padded.data(), data + position, lastLength);
+            auto paddedData = reinterpret_cast<const uchar*>(
+                padded.constData());
+            if ((weakSum(paddedData, _blockSize) & _weakMask) == _weak[block]
+                    && strongEquals(block, strongSum(paddedData,
+                        _blockSize, _blockSize))) {
+                found[block] = position;
+            }
+        }
+    }
+}
+
+bool
+DeltaControl::strongEquals(int block, const QByteArray& strong) const {
+    return memcmp(_strong.constData() + block * _strongBytes,
+        strong.constData(), _strongBytes) == 0;
+}
+
+quint32
+DeltaControl::weakSum(const uchar* data, qint64 length) {
+    // plain loop with wrapping 32 bits sums so that the compiler can
+    // vectorize it, only the low 16 bits of each sum are used
+    quint32 a = 0;
+    quint32 b = 0;
+    for (qint64 index = 0; index < length; index++) {
+        a += data[index];
+        b += static_cast<quint32>(length - index) * data[index];
+    }
+    return ((a & 0xffff) << 16) | (b & 0xffff);
+}
+
+QByteArray
+DeltaControl::strongSum(const uchar* data, qint64 length, qint64 blockSize) {
+    if (length < blockSize) {
+        QByteArray padded(blockSize, '\0');
+        memcpy(padded.data(), data, length);
+        return QCryptographicHash::hash(padded, QCryptographicHash::Md4);
+    }
+    return QCryptographicHash::hash(QByteArray::fromRawData(
+        reinterpret_cast<const char*>(data), length),
+        QCryptographicHash::Md4);
+}
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
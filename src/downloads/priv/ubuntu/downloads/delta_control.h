@@ -0,0 +1,97 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_DELTA_CONTROL_H
+#define DOWNLOADER_LIB_DELTA_CONTROL_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+// part of the target file that is either copied from the seed or
+// downloaded from the server
+struct DeltaSegment {
+    qint64 offset = 0;  // in the target file
+    qint64 length = 0;
+    qint64 seedOffset = -1;  // -1 when the data has to be downloaded
+
+    bool isRemote() const {
+        return seedOffset < 0;
+    }
+};
+
+// Block checksums of a file as described by a zsync (0.6) control file.
+// The checksums are used to find the blocks of the file that are already
+// present in a local seed so that only the missing ones are downloaded.
+class DeltaControl {
+ public:
+    DeltaControl() = default;
+
+    bool parse(const QByteArray& data);
+    QString lastError() const;
+
+    qint64 blockSize() const;
+    qint64 length() const;
+    int blockCount() const;
+    // hex sha1 of the whole file, empty if the control file has none
+    QString sha1() const;
+
+    // segments of the target file in order, the blocks that were found in
+    // the seed are copied from it and the rest must be downloaded
+    QList<DeltaSegment> match(const QString& seedPath) const;
+
+    // rolling checksum of the block as used by zsync: (a << 16) | b
+    static quint32 weakSum(const uchar* data, qint64 length);
+    // md4 of the block, the last block is padded with zeros
+    static QByteArray strongSum(const uchar* data, qint64 length,
+                                qint64 blockSize);
+
+ private:
+    void findBlocks(const uchar* data, qint64 size,
+                    QVector<qint64>& found) const;
+    bool strongEquals(int block, const QByteArray& strong) const;
+
+ private:
+    QString _lastError;
+    qint64 _blockSize = 0;
+    int _blockShift = 0;
+    qint64 _length = 0;
+    int _seqMatches = 1;
+    int _weakBytes = 4;
+    int _strongBytes = 16;
+    quint32 _weakMask = 0xffffffff;
+    QString _sha1;
+    QVector<quint32> _weak;
+    // all the truncated strong sums one after the other
+    QByteArray _strong;
+};
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_DELTA_CONTROL_H
@@ -0,0 +1,388 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <glog/logging.h>
+#include <ubuntu/transfers/system/logger.h>
+#include <ubuntu/transfers/system/request_factory.h>
+#include "header_parser.h"
+#include "delta_transfer.h"
+
+namespace {
+    // servers limit the size of the headers, keep the list of ranges short
+    const int MAX_RANGES = 32;
+    const qint64 COPY_CHUNK_SIZE = 1024 * 1024;
+    const QByteArray CONTENT_TYPE = "Content-Type";
+    const QByteArray CONTENT_RANGE = "Content-Range";
+    const QByteArray RANGE = "Range";
+}
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+DeltaTransfer::DeltaTransfer(const QNetworkRequest& request,
+                             const QUrl& control,
+                             const QString& seedPath,
+                             File* output,
+                             QObject* parent)
+    : QObject(parent),
+      _request(request),
+      _control(control),
+      _seedPath(seedPath),
+      _output(output) {
+}
+
+DeltaTransfer::~DeltaTransfer() {
+    if (_reply != nullptr) {
+        disconnect(_reply, nullptr, this, nullptr);
+        _reply->abort();
+        releaseReply();
+    }
+}
+
+void
+DeltaTransfer::start() {
+    TRACE << _control << _seedPath;
+    _failed = false;
+    _written = _output->size();
+
+    // the control file uses the same credentials as the data
+    auto request = _request;
+    request.setUrl(_control);
+    _reply = get(request);
+    CHECK(connect(_reply, &NetworkReply::finished,
+        this, &DeltaTransfer::onControlFinished))
+            << "Could not connect to signal";
+}
+
+void
+DeltaTransfer::stop() {
+    TRACE << _control;
+    // nothing to report once the owner stopped us
+    _failed = true;
+    if (_reply != nullptr) {
+        disconnect(_reply, nullptr, this, nullptr);
+        // do abort before reading
+        _reply->abort();
+        if (!_parser.isNull()) {
+            readData();
+        }
+        releaseReply();
+    }
+}
+
+void
+DeltaTransfer::setThrottle(qulonglong speed) {
+    _throttle = speed;
+    if (_reply != nullptr) {
+        _reply->setReadBufferSize(speed);
+    }
+}
+
+qulonglong
+DeltaTransfer::totalSize() const {
+    return static_cast<qulonglong>(_deltaControl.length());
+}
+
+QString
+DeltaTransfer::sha1() const {
+    return _deltaControl.sha1();
+}
+
+NetworkReply*
+DeltaTransfer::get(const QNetworkRequest& request) {
+    auto reply = RequestFactory::instance()->get(request);
+    reply->setReadBufferSize(_throttle);
+    CHECK(connect(reply, &NetworkReply::error,
+        this, &DeltaTransfer::onError))
+            << "Could not connect to signal";
+    CHECK(connect(reply, &NetworkReply::sslErrors,
+        this, &DeltaTransfer::onSslErrors))
+            << "Could not connect to signal";
+    return reply;
+}
+
+void
+DeltaTransfer::releaseReply() {
+    if (_reply != nullptr) {
+        disconnect(_reply, nullptr, this, nullptr);
+        _reply->deleteLater();
+        _reply = nullptr;
+    }
+}
+
+void
+DeltaTransfer::fail(const QString& reason) {
+    if (_failed) {
+        return;
+    }
+    _failed = true;
+    if (_reply != nullptr) {
+        disconnect(_reply, nullptr, this, nullptr);
+        _reply->abort();
+        releaseReply();
+    }
+    LOG(WARNING) << "Delta transfer failed: " << reason;
+    emit failed(reason);
+}
+
+void
+DeltaTransfer::requestRanges() {
+    if (!writeSeedSegments()) {
+        return;
+    }
+
+    if (_segment >= _segments.count()) {
+        emit progress(_written, totalSize());
+        emit finished();
+        return;
+    }
+
+    // the blocks between the ranges are copied from the seed as the data
+    // of the ranges arrives
+    QByteArrayList ranges;
+    for (int index = _segment; index < _segments.count()
+            && ranges.count() < MAX_RANGES; index++) {
+        auto segment = _segments[index];
+        if (!segment.isRemote()) {
+            continue;
+        }
+        auto first = qMax(segment.offset, _written);
+        auto last = segment.offset + segment.length - 1;
+        ranges << QByteArray::number(first) + "-" + QByteArray::number(last);
+    }
+
+    auto request = _request;
+    request.setRawHeader(RANGE, "bytes=" + ranges.join(','));
+    _requestStart = _written;
+    _parser.reset();
+    _reply = get(request);
+    CHECK(connect(_reply, &NetworkReply::downloadProgress,
+        this, &DeltaTransfer::onDownloadProgress))
+            << "Could not connect to signal";
+    CHECK(connect(_reply, &NetworkReply::finished,
+        this, &DeltaTransfer::onRangesFinished))
+            << "Could not connect to signal";
+}
+
+bool
+DeltaTransfer::writeSeedSegments() {
+    while (_segment < _segments.count() && !_segments[_segment].isRemote()) {
+        auto segment = _segments[_segment];
+        auto end = segment.offset + segment.length;
+        while (_written < end) {
+            auto size = qMin(COPY_CHUNK_SIZE, end - _written);
+            if (!_seed.seek(segment.seedOffset + _written - segment.offset)) {
+                fail("Could not read the seed.");
+                return false;
+            }
+            auto data = _seed.read(size);
+            if (data.size() != size || _output->write(data) != size) {
+                fail("Could not copy the data of the seed.");
+                return false;
+            }
+            _written += size;
+        }
+        _segment++;
+    }
+    return true;
+}
+
+bool
+DeltaTransfer::writePart(const ByteRangesParser::Part& part) {
+    auto position = part.offset;
+    int index = 0;
+    while (index < part.data.size()) {
+        // a server can merge close ranges, the data that belongs to the
+        // seed segments between them is skipped
+        if (!writeSeedSegments()) {
+            return false;
+        }
+        if (_segment >= _segments.count()) {
+            break;
+        }
+
+        auto segment = _segments[_segment];
+        auto end = position + part.data.size() - index;
+        if (end <= _written) {
+            break;
+        }
+        if (position > _written) {
+            fail("The server did not send the requested ranges.");
+            return false;
+        }
+
+        auto skip = _written - position;
+        index += skip;
+        position += skip;
+
+        auto size = qMin<qint64>(part.data.size() - index,
+            segment.offset + segment.length - _written);
+        if (_output->write(part.data.mid(index, size)) != size) {
+            fail("Could not write the data.");
+            return false;
+        }
+        index += size;
+        position += size;
+        _written += size;
+
+        if (_written == segment.offset + segment.length) {
+            _segment++;
+        }
+    }
+    return true;
+}
+
+void
+DeltaTransfer::readData() {
+    if (_parser.isNull()) {
+        // a server that does not support ranges sends the whole file
+        auto status = _reply->attribute(
+            QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status != 206) {
+            fail(QString("The server does not support ranges: %1").arg(
+                status));
+            return;
+        }
+
+        auto boundary = HeaderParser::boundaryFromContentType(
+            _reply->rawHeader(CONTENT_TYPE));
+        if (!boundary.isEmpty()) {
+            _parser.reset(new ByteRangesParser(boundary));
+        } else {
+            // a single range is sent without a multipart body
+            qint64 first = 0;
+            qint64 last = 0;
+            if (!HeaderParser::rangeFromContentRange(
+                    _reply->rawHeader(CONTENT_RANGE), first, last)) {
+                fail("Missing Content-Range.");
+                return;
+            }
+            _parser.reset(new ByteRangesParser(first, last - first + 1));
+        }
+    }
+
+    QList<ByteRangesParser::Part> parts;
+    if (!_parser->feed(_reply->readAll(), parts)) {
+        fail(_parser->lastError());
+        return;
+    }
+
+    foreach(const ByteRangesParser::Part& part, parts) {
+        if (!writePart(part)) {
+            return;
+        }
+    }
+}
+
+void
+DeltaTransfer::onControlFinished() {
+    auto data = _reply->readAll();
+    releaseReply();
+    if (_failed) {
+        return;
+    }
+
+    if (!_deltaControl.parse(data)) {
+        fail(QString("Invalid control file: %1").arg(
+            _deltaControl.lastError()));
+        return;
+    }
+
+    if (_written > _deltaControl.length()) {
+        fail("The output is larger than the file.");
+        return;
+    }
+
+    _segments = _deltaControl.match(_seedPath);
+
+    qint64 reused = 0;
+    foreach(const DeltaSegment& segment, _segments) {
+        if (!segment.isRemote()) {
+            reused += segment.length;
+        }
+    }
+    LOG(INFO) << "Reusing " << reused << " of " << _deltaControl.length()
+        << " bytes from " << _seedPath;
+
+    if (reused > 0 && !_seed.isOpen()) {
+        _seed.setFileName(_seedPath);
+        if (!_seed.open(QIODevice::ReadOnly)) {
+            fail("Could not open the seed.");
+            return;
+        }
+    }
+
+    // skip the data that was written by a previous run
+    _segment = 0;
+    while (_segment < _segments.count()
+            && _segments[_segment].offset + _segments[_segment].length
+                <= _written) {
+        _segment++;
+    }
+
+    emit progress(_written, totalSize());
+    requestRanges();
+}
+
+void
+DeltaTransfer::onDownloadProgress(qint64 received, qint64 total) {
+    Q_UNUSED(received);
+    Q_UNUSED(total);
+    readData();
+    if (!_failed) {
+        emit progress(_written, totalSize());
+    }
+}
+
+void
+DeltaTransfer::onRangesFinished() {
+    // the last chunk of data might not have been read
+    readData();
+    if (_failed) {
+        return;
+    }
+    releaseReply();
+
+    if (_written == _requestStart) {
+        fail("The server did not send the requested ranges.");
+        return;
+    }
+    requestRanges();
+}
+
+void
+DeltaTransfer::onError(QNetworkReply::NetworkError code) {
+    fail(QString("Network error %1: %2").arg(code).arg(
+        _reply->errorString()));
+}
+
+void
+DeltaTransfer::onSslErrors(const QList<QSslError>& errors) {
+    if (!_reply->canIgnoreSslErrors(errors)) {
+        fail("SSL error.");
+    }
+}
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
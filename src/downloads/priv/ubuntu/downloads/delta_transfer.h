@@ -0,0 +1,115 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_DELTA_TRANSFER_H
+#define DOWNLOADER_LIB_DELTA_TRANSFER_H
+
+#include <QByteArrayList>
+#include <QFile>
+#include <QList>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QScopedPointer>
+#include <QSslError>
+#include <QUrl>
+#include <ubuntu/transfers/system/file_manager.h>
+#include <ubuntu/transfers/system/network_reply.h>
+#include "byte_ranges_parser.h"
+#include "delta_control.h"
+
+namespace Ubuntu {
+
+using namespace Transfers::System;
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+// Builds a file from the blocks of a local seed that are still valid and
+// the missing ones, which are requested to the server using multi range
+// requests. The data is appended in order to the output so that a paused
+// transfer can be started again from the size of the output.
+class DeltaTransfer : public QObject {
+    Q_OBJECT
+
+ public:
+    DeltaTransfer(const QNetworkRequest& request,
+                  const QUrl& control,
+                  const QString& seedPath,
+                  File* output,
+                  QObject* parent = 0);
+    virtual ~DeltaTransfer();
+
+    // the output might already contain the data of a previous transfer
+    void start();
+    // writes the data that was already received and aborts the request
+    void stop();
+
+    void setThrottle(qulonglong speed);
+    // bytes of the file, 0 until the control file was downloaded
+    qulonglong totalSize() const;
+    // hex sha1 of the file as given by the control file
+    QString sha1() const;
+
+ signals:
+    void progress(qulonglong received, qulonglong total);
+    void finished();
+    // the delta cannot be used, the whole file has to be downloaded
+    void failed(const QString& reason);
+
+ private:
+    NetworkReply* get(const QNetworkRequest& request);
+    void releaseReply();
+    void fail(const QString& reason);
+    void requestRanges();
+    bool writeSeedSegments();
+    bool writePart(const ByteRangesParser::Part& part);
+    void readData();
+
+    // slots used to react to signals
+    void onControlFinished();
+    void onDownloadProgress(qint64 received, qint64 total);
+    void onRangesFinished();
+    void onError(QNetworkReply::NetworkError code);
+    void onSslErrors(const QList<QSslError>& errors);
+
+ private:
+    QNetworkRequest _request;
+    QUrl _control;
+    QString _seedPath;
+    QFile _seed;
+    File* _output = nullptr;
+    NetworkReply* _reply = nullptr;
+    qulonglong _throttle = 0;
+    bool _failed = false;
+    DeltaControl _deltaControl;
+    QList<DeltaSegment> _segments;
+    int _segment = 0;  // first segment that was not fully written
+    qint64 _written = 0;  // bytes of the output
+    qint64 _requestStart = 0;  // written when the ranges were requested
+    QScopedPointer<ByteRangesParser> _parser;
+};
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_DELTA_TRANSFER_H
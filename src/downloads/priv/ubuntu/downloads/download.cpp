@@ -17,6 +17,7 @@
  */
 
 #include <QStringList>
+#include "ubuntu/transfers/i18n.h"
 #include "ubuntu/transfers/metadata.h"
 #include "ubuntu/transfers/system/logger.h"
 #include "download.h"
@@ -53,6 +54,26 @@ Download::setAdaptor(const QString& interface, QObject* adaptor) {
     _adaptors[interface] = adaptor;
 }
 
+QString
+Download::storagePath() {
+    return filePath();
+}
+
+bool
+Download::setOutputDescriptor(int fd) {
+    Q_UNUSED(fd);
+    setIsValid(false);
+    setLastError(QString(_("The download cannot be written to a descriptor.")));
+    return false;
+}
+
+qulonglong
+Download::requiredSpace() {
+    auto total = totalSize();
+    auto received = progress();
+    return (total > received)? total - received : 0;
+}
+
 void
 Download::emitError(const QString& errorStr) {
     setState(Download::ERROR);
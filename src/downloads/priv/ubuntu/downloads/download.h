@@ -67,6 +67,13 @@ class Download : public Transfer {
         return true;
     }
 
+    virtual QString storagePath() override;
+    virtual qulonglong requiredSpace() override;
+
+    // downloads that can write the data in a descriptor of the client
+    // override it, the rest become invalid
+    virtual bool setOutputDescriptor(int fd);
+
  public slots:  // NOLINT(whitespace/indent)
     // slots that are exposed via dbus, they just change the state,
     // the downloader takes care of the actual download operations
@@ -105,7 +112,13 @@ class Download : public Transfer {
     }
 
     virtual int stateInt() const {
-        return Transfer::state();
+        // waiting for space is internal to the queue, clients see a
+        // started download that did not make any progress yet
+        auto current = Transfer::state();
+        if (current == Transfer::WAITING_FOR_SPACE) {
+            return Transfer::START;
+        }
+        return current;
     }
 
     // slots to be implemented by the children
@@ -5,6 +5,8 @@
  * qdbusxml2cpp is Copyright (C) 2015 Digia Plc and/or its subsidiary(-ies).
  *
  * This file has been manually edited to wrap the state -> stateInt methods
+ *
+ * HAND-EDIT: the method calls are timed in the metrics of the daemon
  */
 
 #include "download_adaptor.h"
@@ -15,6 +17,9 @@
 #include <QtCore/QString>
 #include <QtCore/QStringList>
 #include <QtCore/QVariant>
+#include <ubuntu/transfers/system/metrics.h>
+
+using Ubuntu::Transfers::System::DBusCallTimer;
 
 /*
  * Implementation of adaptor class DownloadAdaptor
@@ -59,24 +64,37 @@ QString DownloadAdaptor::title() const
 void DownloadAdaptor::allowGSMDownload(bool allowed)
 {
     // handle method call com.canonical.applications.Download.allowGSMDownload
+    DBusCallTimer timer("Download.allowGSMDownload");
     QMetaObject::invokeMethod(parent(), "allowGSMDownload", Q_ARG(bool, allowed));
 }
 
 void DownloadAdaptor::cancel()
 {
     // handle method call com.canonical.applications.Download.cancel
+    DBusCallTimer timer("Download.cancel");
     QMetaObject::invokeMethod(parent(), "cancel");
 }
 
 void DownloadAdaptor::collected()
 {
     // handle method call com.canonical.applications.Download.collected
+    DBusCallTimer timer("Download.collected");
     QMetaObject::invokeMethod(parent(), "collected");
 }
 
+qulonglong DownloadAdaptor::contiguousBytes()
+{
+    // handle method call com.canonical.applications.Download.contiguousBytes
+    DBusCallTimer timer("Download.contiguousBytes");
+    qulonglong bytes;
+    QMetaObject::invokeMethod(parent(), "contiguousBytes", Q_RETURN_ARG(qulonglong, bytes));
+    return bytes;
+}
+
 QString DownloadAdaptor::filePath()
 {
     // handle method call com.canonical.applications.Download.filePath
+    DBusCallTimer timer("Download.filePath");
     QString filePath;
     QMetaObject::invokeMethod(parent(), "filePath", Q_RETURN_ARG(QString, filePath));
     return filePath;    
@@ -85,6 +103,7 @@ QString DownloadAdaptor::filePath()
 StringMap DownloadAdaptor::headers()
 {
     // handle method call com.canonical.applications.Download.headers
+    DBusCallTimer timer("Download.headers");
     StringMap headers;
     QMetaObject::invokeMethod(parent(), "headers", Q_RETURN_ARG(StringMap, headers));
     return headers;
@@ -93,6 +112,7 @@ StringMap DownloadAdaptor::headers()
 bool DownloadAdaptor::isGSMDownloadAllowed()
 {
     // handle method call com.canonical.applications.Download.isGSMDownloadAllowed
+    DBusCallTimer timer("Download.isGSMDownloadAllowed");
     bool allowed;
     QMetaObject::invokeMethod(parent(), "isGSMDownloadAllowed", Q_RETURN_ARG(bool, allowed));
     return allowed;
@@ -101,20 +121,32 @@ bool DownloadAdaptor::isGSMDownloadAllowed()
 QVariantMap DownloadAdaptor::metadata()
 {
     // handle method call com.canonical.applications.Download.metadata
+    DBusCallTimer timer("Download.metadata");
     QVariantMap data;
     QMetaObject::invokeMethod(parent(), "metadata", Q_RETURN_ARG(QVariantMap, data));
     return data;
 }
 
+QDBusUnixFileDescriptor DownloadAdaptor::openReadDescriptor()
+{
+    // handle method call com.canonical.applications.Download.openReadDescriptor
+    DBusCallTimer timer("Download.openReadDescriptor");
+    QDBusUnixFileDescriptor fd;
+    QMetaObject::invokeMethod(parent(), "openReadDescriptor", Q_RETURN_ARG(QDBusUnixFileDescriptor, fd));
+    return fd;
+}
+
 void DownloadAdaptor::pause()
 {
     // handle method call com.canonical.applications.Download.pause
+    DBusCallTimer timer("Download.pause");
     QMetaObject::invokeMethod(parent(), "pause");
 }
 
 qulonglong DownloadAdaptor::progress()
 {
     // handle method call com.canonical.applications.Download.progress
+    DBusCallTimer timer("Download.progress");
     qulonglong received;
     QMetaObject::invokeMethod(parent(), "progress", Q_RETURN_ARG(qulonglong, received));
     return received;
@@ -123,42 +155,94 @@ qulonglong DownloadAdaptor::progress()
 void DownloadAdaptor::resume()
 {
     // handle method call com.canonical.applications.Download.resume
+    DBusCallTimer timer("Download.resume");
     QMetaObject::invokeMethod(parent(), "resume");
 }
 
+uint DownloadAdaptor::retries()
+{
+    // handle method call com.canonical.applications.Download.retries
+    DBusCallTimer timer("Download.retries");
+    uint retries;
+    QMetaObject::invokeMethod(parent(), "retries", Q_RETURN_ARG(uint, retries));
+    return retries;
+}
+
 void DownloadAdaptor::setDestinationDir(const QString &path)
 {
     // handle method call com.canonical.applications.Download.setDestinationDir
+    DBusCallTimer timer("Download.setDestinationDir");
     QMetaObject::invokeMethod(parent(), "setDestinationDir", Q_ARG(QString, path));
 }
 
 void DownloadAdaptor::setHeaders(StringMap headers)
 {
     // handle method call com.canonical.applications.Download.setHeaders
+    DBusCallTimer timer("Download.setHeaders");
     QMetaObject::invokeMethod(parent(), "setHeaders", Q_ARG(StringMap, headers));
 }
 
 void DownloadAdaptor::setMetadata(const QVariantMap &data)
 {
     // handle method call com.canonical.applications.Download.setMetadata
+    DBusCallTimer timer("Download.setMetadata");
     QMetaObject::invokeMethod(parent(), "setMetadata", Q_ARG(QVariantMap, data));
 }
 
 void DownloadAdaptor::setThrottle(qulonglong speed)
 {
     // handle method call com.canonical.applications.Download.setThrottle
+    DBusCallTimer timer("Download.setThrottle");
     QMetaObject::invokeMethod(parent(), "setThrottle", Q_ARG(qulonglong, speed));
 }
 
+QVariantMap DownloadAdaptor::sourcesThroughput()
+{
+    // handle method call com.canonical.applications.Download.sourcesThroughput
+    DBusCallTimer timer("Download.sourcesThroughput");
+    QVariantMap throughput;
+    QMetaObject::invokeMethod(parent(), "sourcesThroughput", Q_RETURN_ARG(QVariantMap, throughput));
+    return throughput;
+}
+
+QVariantList DownloadAdaptor::timeline()
+{
+    // handle method call com.canonical.applications.Download.timeline
+    DBusCallTimer timer("Download.timeline");
+    QVariantList spans;
+    QMetaObject::invokeMethod(parent(), "timeline", Q_RETURN_ARG(QVariantList, spans));
+    return spans;
+}
+
+QString DownloadAdaptor::chromeTrace()
+{
+    // handle method call com.canonical.applications.Download.chromeTrace
+    DBusCallTimer timer("Download.chromeTrace");
+    QString trace;
+    QMetaObject::invokeMethod(parent(), "chromeTrace", Q_RETURN_ARG(QString, trace));
+    return trace;
+}
+
+uint DownloadAdaptor::stalls()
+{
+    // handle method call com.canonical.applications.Download.stalls
+    DBusCallTimer timer("Download.stalls");
+    uint stalls;
+    QMetaObject::invokeMethod(parent(), "stalls", Q_RETURN_ARG(uint, stalls));
+    return stalls;
+}
+
 void DownloadAdaptor::start()
 {
     // handle method call com.canonical.applications.Download.start
+    DBusCallTimer timer("Download.start");
     QMetaObject::invokeMethod(parent(), "start");
 }
 
 int DownloadAdaptor::state()
 {
     // handle method call com.canonical.applications.Download.state
+    DBusCallTimer timer("Download.state");
     int state;
     QMetaObject::invokeMethod(parent(), "stateInt", Q_RETURN_ARG(int, state));
    
@@ -168,6 +252,7 @@ int DownloadAdaptor::state()
 qulonglong DownloadAdaptor::throttle()
 {
     // handle method call com.canonical.applications.Download.throttle
+    DBusCallTimer timer("Download.throttle");
     qulonglong speed;
     QMetaObject::invokeMethod(parent(), "throttle", Q_RETURN_ARG(qulonglong, speed));
     return speed;
@@ -176,6 +261,7 @@ qulonglong DownloadAdaptor::throttle()
 qulonglong DownloadAdaptor::totalSize()
 {
     // handle method call com.canonical.applications.Download.totalSize
+    DBusCallTimer timer("Download.totalSize");
     qulonglong total;
     QMetaObject::invokeMethod(parent(), "totalSize", Q_RETURN_ARG(qulonglong, total));
     return total;
@@ -40,6 +40,29 @@ class DownloadAdaptor: public QDBusAbstractAdaptor
 "    <method name=\"progress\">\n"
 "      <arg direction=\"out\" type=\"t\" name=\"received\"/>\n"
 "    </method>\n"
+"    <method name=\"retries\">\n"
+"      <arg direction=\"out\" type=\"u\" name=\"retries\"/>\n"
+"    </method>\n"
+"    <method name=\"stalls\">\n"
+"      <arg direction=\"out\" type=\"u\" name=\"stalls\"/>\n"
+"    </method>\n"
+"    <method name=\"contiguousBytes\">\n"
+"      <arg direction=\"out\" type=\"t\" name=\"bytes\"/>\n"
+"    </method>\n"
+"    <method name=\"openReadDescriptor\">\n"
+"      <arg direction=\"out\" type=\"h\" name=\"fd\"/>\n"
+"    </method>\n"
+"    <method name=\"sourcesThroughput\">\n"
+"      <annotation value=\"QVariantMap\" name=\"org.qtproject.QtDBus.QtTypeName.Out0\"/>\n"
+"      <arg direction=\"out\" type=\"a{sv}\" name=\"throughput\"/>\n"
+"    </method>\n"
+"    <method name=\"timeline\">\n"
+"      <annotation value=\"QVariantList\" name=\"org.qtproject.QtDBus.QtTypeName.Out0\"/>\n"
+"      <arg direction=\"out\" type=\"av\" name=\"spans\"/>\n"
+"    </method>\n"
+"    <method name=\"chromeTrace\">\n"
+"      <arg direction=\"out\" type=\"s\" name=\"trace\"/>\n"
+"    </method>\n"
 "    <method name=\"metadata\">\n"
 "      <annotation value=\"QVariantMap\" name=\"org.qtproject.QtDBus.QtTypeName.Out0\"/>\n"
 "      <arg direction=\"out\" type=\"a{sv}\" name=\"data\"/>\n"
@@ -124,6 +147,9 @@ class DownloadAdaptor: public QDBusAbstractAdaptor
 "      <arg direction=\"out\" type=\"t\" name=\"received\"/>\n"
 "      <arg direction=\"out\" type=\"t\" name=\"total\"/>\n"
 "    </signal>\n"
+"    <signal name=\"contiguousBytesAvailable\">\n"
+"      <arg direction=\"out\" type=\"t\" name=\"bytes\"/>\n"
+"    </signal>\n"
 "    <signal name=\"processing\">\n"
 "      <arg direction=\"out\" type=\"s\" name=\"path\"/>\n"
 "    </signal>\n"
@@ -153,25 +179,33 @@ public: // PROPERTIES
 public Q_SLOTS: // METHODS
     void allowGSMDownload(bool allowed);
     void cancel();
+    QString chromeTrace();
     void collected();
+    qulonglong contiguousBytes();
     QString filePath();
     StringMap headers();
     bool isGSMDownloadAllowed();
     QVariantMap metadata();
+    QDBusUnixFileDescriptor openReadDescriptor();
     void pause();
     qulonglong progress();
     void resume();
+    uint retries();
     void setDestinationDir(const QString &path);
     void setHeaders(StringMap headers);
     void setMetadata(const QVariantMap &data);
     void setThrottle(qulonglong speed);
+    QVariantMap sourcesThroughput();
+    uint stalls();
     void start();
     int state();
     qulonglong throttle();
+    QVariantList timeline();
     qulonglong totalSize();
 Q_SIGNALS: // SIGNALS
     void authError(AuthErrorStruct error);
     void canceled(bool success);
+    void contiguousBytesAvailable(qulonglong bytes);
     void error(const QString &error);
     void finished(const QString &path);
     void hashError(HashErrorStruct error);
@@ -6,6 +6,8 @@
  *
  * This is an auto-generated file.
  * Do not edit! All changes made to it will be lost.
+ *
+ * HAND-EDIT: the method calls are timed in the metrics of the daemon
  */
 
 #include "download_manager_adaptor.h"
@@ -16,6 +18,7 @@
 #include <QtCore/QString>
 #include <QtCore/QStringList>
 #include <QtCore/QVariant>
+#include <ubuntu/transfers/system/metrics.h>
 
 namespace Ubuntu {
 
@@ -23,6 +26,8 @@ namespace DownloadManager {
 
 namespace Daemon {
 
+using Ubuntu::Transfers::System::DBusCallTimer;
+
 /*
  * Implementation of adaptor class DownloadManagerAdaptor
  */
@@ -42,12 +47,14 @@ DownloadManagerAdaptor::~DownloadManagerAdaptor()
 void DownloadManagerAdaptor::allowGSMDownload(bool allowed)
 {
     // handle method call com.canonical.applications.DownloadManager.allowGSMDownload
+    DBusCallTimer timer("DownloadManager.allowGSMDownload");
     QMetaObject::invokeMethod(parent(), "allowGSMDownload", Q_ARG(bool, allowed));
 }
 
 QDBusObjectPath DownloadManagerAdaptor::createDownload(DownloadStruct download)
 {
     // handle method call com.canonical.applications.DownloadManager.createDownload
+    DBusCallTimer timer("DownloadManager.createDownload");
     QDBusObjectPath downloadPath;
     QMetaObject::invokeMethod(parent(), "createDownload", Q_RETURN_ARG(QDBusObjectPath, downloadPath), Q_ARG(DownloadStruct, download));
     return downloadPath;
@@ -56,14 +63,25 @@ QDBusObjectPath DownloadManagerAdaptor::createDownload(DownloadStruct download)
 QDBusObjectPath DownloadManagerAdaptor::createDownloadGroup(StructList downloads, const QString &algorithm, bool allowed3G, const QVariantMap &metadata, StringMap headers)
 {
     // handle method call com.canonical.applications.DownloadManager.createDownloadGroup
+    DBusCallTimer timer("DownloadManager.createDownloadGroup");
     QDBusObjectPath download;
     QMetaObject::invokeMethod(parent(), "createDownloadGroup", Q_RETURN_ARG(QDBusObjectPath, download), Q_ARG(StructList, downloads), Q_ARG(QString, algorithm), Q_ARG(bool, allowed3G), Q_ARG(QVariantMap, metadata), Q_ARG(StringMap, headers));
     return download;
 }
 
+QDBusObjectPath DownloadManagerAdaptor::createDownloadWithFd(DownloadStruct download, const QDBusUnixFileDescriptor &fd)
+{
+    // handle method call com.canonical.applications.DownloadManager.createDownloadWithFd
+    DBusCallTimer timer("DownloadManager.createDownloadWithFd");
+    QDBusObjectPath downloadPath;
+    QMetaObject::invokeMethod(parent(), "createDownloadWithFd", Q_RETURN_ARG(QDBusObjectPath, downloadPath), Q_ARG(DownloadStruct, download), Q_ARG(QDBusUnixFileDescriptor, fd));
+    return downloadPath;
+}
+
 QDBusObjectPath DownloadManagerAdaptor::createMmsDownload(const QString &url, const QString &hostname, int port)
 {
     // handle method call com.canonical.applications.DownloadManager.createMmsDownload
+    DBusCallTimer timer("DownloadManager.createMmsDownload");
     QDBusObjectPath downloadPath;
     QMetaObject::invokeMethod(parent(), "createMmsDownload", Q_RETURN_ARG(QDBusObjectPath, downloadPath), Q_ARG(QString, url), Q_ARG(QString, hostname), Q_ARG(int, port));
     return downloadPath;
@@ -72,6 +90,7 @@ QDBusObjectPath DownloadManagerAdaptor::createMmsDownload(const QString &url, co
 qulonglong DownloadManagerAdaptor::defaultThrottle()
 {
     // handle method call com.canonical.applications.DownloadManager.defaultThrottle
+    DBusCallTimer timer("DownloadManager.defaultThrottle");
     qulonglong speed;
     QMetaObject::invokeMethod(parent(), "defaultThrottle", Q_RETURN_ARG(qulonglong, speed));
     return speed;
@@ -80,12 +99,14 @@ qulonglong DownloadManagerAdaptor::defaultThrottle()
 void DownloadManagerAdaptor::exit()
 {
     // handle method call com.canonical.applications.DownloadManager.exit
+    DBusCallTimer timer("DownloadManager.exit");
     QMetaObject::invokeMethod(parent(), "exit");
 }
 
 QList<QDBusObjectPath> DownloadManagerAdaptor::getAllDownloads(const QString &appId, bool uncollected)
 {
     // handle method call com.canonical.applications.DownloadManager.getAllDownloads
+    DBusCallTimer timer("DownloadManager.getAllDownloads");
     QList<QDBusObjectPath> downloads;
     QMetaObject::invokeMethod(parent(), "getAllDownloads", Q_RETURN_ARG(QList<QDBusObjectPath>, downloads), Q_ARG(QString, appId), Q_ARG(bool, uncollected));
     return downloads;
@@ -94,6 +115,7 @@ QList<QDBusObjectPath> DownloadManagerAdaptor::getAllDownloads(const QString &ap
 QList<QDBusObjectPath> DownloadManagerAdaptor::getAllDownloadsWithMetadata(const QString &name, const QString &value)
 {
     // handle method call com.canonical.applications.DownloadManager.getAllDownloadsWithMetadata
+    DBusCallTimer timer("DownloadManager.getAllDownloadsWithMetadata");
     QList<QDBusObjectPath> downloads;
     QMetaObject::invokeMethod(parent(), "getAllDownloadsWithMetadata", Q_RETURN_ARG(QList<QDBusObjectPath>, downloads), Q_ARG(QString, name), Q_ARG(QString, value));
     return downloads;
@@ -102,6 +124,7 @@ QList<QDBusObjectPath> DownloadManagerAdaptor::getAllDownloadsWithMetadata(const
 DownloadStateStruct DownloadManagerAdaptor::getDownloadState(const QString &downloadId)
 {
     // handle method call com.canonical.applications.DownloadManager.getDownloadState
+    DBusCallTimer timer("DownloadManager.getDownloadState");
     DownloadStateStruct state;
     QMetaObject::invokeMethod(parent(), "getDownloadState", Q_RETURN_ARG(DownloadStateStruct, state), Q_ARG(QString, downloadId));
     return state;
@@ -110,6 +133,7 @@ DownloadStateStruct DownloadManagerAdaptor::getDownloadState(const QString &down
 bool DownloadManagerAdaptor::isGSMDownloadAllowed()
 {
     // handle method call com.canonical.applications.DownloadManager.isGSMDownloadAllowed
+    DBusCallTimer timer("DownloadManager.isGSMDownloadAllowed");
     bool allowed;
     QMetaObject::invokeMethod(parent(), "isGSMDownloadAllowed", Q_RETURN_ARG(bool, allowed));
     return allowed;
@@ -118,6 +142,7 @@ bool DownloadManagerAdaptor::isGSMDownloadAllowed()
 void DownloadManagerAdaptor::setDefaultThrottle(qulonglong speed)
 {
     // handle method call com.canonical.applications.DownloadManager.setDefaultThrottle
+    DBusCallTimer timer("DownloadManager.setDefaultThrottle");
     QMetaObject::invokeMethod(parent(), "setDefaultThrottle", Q_ARG(qulonglong, speed));
 }
 
@@ -45,6 +45,12 @@ class DownloadManagerAdaptor: public QDBusAbstractAdaptor
 "      <arg direction=\"in\" type=\"(sssa{sv}a{ss})\" name=\"download\"/>\n"
 "      <arg direction=\"out\" type=\"o\" name=\"downloadPath\"/>\n"
 "    </method>\n"
+"    <method name=\"createDownloadWithFd\">\n"
+"      <annotation value=\"DownloadStruct\" name=\"org.qtproject.QtDBus.QtTypeName.In0\"/>\n"
+"      <arg direction=\"in\" type=\"(sssa{sv}a{ss})\" name=\"download\"/>\n"
+"      <arg direction=\"in\" type=\"h\" name=\"fd\"/>\n"
+"      <arg direction=\"out\" type=\"o\" name=\"downloadPath\"/>\n"
+"    </method>\n"
 "    <method name=\"createMmsDownload\">\n"
 "      <arg direction=\"in\" type=\"s\" name=\"url\"/>\n"
 "      <arg direction=\"in\" type=\"s\" name=\"hostname\"/>\n"
@@ -103,6 +109,7 @@ public: // PROPERTIES
 public Q_SLOTS: // METHODS
     void allowGSMDownload(bool allowed);
     QDBusObjectPath createDownload(DownloadStruct download);
+    QDBusObjectPath createDownloadWithFd(DownloadStruct download, const QDBusUnixFileDescriptor &fd);
     QDBusObjectPath createDownloadGroup(StructList downloads, const QString &algorithm, bool allowed3G, const QVariantMap &metadata, StringMap headers);
     QDBusObjectPath createMmsDownload(const QString &url, const QString &hostname, int port);
     qulonglong defaultThrottle();
@@ -28,6 +28,7 @@
 #include <ubuntu/transfers/system/hash_algorithm.h>
 #include <unistd.h>
 #include "ubuntu/transfers/system/logger.h"
+#include "ubuntu/transfers/system/metrics.h"
 #include "downloads_db.h"
 #include "download_adaptor.h"
 
@@ -96,6 +97,10 @@ namespace {
     const QString ERROR_STRING = "error";
 
     const QString DOWNLOAD_INTERFACE = "com.canonical.applications.Download";
+
+    const QString DB_WRITE_METRIC = "udm_db_write_seconds";
+    const QString QUERY_LABEL = "query";
+    const QString STORE_QUERY = "store";
 }
 
 namespace Ubuntu {
@@ -184,6 +189,8 @@ DownloadsDb::stateToString(Download::State state) {
         case Download::IDLE:
             return IDLE_STRING;
         case Download::START:
+        case Download::WAITING_FOR_SPACE:
+            // the queue checks again the space once the download is loaded
             return START_STRING;
         case Download::PAUSE:
             return PAUSE_STRING;
@@ -362,6 +369,7 @@ DownloadsDb::getUncollectedDownloads(const QString &appId) {
 
 bool
 DownloadsDb::storeSingleDownload(FileDownload* download) {
+    MetricsTimer timer(DB_WRITE_METRIC, {{QUERY_LABEL, STORE_QUERY}});
     // decide if we store it as a new download or update an existing one
     bool opened = _db.open();
 
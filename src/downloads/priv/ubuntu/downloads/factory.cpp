@@ -31,6 +31,10 @@ namespace {
     const QString DOWNLOAD_INTERFACE = "com.canonical.applications.Download";
     const QString GROUP_INTERFACE = "com.canonical.applications.GroupDownload";
     const QString PROPERTY_INTERFACE = "org.freedesktop.DBus.Properties";
+    // the strings and headers are sent by the clients, do not let them
+    // grow the pools without a limit
+    const int MAX_SHARED_STRINGS = 1024;
+    const int MAX_SHARED_HEADERS = 32;
 }
 
 namespace Ubuntu {
@@ -86,8 +90,9 @@ Factory::createDownload(const QString& dbusOwner,
         // distinguish between different unconfined apps
         appId = metadata[Metadata::APP_ID].toString();
     }
-    auto down = new FileDownload(details->id, appId,
-        dbusPath, details->isConfined, details->localPath, url, metadata, headers);
+    auto down = new FileDownload(details->id, share(appId),
+        dbusPath, details->isConfined, share(details->localPath), url,
+        share(metadata), share(headers));
     auto downAdaptor = new DownloadAdaptor(down);
     down->setAdaptor(DOWNLOAD_INTERFACE, downAdaptor);
     return down;
@@ -103,9 +108,9 @@ Factory::createDownload(const QString& dbusOwner,
     QScopedPointer<SecurityDetails> details(
         getSecurityDetails(dbusOwner, metadata));
     auto dbusPath = details->dbusPath.arg("download");
-    auto down = new FileDownload(details->id, details->appId,
-        dbusPath, details->isConfined, details->localPath,
-        url, hash, algo, metadata, headers);
+    auto down = new FileDownload(details->id, share(details->appId),
+        dbusPath, details->isConfined, share(details->localPath),
+        url, hash, algo, share(metadata), share(headers));
     auto downAdaptor = new DownloadAdaptor(down);
     down->setAdaptor(DOWNLOAD_INTERFACE, downAdaptor);
     return down;
@@ -157,8 +162,8 @@ Factory::createDownloadForGroup(bool isConfined,
                                 const QMap<QString, QString>& headers) {
     auto idAndPath = _apparmor->getDBusPath();
     auto down = new FileDownload(idAndPath.first, "",
-        idAndPath.second.arg("download"), isConfined, rootPath, url,
-        metadata, headers);
+        idAndPath.second.arg("download"), isConfined, share(rootPath), url,
+        share(metadata), share(headers));
     auto downAdaptor = new DownloadAdaptor(down);
     down->setAdaptor(DOWNLOAD_INTERFACE, downAdaptor);
     return down;
@@ -174,13 +179,52 @@ Factory::createDownloadForGroup(bool isConfined,
                                 const QMap<QString, QString>& headers) {
     auto idAndPath = _apparmor->getDBusPath();
     auto down = new FileDownload(idAndPath.first, "",
-        idAndPath.second.arg("download"), isConfined, rootPath, url, hash,
-        algo, metadata, headers);
+        idAndPath.second.arg("download"), isConfined, share(rootPath), url,
+        hash, algo, share(metadata), share(headers));
     auto downAdaptor = new DownloadAdaptor(down);
     down->setAdaptor(DOWNLOAD_INTERFACE, downAdaptor);
     return down;
 }
 
+QString
+Factory::share(const QString& value) {
+    auto it = _sharedStrings.constFind(value);
+    if (it != _sharedStrings.constEnd()) {
+        return *it;
+    }
+    if (_sharedStrings.count() < MAX_SHARED_STRINGS) {
+        _sharedStrings.insert(value);
+    }
+    return value;
+}
+
+QVariantMap
+Factory::share(const QVariantMap& metadata) {
+    // only the keys are shared, the values are specific of each download
+    QVariantMap result;
+    for (auto it = metadata.constBegin(); it != metadata.constEnd(); ++it) {
+        result.insert(share(it.key()), it.value());
+    }
+    return result;
+}
+
+StringMap
+Factory::share(const StringMap& headers) {
+    if (headers.isEmpty()) {
+        return headers;
+    }
+    foreach(const StringMap& shared, _sharedHeaders) {
+        if (shared == headers) {
+            return shared;
+        }
+    }
+    if (_sharedHeaders.count() >= MAX_SHARED_HEADERS) {
+        _sharedHeaders.removeFirst();
+    }
+    _sharedHeaders.append(headers);
+    return headers;
+}
+
 QList<QSslCertificate>
 Factory::acceptedCertificates() {
     return RequestFactory::instance()->acceptedCertificates();
@@ -19,7 +19,9 @@
 #ifndef DOWNLOADER_LIB_DOWNLOAD_FACTORY_H
 #define DOWNLOADER_LIB_DOWNLOAD_FACTORY_H
 
+#include <QList>
 #include <QObject>
+#include <QSet>
 #include <ubuntu/download_manager/metatypes.h>
 #include <ubuntu/transfers/system/apparmor.h>
 #include <ubuntu/transfers/system/uuid_factory.h>
@@ -91,8 +93,17 @@ class Factory : public QObject {
     SecurityDetails* getSecurityDetails(const QString& dbusOwner,
                                         const QVariantMap& metadata);
 
+    // the downloads of an app repeat the same paths, metadata keys and
+    // headers, keep a single copy of them instead of the one that was
+    // demarshalled for each request
+    QString share(const QString& value);
+    QVariantMap share(const QVariantMap& metadata);
+    StringMap share(const StringMap& headers);
+
  private:
     AppArmor* _apparmor;
+    QSet<QString> _sharedStrings;
+    QList<StringMap> _sharedHeaders;
 };
 
 }  // Daemon
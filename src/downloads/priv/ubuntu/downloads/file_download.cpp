@@ -16,8 +16,13 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <cerrno>
+#include <cstring>
 #include <map>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <glog/logging.h>
 
 #include <QBuffer>
@@ -37,16 +42,28 @@
 #include <ubuntu/transfers/system/dbus_connection.h>
 #include <ubuntu/transfers/system/hash_algorithm.h>
 #include <ubuntu/transfers/system/cryptographic_hash.h>
+#include <ubuntu/transfers/system/content_cache.h>
 #include <ubuntu/transfers/system/logger.h>
+#include <ubuntu/transfers/system/metrics.h>
 #include <ubuntu/transfers/system/network_reply.h>
 #include <ubuntu/transfers/system/filename_mutex.h>
+#include <ubuntu/transfers/system/process_queue.h>
+#include <ubuntu/transfers/system/retry_policy.h>
+#include <ubuntu/transfers/system/timeline.h>
 #include <ubuntu/transfers/system/uuid_factory.h>
 #include <ubuntu/transfers/system/uuid_utils.h>
 
+#include "delta_transfer.h"
 #include "header_parser.h"
+#include "metalink_transfer.h"
+#include "range_transfer.h"
 #include "file_download.h"
+#include "shared_downloads.h"
 
 #define DOWN_LOG(LEVEL) LOG(LEVEL) << ((parent() != nullptr)?"GroupDownload {" + parent()->objectName() + " } ":"") << "Download ID{" << objectName() << " } "
+// used for the messages that are repeated while the download retries or
+// reconnects so that a flaky server cannot flood the log
+#define DOWN_LOG_LIMITED(LEVEL) LOG_RATE_LIMITED(LEVEL, this) << ((parent() != nullptr)?"GroupDownload {" + parent()->objectName() + " } ":"") << "Download ID{" << objectName() << " } "
 
 std::ostream& operator<<(std::ostream &out, QNetworkReply::NetworkError err) {
     static std::map<QNetworkReply::NetworkError, std::string> errorsMap {
@@ -160,7 +177,51 @@ namespace {
     const QString UNEXPECTED_ERROR = "UNEXPECTED_ERROR";
     const QByteArray CONTENT_DISPOSITION = "Content-Disposition";
     const QByteArray CONTENT_TYPE = "Content-Type";
+    const QByteArray CONTENT_RANGE = "Content-Range";
+    const QByteArray RETRY_AFTER = "Retry-After";
+    const QByteArray ETAG = "ETag";
+    const QByteArray LAST_MODIFIED = "Last-Modified";
+    const QByteArray IF_NONE_MATCH = "If-None-Match";
+    const QByteArray IF_MODIFIED_SINCE = "If-Modified-Since";
     const QString DATA_URI_PREFIX = "data:";
+    // msecs used to measure the throughput of a mirror
+    const qint64 MIRROR_SPEED_WINDOW = 10000;
+    const QString NO_SYNC_POLICY = "none";
+    const QString SYNC_ON_FINISH_POLICY = "finish";
+    const QString PERIODIC_SYNC_POLICY = "periodic";
+    // bytes between syncs when the client did not provide an interval
+    const qulonglong DEFAULT_SYNC_INTERVAL = 8 * 1024 * 1024;
+    // spans of the timeline of a download, the connect span covers the
+    // name resolution, the tcp connection and the tls handshake which are
+    // not reported separately by the network stack
+    const QString DOWNLOAD_SPAN = "download";
+    const QString CONNECT_SPAN = "connect";
+    const QString FIRST_BYTE_SPAN = "first byte";
+    const QString RECEIVE_SPAN = "receive";
+    const QString RETRY_SPAN = "retry wait";
+    const QString SHARED_SPAN = "shared";
+    const QString COPY_SPAN = "copy";
+    const QString DELTA_SPAN = "delta";
+    const QString METALINK_SPAN = "metalink";
+    const QString RANGES_SPAN = "ranges";
+    const QString SYNC_SPAN = "sync";
+    const QString POST_PROCESSING_SPAN = "post processing";
+    const QString HASH_SPAN = "hash";
+    const QString PROCESS_SPAN = "process";
+    const QString RENAME_SPAN = "rename";
+    const QString PAUSED_MARK = "paused";
+    const QString RESUMED_MARK = "resumed";
+    const QString REDIRECT_MARK = "redirect";
+    const QString STALLED_ERROR = "STALLED";
+    const QString TOO_SLOW_ERROR = "TOO SLOW";
+    const QString CANCELED_ERROR = "CANCELED";
+
+    const QString DOWNLOADED_BYTES_METRIC = "udm_downloaded_bytes_total";
+    const QString RETRIES_METRIC = "udm_retries_total";
+    const QString NETWORK_ERRORS_METRIC = "udm_network_errors_total";
+    const QString APP_LABEL = "app";
+    const QString BEARER_LABEL = "bearer";
+    const QString ERROR_LABEL = "error";
 }
 
 namespace Ubuntu {
@@ -213,16 +274,37 @@ FileDownload::FileDownload(const QString& id,
 }
 
 FileDownload::~FileDownload() {
+    stopSharing();
+    delete _delta;
+    delete _metalink;
+    delete _ranges;
+    stopHashing();
+    stopCopying();
     if (_currentData != nullptr) {
         _currentData->close();
     }
     delete _currentData;
     delete _reply;
+    delete _timeline;
+    if (_outputFd != -1) {
+        ::close(_outputFd);
+    }
 }
 
 void
 FileDownload::cancelTransfer() {
     TRACE << _url;
+    traceDone(CANCELED_ERROR);
+    if (_retryTimer != nullptr) {
+        _retryTimer->stop();
+    }
+    unfollowLeader();
+    stopSharing();
+    stopDelta();
+    stopMetalink();
+    stopRanges();
+    stopHashing();
+    stopCopying();
 
     if (_reply != nullptr) {
         // disconnect so that we do not get useless signals
@@ -245,11 +327,72 @@ FileDownload::cancelTransfer() {
 void
 FileDownload::pauseTransfer() {
     TRACE << _url;
+    traceMark(PAUSED_MARK);
     if (_url.toString().contains(DATA_URI_PREFIX)) {
         DOWN_LOG(INFO) << "EMIT paused(false) since we are using a data uri";
         _downloading = false;
         emit paused(false);
     } else {
+        if (_leader != nullptr) {
+            // we do not own the transfer, just stop following it
+            unfollowLeader();
+            DOWN_LOG(INFO) << "EMIT paused(true)";
+            _downloading = false;
+            emit paused(true);
+            return;
+        }
+
+        if (_metalink != nullptr && _metalink->isRunning()) {
+            DOWN_LOG(INFO) << "Pausing metalink download" << _url;
+            // the verified pieces are kept, the rest are requested again
+            _metalink->stop();
+            if (!flushFile()) {
+                emit paused(false);
+                return;
+            }
+            DOWN_LOG(INFO) << "EMIT paused(true)";
+            _downloading = false;
+            emit paused(true);
+            return;
+        }
+
+        if (_ranges != nullptr && _ranges->isRunning()) {
+            DOWN_LOG(INFO) << "Pausing range download" << _url;
+            // the ranges that were not fully received are requested again
+            _ranges->stop();
+            if (!flushFile()) {
+                emit paused(false);
+                return;
+            }
+            DOWN_LOG(INFO) << "EMIT paused(true)";
+            _downloading = false;
+            emit paused(true);
+            return;
+        }
+
+        if (_delta != nullptr) {
+            DOWN_LOG(INFO) << "Pausing delta download" << _url;
+            stopDelta();
+            if (!flushFile()) {
+                emit paused(false);
+                return;
+            }
+            DOWN_LOG(INFO) << "EMIT paused(true)";
+            _downloading = false;
+            emit paused(true);
+            return;
+        }
+
+        if (_reply == nullptr && _retryTimer != nullptr
+                && _retryTimer->isActive()) {
+            // waiting to retry, the data is already in the file system
+            _retryTimer->stop();
+            DOWN_LOG(INFO) << "EMIT paused(true)";
+            _downloading = false;
+            emit paused(true);
+            return;
+        }
+
         if (_reply == nullptr) {
             // cannot pause because is not running
             DOWN_LOG(INFO) << "Cannot pause download because reply is NULL";
@@ -264,9 +407,12 @@ FileDownload::pauseTransfer() {
         // the data in the reply and store it in a file
         disconnectFromReplySignals();
 
+        // the downloads that follow us have to get the data on their own
+        stopSharing();
+
         // do abort before reading
         _reply->abort();
-        _currentData->write(_reply->readAll());
+        writeReplyData();
         if (!flushFile()) {
             emit paused(false);
         } else {
@@ -282,14 +428,18 @@ FileDownload::pauseTransfer() {
 void
 FileDownload::resumeTransfer() {
     DOWN_LOG(INFO) << __PRETTY_FUNCTION__ << _url;
+    activate();
 
-    if (_reply != nullptr) {
+    if (_reply != nullptr || _leader != nullptr || _delta != nullptr
+            || (_metalink != nullptr && _metalink->isRunning())
+            || (_ranges != nullptr && _ranges->isRunning())) {
         // cannot resume because it is already running
         DOWN_LOG(INFO) << "Cannot resume download because reply != NULL";
         DOWN_LOG(INFO) << "EMIT resumed(false)";
         emit resumed(false);
         return;
     }
+    traceMark(RESUMED_MARK);
 
     // it is not very probable, yet possible that we do reach this point with a data uri
 
@@ -298,20 +448,36 @@ FileDownload::resumeTransfer() {
         _downloading = true;
         emit resumed(true);
         writeDataUri();
+    } else if (isMetalink()) {
+        DOWN_LOG(INFO) << "Resuming metalink download.";
+        startMetalink();
+        DOWN_LOG(INFO) << "EMIT resumed(true)";
+        _downloading = true;
+        emit resumed(true);
+    } else if (isRanges()) {
+        DOWN_LOG(INFO) << "Resuming range download.";
+        startRanges();
+        DOWN_LOG(INFO) << "EMIT resumed(true)";
+        _downloading = true;
+        emit resumed(true);
     } else {
-        DOWN_LOG(INFO) << "Resuming download.";
-        QNetworkRequest request = buildRequest();
-
-        // overrides the range header, we do not let clients set the range!!!
-        qint64 currentDataSize = _currentData->size();
-        QByteArray rangeHeaderValue = "bytes=" +
-                QByteArray::number(currentDataSize) + "-";
-        request.setRawHeader("Range", rangeHeaderValue);
-
-        _reply = _requestFactory->get(request);
-        _reply->setReadBufferSize(throttle());
+        auto received = _currentData->size();
+        if (received == 0 && followLeader()) {
+            DOWN_LOG(INFO) << "Following the transfer of an identical download.";
+            DOWN_LOG(INFO) << "EMIT resumed(true)";
+            _downloading = true;
+            emit resumed(true);
+            return;
+        }
 
-        connectToReplySignals();
+        DOWN_LOG(INFO) << "Resuming download.";
+        if (isDelta()) {
+            // the blocks are matched again and the data that is already
+            // in the file is skipped
+            startDelta();
+        } else {
+            requestRemainingData(received);
+        }
 
         DOWN_LOG(INFO) << "EMIT resumed(true)";
         _downloading = true;
@@ -322,8 +488,11 @@ FileDownload::resumeTransfer() {
 void
 FileDownload::startTransfer() {
     TRACE << _url;
+    activate();
 
-    if (_reply != nullptr) {
+    if (_reply != nullptr || _leader != nullptr || _delta != nullptr
+            || (_metalink != nullptr && _metalink->isRunning())
+            || (_ranges != nullptr && _ranges->isRunning())) {
         // the download was already started, lets say that we did it
         DOWN_LOG(INFO) << "Cannot start download because reply != NULL";
         DOWN_LOG(INFO) << "EMIT started(false)";
@@ -331,10 +500,20 @@ FileDownload::startTransfer() {
         return;
     }
 
+    if (_timeline == nullptr && Timeline::isEnabled()) {
+        _timeline = new Timeline(path());
+    }
+    traceBegin(DOWNLOAD_SPAN);
+
     // create file that will be used to maintain the state of the
-    // download when resumed.
-    _currentData = FileManager::instance()->createFile(_tempFilePath);
-    bool canWrite = _currentData->open(QIODevice::ReadWrite | QFile::Append);
+    // download when resumed. The pieces of a metalink download and the
+    // byte ranges are written at their offsets.
+    _currentData = createDataFile();
+    QIODevice::OpenMode mode = QIODevice::ReadWrite;
+    if (!isMetalink() && !isRanges()) {
+        mode |= QFile::Append;
+    }
+    bool canWrite = _currentData->open(mode);
 
     if (!canWrite) {
         DOWN_LOG(ERROR) << "Destination file path is not writable: " << _filePath;
@@ -348,6 +527,10 @@ FileDownload::startTransfer() {
         return;
     }
 
+    // data with a known hash does not need the network if it was already
+    // downloaded, even by another app
+    auto cached = cachedContent();
+
     // make a diff between a data uri and a "normal" download
     if (_url.toString().contains(DATA_URI_PREFIX)) {
         DOWN_LOG(INFO) << "Performing a data uri download.";
@@ -359,22 +542,80 @@ FileDownload::startTransfer() {
         emit started(true);
 
         writeDataUri();
+    } else if (!cached.isEmpty()) {
+        DOWN_LOG(INFO) << "Using the cached data of the download.";
+        DOWN_LOG(INFO) << "EMIT started(true)";
+        _downloading = true;
+        emit started(true);
+
+        copyFromCache(cached);
+    } else if (isMetalink()) {
+        // the url is the one of the document and not of the data, it cannot
+        // be shared with other downloads
+        DOWN_LOG(INFO) << "Performing a metalink download.";
+        startMetalink();
+        DOWN_LOG(INFO) << "EMIT started(true)";
+        _downloading = true;
+        emit started(true);
+    } else if (isRanges()) {
+        // the data is not the whole resource, it cannot be shared
+        DOWN_LOG(INFO) << "Performing a byte range download.";
+        startRanges();
+        DOWN_LOG(INFO) << "EMIT started(true)";
+        _downloading = true;
+        emit started(true);
+    } else if (followLeader()) {
+        DOWN_LOG(INFO) << "Following the transfer of an identical download.";
+        DOWN_LOG(INFO) << "EMIT started(true)";
+        _downloading = true;
+        emit started(true);
+    } else if (isDelta()) {
+        DOWN_LOG(INFO) << "Performing a delta download.";
+        startDelta();
+        DOWN_LOG(INFO) << "EMIT started(true)";
+        _downloading = true;
+        emit started(true);
     } else {
         DOWN_LOG(INFO) << "Performing a network download.";
-        // signals should take care of calling deleteLater on the
-        // NetworkReply object
-        _reply = _requestFactory->get(buildRequest());
-        _reply->setReadBufferSize(throttle());
-
-        connectToReplySignals();
+        startNetworkTransfer();
         DOWN_LOG(INFO) << "EMIT started(true)";
         _downloading = true;
         emit started(true);
     }
 }
 
+qulonglong
+FileDownload::requiredSpace() {
+    // once reserved the space is already accounted in the file system
+    return (_spaceReserved)? 0 : Download::requiredSpace();
+}
+
+QString
+FileDownload::storagePath() {
+    if (_outputFd != -1) {
+        // opening the link opens the client file, the file system has
+        // to be queried through the descriptor
+        return QString("/proc/self/fd/%1").arg(_outputFd);
+    }
+    return Download::storagePath();
+}
+
+int
+FileDownload::storageDescriptor() {
+    return _outputFd;
+}
+
 qulonglong
 FileDownload::progress() {
+    if (_leader != nullptr) {
+        return _leader->progress();
+    }
+    if (_metalink != nullptr) {
+        return _metalink->received();
+    }
+    if (_ranges != nullptr) {
+        return _ranges->received();
+    }
     return (_currentData == nullptr) ? 0 : _currentData->size();
 }
 
@@ -389,6 +630,12 @@ FileDownload::setThrottle(qulonglong speed) {
     Download::setThrottle(speed);
     if (_reply != nullptr)
         _reply->setReadBufferSize(speed);
+    if (_delta != nullptr)
+        _delta->setThrottle(speed);
+    if (_metalink != nullptr)
+        _metalink->setThrottle(speed);
+    if (_ranges != nullptr)
+        _ranges->setThrottle(speed);
 }
 
 void
@@ -501,9 +748,27 @@ void
 FileDownload::onDownloadProgress(qint64 currentProgress, qint64 bytesTotal) {
     TRACE << _url << currentProgress << bytesTotal;
 
-    _currentData->write(_reply->readAll());
+    if (!writeReplyData()) {
+        // the body of an http error is dropped, onError decides whether
+        // the request is retried
+        return;
+    }
     auto received = static_cast<qulonglong>(_currentData->size());
 
+    if (currentProgress > 0) {
+        // the connection is healthy again
+        _attempt = 0;
+    }
+
+    if (isTooSlow(received)) {
+        // the data we have is kept, the next mirror sends the rest
+        traceReplyDone(TOO_SLOW_ERROR);
+        disconnectFromReplySignals();
+        _reply->abort();
+        failOver(0);
+        return;
+    }
+
     if (bytesTotal == -1) {
         // we do not know the size of the download, simply return
         // the same for received and for total
@@ -516,6 +781,19 @@ FileDownload::onDownloadProgress(qint64 currentProgress, qint64 bytesTotal) {
             // therefore we only do this once
             // update the metadata
             _totalSize = static_cast<qulonglong>(bytesTotal);
+
+            // reserve the space for the rest of the data so that the file
+            // is not fragmented and we fail as soon as the disk is full
+            auto expected = static_cast<qint64>(received) - currentProgress
+                + bytesTotal;
+            if (!_currentData->allocate(expected)) {
+                DOWN_LOG(ERROR) << "Not enough space to store " << expected
+                    << " bytes in " << _tempFilePath;
+                emitError(QString(FILE_SYSTEM_ERROR).arg(
+                    QFile::ResourceError));
+                return;
+            }
+            _spaceReserved = true;
         }
         emit Download::progress(received, _totalSize);
         return;
@@ -524,14 +802,44 @@ FileDownload::onDownloadProgress(qint64 currentProgress, qint64 bytesTotal) {
 
 void
 FileDownload::onError(QNetworkReply::NetworkError code) {
-    DOWN_LOG(ERROR) << _url << " ERROR:" << ":" << code;
-    _downloading = false;
+    DOWN_LOG_LIMITED(ERROR) << _url << " ERROR:" << ":" << code;
+    Metrics::instance()->increment(NETWORK_ERRORS_METRIC,
+        {{ERROR_LABEL, Metrics::errorName(code)}});
+    if (_timeline != nullptr) {
+        traceReplyDone(QString("%1 %2").arg(NETWORK_ERROR).arg(
+            static_cast<int>(code)));
+    }
     QString msg;
     QString errStr;
 
     // decide if we are talking about an http error or no
     auto statusCode = _reply->attribute(
         QNetworkRequest::HttpStatusCodeAttribute);
+
+    auto httpStatus = (statusCode.isValid())? statusCode.toInt() : 0;
+    if (httpStatus < 300) {
+        // not an http error, only the network error is relevant
+        httpStatus = 0;
+    }
+
+    // the credentials are the same for all the mirrors, any other error
+    // might be specific to the server we are talking to
+    if (code != QNetworkReply::AuthenticationRequiredError
+            && code != QNetworkReply::ProxyAuthenticationRequiredError
+            && failOver(httpStatus)) {
+        return;
+    }
+
+    // transient errors are retried resuming from the data we already
+    // have, the client only gets an error once we give up
+    auto policy = RetryPolicy::instance();
+    if (_attempt < policy->maxAttempts()
+            && policy->isTransient(code, httpStatus)) {
+        scheduleRetry(httpStatus);
+        return;
+    }
+
+    _downloading = false;
     if (statusCode.isValid()) {
         auto status = statusCode.toInt();
         if (status >= 300) {
@@ -580,6 +888,7 @@ FileDownload::onRedirect(QUrl redirect) {
     }
     _visitedUrls.append(_url);
     _url = redirect;
+    traceMark(REDIRECT_MARK);
 
     // clean the reply
     disconnectFromReplySignals();
@@ -592,7 +901,7 @@ FileDownload::onRedirect(QUrl redirect) {
     cleanUpCurrentData();
 
     // perform again the request but do not emit started signal
-    _currentData = FileManager::instance()->createFile(_tempFilePath);
+    _currentData = createDataFile();
     bool canWrite = _currentData->open(QIODevice::ReadWrite | QFile::Append);
 
     if (!canWrite) {
@@ -601,7 +910,12 @@ FileDownload::onRedirect(QUrl redirect) {
     }
     _reply = _requestFactory->get(buildRequest());
     _reply->setReadBufferSize(throttle());
+    _requestOffset = 0;
+    _replyHasData = true;
     _totalSize = 0;
+    _speedBytes = 0;
+    _speedClock.start();
+    startStallWatchdog(0);
 
     connectToReplySignals();
 }
@@ -609,6 +923,10 @@ FileDownload::onRedirect(QUrl redirect) {
 void
 FileDownload::onDownloadCompleted() {
     TRACE << _url;
+    traceReplyDone();
+    if (_stallTimer != nullptr) {
+        _stallTimer->stop();
+    }
     // ensure that if content-disposition is present we will use it
     updateFileNamePerContentDisposition();
 
@@ -616,6 +934,37 @@ FileDownload::onDownloadCompleted() {
             QString(_reply->rawHeader(CONTENT_TYPE)) : QString();
 
     flushFile();
+
+    auto cache = ContentCache::instance();
+    if (cache->isEnabled()) {
+        _etag = _reply->rawHeader(ETAG);
+        _lastModified = _reply->rawHeader(LAST_MODIFIED);
+    }
+
+    if (!_cachedResponse.isEmpty() && _reply->attribute(
+            QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        DOWN_LOG(INFO) << "The cached data of the download is still valid.";
+        if (!_currentData->copyFrom(_cachedResponse)) {
+            DOWN_LOG(ERROR) << "Could not copy the cached data from "
+                << _cachedResponse;
+            // the error clean up releases the reply
+            emitError(QString(FILE_SYSTEM_ERROR).arg(QFile::CopyError));
+            return;
+        }
+        _cached = true;
+        _totalSize = QFileInfo(_cachedResponse).size();
+        // the server does not send the headers of the data again
+        QMimeDatabase db;
+        contentType = db.mimeTypeForFile(_cachedResponse,
+            QMimeDatabase::MatchContent).name();
+    }
+
+    // let the downloads that follow us take the data before it is moved
+    if (_sharing) {
+        _sharing = false;
+        SharedDownloads::instance()->removeLeader(this);
+        emit sharedDataReady(_tempFilePath, contentType);
+    }
     downloadPostProcessing(contentType);
 
     // clean the reply
@@ -793,6 +1142,7 @@ FileDownload::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus) {
     }
 
     if (exitCode == 0 && exitStatus == QProcess::NormalExit) {
+        traceEnd(PROCESS_SPAN);
         emitFinished();
     } else {
         auto standardOut = p->readAllStandardOutput();
@@ -846,7 +1196,6 @@ void
 FileDownload::init() {
     _requestFactory = RequestFactory::instance();
     _fileNameMutex = FileNameMutex::instance();
-    _connected = NetworkSession::instance()->isOnline();
     _downloading = false;
 
     // applications that are confined are not allowed to set the click metadata.
@@ -854,11 +1203,6 @@ FileDownload::init() {
         _metadata.remove(Metadata::CLICK_PACKAGE_KEY);
     }
 
-    // connect to the network changed signals
-    CHECK(connect(NetworkSession::instance(), &NetworkSession::onlineStateChanged,
-        this, &FileDownload::onOnlineStateChanged))
-            << "Could not connect to signal";
-
     CHECK(connect(this, &FileDownload::propertiesChanged,
         this, &FileDownload::onPropertiesChanged))
             << "Could not connect to signal";
@@ -871,6 +1215,73 @@ FileDownload::init() {
         setLastError(QString(_("Invalid URL: '%1'")).arg(_url.toString()));
     }
 
+    Metadata metadata(_metadata);
+    _mirrors.append(_url);
+    _minSpeed = metadata.mirrorMinSpeed();
+    foreach(const QString& mirror, metadata.mirrors()) {
+        QUrl mirrorUrl(mirror);
+        if (!mirrorUrl.isValid() || mirrorUrl.isRelative()
+                || mirror.startsWith(DATA_URI_PREFIX)) {
+            setIsValid(false);
+            setLastError(QString(_("Invalid mirror URL: '%1'")).arg(mirror));
+            break;
+        }
+        if (!_mirrors.contains(mirrorUrl)) {
+            _mirrors.append(mirrorUrl);
+        }
+    }
+
+    if (metadata.hasDeltaControl() || metadata.hasDeltaSeed()) {
+        QUrl control(metadata.deltaControl());
+        QFileInfo seed(metadata.deltaSeed());
+        if (!control.isValid() || control.isRelative()
+                || !seed.isAbsolute()) {
+            setIsValid(false);
+            setLastError(QString(
+                _("Delta downloads need a control URL and an absolute seed path.")));
+        } else if (isConfined() && seed.exists()
+                && !seed.canonicalFilePath().startsWith(
+                    QFileInfo(rootPath()).canonicalFilePath() + "/")) {
+            // confined apps cannot make us read files they have no access to
+            setIsValid(false);
+            setLastError(QString(_("Invalid seed path: '%1'")).arg(
+                metadata.deltaSeed()));
+        }
+    }
+
+    if (metadata.hasByteRanges()) {
+        QList<ByteRange> ranges;
+        if (!RangeTransfer::parse(metadata.byteRanges(), ranges)) {
+            setIsValid(false);
+            setLastError(QString(_("Invalid byte ranges: '%1'")).arg(
+                metadata.byteRanges().join(',')));
+        } else if (!_hash.isEmpty() || isMetalink() || isDelta()) {
+            // the hash is of the whole file and not of the ranges
+            setIsValid(false);
+            setLastError(QString(
+                _("Byte range downloads cannot have a hash, be delta or metalink downloads.")));
+        }
+    }
+
+    if (metadata.hasDurability()) {
+        auto policy = metadata.durability();
+        if (policy == NO_SYNC_POLICY) {
+            _durability = NO_SYNC;
+        } else if (policy == SYNC_ON_FINISH_POLICY) {
+            _durability = SYNC_ON_FINISH;
+        } else if (policy == PERIODIC_SYNC_POLICY) {
+            _durability = PERIODIC_SYNC;
+            _syncInterval = metadata.durabilityInterval();
+            if (_syncInterval == 0) {
+                _syncInterval = DEFAULT_SYNC_INTERVAL;
+            }
+        } else {
+            setIsValid(false);
+            setLastError(QString(_("Invalid durability policy: '%1'")).arg(
+                policy));
+        }
+    }
+
     // ensure that if we are going to deflate the download that the hash is set
     // to be empty. The reason for this is that if we deflate the hash wont be
     // correctly checked
@@ -898,11 +1309,29 @@ FileDownload::connectToReplySignals() {
         CHECK(connect(_reply, &NetworkReply::sslErrors,
             this, &FileDownload::onSslErrors))
                 << "Could not connect to signal";
+
+        // the status of the reply tells whether its body is our data
+        CHECK(connect(_reply, &NetworkReply::metaDataChanged,
+            this, &FileDownload::onReplyMetaDataChanged))
+                << "Could not connect to signal";
+
+        // the phases of the connection are only needed for the timeline
+        if (_timeline != nullptr) {
+            traceBegin(CONNECT_SPAN);
+            CHECK(connect(_reply, &NetworkReply::encrypted,
+                this, &FileDownload::onReplyEncrypted))
+                    << "Could not connect to signal";
+        }
     }
 }
 
 void
 FileDownload::disconnectFromReplySignals() {
+    // there is nothing to watch once we stop listening to the reply
+    if (_stallTimer != nullptr) {
+        _stallTimer->stop();
+    }
+    traceReplyDone();
     if (_reply != nullptr) {
         disconnect(_reply, &NetworkReply::downloadProgress,
             this, &FileDownload::onDownloadProgress);
@@ -912,6 +1341,12 @@ FileDownload::disconnectFromReplySignals() {
             this, &FileDownload::onFinished);
         disconnect(_reply, &NetworkReply::sslErrors,
             this, &FileDownload::onSslErrors);
+        disconnect(_reply, &NetworkReply::metaDataChanged,
+            this, &FileDownload::onReplyMetaDataChanged);
+        if (_timeline != nullptr) {
+            disconnect(_reply, &NetworkReply::encrypted,
+                this, &FileDownload::onReplyEncrypted);
+        }
     }
 }
 
@@ -927,26 +1362,211 @@ FileDownload::flushFile() {
 }
 
 bool
-FileDownload::hashIsValid() {
-    // if the hash is present we check it
-    if (!_hash.isEmpty()) {
-        emit processing(filePath());
-        _currentData->reset();
-        auto hashFactory = CryptographicHashFactory::instance();
-        QScopedPointer<CryptographicHash> hash(
-            hashFactory->createCryptographicHash(_algo, this));
-        // addData is smart enough to not load the entire file in memory
-        hash->addData(_currentData->device());
-        QString fileSig = QString(hash->result().toHex());
-        if (fileSig != _hash) {
-            DOWN_LOG(ERROR) << HASH_ERROR << fileSig << "!=" << _hash;
-            emit hashError(HashErrorStruct(HashAlgorithm::getHashAlgo(_algo), _hash, fileSig));
-            return false;
-        }
+FileDownload::syncFile() {
+    traceBegin(SYNC_SPAN);
+    auto synced = _currentData->sync();
+    if (!synced) {
+        auto err = _currentData->error();
+        DOWN_LOG(ERROR) << "Could not sync the data to the disk" << err;
+        emitError(QString(FILE_SYSTEM_ERROR).arg(err));
+        return false;
+    }
+    traceEnd(SYNC_SPAN);
+    return true;
+}
+
+bool
+FileDownload::truncateFile(qint64 size) {
+    if (!_currentData->truncate(size)) {
+        auto err = _currentData->error();
+        DOWN_LOG(ERROR) << "Could not truncate the file to " << size << err;
+        emitError(QString(FILE_SYSTEM_ERROR).arg(err));
+        return false;
+    }
+    return true;
+}
+
+bool
+FileDownload::writeReplyData() {
+    // the data is read even when it is dropped, otherwise a reply with a
+    // limited read buffer would stop receiving
+    auto data = _reply->readAll();
+    if (!_replyHasData) {
+        return false;
     }
+    _currentData->write(data);
     return true;
 }
 
+void
+FileDownload::checkReplyStatus() {
+    auto statusCode = _reply->attribute(
+        QNetworkRequest::HttpStatusCodeAttribute);
+    if (!statusCode.isValid()) {
+        // only http replies have a status
+        return;
+    }
+
+    // the body of an http error is never part of the file
+    auto status = statusCode.toInt();
+    _replyHasData = status >= 200 && status < 300;
+    if (!_replyHasData) {
+        return;
+    }
+
+    if (status == 206) {
+        qint64 first = -1;
+        qint64 last = -1;
+        if (HeaderParser::rangeFromContentRange(
+                    _reply->rawHeader(CONTENT_RANGE), first, last)
+                && first == _requestOffset) {
+            return;
+        }
+
+        // appending the data would corrupt the file
+        DOWN_LOG_LIMITED(WARNING) << _url << " sent a range starting at "
+            << first << " instead of " << _requestOffset;
+        _replyHasData = false;
+        disconnectFromReplySignals();
+        _reply->abort();
+        _reply->deleteLater();
+        _reply = nullptr;
+
+        if (_requestOffset == 0) {
+            NetworkErrorStruct err(QNetworkReply::ProtocolFailure);
+            emit networkError(err);
+            emitError(NETWORK_ERROR);
+            return;
+        }
+
+        // the server cannot be trusted with the range, get all the data
+        if (truncateFile(0)) {
+            requestRemainingData(0);
+        }
+        return;
+    }
+
+    if (_requestOffset > 0) {
+        // the server ignored the range and sends all the data
+        DOWN_LOG(WARNING) << _url << " does not support ranges, "
+            << "downloading the data again";
+        if (truncateFile(0)) {
+            _requestOffset = 0;
+        }
+    }
+}
+
+void
+FileDownload::verifyHash(const QString& contentType) {
+    // the worker reads the file through its own descriptor, the data in
+    // the buffers of our device has to reach the file first
+    if (!flushFile()) {
+        return;
+    }
+
+    // the data is read back in the pool so that large files do not block
+    // the daemon, the post processing continues with the digest
+    auto job = new HashJob();
+    _hashJob = job;
+    // processing is emitted when the data is really being read
+    CHECK(connect(job, &HashJob::started, this, [this, job]() {
+            if (job == _hashJob) {
+                emit processing(filePath());
+            }
+        })) << "Could not connect to signal";
+    CHECK(connect(job, &HashJob::finished, this,
+        [this, job, contentType](const QByteArray& digest) {
+            // ignore the results of the jobs that were stopped
+            if (job == _hashJob) {
+                onHashCalculated(digest, contentType);
+            }
+        })) << "Could not connect to signal";
+
+    traceBegin(HASH_SPAN);
+    auto path = (_outputFd != -1)? storagePath() : _tempFilePath;
+    HashVerifier::instance()->hash(job, path, _algo);
+}
+
+void
+FileDownload::stopHashing() {
+    if (_hashJob != nullptr) {
+        // the worker has its own descriptor so the data can be removed
+        // right away, it stops at the next chunk and deletes the job
+        disconnect(_hashJob, nullptr, this, nullptr);
+        HashVerifier::instance()->cancel(_hashJob);
+        _hashJob = nullptr;
+    }
+}
+
+void
+FileDownload::onHashCalculated(const QByteArray& digest,
+                               const QString& contentType) {
+    // the worker might still be returning, it deletes the job once done
+    _hashJob->release();
+    _hashJob = nullptr;
+
+    QString fileSig = QString(digest.toHex());
+    if (fileSig != _hash) {
+        traceEnd(HASH_SPAN, _currentData->size(), HASH_ERROR);
+        DOWN_LOG(ERROR) << HASH_ERROR << fileSig << "!=" << _hash;
+        emit hashError(HashErrorStruct(HashAlgorithm::getHashAlgo(_algo), _hash, fileSig));
+        emitError(HASH_ERROR);
+        return;
+    }
+    traceEnd(HASH_SPAN, _currentData->size());
+    processData(contentType);
+}
+
+Timer*
+FileDownload::retryTimer() {
+    // most downloads never retry, do not pay for the timer up front
+    if (_retryTimer == nullptr) {
+        _retryTimer = new Timer(this);
+        CHECK(connect(_retryTimer, &Timer::timeout,
+            this, &FileDownload::onRetryTimeout))
+                << "Could not connect to signal";
+    }
+    return _retryTimer;
+}
+
+Timer*
+FileDownload::stallTimer() {
+    if (_stallTimer == nullptr) {
+        _stallTimer = new Timer(this);
+        CHECK(connect(_stallTimer, &Timer::timeout,
+            this, &FileDownload::onStallTimeout))
+                << "Could not connect to signal";
+    }
+    return _stallTimer;
+}
+
+void
+FileDownload::activate() {
+    // queued downloads do not care about the connection nor the progress,
+    // only pay for the connections once the download was started
+    if (_active) {
+        return;
+    }
+    _active = true;
+    _connected = NetworkSession::instance()->isOnline();
+    CHECK(connect(NetworkSession::instance(),
+        &NetworkSession::onlineStateChanged,
+        this, &FileDownload::onOnlineStateChanged))
+            << "Could not connect to signal";
+
+    CHECK(connect(this, &Download::progress,
+        this, &FileDownload::onProgressForReaders))
+            << "Could not connect to signal";
+
+    CHECK(connect(this, &Download::progress,
+        this, &FileDownload::onProgressForDurability))
+            << "Could not connect to signal";
+
+    CHECK(connect(this, &Download::progress,
+        this, &FileDownload::onProgressForMetrics))
+            << "Could not connect to signal";
+}
+
 void
 FileDownload::initFileNames() {
     // the mutex will ensure that we do not have race conditions about
@@ -982,12 +1602,25 @@ FileDownload::initFileNames() {
 void
 FileDownload::downloadPostProcessing(const QString& contentType) {
     TRACE << _url;
+    traceBegin(POST_PROCESSING_SPAN);
 
-    if(!hashIsValid()) {
-        emitError(HASH_ERROR);
+    if (_durability != NO_SYNC && !syncFile()) {
         return;
     }
 
+    // if the hash is present we check it
+    if (!_hash.isEmpty()) {
+        verifyHash(contentType);
+        return;
+    }
+    processData(contentType);
+}
+
+void
+FileDownload::processData(const QString& contentType) {
+    // must be done before the file is moved or processed
+    storeInCache();
+
     // there are three possible cases, in the first case we are requested
     // to extract the file, in which case we start a special helper process.
     // In the second case we are requested to execute a specific command, in
@@ -1028,7 +1661,9 @@ FileDownload::downloadPostProcessing(const QString& contentType) {
         args << fileInfo.dir().absolutePath();
 
         DOWN_LOG(INFO) << "Executing" << command << args;
-        postDownloadProcess->start(command, args);
+        traceBegin(PROCESS_SPAN);
+        ProcessQueue::instance()->enqueue(postDownloadProcess, command, args,
+            postProcessingPriority());
         return;
     } else if (_metadata.contains(Metadata::COMMAND_KEY)) {
         if (isConfined()) {
@@ -1085,7 +1720,9 @@ FileDownload::downloadPostProcessing(const QString& contentType) {
                     << "Could not connect to signal";
 
             DOWN_LOG(INFO) << "Executing" << command << args;
-            postDownloadProcess->start(command, args);
+            traceBegin(PROCESS_SPAN);
+            ProcessQueue::instance()->enqueue(postDownloadProcess, command,
+                args, postProcessingPriority());
             return;
         }
     } else {
@@ -1093,24 +1730,42 @@ FileDownload::downloadPostProcessing(const QString& contentType) {
     }
 }
 
+int
+FileDownload::postProcessingPriority() {
+    // only unconfined applications are allowed to jump the queue
+    if (isConfined()) {
+        return 0;
+    }
+    return Metadata(_metadata).postProcessingPriority();
+}
+
 void
 FileDownload::emitFinished() {
     auto fileMan = FileManager::instance();
-
+    traceEnd(POST_PROCESSING_SPAN);
 
     if (fileMan->exists(_tempFilePath)) {
         DOWN_LOG(INFO) << "Rename '" << _tempFilePath << "' to '"
             << _filePath << "'";
-        QFile tempFile(_tempFilePath);
-        auto r = tempFile.rename(_filePath);
+        traceBegin(RENAME_SPAN);
+        // the temp file lives next to the destination so this is an atomic
+        // rename, the file manager only copies when that is not the case
+        auto r = fileMan->rename(_tempFilePath, _filePath);
+        // logging can change errno, keep the one of the rename
+        int err = errno;
         if (!r) {
+            auto reason = QString(strerror(err));
             DOWN_LOG(WARNING) << "Could not rename '" << _tempFilePath << "' to '"
-                << _filePath << "' due to " << tempFile.errorString();
+                << _filePath << "' due to " << reason;
+            traceEnd(RENAME_SPAN, 0, reason);
+        } else {
+            traceEnd(RENAME_SPAN);
         }
     }
 
     setState(Download::UNCOLLECTED);
     unlockFilePath();
+    traceDone();
 
     DOWN_LOG(INFO) << "EMIT finished" << filePath();
 
@@ -1128,6 +1783,10 @@ FileDownload::emitFinished() {
 
 void
 FileDownload::unlockFilePath() {
+    if (_outputFd != -1) {
+        // the names were released when the descriptor was set
+        return;
+    }
     if (!isConfined() && _metadata.contains(Metadata::LOCAL_PATH_KEY)) {
         _fileNameMutex->unlockFileName(_tempFilePath);
     } else {
@@ -1140,7 +1799,7 @@ FileDownload::updateFileNamePerContentDisposition() {
     // check if we have the content-type header, if we do we are going to change the
     // file path that will be used by the download, do not do it if the app is
     // unconfined
-    if ((_reply->hasRawHeader(CONTENT_DISPOSITION) && (
+    if (_outputFd == -1 && (_reply->hasRawHeader(CONTENT_DISPOSITION) && (
             isConfined() || !_metadata.contains(Metadata::LOCAL_PATH_KEY)))) {
         auto contentDisposition = _reply->rawHeader(CONTENT_DISPOSITION);
         DOWN_LOG(INFO) << "Content-Disposition header" << contentDisposition;
@@ -1180,7 +1839,8 @@ FileDownload::cleanUpCurrentData() {
 
         _currentData->deleteLater();
         _currentData = nullptr;
-    } else {
+        _spaceReserved = false;
+    } else if (_outputFd == -1) {
         QScopedPointer<QFile> tempFile(new QFile(_tempFilePath));
         success = tempFile->remove();
         if (!success)
@@ -1210,22 +1870,827 @@ FileDownload::buildRequest() {
         // else we will have an error in the checksum for example #1224678
         request.setRawHeader("Accept-Encoding", "identity");
     }
+    // let the server tell us that the cached data is still valid
+    if (!_cachedResponse.isEmpty()) {
+        if (!_etag.isEmpty()) {
+            request.setRawHeader(IF_NONE_MATCH, _etag);
+        }
+        if (!_lastModified.isEmpty()) {
+            request.setRawHeader(IF_MODIFIED_SINCE, _lastModified);
+        }
+    }
     return request;
 }
 
 void 
 FileDownload::errorCleanup() {
+    unfollowLeader();
+    stopSharing();
+    stopDelta();
+    stopMetalink();
+    stopRanges();
+    stopHashing();
+    stopCopying();
     disconnectFromReplySignals();
-    _reply->deleteLater();
-    _reply = nullptr;
+    if (_reply != nullptr) {
+        _reply->deleteLater();
+        _reply = nullptr;
+    }
     cleanUpCurrentData();
     // let other downloads use the same file name
     unlockFilePath();
 }
 
+void
+FileDownload::scheduleRetry(int httpStatus) {
+    auto delay = RetryPolicy::instance()->delay(_attempt,
+        (httpStatus != 0)? _reply->rawHeader(RETRY_AFTER) : QByteArray());
+    _attempt++;
+    _retries++;
+    Metrics::instance()->increment(RETRIES_METRIC,
+        {{APP_LABEL, transferAppId()}});
+    DOWN_LOG_LIMITED(WARNING) << "Retrying " << _url << " in " << delay
+        << " msecs, attempt " << _attempt;
+
+    disconnectFromReplySignals();
+    // keep the data that was received before the connection broke, the
+    // body of an http error is not part of the file and the retry has to
+    // continue from where the request started
+    if ((httpStatus != 0 || !writeReplyData())
+            && !truncateFile(_requestOffset)) {
+        // the error clean up already released the reply
+        return;
+    }
+
+    if (!flushFile()) {
+        // the error clean up already released the reply
+        return;
+    }
+    _reply->deleteLater();
+    _reply = nullptr;
+    traceBegin(RETRY_SPAN);
+    retryTimer()->start(delay);
+}
+
+void
+FileDownload::requestRemainingData(qint64 received) {
+    // a range of the data cannot be revalidated against the cached one
+    _cachedResponse.clear();
+    QNetworkRequest request = buildRequest();
+
+    // overrides the range header, we do not let clients set the range!!!
+    QByteArray rangeHeaderValue = "bytes=" +
+            QByteArray::number(received) + "-";
+    request.setRawHeader("Range", rangeHeaderValue);
+
+    _reply = _requestFactory->get(request);
+    _reply->setReadBufferSize(throttle());
+    // only a 206 with a range that starts at received continues the file,
+    // see checkReplyStatus
+    _requestOffset = received;
+    _replyHasData = true;
+    _speedBytes = static_cast<qulonglong>(received);
+    _speedClock.start();
+    startStallWatchdog(_speedBytes);
+
+    connectToReplySignals();
+    shareTransfer();
+}
+
+bool
+FileDownload::failOver(int httpStatus) {
+    if (_mirror + 1 >= _mirrors.count()) {
+        return false;
+    }
+
+    _mirror++;
+    DOWN_LOG(WARNING) << "Failing over from " << _url << " to "
+        << _mirrors[_mirror];
+
+    disconnectFromReplySignals();
+    // the mirrors serve the same data, the hash check at the end ensures
+    // that they really did, the body of an http error is not part of it
+    if ((httpStatus != 0 || !writeReplyData())
+            && !truncateFile(_requestOffset)) {
+        // the error clean up already released the reply
+        return true;
+    }
+
+    if (!flushFile()) {
+        // the error clean up already released the reply
+        return true;
+    }
+    _reply->deleteLater();
+    _reply = nullptr;
+
+    // each mirror gets its own redirects and retries
+    _url = _mirrors[_mirror];
+    _visitedUrls.clear();
+    _attempt = 0;
+    requestRemainingData(_currentData->size());
+    return true;
+}
+
+bool
+FileDownload::isTooSlow(qulonglong received) {
+    if (_minSpeed == 0 || _mirror + 1 >= _mirrors.count()) {
+        return false;
+    }
+
+    // the client asked for a speed that is under the threshold
+    if (throttle() > 0 && throttle() <= _minSpeed) {
+        return false;
+    }
+
+    auto elapsed = _speedClock.elapsed();
+    if (elapsed < MIRROR_SPEED_WINDOW) {
+        return false;
+    }
+
+    auto speed = (received > _speedBytes)?
+        (received - _speedBytes) * 1000 / elapsed : 0;
+    _speedBytes = received;
+    _speedClock.restart();
+
+    if (speed >= _minSpeed) {
+        return false;
+    }
+    DOWN_LOG_LIMITED(WARNING) << _url << " is too slow: " << speed
+        << " bytes/sec";
+    return true;
+}
+
+void
+FileDownload::startStallWatchdog(qulonglong received) {
+    auto timeout = RetryPolicy::instance()->stallTimeout();
+    if (timeout > 0) {
+        _stallBytes = received;
+        stallTimer()->start(timeout);
+    }
+}
+
+void
+FileDownload::traceBegin(const QString& span) {
+    if (_timeline != nullptr) {
+        _timeline->begin(span);
+    }
+}
+
+void
+FileDownload::traceEnd(const QString& span,
+                       qulonglong bytes,
+                       const QString& error) {
+    if (_timeline != nullptr) {
+        _timeline->end(span, bytes, error);
+    }
+}
+
+void
+FileDownload::traceMark(const QString& mark) {
+    if (_timeline != nullptr) {
+        _timeline->mark(mark);
+    }
+}
+
+void
+FileDownload::traceReplyDone(const QString& error) {
+    if (_timeline == nullptr) {
+        return;
+    }
+    _timeline->end(CONNECT_SPAN, 0, error);
+    _timeline->end(FIRST_BYTE_SPAN, 0, error);
+    if (_timeline->isOpen(RECEIVE_SPAN)) {
+        auto received = (_currentData == nullptr)? 0
+            : static_cast<qulonglong>(_currentData->size());
+        _timeline->end(RECEIVE_SPAN,
+            (received > _traceBytes)? received - _traceBytes : 0, error);
+    }
+}
+
+void
+FileDownload::traceDone(const QString& error) {
+    if (_timeline == nullptr) {
+        return;
+    }
+    traceReplyDone(error);
+    _timeline->endAll(error);
+    auto dir = Timeline::traceDir();
+    if (!dir.isEmpty()) {
+        _timeline->save(dir);
+    }
+}
+
+void
+FileDownload::onReplyEncrypted() {
+    traceEnd(CONNECT_SPAN);
+    traceBegin(FIRST_BYTE_SPAN);
+}
+
+void
+FileDownload::onReplyMetaDataChanged() {
+    // the meta data is updated again when the reply is finished
+    if (_timeline != nullptr && !_timeline->isOpen(RECEIVE_SPAN)) {
+        // plain http connections do not have a handshake
+        traceEnd(CONNECT_SPAN);
+        traceEnd(FIRST_BYTE_SPAN);
+        _traceBytes = (_currentData == nullptr)? 0
+            : static_cast<qulonglong>(_currentData->size());
+        traceBegin(RECEIVE_SPAN);
+    }
+    checkReplyStatus();
+}
+
+void
+FileDownload::onStallTimeout() {
+    if (_reply == nullptr) {
+        return;
+    }
+
+    // the data in the buffer of the reply is progress as well
+    writeReplyData();
+    auto received = static_cast<qulonglong>(_currentData->size());
+    auto policy = RetryPolicy::instance();
+    auto arrived = (received > _stallBytes)? received - _stallBytes : 0;
+
+    if (!policy->isStalled(arrived, policy->stallTimeout(), throttle())) {
+        startStallWatchdog(received);
+        return;
+    }
+
+    _stalls++;
+    DOWN_LOG_LIMITED(WARNING) << "Connection to " << _url << " stalled after "
+        << received << " bytes, reconnecting";
+
+    // a new connection is more likely to make progress, prefer a
+    // different server if we have one
+    traceReplyDone(STALLED_ERROR);
+    disconnectFromReplySignals();
+    _reply->abort();
+    if (failOver(0)) {
+        return;
+    }
+
+    if (!flushFile()) {
+        // the error clean up already released the reply
+        return;
+    }
+    _reply->deleteLater();
+    _reply = nullptr;
+    requestRemainingData(received);
+}
+
+QString
+FileDownload::shareKey() {
+    // data uris are not shared, mirrors and redirects are identified by
+    // the url the client asked for
+    if (_mirrors.isEmpty() || _url.toString().contains(DATA_URI_PREFIX)
+            || !isSharable()) {
+        return QString();
+    }
+    return SharedDownloads::key(_mirrors.first(), headers(), _hash, _algo);
+}
+
+void
+FileDownload::shareTransfer() {
+    auto shared = SharedDownloads::instance();
+    if (_sharing || !shared->isEnabled()) {
+        return;
+    }
+
+    auto key = shareKey();
+    if (!key.isEmpty() && shared->leader(key) == nullptr) {
+        shared->setLeader(key, this);
+        _sharing = true;
+    }
+}
+
+void
+FileDownload::stopSharing() {
+    if (_sharing) {
+        _sharing = false;
+        SharedDownloads::instance()->removeLeader(this);
+        emit sharingStopped();
+    }
+}
+
+QString
+FileDownload::cacheKey() {
+    // the hash is not part of the key, the validators are about the url
+    if (_mirrors.isEmpty() || _url.toString().contains(DATA_URI_PREFIX)
+            || !isSharable()) {
+        return QString();
+    }
+    return SharedDownloads::key(_mirrors.first(), headers(), QString(), 0);
+}
+
+QString
+FileDownload::cachedContent() {
+    // only the data that can be verified is used without asking the server
+    if (_hash.isEmpty() || !isSharable()) {
+        return QString();
+    }
+    return ContentCache::instance()->findContent(
+        HashAlgorithm::getHashAlgo(_algo), _hash);
+}
+
+void
+FileDownload::copyFromCache(const QString& path) {
+    DOWN_LOG(INFO) << "Copying the cached data from " << path;
+    if (!_currentData->copyFrom(path)) {
+        DOWN_LOG(ERROR) << "Could not copy the cached data from " << path;
+        emitError(QString(FILE_SYSTEM_ERROR).arg(QFile::CopyError));
+        return;
+    }
+    _cached = true;
+    _totalSize = QFileInfo(path).size();
+
+    // the post processing checks the hash again, a corrupted cache
+    // results in a hash error and not in a wrong file
+    QMimeDatabase db;
+    downloadPostProcessing(db.mimeTypeForFile(path,
+        QMimeDatabase::MatchContent).name());
+}
+
+void
+FileDownload::findCachedResponse() {
+    _cachedResponse.clear();
+    auto cache = ContentCache::instance();
+    if (!cache->isEnabled() || !isSharable()) {
+        return;
+    }
+
+    // the client might be revalidating its own copy of the data
+    foreach(const QString& header, headers().keys()) {
+        auto name = header.toLower().toUtf8();
+        if (name == IF_NONE_MATCH.toLower()
+                || name == IF_MODIFIED_SINCE.toLower()) {
+            return;
+        }
+    }
+
+    _cachedResponse = cache->findResponse(cacheKey(), _etag, _lastModified);
+    if (!_cachedResponse.isEmpty()) {
+        DOWN_LOG(INFO) << "Revalidating the cached data " << _cachedResponse;
+    }
+}
+
+void
+FileDownload::storeInCache() {
+    auto cache = ContentCache::instance();
+    if (_cached || !cache->isEnabled() || !isSharable()
+            || _url.toString().contains(DATA_URI_PREFIX)) {
+        return;
+    }
+
+    // without a hash the cache calculates its own
+    auto algo = (_hash.isEmpty())? QString() : HashAlgorithm::getHashAlgo(_algo);
+    if (cache->insert(_tempFilePath, algo, _hash, cacheKey(), _etag,
+            _lastModified)) {
+        _cached = true;
+    }
+}
+
+void
+FileDownload::startNetworkTransfer() {
+    findCachedResponse();
+    // signals should take care of calling deleteLater on the
+    // NetworkReply object
+    _reply = _requestFactory->get(buildRequest());
+    _reply->setReadBufferSize(throttle());
+    _requestOffset = 0;
+    _replyHasData = true;
+    _speedBytes = 0;
+    _speedClock.start();
+    startStallWatchdog(0);
+
+    connectToReplySignals();
+    shareTransfer();
+}
+
+bool
+FileDownload::isDelta() {
+    return !_deltaFailed && _metadata.contains(Metadata::DELTA_CONTROL_KEY);
+}
+
+void
+FileDownload::startDelta() {
+    Metadata metadata(_metadata);
+    _delta = new DeltaTransfer(buildRequest(), QUrl(metadata.deltaControl()),
+        metadata.deltaSeed(), _currentData, this);
+    _delta->setThrottle(throttle());
+
+    CHECK(connect(_delta, &DeltaTransfer::progress,
+        this, &FileDownload::onDeltaProgress))
+            << "Could not connect to signal";
+    CHECK(connect(_delta, &DeltaTransfer::finished,
+        this, &FileDownload::onDeltaFinished))
+            << "Could not connect to signal";
+    CHECK(connect(_delta, &DeltaTransfer::failed,
+        this, &FileDownload::onDeltaFailed))
+            << "Could not connect to signal";
+    traceBegin(DELTA_SPAN);
+    _delta->start();
+}
+
+void
+FileDownload::stopDelta() {
+    if (_delta != nullptr) {
+        traceEnd(DELTA_SPAN, _currentData->size());
+        disconnect(_delta, nullptr, this, nullptr);
+        _delta->stop();
+        _delta->deleteLater();
+        _delta = nullptr;
+    }
+}
+
+bool
+FileDownload::isMetalink() {
+    return _metadata.value(Metadata::METALINK_KEY).toBool();
+}
+
+void
+FileDownload::startMetalink() {
+    if (_metalink == nullptr) {
+        _metalink = new MetalinkTransfer(buildRequest(), _currentData, this);
+        CHECK(connect(_metalink, &MetalinkTransfer::progress,
+            this, &FileDownload::onMetalinkProgress))
+                << "Could not connect to signal";
+        CHECK(connect(_metalink, &MetalinkTransfer::finished,
+            this, &FileDownload::onMetalinkFinished))
+                << "Could not connect to signal";
+        CHECK(connect(_metalink, &MetalinkTransfer::failed,
+            this, &FileDownload::onMetalinkFailed))
+                << "Could not connect to signal";
+    }
+    _metalink->setThrottle(throttle());
+    _metalink->setSequential(Metadata(_metadata).sequential());
+    traceBegin(METALINK_SPAN);
+    _metalink->start();
+}
+
+void
+FileDownload::stopMetalink() {
+    if (_metalink != nullptr) {
+        traceEnd(METALINK_SPAN, _metalink->contiguous());
+        disconnect(_metalink, nullptr, this, nullptr);
+        _metalink->stop();
+        _metalink->deleteLater();
+        _metalink = nullptr;
+    }
+}
+
+bool
+FileDownload::isRanges() {
+    return _metadata.contains(Metadata::BYTE_RANGES_KEY);
+}
+
+void
+FileDownload::startRanges() {
+    if (_ranges == nullptr) {
+        QList<ByteRange> ranges;
+        RangeTransfer::parse(Metadata(_metadata).byteRanges(), ranges);
+        _ranges = new RangeTransfer(buildRequest(), ranges, _currentData,
+            this);
+        CHECK(connect(_ranges, &RangeTransfer::progress,
+            this, &FileDownload::onRangesProgress))
+                << "Could not connect to signal";
+        CHECK(connect(_ranges, &RangeTransfer::finished,
+            this, &FileDownload::onRangesFinished))
+                << "Could not connect to signal";
+        CHECK(connect(_ranges, &RangeTransfer::failed,
+            this, &FileDownload::onRangesFailed))
+                << "Could not connect to signal";
+    }
+    _ranges->setThrottle(throttle());
+    traceBegin(RANGES_SPAN);
+    _ranges->start();
+}
+
+void
+FileDownload::stopRanges() {
+    if (_ranges != nullptr) {
+        traceEnd(RANGES_SPAN);
+        disconnect(_ranges, nullptr, this, nullptr);
+        _ranges->stop();
+        _ranges->deleteLater();
+        _ranges = nullptr;
+    }
+}
+
+bool
+FileDownload::isSharable() {
+    // the data is the whole resource and it is in a path of the daemon
+    return _outputFd == -1 && !isRanges();
+}
+
+bool
+FileDownload::followLeader() {
+    auto shared = SharedDownloads::instance();
+    if (!shared->isEnabled()) {
+        return false;
+    }
+
+    auto key = shareKey();
+    auto leader = (key.isEmpty())? nullptr : shared->leader(key);
+    if (leader == nullptr || leader == this) {
+        return false;
+    }
+
+    DOWN_LOG(INFO) << "Following the transfer of " << leader->path();
+    _leader = leader;
+    CHECK(connect(_leader, static_cast<void(Download::*)
+            (qulonglong, qulonglong)>(&Download::progress),
+                this, &FileDownload::onLeaderProgress))
+                    << "Could not connect to signal";
+    CHECK(connect(_leader, &FileDownload::sharedDataReady,
+        this, &FileDownload::onLeaderDataReady))
+            << "Could not connect to signal";
+    CHECK(connect(_leader, &FileDownload::sharingStopped,
+        this, &FileDownload::onLeaderStopped))
+            << "Could not connect to signal";
+    traceBegin(SHARED_SPAN);
+    return true;
+}
+
+void
+FileDownload::unfollowLeader() {
+    if (_leader != nullptr) {
+        traceEnd(SHARED_SPAN);
+        disconnect(_leader, nullptr, this, nullptr);
+        _leader = nullptr;
+    }
+}
+
+void
+FileDownload::onLeaderProgress(qulonglong received, qulonglong total) {
+    _totalSize = total;
+    emit Download::progress(received, total);
+}
+
+void
+FileDownload::onLeaderDataReady(const QString& path,
+                                const QString& contentType) {
+    unfollowLeader();
+
+    // each download keeps its own copy so that apps cannot see or
+    // modify the files of others. The leader moves its file once we
+    // return, the worker reads it through a descriptor opened now
+    DOWN_LOG(INFO) << "Copying the shared data from " << path;
+    int source = ::open(QFile::encodeName(path).constData(),
+        O_RDONLY | O_CLOEXEC);
+    if (source < 0) {
+        DOWN_LOG(ERROR) << "Could not open the shared data in " << path
+            << ": " << strerror(errno);
+        emitError(QString(FILE_SYSTEM_ERROR).arg(QFile::CopyError));
+        return;
+    }
+
+    // large files are copied in the pool so that the daemon is not blocked
+    auto job = new CopyJob(source,
+        (_outputFd != -1)? storagePath() : _tempFilePath);
+    _copyJob = job;
+    CHECK(connect(job, &CopyJob::finished, this,
+        [this, job, path, contentType](bool success) {
+            // ignore the results of the jobs that were stopped
+            if (job == _copyJob) {
+                onSharedDataCopied(success, path, contentType);
+            }
+        })) << "Could not connect to signal";
+
+    traceBegin(COPY_SPAN);
+    FileCopier::instance()->copy(job);
+}
+
+void
+FileDownload::stopCopying() {
+    if (_copyJob != nullptr) {
+        // a copy that already started writes to a file that is removed
+        // or no longer ours, the job deletes itself once it is done
+        disconnect(_copyJob, nullptr, this, nullptr);
+        FileCopier::instance()->cancel(_copyJob);
+        _copyJob = nullptr;
+    }
+}
+
+void
+FileDownload::onSharedDataCopied(bool success,
+                                 const QString& path,
+                                 const QString& contentType) {
+    // the worker might still be returning, it deletes the job once done
+    _copyJob->release();
+    _copyJob = nullptr;
+
+    if (!success) {
+        DOWN_LOG(ERROR) << "Could not copy the shared data from " << path;
+        auto err = QString(FILE_SYSTEM_ERROR).arg(QFile::CopyError);
+        traceEnd(COPY_SPAN, 0, err);
+        emitError(err);
+        return;
+    }
+    traceEnd(COPY_SPAN, _currentData->size());
+
+    // the leader takes care of storing the data in the cache
+    _cached = true;
+    downloadPostProcessing(contentType);
+}
+
+void
+FileDownload::onLeaderStopped() {
+    unfollowLeader();
+
+    // the leader was paused, canceled or failed, another follower might
+    // have taken its place
+    Download::State currentState = state();
+    if (currentState != Download::START && currentState != Download::RESUME) {
+        return;
+    }
+
+    // without a connection the network session resumes us later
+    if (!_connected) {
+        return;
+    }
+
+    if (!followLeader()) {
+        DOWN_LOG(INFO) << "Performing a network download.";
+        requestRemainingData(_currentData->size());
+    }
+}
+
+void
+FileDownload::onRetryTimeout() {
+    traceEnd(RETRY_SPAN);
+    Download::State currentState = state();
+    if (_reply == nullptr && _currentData != nullptr
+            && (currentState == Download::START
+                || currentState == Download::RESUME)) {
+        resumeTransfer();
+    }
+}
+
+void
+FileDownload::onDeltaProgress(qulonglong received, qulonglong total) {
+    _totalSize = total;
+    emit Download::progress(received, total);
+}
+
+void
+FileDownload::onDeltaFinished() {
+    traceEnd(DELTA_SPAN, _currentData->size());
+    auto sha1 = _delta->sha1();
+    _delta->deleteLater();
+    _delta = nullptr;
+
+    if (!flushFile()) {
+        return;
+    }
+
+    // the whole file is verified with the hash of the control file when
+    // the client did not provide one
+    if (_hash.isEmpty() && !sha1.isEmpty()) {
+        _hash = sha1;
+        _algo = QCryptographicHash::Sha1;
+    }
+
+    QMimeDatabase db;
+    downloadPostProcessing(db.mimeTypeForFile(_tempFilePath,
+        QMimeDatabase::MatchContent).name());
+}
+
+void
+FileDownload::onDeltaFailed(const QString& reason) {
+    DOWN_LOG(WARNING) << "Downloading the whole file, the delta failed: "
+        << reason;
+    traceEnd(DELTA_SPAN, _currentData->size(), reason);
+    _delta->deleteLater();
+    _delta = nullptr;
+    _deltaFailed = true;
+
+    // the data that was already assembled might not be valid
+    cleanUpCurrentData();
+    _currentData = createDataFile();
+    if (!_currentData->open(QIODevice::ReadWrite | QFile::Append)) {
+        DOWN_LOG(ERROR) << "Could not open " << _tempFilePath;
+        emitError(QString(FILE_SYSTEM_ERROR).arg(_currentData->error()));
+        return;
+    }
+    startNetworkTransfer();
+}
+
+void
+FileDownload::onMetalinkProgress(qulonglong received, qulonglong total) {
+    _totalSize = total;
+    emit Download::progress(received, total);
+}
+
+void
+FileDownload::onMetalinkFinished() {
+    traceEnd(METALINK_SPAN, _currentData->size());
+    auto metalink = _metalink->metalink();
+    if (!flushFile()) {
+        return;
+    }
+
+    // the pieces were verified, the whole file is verified as well with
+    // the strongest hash of the document when the client did not set one
+    if (_hash.isEmpty() && !metalink.hash().isEmpty()) {
+        _hash = metalink.hash();
+        _algo = metalink.hashAlgorithm();
+    }
+
+    QMimeDatabase db;
+    downloadPostProcessing(db.mimeTypeForFile(_tempFilePath,
+        QMimeDatabase::MatchContent).name());
+}
+
+void
+FileDownload::onMetalinkFailed(const QString& reason) {
+    DOWN_LOG(ERROR) << "Metalink download failed: " << reason;
+    emitError(reason);
+}
+
+void
+FileDownload::onRangesProgress(qulonglong received, qulonglong total) {
+    _totalSize = total;
+    emit Download::progress(received, total);
+}
+
+void
+FileDownload::onRangesFinished() {
+    traceEnd(RANGES_SPAN, _currentData->size());
+    if (!flushFile()) {
+        return;
+    }
+    // there is no content type for a set of ranges
+    downloadPostProcessing(QString());
+}
+
+void
+FileDownload::onRangesFailed(const QString& reason) {
+    DOWN_LOG(ERROR) << "Byte range download failed: " << reason;
+    emitError(reason);
+}
+
+void
+FileDownload::onProgressForReaders(qulonglong received, qulonglong total) {
+    Q_UNUSED(received);
+    Q_UNUSED(total);
+    if (!_hasReaders || _currentData == nullptr) {
+        return;
+    }
+
+    auto contiguous = contiguousBytes();
+    if (contiguous != _contiguousBytes) {
+        _currentData->flush();
+        _contiguousBytes = contiguous;
+        emit contiguousBytesAvailable(contiguous);
+    }
+}
+
+void
+FileDownload::onProgressForDurability(qulonglong received, qulonglong total) {
+    Q_UNUSED(total);
+    if (_durability != PERIODIC_SYNC || _currentData == nullptr
+            || _leader != nullptr) {
+        return;
+    }
+
+    if (received < _syncedBytes) {
+        // the data was discarded, for example by a mirror fail over
+        _syncedBytes = received;
+    }
+
+    // fdatasync blocks until the data is in the disk, syncing in large
+    // intervals keeps the throughput close to the one of the page cache
+    if (received - _syncedBytes >= _syncInterval) {
+        _syncedBytes = received;
+        syncFile();
+    }
+}
+
+void
+FileDownload::onProgressForMetrics(qulonglong received, qulonglong total) {
+    Q_UNUSED(total);
+    if (received < _metricsBytes || _leader != nullptr) {
+        // the data was discarded or it is the one of the leader
+        _metricsBytes = received;
+        return;
+    }
+    if (received == _metricsBytes) {
+        return;
+    }
+
+    auto bearer = Metrics::bearerName(
+        NetworkSession::instance()->sessionType());
+    Metrics::instance()->increment(DOWNLOADED_BYTES_METRIC,
+        {{APP_LABEL, transferAppId()}, {BEARER_LABEL, bearer}},
+        received - _metricsBytes);
+    _metricsBytes = received;
+}
+
 void
 FileDownload::emitError(const QString& error) {
     TRACE << error;
+    traceDone(error);
     errorCleanup();
     Download::emitError(error);
 }
@@ -1237,6 +2702,149 @@ FileDownload::setFilePath(const QString& filePath) {
     _filePath = filePath;
 }
 
+bool
+FileDownload::setOutputDescriptor(int fd) {
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        setIsValid(false);
+        setLastError(QString(_("The descriptor is not of a regular file.")));
+        return false;
+    }
+
+    // the data is read back to verify the hash
+    auto flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || (flags & O_ACCMODE) != O_RDWR) {
+        setIsValid(false);
+        setLastError(QString(
+            _("The descriptor must be opened to read and write.")));
+        return false;
+    }
+
+    // post processing works with paths that the daemon owns
+    if (_metadata.value(Metadata::EXTRACT_KEY).toBool()
+            || _metadata.contains(Metadata::COMMAND_KEY)) {
+        setIsValid(false);
+        setLastError(QString(
+            _("Downloads to a descriptor cannot be post processed.")));
+        return false;
+    }
+
+    auto dup = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (dup == -1 || ftruncate(dup, 0) != 0) {
+        setIsValid(false);
+        setLastError(QString(_("Could not use the descriptor: %1")).arg(
+            QString::fromLocal8Bit(strerror(errno))));
+        if (dup != -1) {
+            ::close(dup);
+        }
+        return false;
+    }
+
+    // no file is created nor renamed, release the names that were reserved
+    unlockFilePath();
+    _filePath.clear();
+    _tempFilePath.clear();
+    _outputFd = dup;
+    return true;
+}
+
+bool
+FileDownload::hasOutputDescriptor() const {
+    return _outputFd != -1;
+}
+
+File*
+FileDownload::createDataFile() {
+    auto fileMan = FileManager::instance();
+    if (_outputFd != -1) {
+        return fileMan->createFileFromDescriptor(_outputFd);
+    }
+    return fileMan->createFile(_tempFilePath);
+}
+
+uint
+FileDownload::retries() {
+    return _retries;
+}
+
+uint
+FileDownload::stalls() {
+    return _stalls;
+}
+
+QVariantList
+FileDownload::timeline() {
+    if (_timeline == nullptr) {
+        return QVariantList();
+    }
+    return _timeline->toVariantList();
+}
+
+QString
+FileDownload::chromeTrace() {
+    if (_timeline == nullptr) {
+        return QString();
+    }
+    return QString::fromUtf8(_timeline->toChromeTrace());
+}
+
+QVariantMap
+FileDownload::sourcesThroughput() {
+    if (_metalink == nullptr) {
+        return QVariantMap();
+    }
+    return _metalink->throughput();
+}
+
+qulonglong
+FileDownload::contiguousBytes() {
+    if (_metalink != nullptr) {
+        return _metalink->contiguous();
+    }
+    // the ranges are written at their offsets, the size of the file
+    // includes the holes between them
+    if (isRanges()) {
+        return (_ranges == nullptr)? 0 : _ranges->contiguous();
+    }
+    // the data of the leader is only copied once it is finished
+    return (_currentData == nullptr) ? 0 : _currentData->size();
+}
+
+QDBusUnixFileDescriptor
+FileDownload::openReadDescriptor() {
+    // the data is moved to the final path once the download is finished
+    // unless the rename failed, the descriptor of the temp file is still
+    // valid after that
+    auto path = (FileManager::instance()->exists(_tempFilePath))?
+        _tempFilePath : _filePath;
+    if (_outputFd != -1) {
+        path = storagePath();
+    }
+    int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        DOWN_LOG(WARNING) << "Could not open " << path << " for reading: "
+            << strerror(errno);
+        if (calledFromDBus()) {
+            sendErrorReply(QDBusError::Failed,
+                QString(_("The data of the download cannot be read yet.")));
+        }
+        return QDBusUnixFileDescriptor();
+    }
+
+    // readers only see the data that is in the file system, from now on
+    // the data is flushed before the watermark is updated
+    _hasReaders = true;
+    if (_currentData != nullptr) {
+        _currentData->flush();
+    }
+    _contiguousBytes = contiguousBytes();
+
+    // the D-Bus type dups the descriptor
+    QDBusUnixFileDescriptor descriptor(fd);
+    ::close(fd);
+    return descriptor;
+}
+
 QString
 FileDownload::filePath() {
     return _filePath;
@@ -19,6 +19,8 @@
 #pragma once
 
 #include <QDBusContext>
+#include <QDBusUnixFileDescriptor>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QNetworkReply>
 #include <QProcess>
@@ -28,8 +30,12 @@
 #include <ubuntu/transfers/errors/http_error_struct.h>
 #include <ubuntu/transfers/errors/network_error_struct.h>
 #include <ubuntu/transfers/errors/process_error_struct.h>
+#include <ubuntu/transfers/system/file_copier.h>
 #include <ubuntu/transfers/system/file_manager.h>
 #include <ubuntu/transfers/system/filename_mutex.h>
+#include <ubuntu/transfers/system/hash_verifier.h>
+#include <ubuntu/transfers/system/timeline.h>
+#include <ubuntu/transfers/system/timer.h>
 #include "download.h"
 
 namespace Ubuntu {
@@ -40,6 +46,10 @@ namespace DownloadManager {
 
 namespace Daemon {
 
+class DeltaTransfer;
+class MetalinkTransfer;
+class RangeTransfer;
+
 class FileDownload : public Download, public QDBusContext {
     Q_OBJECT
 
@@ -85,8 +95,18 @@ class FileDownload : public Download, public QDBusContext {
     virtual void resumeTransfer() override;
     virtual void startTransfer() override;
 
+    virtual qulonglong requiredSpace() override;
+    virtual QString storagePath() override;
+    virtual int storageDescriptor() override;
+
     void setFilePath(const QString& path);
 
+    // writes the data in the given descriptor instead of in a file owned
+    // by the daemon, the descriptor must be of a regular file opened to
+    // read and write so that the hash can be verified
+    bool setOutputDescriptor(int fd) override;
+    bool hasOutputDescriptor() const;
+
  public slots:  // NOLINT(whitespace/indent)
     qulonglong progress() override;
     qulonglong totalSize() override;
@@ -95,6 +115,21 @@ class FileDownload : public Download, public QDBusContext {
     virtual void setHeaders(StringMap headers) override;
     virtual void setMetadata(const QVariantMap& metadata) override;
     virtual QString filePath() override;
+    // number of times the download was retried after a transient error
+    virtual uint retries();
+    // number of times the connection was recycled because it stalled
+    virtual uint stalls();
+    // bytes per second received from each of the sources of a metalink
+    virtual QVariantMap sourcesThroughput();
+    // spans of the work done for the download, empty unless the daemon
+    // traces the downloads
+    virtual QVariantList timeline();
+    virtual QString chromeTrace();
+    // bytes from the start of the file that are already in the file system
+    virtual qulonglong contiguousBytes();
+    // read only descriptor of the file that is being downloaded so that
+    // the data can be used before the download is finished
+    virtual QDBusUnixFileDescriptor openReadDescriptor();
 
  signals:
     void finished(const QString& path);
@@ -104,6 +139,11 @@ class FileDownload : public Download, public QDBusContext {
     void processError(ProcessErrorStruct error);
     void hashError(HashErrorStruct error);
     void propertiesChanged(const QVariantMap& changes);
+    // only emitted once the data has readers
+    void contiguousBytesAvailable(qulonglong bytes);
+    // internal signals used by the downloads that share our transfer
+    void sharedDataReady(const QString& path, const QString& contentType);
+    void sharingStopped();
 
  protected:
     void emitError(const QString& error) override;
@@ -112,21 +152,79 @@ class FileDownload : public Download, public QDBusContext {
     RequestFactory* _requestFactory;
 
  private:
+    // when the data is synced to the disk
+    enum Durability {
+        NO_SYNC,
+        SYNC_ON_FINISH,
+        PERIODIC_SYNC
+    };
+
     // helper methods
     QNetworkRequest buildRequest();
+    File* createDataFile();
     void cleanUpCurrentData();
     void connectToReplySignals();
     void disconnectFromReplySignals();
     void emitFinished();
     bool flushFile();
-    bool hashIsValid();
+    bool syncFile();
+    bool truncateFile(qint64 size);
+    bool writeReplyData();
+    void checkReplyStatus();
+    void verifyHash(const QString& contentType);
+    void stopHashing();
+    void onHashCalculated(const QByteArray& digest,
+                          const QString& contentType);
+    void stopCopying();
+    void onSharedDataCopied(bool success,
+                            const QString& path,
+                            const QString& contentType);
     void init();
     void initFileNames();
+    Timer* retryTimer();
+    Timer* stallTimer();
+    void activate();
     void downloadPostProcessing(const QString& contentType);
+    void processData(const QString& contentType);
+    int postProcessingPriority();
     void unlockFilePath();
     void updateFileNamePerContentDisposition();
     void writeDataUri();
     void errorCleanup();
+    void scheduleRetry(int httpStatus);
+    void requestRemainingData(qint64 received);
+    bool failOver(int httpStatus);
+    bool isTooSlow(qulonglong received);
+    void startStallWatchdog(qulonglong received);
+    QString shareKey();
+    void shareTransfer();
+    void stopSharing();
+    bool followLeader();
+    void unfollowLeader();
+    QString cacheKey();
+    QString cachedContent();
+    void copyFromCache(const QString& path);
+    void findCachedResponse();
+    void storeInCache();
+    void startNetworkTransfer();
+    bool isDelta();
+    void startDelta();
+    void stopDelta();
+    bool isMetalink();
+    void startMetalink();
+    void stopMetalink();
+    bool isRanges();
+    void startRanges();
+    void stopRanges();
+    bool isSharable();
+    void traceBegin(const QString& span);
+    void traceEnd(const QString& span,
+                  qulonglong bytes = 0,
+                  const QString& error = QString());
+    void traceMark(const QString& mark);
+    // closes the spans of the current connection
+    void traceReplyDone(const QString& error = QString());
+    void traceDone(const QString& error = QString());
 
     // slots used to react to signals
     void onDownloadProgress(qint64 currentProgress, qint64);
@@ -140,11 +238,36 @@ class FileDownload : public Download, public QDBusContext {
                            QProcess::ExitStatus exitStatus);
     void onOnlineStateChanged(bool);
     void onPropertiesChanged(const QVariantMap& changes);
+    void onRetryTimeout();
+    void onStallTimeout();
+    void onLeaderProgress(qulonglong received, qulonglong total);
+    void onLeaderDataReady(const QString& path, const QString& contentType);
+    void onLeaderStopped();
+    void onDeltaProgress(qulonglong received, qulonglong total);
+    void onDeltaFinished();
+    void onDeltaFailed(const QString& reason);
+    void onMetalinkProgress(qulonglong received, qulonglong total);
+    void onMetalinkFinished();
+    void onMetalinkFailed(const QString& reason);
+    void onRangesProgress(qulonglong received, qulonglong total);
+    void onRangesFinished();
+    void onRangesFailed(const QString& reason);
+    void onProgressForReaders(qulonglong received, qulonglong total);
+    void onProgressForDurability(qulonglong received, qulonglong total);
+    void onProgressForMetrics(qulonglong received, qulonglong total);
+    void onReplyEncrypted();
+    void onReplyMetaDataChanged();
 
 
  private:
     bool _downloading = false;
     bool _connected = false;
+    bool _active = false;  // started at least once
+    bool _spaceReserved = false;
+    int _attempt = 0;  // consecutive retries, reset when data arrives
+    uint _retries = 0;
+    uint _stalls = 0;
+    qulonglong _stallBytes = 0;  // received when the watchdog started
     qulonglong _totalSize = 0;
     QUrl _url;
     QString _basename;
@@ -155,7 +278,38 @@ class FileDownload : public Download, public QDBusContext {
     NetworkReply* _reply = nullptr;
     File* _currentData = nullptr;
     FileNameMutex* _fileNameMutex = nullptr;
+    Timer* _retryTimer = nullptr;
+    Timer* _stallTimer = nullptr;
     QList<QUrl> _visitedUrls;
+    qint64 _requestOffset = 0;  // size of the file when the request was sent
+    bool _replyHasData = true;  // the body of the reply continues the file
+    // the url of the client followed by the mirrors from the metadata
+    QList<QUrl> _mirrors;
+    int _mirror = 0;
+    qulonglong _minSpeed = 0;
+    qulonglong _speedBytes = 0;  // received when the window started
+    QElapsedTimer _speedClock;
+    bool _sharing = false;  // other downloads can follow our transfer
+    FileDownload* _leader = nullptr;  // download whose transfer we follow
+    bool _cached = false;  // the data is already in the content cache
+    QString _cachedResponse;  // cached data that is being revalidated
+    QByteArray _etag;
+    QByteArray _lastModified;
+    DeltaTransfer* _delta = nullptr;
+    bool _deltaFailed = false;  // the whole file is downloaded instead
+    MetalinkTransfer* _metalink = nullptr;
+    RangeTransfer* _ranges = nullptr;
+    HashJob* _hashJob = nullptr;  // verification running in the pool
+    CopyJob* _copyJob = nullptr;  // copy of the shared data in the pool
+    bool _hasReaders = false;
+    qulonglong _contiguousBytes = 0;
+    int _outputFd = -1;  // client descriptor used instead of a file
+    Durability _durability = NO_SYNC;
+    qulonglong _syncInterval = 0;
+    qulonglong _syncedBytes = 0;  // received when the data was last synced
+    qulonglong _metricsBytes = 0;  // received when the metrics were updated
+    Timeline* _timeline = nullptr;  // only created when tracing
+    qulonglong _traceBytes = 0;  // received when the receive span started
 };
 
 }  // Daemon
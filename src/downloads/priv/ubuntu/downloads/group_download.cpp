@@ -222,6 +222,12 @@ GroupDownload::resumeTransfer() {
 
 void
 GroupDownload::startTransfer() {
+    if (!hasFreeSpace()) {
+        cancelAllDownloads();
+        emitError(QString(_("Not enough free space to store the downloads")));
+        return;
+    }
+
     if (_downloads.count() > 0) {
         foreach(FileDownload* download, _downloads) {
             Download::State state = download->state();
@@ -240,6 +246,48 @@ GroupDownload::startTransfer() {
     }
 }
 
+bool
+GroupDownload::hasFreeSpace() {
+    // the downloads can be stored in diff file systems, sum the bytes
+    // still needed per dir. The size is only known for those downloads
+    // that already got a response, the rest reserve their space as soon
+    // as it is known.
+    QMap<QString, qulonglong> required;
+    foreach(FileDownload* download, _downloads) {
+        auto total = download->totalSize();
+        auto received = download->progress();
+        if (total <= received) {
+            continue;
+        }
+        Download::State state = download->state();
+        if (state == Download::FINISH || state == Download::ERROR
+                || state == Download::CANCEL) {
+            continue;
+        }
+        auto dir = QFileInfo(download->filePath()).absolutePath();
+        required[dir] += total - received;
+    }
+
+    foreach(const QString& dir, required.keys()) {
+        auto available = _fileManager->bytesAvailable(dir);
+        if (available >= 0
+                && required[dir] > static_cast<qulonglong>(available)) {
+            GROUP_LOG(WARNING) << "Required " << required[dir]
+                << " bytes in " << dir << " but only " << available
+                << " are available";
+            return false;
+        }
+    }
+    return true;
+}
+
+QString
+GroupDownload::storagePath() {
+    // the group does not have a path, use the one of the first download
+    // which is the most common case
+    return (_downloads.count() > 0)? _downloads.first()->filePath() : "";
+}
+
 qulonglong
 GroupDownload::progress() {
     qulonglong total = 0;
@@ -58,6 +58,12 @@ class GroupDownload : public Download {
     virtual void resumeTransfer() override;
     virtual void startTransfer() override;
 
+    // checks that the file systems of the downloads have enough free
+    // space for the data that is still to be downloaded
+    virtual bool hasFreeSpace();
+
+    virtual QString storagePath() override;
+
  public slots:  // NOLINT(whitespace/indent)
     virtual qulonglong progress() override;
     virtual qulonglong progress(qulonglong &started, qulonglong &paused,
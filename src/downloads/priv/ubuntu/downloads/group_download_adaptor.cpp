@@ -6,6 +6,8 @@
  *
  * This is an auto-generated file.
  * Do not edit! All changes made to it will be lost.
+ *
+ * HAND-EDIT: the method calls are timed in the metrics of the daemon
  */
 
 #include <QtCore/QMetaObject>
@@ -15,6 +17,7 @@
 #include <QtCore/QString>
 #include <QtCore/QStringList>
 #include <QtCore/QVariant>
+#include <ubuntu/transfers/system/metrics.h>
 #include "group_download.h"
 #include "group_download_adaptor.h"
 
@@ -24,6 +27,8 @@ namespace DownloadManager {
 
 namespace Daemon {
 
+using Ubuntu::Transfers::System::DBusCallTimer;
+
 /*
  * Implementation of adaptor class GroupDownloadAdaptor
  */
@@ -43,18 +48,21 @@ GroupDownloadAdaptor::~GroupDownloadAdaptor()
 void GroupDownloadAdaptor::allowGSMDownload(bool allowed)
 {
     // handle method call com.canonical.applications.GroupDownload.allowGSMDownload
+    DBusCallTimer timer("GroupDownload.allowGSMDownload");
     QMetaObject::invokeMethod(parent(), "allowGSMDownload", Q_ARG(bool, allowed));
 }
 
 void GroupDownloadAdaptor::cancel()
 {
     // handle method call com.canonical.applications.GroupDownload.cancel
+    DBusCallTimer timer("GroupDownload.cancel");
     QMetaObject::invokeMethod(parent(), "cancel");
 }
 
 bool GroupDownloadAdaptor::isGSMDownloadAllowed()
 {
     // handle method call com.canonical.applications.GroupDownload.isGSMDownloadAllowed
+    DBusCallTimer timer("GroupDownload.isGSMDownloadAllowed");
     bool allowed;
     QMetaObject::invokeMethod(parent(), "isGSMDownloadAllowed", Q_RETURN_ARG(bool, allowed));
     return allowed;
@@ -63,6 +71,7 @@ bool GroupDownloadAdaptor::isGSMDownloadAllowed()
 QVariantMap GroupDownloadAdaptor::metadata()
 {
     // handle method call com.canonical.applications.GroupDownload.metadata
+    DBusCallTimer timer("GroupDownload.metadata");
     QVariantMap data;
     QMetaObject::invokeMethod(parent(), "metadata", Q_RETURN_ARG(QVariantMap, data));
     return data;
@@ -71,36 +80,42 @@ QVariantMap GroupDownloadAdaptor::metadata()
 void GroupDownloadAdaptor::pause()
 {
     // handle method call com.canonical.applications.GroupDownload.pause
+    DBusCallTimer timer("GroupDownload.pause");
     QMetaObject::invokeMethod(parent(), "pause");
 }
 
 qulonglong GroupDownloadAdaptor::progress(qulonglong &started, qulonglong &paused, qulonglong &finished)
 {
     // handle method call com.canonical.applications.GroupDownload.progress
+    DBusCallTimer timer("GroupDownload.progress");
     return static_cast<GroupDownload*>(parent())->progress(started, paused, finished);
 }
 
 void GroupDownloadAdaptor::resume()
 {
     // handle method call com.canonical.applications.GroupDownload.resume
+    DBusCallTimer timer("GroupDownload.resume");
     QMetaObject::invokeMethod(parent(), "resume");
 }
 
 void GroupDownloadAdaptor::setThrottle(qulonglong speed)
 {
     // handle method call com.canonical.applications.GroupDownload.setThrottle
+    DBusCallTimer timer("GroupDownload.setThrottle");
     QMetaObject::invokeMethod(parent(), "setThrottle", Q_ARG(qulonglong, speed));
 }
 
 void GroupDownloadAdaptor::start()
 {
     // handle method call com.canonical.applications.GroupDownload.start
+    DBusCallTimer timer("GroupDownload.start");
     QMetaObject::invokeMethod(parent(), "start");
 }
 
 qulonglong GroupDownloadAdaptor::throttle()
 {
     // handle method call com.canonical.applications.GroupDownload.throttle
+    DBusCallTimer timer("GroupDownload.throttle");
     qulonglong speed;
     QMetaObject::invokeMethod(parent(), "throttle", Q_RETURN_ARG(qulonglong, speed));
     return speed;
@@ -109,6 +124,7 @@ qulonglong GroupDownloadAdaptor::throttle()
 qulonglong GroupDownloadAdaptor::totalSize()
 {
     // handle method call com.canonical.applications.GroupDownload.totalSize
+    DBusCallTimer timer("GroupDownload.totalSize");
     qulonglong total;
     QMetaObject::invokeMethod(parent(), "totalSize", Q_RETURN_ARG(qulonglong, total));
     return total;
@@ -65,6 +65,40 @@ HeaderParser::isDeflatableContentType(QString value) {
     return types.find(value.toStdString()) != types.end();
 }
 
+QString
+HeaderParser::boundaryFromContentType(QString value) {
+    auto params = value.split(';');
+    if (!params[0].trimmed().toLower().startsWith("multipart/"))
+        return QString();
+
+    for (int index = 1; index < params.count(); index++) {
+        auto param = params[index].trimmed();
+        if (!param.toLower().startsWith("boundary="))
+            continue;
+        return param.mid(9).replace("\"", "").trimmed();
+    }
+    return QString();
+}
+
+bool
+HeaderParser::rangeFromContentRange(QString value, qint64& first,
+                                    qint64& last) {
+    // bytes <first>-<last>/<total or *>
+    auto range = value.simplified();
+    if (!range.toLower().startsWith("bytes "))
+        return false;
+
+    auto limits = range.mid(6).split('/')[0].split('-');
+    if (limits.count() != 2)
+        return false;
+
+    bool firstOk = false;
+    bool lastOk = false;
+    first = limits[0].toLongLong(&firstOk);
+    last = limits[1].toLongLong(&lastOk);
+    return firstOk && lastOk && first >= 0 && last >= first;
+}
+
 }  // Daemon
 
 }  // DownloadManager
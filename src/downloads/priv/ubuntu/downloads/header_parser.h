@@ -31,6 +31,11 @@ class HeaderParser {
  public:
     static QString fileNameFromContentDisposition(QString value);
     static bool isDeflatableContentType(QString value);
+    // boundary of a multipart content type, empty if there is none
+    static QString boundaryFromContentType(QString value);
+    // first and last bytes of a 'bytes first-last/total' value
+    static bool rangeFromContentRange(QString value, qint64& first,
+                                      qint64& last);
 };
 
 }  // Daemon
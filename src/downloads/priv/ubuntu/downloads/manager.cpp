@@ -22,9 +22,15 @@
 #include <ubuntu/download_manager/system/logger.h>
 #include <ubuntu/transfers/system/apparmor.h>
 #include <ubuntu/transfers/system/logger.h>
+#include <ubuntu/transfers/system/metrics.h>
 #include <ubuntu/transfers/system/request_factory.h>
 #include "manager.h"
 
+namespace {
+    const QString CREATED_METRIC = "udm_downloads_created_total";
+    const QString APP_LABEL = "app";
+}
+
 namespace Ubuntu {
 
 namespace DownloadManager {
@@ -162,6 +168,8 @@ DownloadManager::registerDownload(Download* download) {
     }
     _db->connectToDownload(download);
     _queue->add(download);
+    Metrics::instance()->increment(CREATED_METRIC,
+        {{APP_LABEL, download->transferAppId()}});
     auto path = download->path();
     qDebug() << "ADDED TO Q";
     _conn->registerObject(path, download);
@@ -217,6 +225,31 @@ DownloadManager::createDownload(DownloadStruct download) {
         download.getAlgorithm(), download.getMetadata(), download.getHeaders());
 }
 
+QDBusObjectPath
+DownloadManager::createDownloadWithFd(DownloadStruct download,
+                                      const QDBusUnixFileDescriptor& fd) {
+    LOG(INFO) << "Create download with descriptor == {url:"
+        << download.getUrl() << " fd: " << fd.fileDescriptor() << "}";
+    DownloadCreationFunc createDownloadFunc =
+        [this, download, fd](QString owner) {
+        Download* result = nullptr;
+        if (download.getHash().isEmpty())
+            result = _downloadFactory->createDownload(owner,
+                download.getUrl(), download.getMetadata(),
+                download.getHeaders());
+        else
+            result = _downloadFactory->createDownload(owner,
+                download.getUrl(), download.getHash(),
+                download.getAlgorithm(), download.getMetadata(),
+                download.getHeaders());
+        // the descriptor is dup'ed so it remains valid once the message
+        // is gone
+        result->setOutputDescriptor(fd.fileDescriptor());
+        return result;
+    };
+    return createDownload(createDownloadFunc);
+}
+
 QDBusObjectPath
 DownloadManager::createMmsDownload(const QString& url,
                            const QString& hostname,
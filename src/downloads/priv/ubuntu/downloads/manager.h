@@ -23,6 +23,7 @@
 
 #include <QByteArray>
 #include <QDBusObjectPath>
+#include <QDBusUnixFileDescriptor>
 #include <QObject>
 #include <QSslCertificate>
 
@@ -69,6 +70,8 @@ class DownloadManager : public BaseManager {
 
  public slots:  // NOLINT(whitespace/indent)
     virtual QDBusObjectPath createDownload(DownloadStruct download);
+    virtual QDBusObjectPath createDownloadWithFd(DownloadStruct download,
+                                        const QDBusUnixFileDescriptor& fd);
     virtual QDBusObjectPath createMmsDownload(const QString& url,
                                               const QString& hostname,
                                               int port);
@@ -0,0 +1,277 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+
+#include <QRegExp>
+#include <QXmlStreamReader>
+#include "metalink.h"
+
+namespace {
+    // the pieces are kept in memory until they are verified
+    const qint64 MAX_PIECE_LENGTH = 16 * 1024 * 1024;
+
+    struct HashName {
+        const char* name;
+        QCryptographicHash::Algorithm algo;
+    };
+
+    // from the weakest to the strongest
+    const HashName HASH_NAMES[] = {
+        {"md5", QCryptographicHash::Md5},
+        {"sha-1", QCryptographicHash::Sha1},
+        {"sha-224", QCryptographicHash::Sha224},
+        {"sha-256", QCryptographicHash::Sha256},
+        {"sha-384", QCryptographicHash::Sha384},
+        {"sha-512", QCryptographicHash::Sha512},
+    };
+
+    int strength(const QString& name) {
+        for (unsigned index = 0;
+                index < sizeof(HASH_NAMES) / sizeof(HASH_NAMES[0]); index++) {
+            if (name == HASH_NAMES[index].name) {
+                return index;
+            }
+        }
+        return -1;
+    }
+}
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+bool
+Metalink::parse(const QByteArray& data) {
+    *this = Metalink();
+    QXmlStreamReader xml(data);
+
+    if (!xml.readNextStartElement() || xml.name() != "metalink") {
+        _lastError = "Not a metalink document.";
+        return false;
+    }
+
+    bool found = false;
+    while (xml.readNextStartElement()) {
+        if (xml.name() == "file" && !found) {
+            if (!parseFile(xml)) {
+                return false;
+            }
+            found = true;
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+
+    if (xml.hasError()) {
+        _lastError = xml.errorString();
+        return false;
+    }
+
+    if (!found) {
+        _lastError = "The document does not describe any file.";
+        return false;
+    }
+
+    if (_size <= 0) {
+        _lastError = "The size of the file is missing.";
+        return false;
+    }
+
+    if (_urls.isEmpty()) {
+        _lastError = "The file does not have any supported url.";
+        return false;
+    }
+
+    if (!_pieceHashes.isEmpty()) {
+        auto count = (_size + _pieceLength - 1) / _pieceLength;
+        if (_pieceHashes.count() != count) {
+            _lastError = "The pieces do not match the size of the file.";
+            return false;
+        }
+    }
+
+    std::stable_sort(_urls.begin(), _urls.end(),
+        [](const MetalinkUrl& a, const MetalinkUrl& b) {
+            return a.priority < b.priority;
+        });
+    return true;
+}
+
+bool
+Metalink::parseFile(QXmlStreamReader& xml) {
+    _name = xml.attributes().value("name").toString();
+
+    while (xml.readNextStartElement()) {
+        if (xml.name() == "size") {
+            bool ok = false;
+            _size = xml.readElementText().trimmed().toLongLong(&ok);
+            if (!ok) {
+                _lastError = "Invalid size.";
+                return false;
+            }
+        } else if (xml.name() == "url") {
+            MetalinkUrl url;
+            if (xml.attributes().hasAttribute("priority")) {
+                url.priority = xml.attributes().value(
+                    "priority").toString().toInt();
+            }
+            url.url = QUrl(xml.readElementText().trimmed());
+            // local files and other schemes could be used to read data
+            // the client has no access to
+            auto scheme = url.url.scheme().toLower();
+            if (url.url.isValid() && (scheme == "http" || scheme == "https")) {
+                _urls.append(url);
+            }
+        } else if (xml.name() == "hash") {
+            auto type = xml.attributes().value("type").toString().toLower();
+            auto hash = xml.readElementText().trimmed().toLower();
+            QCryptographicHash::Algorithm algo;
+            if (strength(type) > _hashStrength
+                    && algorithmFromName(type, algo)) {
+                if (!isValidHash(hash, algo)) {
+                    _lastError = QString("Invalid %1 hash.").arg(type);
+                    return false;
+                }
+                _hash = hash;
+                _hashAlgo = algo;
+                _hashStrength = strength(type);
+            }
+        } else if (xml.name() == "pieces") {
+            if (!parsePieces(xml)) {
+                return false;
+            }
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+    return !xml.hasError();
+}
+
+bool
+Metalink::parsePieces(QXmlStreamReader& xml) {
+    auto type = xml.attributes().value("type").toString().toLower();
+    bool ok = false;
+    auto length = xml.attributes().value("length").toString().toLongLong(&ok);
+    if (!ok || length <= 0 || length > MAX_PIECE_LENGTH) {
+        _lastError = "Invalid piece length.";
+        return false;
+    }
+
+    QCryptographicHash::Algorithm algo;
+    if (!algorithmFromName(type, algo)) {
+        // the pieces cannot be verified, the whole file hash is used
+        xml.skipCurrentElement();
+        return true;
+    }
+
+    // a document can have the pieces hashed with diff algorithms, use the
+    // first one we understand
+    auto ignore = !_pieceHashes.isEmpty();
+    QStringList hashes;
+    while (xml.readNextStartElement()) {
+        if (xml.name() != "hash") {
+            xml.skipCurrentElement();
+            continue;
+        }
+        auto hash = xml.readElementText().trimmed().toLower();
+        if (!ignore && !isValidHash(hash, algo)) {
+            _lastError = QString("Invalid %1 piece hash.").arg(type);
+            return false;
+        }
+        hashes.append(hash);
+    }
+
+    if (!ignore) {
+        _pieceLength = length;
+        _pieceHashes = hashes;
+        _pieceAlgo = algo;
+    }
+    return !xml.hasError();
+}
+
+bool
+Metalink::isValidHash(const QString& hash,
+                      QCryptographicHash::Algorithm algo) const {
+    auto size = QCryptographicHash::hash(QByteArray(), algo).size() * 2;
+    return hash.size() == size && QRegExp("[0-9a-f]+").exactMatch(hash);
+}
+
+QString
+Metalink::lastError() const {
+    return _lastError;
+}
+
+QString
+Metalink::name() const {
+    return _name;
+}
+
+qint64
+Metalink::size() const {
+    return _size;
+}
+
+QList<MetalinkUrl>
+Metalink::urls() const {
+    return _urls;
+}
+
+QString
+Metalink::hash() const {
+    return _hash;
+}
+
+QCryptographicHash::Algorithm
+Metalink::hashAlgorithm() const {
+    return _hashAlgo;
+}
+
+qint64
+Metalink::pieceLength() const {
+    return _pieceLength;
+}
+
+QStringList
+Metalink::pieceHashes() const {
+    return _pieceHashes;
+}
+
+QCryptographicHash::Algorithm
+Metalink::pieceAlgorithm() const {
+    return _pieceAlgo;
+}
+
+bool
+Metalink::algorithmFromName(const QString& name,
+                            QCryptographicHash::Algorithm& algo) {
+    auto index = strength(name.toLower());
+    if (index < 0) {
+        return false;
+    }
+    algo = HASH_NAMES[index].algo;
+    return true;
+}
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_METALINK_H
+#define DOWNLOADER_LIB_METALINK_H
+
+#include <QCryptographicHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+class QXmlStreamReader;
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+struct MetalinkUrl {
+    QUrl url;
+    int priority = 999999;  // lower values are preferred
+};
+
+// File described by a metalink (RFC 5854) document. Only the first file of
+// the document is used since a download always results in a single file.
+class Metalink {
+ public:
+    Metalink() = default;
+
+    bool parse(const QByteArray& data);
+    QString lastError() const;
+
+    QString name() const;
+    qint64 size() const;
+    // sources of the file sorted by priority
+    QList<MetalinkUrl> urls() const;
+
+    // strongest hash of the whole file, empty if none is supported
+    QString hash() const;
+    QCryptographicHash::Algorithm hashAlgorithm() const;
+
+    // pieces can only be verified when the document has their hashes
+    qint64 pieceLength() const;
+    QStringList pieceHashes() const;
+    QCryptographicHash::Algorithm pieceAlgorithm() const;
+
+    // maps the hash names of the IANA registry used by metalink
+    static bool algorithmFromName(const QString& name,
+                                  QCryptographicHash::Algorithm& algo);
+
+ private:
+    bool parseFile(QXmlStreamReader& xml);
+    bool parsePieces(QXmlStreamReader& xml);
+    bool isValidHash(const QString& hash,
+                     QCryptographicHash::Algorithm algo) const;
+
+ private:
+    QString _lastError;
+    QString _name;
+    qint64 _size = -1;
+    QList<MetalinkUrl> _urls;
+    QString _hash;
+    QCryptographicHash::Algorithm _hashAlgo = QCryptographicHash::Md5;
+    int _hashStrength = -1;
+    qint64 _pieceLength = 0;
+    QStringList _pieceHashes;
+    QCryptographicHash::Algorithm _pieceAlgo = QCryptographicHash::Md5;
+};
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_METALINK_H
@@ -0,0 +1,540 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QBuffer>
+#include <QScopedPointer>
+#include <glog/logging.h>
+#include <ubuntu/transfers/system/cryptographic_hash.h>
+#include <ubuntu/transfers/system/logger.h>
+#include <ubuntu/transfers/system/request_factory.h>
+#include "metalink_transfer.h"
+
+namespace {
+    // connections opened at the same time, each to a diff source
+    const int MAX_CONNECTIONS = 4;
+    // errors after which a source is no longer used
+    const int MAX_SOURCE_ERRORS = 3;
+    // times a piece is requested again before giving up
+    const int MAX_PIECE_FAILURES = 5;
+    // used when the document does not split the file
+    const qint64 DEFAULT_PIECE_LENGTH = 1024 * 1024;
+    // pieces after the first missing one that can be requested when the
+    // data is downloaded sequentially
+    const int SEQUENTIAL_WINDOW = 2 * MAX_CONNECTIONS;
+    const QByteArray RANGE = "Range";
+}
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+bool
+MetalinkTransfer::Source::isEnabled() const {
+    return errors < MAX_SOURCE_ERRORS;
+}
+
+MetalinkTransfer::MetalinkTransfer(const QNetworkRequest& request,
+                                   File* output,
+                                   QObject* parent)
+    : QObject(parent),
+      _request(request),
+      _output(output) {
+}
+
+MetalinkTransfer::~MetalinkTransfer() {
+    stop();
+}
+
+void
+MetalinkTransfer::start() {
+    TRACE << _request.url();
+    if (isRunning()) {
+        return;
+    }
+
+    _failed = false;
+    if (!_parsed) {
+        _document = get(_request);
+        CHECK(connect(_document, &NetworkReply::finished,
+            this, &MetalinkTransfer::onDocumentFinished))
+                << "Could not connect to signal";
+        return;
+    }
+    schedule();
+}
+
+void
+MetalinkTransfer::stop() {
+    if (_document != nullptr) {
+        disconnect(_document, nullptr, this, nullptr);
+        _document->abort();
+        _document->deleteLater();
+        _document = nullptr;
+    }
+    // the data of the pieces that were not verified is dropped
+    for (int index = 0; index < _sources.count(); index++) {
+        releaseSource(index);
+    }
+}
+
+bool
+MetalinkTransfer::isRunning() const {
+    if (_document != nullptr) {
+        return true;
+    }
+    foreach(const Source& source, _sources) {
+        if (source.reply != nullptr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+MetalinkTransfer::setThrottle(qulonglong speed) {
+    _throttle = speed;
+    foreach(const Source& source, _sources) {
+        if (source.reply != nullptr) {
+            source.reply->setReadBufferSize(speed);
+        }
+    }
+}
+
+void
+MetalinkTransfer::setSequential(bool sequential) {
+    _sequential = sequential;
+}
+
+qulonglong
+MetalinkTransfer::contiguous() const {
+    foreach(const Piece& piece, _pieces) {
+        if (!piece.done) {
+            return piece.offset;
+        }
+    }
+    return totalSize();
+}
+
+qulonglong
+MetalinkTransfer::received() const {
+    auto received = _received;
+    foreach(const Source& source, _sources) {
+        received += source.data.size();
+    }
+    return received;
+}
+
+qulonglong
+MetalinkTransfer::totalSize() const {
+    return (_parsed)? static_cast<qulonglong>(_metalink.size()) : 0;
+}
+
+Metalink
+MetalinkTransfer::metalink() const {
+    return _metalink;
+}
+
+QVariantMap
+MetalinkTransfer::throughput() const {
+    QVariantMap result;
+    foreach(const Source& source, _sources) {
+        auto bytes = source.bytes;
+        auto msecs = source.msecs;
+        if (source.reply != nullptr) {
+            bytes += source.data.size();
+            msecs += source.clock.elapsed();
+        }
+        qulonglong speed = (msecs > 0)? bytes * 1000 / msecs : 0;
+        result[source.url.url.toString()] = speed;
+    }
+    return result;
+}
+
+NetworkReply*
+MetalinkTransfer::get(const QNetworkRequest& request) {
+    auto reply = RequestFactory::instance()->get(request);
+    reply->setReadBufferSize(_throttle);
+    CHECK(connect(reply, &NetworkReply::error,
+        this, &MetalinkTransfer::onError))
+            << "Could not connect to signal";
+    CHECK(connect(reply, &NetworkReply::sslErrors,
+        this, &MetalinkTransfer::onSslErrors))
+            << "Could not connect to signal";
+    return reply;
+}
+
+void
+MetalinkTransfer::fail(const QString& reason) {
+    if (_failed) {
+        return;
+    }
+    _failed = true;
+    stop();
+    LOG(WARNING) << "Metalink transfer failed: " << reason;
+    emit failed(reason);
+}
+
+void
+MetalinkTransfer::createPieces() {
+    auto size = _metalink.size();
+    auto hashes = _metalink.pieceHashes();
+    auto length = (hashes.isEmpty())?
+        DEFAULT_PIECE_LENGTH : _metalink.pieceLength();
+
+    _pieces.clear();
+    _received = 0;
+    for (qint64 offset = 0; offset < size; offset += length) {
+        Piece piece;
+        piece.offset = offset;
+        piece.length = qMin(length, size - offset);
+        _pieces.append(piece);
+    }
+
+    auto file = qobject_cast<QFile*>(_output->device());
+    if (file != nullptr && file->size() > size) {
+        file->resize(size);
+    }
+
+    if (hashes.isEmpty()) {
+        // there is no way to know which pieces of a previous run are valid
+        return;
+    }
+
+    // the data of a paused or interrupted download is kept when valid
+    auto device = _output->device();
+    auto available = _output->size();
+    int reused = 0;
+    for (int index = 0; index < _pieces.count(); index++) {
+        auto& piece = _pieces[index];
+        if (piece.offset + piece.length > available) {
+            break;
+        }
+        if (!device->seek(piece.offset)) {
+            break;
+        }
+        if (verifyPiece(index, device->read(piece.length))) {
+            piece.done = true;
+            _received += piece.length;
+            reused++;
+        }
+    }
+    LOG(INFO) << "Reusing " << reused << " of " << _pieces.count()
+        << " pieces of " << _request.url().toString();
+}
+
+bool
+MetalinkTransfer::verifyPiece(int piece, const QByteArray& data) {
+    auto hashes = _metalink.pieceHashes();
+    if (hashes.isEmpty()) {
+        return data.size() == _pieces[piece].length;
+    }
+
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QScopedPointer<CryptographicHash> hash(
+        CryptographicHashFactory::instance()->createCryptographicHash(
+            _metalink.pieceAlgorithm()));
+    hash->addData(&buffer);
+    return QString(hash->result().toHex()) == hashes[piece];
+}
+
+void
+MetalinkTransfer::schedule() {
+    if (_failed) {
+        return;
+    }
+
+    bool done = true;
+    foreach(const Piece& piece, _pieces) {
+        done = done && piece.done;
+    }
+    if (done) {
+        emitProgress();
+        emit finished();
+        return;
+    }
+
+    int active = 0;
+    foreach(const Source& source, _sources) {
+        if (source.reply != nullptr) {
+            active++;
+        }
+    }
+
+    // sources are sorted by priority, the faster ones get more pieces
+    // because they are available earlier
+    for (int index = 0; index < _sources.count() && active < MAX_CONNECTIONS;
+            index++) {
+        if (!_sources[index].isEnabled() || _sources[index].reply != nullptr) {
+            continue;
+        }
+        auto piece = nextPiece(index);
+        if (piece >= 0) {
+            requestPiece(index, piece);
+            active++;
+        }
+    }
+
+    if (active == 0) {
+        fail("None of the sources of the file can be used.");
+    }
+}
+
+int
+MetalinkTransfer::nextPiece(int source) const {
+    int fallback = -1;
+    int first = -1;
+    for (int index = 0; index < _pieces.count(); index++) {
+        auto piece = _pieces[index];
+        if (first < 0 && !piece.done) {
+            first = index;
+        }
+        if (_sequential && first >= 0 && index >= first + SEQUENTIAL_WINDOW) {
+            // the bandwidth is used for the start of the missing data
+            break;
+        }
+        if (piece.done || piece.source >= 0) {
+            continue;
+        }
+        if (piece.badSource != source) {
+            return index;
+        }
+        if (fallback < 0) {
+            fallback = index;
+        }
+    }
+
+    // a source that sent a corrupted piece only gets it again when there
+    // is no other source to use
+    for (int index = 0; index < _sources.count(); index++) {
+        if (index != source && _sources[index].isEnabled()) {
+            return -1;
+        }
+    }
+    return fallback;
+}
+
+void
+MetalinkTransfer::requestPiece(int source, int piece) {
+    auto& current = _sources[source];
+    auto& part = _pieces[piece];
+    auto request = _request;
+    request.setUrl(current.url.url);
+    request.setRawHeader(RANGE, "bytes=" + QByteArray::number(part.offset)
+        + "-" + QByteArray::number(part.offset + part.length - 1));
+
+    part.source = source;
+    current.piece = piece;
+    current.data.clear();
+    current.data.reserve(part.length);
+    current.clock.start();
+    current.reply = get(request);
+    CHECK(connect(current.reply, &NetworkReply::downloadProgress,
+        this, &MetalinkTransfer::onPieceDataReady))
+            << "Could not connect to signal";
+    CHECK(connect(current.reply, &NetworkReply::finished,
+        this, &MetalinkTransfer::onPieceFinished))
+            << "Could not connect to signal";
+}
+
+void
+MetalinkTransfer::releaseSource(int source) {
+    auto& current = _sources[source];
+    if (current.reply != nullptr) {
+        disconnect(current.reply, nullptr, this, nullptr);
+        current.reply->abort();
+        current.reply->deleteLater();
+        current.reply = nullptr;
+    }
+    if (current.piece >= 0) {
+        _pieces[current.piece].source = -1;
+        current.piece = -1;
+    }
+    current.data.clear();
+}
+
+void
+MetalinkTransfer::sourceError(int source, const QString& reason,
+                              bool disable) {
+    auto& current = _sources[source];
+    LOG(WARNING) << current.url.url.toString() << ": " << reason;
+    current.errors = (disable)? MAX_SOURCE_ERRORS : current.errors + 1;
+    releaseSource(source);
+}
+
+int
+MetalinkTransfer::sourceOf(QObject* reply) const {
+    for (int index = 0; index < _sources.count(); index++) {
+        if (_sources[index].reply == reply) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+void
+MetalinkTransfer::emitProgress() {
+    emit progress(received(), totalSize());
+}
+
+void
+MetalinkTransfer::onDocumentFinished() {
+    auto data = _document->readAll();
+    disconnect(_document, nullptr, this, nullptr);
+    _document->deleteLater();
+    _document = nullptr;
+
+    if (!_metalink.parse(data)) {
+        fail(QString("Invalid metalink document: %1").arg(
+            _metalink.lastError()));
+        return;
+    }
+    _parsed = true;
+
+    _sources.clear();
+    foreach(const MetalinkUrl& url, _metalink.urls()) {
+        Source source;
+        source.url = url;
+        _sources.append(source);
+    }
+    createPieces();
+    schedule();
+}
+
+void
+MetalinkTransfer::onPieceDataReady() {
+    auto index = sourceOf(sender());
+    if (index < 0) {
+        return;
+    }
+
+    auto& source = _sources[index];
+    source.data += source.reply->readAll();
+    if (source.data.size() > _pieces[source.piece].length) {
+        // the range was ignored, the source is useless
+        sourceError(index, "The range request was ignored.", true);
+        schedule();
+        return;
+    }
+    emitProgress();
+}
+
+void
+MetalinkTransfer::onPieceFinished() {
+    auto index = sourceOf(sender());
+    if (index < 0) {
+        return;
+    }
+
+    auto& source = _sources[index];
+    auto& piece = _pieces[source.piece];
+    auto pieceIndex = source.piece;
+    auto status = source.reply->attribute(
+        QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    source.data += source.reply->readAll();
+
+    auto whole = piece.offset == 0 && piece.length == _metalink.size();
+    if (status != 206 && !(status == 200 && whole)) {
+        sourceError(index, QString("Unexpected status %1").arg(status),
+            status == 200);
+        schedule();
+        return;
+    }
+    if (source.data.size() != piece.length) {
+        sourceError(index, "The piece is incomplete.");
+        schedule();
+        return;
+    }
+
+    auto data = source.data;
+    auto elapsed = source.clock.elapsed();
+    releaseSource(index);
+
+    if (!verifyPiece(pieceIndex, data)) {
+        // only the piece is requested again, preferably to another source
+        LOG(WARNING) << "Piece " << pieceIndex << " from "
+            << source.url.url.toString() << " is corrupted";
+        piece.failures++;
+        piece.badSource = index;
+        source.errors++;
+        if (piece.failures >= MAX_PIECE_FAILURES) {
+            fail(QString("Piece %1 could not be verified.").arg(pieceIndex));
+            return;
+        }
+        schedule();
+        return;
+    }
+
+    if (!_output->device()->seek(piece.offset)
+            || _output->write(data) != data.size()) {
+        fail("Could not write the data.");
+        return;
+    }
+    piece.done = true;
+    _received += piece.length;
+    source.bytes += piece.length;
+    source.msecs += elapsed;
+
+    emitProgress();
+    schedule();
+}
+
+void
+MetalinkTransfer::onError(QNetworkReply::NetworkError code) {
+    auto reply = qobject_cast<NetworkReply*>(sender());
+    if (reply == _document) {
+        fail(QString("Network error %1: %2").arg(code).arg(
+            _document->errorString()));
+        return;
+    }
+
+    auto index = sourceOf(reply);
+    if (index >= 0) {
+        sourceError(index, QString("Network error %1: %2").arg(code).arg(
+            reply->errorString()));
+        schedule();
+    }
+}
+
+void
+MetalinkTransfer::onSslErrors(const QList<QSslError>& errors) {
+    auto reply = qobject_cast<NetworkReply*>(sender());
+    if (reply == nullptr || reply->canIgnoreSslErrors(errors)) {
+        return;
+    }
+
+    if (reply == _document) {
+        fail("SSL error.");
+        return;
+    }
+
+    auto index = sourceOf(reply);
+    if (index >= 0) {
+        sourceError(index, "SSL error.", true);
+        schedule();
+    }
+}
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_METALINK_TRANSFER_H
+#define DOWNLOADER_LIB_METALINK_TRANSFER_H
+
+#include <QElapsedTimer>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QSslError>
+#include <QVariantMap>
+#include <QVector>
+#include <ubuntu/transfers/system/file_manager.h>
+#include <ubuntu/transfers/system/network_reply.h>
+#include "metalink.h"
+
+namespace Ubuntu {
+
+using namespace Transfers::System;
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+// Downloads the file described by a metalink document splitting it in
+// pieces that are requested to the diff sources at the same time. Each
+// piece is verified before it is written so that a corrupted piece is
+// requested again, preferably to another source, instead of failing the
+// whole download.
+class MetalinkTransfer : public QObject {
+    Q_OBJECT
+
+ public:
+    // the url of the request is the one of the metalink document
+    MetalinkTransfer(const QNetworkRequest& request,
+                     File* output,
+                     QObject* parent = 0);
+    virtual ~MetalinkTransfer();
+
+    // the pieces of the output that are valid are not downloaded again
+    void start();
+    // aborts the requests, the verified pieces are kept
+    void stop();
+    bool isRunning() const;
+
+    void setThrottle(qulonglong speed);
+    // pieces are only requested close to the start of the data that is
+    // missing so that the file can be read while it is downloaded
+    void setSequential(bool sequential);
+    qulonglong received() const;
+    // bytes from the start of the file that were verified and written
+    qulonglong contiguous() const;
+    // bytes of the file, 0 until the document was downloaded
+    qulonglong totalSize() const;
+    Metalink metalink() const;
+    // bytes per second received from each of the sources
+    QVariantMap throughput() const;
+
+ signals:
+    void progress(qulonglong received, qulonglong total);
+    void finished();
+    void failed(const QString& reason);
+
+ private:
+    struct Piece {
+        qint64 offset = 0;
+        qint64 length = 0;
+        bool done = false;
+        int source = -1;  // source downloading the piece
+        int badSource = -1;  // last source that sent corrupted data
+        int failures = 0;
+    };
+
+    struct Source {
+        MetalinkUrl url;
+        NetworkReply* reply = nullptr;
+        int piece = -1;
+        QByteArray data;
+        int errors = 0;
+        qulonglong bytes = 0;  // verified bytes
+        qint64 msecs = 0;  // time spent receiving them
+        QElapsedTimer clock;
+
+        bool isEnabled() const;
+    };
+
+    NetworkReply* get(const QNetworkRequest& request);
+    void fail(const QString& reason);
+    void createPieces();
+    bool verifyPiece(int piece, const QByteArray& data);
+    void schedule();
+    int nextPiece(int source) const;
+    void requestPiece(int source, int piece);
+    void releaseSource(int source);
+    void sourceError(int source, const QString& reason, bool disable=false);
+    int sourceOf(QObject* reply) const;
+    void emitProgress();
+
+    // slots used to react to signals
+    void onDocumentFinished();
+    void onPieceDataReady();
+    void onPieceFinished();
+    void onError(QNetworkReply::NetworkError code);
+    void onSslErrors(const QList<QSslError>& errors);
+
+ private:
+    QNetworkRequest _request;
+    File* _output = nullptr;
+    NetworkReply* _document = nullptr;
+    bool _parsed = false;
+    bool _failed = false;
+    qulonglong _throttle = 0;
+    bool _sequential = false;
+    Metalink _metalink;
+    QVector<Piece> _pieces;
+    QVector<Source> _sources;
+    qulonglong _received = 0;  // bytes of the pieces that are done
+};
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_METALINK_TRANSFER_H
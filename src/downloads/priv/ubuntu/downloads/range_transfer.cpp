@@ -0,0 +1,370 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <glog/logging.h>
+#include <QByteArrayList>
+#include <ubuntu/transfers/system/logger.h>
+#include <ubuntu/transfers/system/request_factory.h>
+#include "header_parser.h"
+#include "range_transfer.h"
+
+namespace {
+    // servers limit the size of the headers, keep the list of ranges short
+    const int MAX_RANGES = 32;
+    const QByteArray CONTENT_TYPE = "Content-Type";
+    const QByteArray CONTENT_RANGE = "Content-Range";
+    const QByteArray RANGE = "Range";
+}
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+RangeTransfer::RangeTransfer(const QNetworkRequest& request,
+                             const QList<ByteRange>& ranges,
+                             File* output,
+                             QObject* parent)
+    : QObject(parent),
+      _request(request),
+      _output(output),
+      _ranges(ranges),
+      _missing(ranges) {
+    foreach(const ByteRange& range, ranges) {
+        _total += range.length();
+    }
+}
+
+RangeTransfer::~RangeTransfer() {
+    if (_reply != nullptr) {
+        disconnect(_reply, nullptr, this, nullptr);
+        _reply->abort();
+        releaseReply();
+    }
+}
+
+void
+RangeTransfer::start() {
+    TRACE << _request.url();
+    _running = true;
+    emit progress(_received, _total);
+    requestRanges();
+}
+
+void
+RangeTransfer::stop() {
+    TRACE << _request.url();
+    if (_reply != nullptr) {
+        disconnect(_reply, nullptr, this, nullptr);
+        // do abort before reading
+        _reply->abort();
+        if (!_parser.isNull()) {
+            readData();
+        }
+        releaseReply();
+    }
+    // nothing to report once the owner stopped us
+    _running = false;
+}
+
+bool
+RangeTransfer::isRunning() const {
+    return _running;
+}
+
+void
+RangeTransfer::setThrottle(qulonglong speed) {
+    _throttle = speed;
+    if (_reply != nullptr) {
+        _reply->setReadBufferSize(speed);
+    }
+}
+
+qulonglong
+RangeTransfer::received() const {
+    return _received;
+}
+
+qulonglong
+RangeTransfer::contiguous() const {
+    // touching ranges are merged, only the first one can be a prefix
+    if (_ranges.isEmpty() || _ranges.first().first != 0) {
+        return 0;
+    }
+    auto end = _ranges.first().last + 1;
+    if (!_missing.isEmpty()) {
+        end = qMin(end, _missing.first().first);
+    }
+    return static_cast<qulonglong>(end);
+}
+
+qulonglong
+RangeTransfer::totalSize() const {
+    return _total;
+}
+
+bool
+RangeTransfer::parse(const QStringList& specs, QList<ByteRange>& ranges) {
+    QList<ByteRange> parsed;
+    foreach(const QString& spec, specs) {
+        // suffix and open ranges are not allowed, the offsets must be known
+        // before the response arrives
+        auto limits = spec.trimmed().split('-');
+        if (limits.count() != 2) {
+            return false;
+        }
+        bool firstOk = false;
+        bool lastOk = false;
+        ByteRange range;
+        range.first = limits[0].toLongLong(&firstOk);
+        range.last = limits[1].toLongLong(&lastOk);
+        if (!firstOk || !lastOk || range.first < 0
+                || range.last < range.first) {
+            return false;
+        }
+        parsed.append(range);
+    }
+
+    if (parsed.isEmpty()) {
+        return false;
+    }
+
+    std::sort(parsed.begin(), parsed.end(),
+        [](const ByteRange& a, const ByteRange& b) {
+            return a.first < b.first;
+        });
+
+    ranges.clear();
+    foreach(const ByteRange& range, parsed) {
+        if (!ranges.isEmpty() && range.first <= ranges.last().last + 1) {
+            ranges.last().last = qMax(ranges.last().last, range.last);
+        } else {
+            ranges.append(range);
+        }
+    }
+    return true;
+}
+
+NetworkReply*
+RangeTransfer::get(const QNetworkRequest& request) {
+    auto reply = RequestFactory::instance()->get(request);
+    reply->setReadBufferSize(_throttle);
+    CHECK(connect(reply, &NetworkReply::error,
+        this, &RangeTransfer::onError))
+            << "Could not connect to signal";
+    CHECK(connect(reply, &NetworkReply::sslErrors,
+        this, &RangeTransfer::onSslErrors))
+            << "Could not connect to signal";
+    return reply;
+}
+
+void
+RangeTransfer::releaseReply() {
+    if (_reply != nullptr) {
+        disconnect(_reply, nullptr, this, nullptr);
+        _reply->deleteLater();
+        _reply = nullptr;
+    }
+}
+
+void
+RangeTransfer::fail(const QString& reason) {
+    if (!_running) {
+        return;
+    }
+    _running = false;
+    if (_reply != nullptr) {
+        disconnect(_reply, nullptr, this, nullptr);
+        _reply->abort();
+        releaseReply();
+    }
+    LOG(WARNING) << "Range transfer failed: " << reason;
+    emit failed(reason);
+}
+
+void
+RangeTransfer::requestRanges() {
+    if (_missing.isEmpty()) {
+        _running = false;
+        emit progress(_received, _total);
+        emit finished();
+        return;
+    }
+
+    QByteArrayList ranges;
+    for (int index = 0; index < _missing.count()
+            && ranges.count() < MAX_RANGES; index++) {
+        ranges << QByteArray::number(_missing[index].first) + "-"
+            + QByteArray::number(_missing[index].last);
+    }
+
+    auto request = _request;
+    request.setRawHeader(RANGE, "bytes=" + ranges.join(','));
+    _requestStart = _received;
+    _parser.reset();
+    _reply = get(request);
+    CHECK(connect(_reply, &NetworkReply::downloadProgress,
+        this, &RangeTransfer::onDownloadProgress))
+            << "Could not connect to signal";
+    CHECK(connect(_reply, &NetworkReply::finished,
+        this, &RangeTransfer::onFinished))
+            << "Could not connect to signal";
+}
+
+bool
+RangeTransfer::writePart(const ByteRangesParser::Part& part) {
+    auto partLast = part.offset + part.data.size() - 1;
+    QList<ByteRange> missing;
+
+    // the server can merge close ranges or send the whole file, only the
+    // data of the missing ranges is written
+    foreach(const ByteRange& range, _missing) {
+        auto first = qMax(range.first, part.offset);
+        auto last = qMin(range.last, partLast);
+        if (first > last) {
+            missing.append(range);
+            continue;
+        }
+
+        auto size = last - first + 1;
+        if (!_output->device()->seek(first)
+                || _output->write(part.data.mid(first - part.offset, size))
+                    != size) {
+            fail("Could not write the data.");
+            return false;
+        }
+        _received += size;
+
+        if (range.first < first) {
+            ByteRange before;
+            before.first = range.first;
+            before.last = first - 1;
+            missing.append(before);
+        }
+        if (last < range.last) {
+            ByteRange after;
+            after.first = last + 1;
+            after.last = range.last;
+            missing.append(after);
+        }
+    }
+    _missing = missing;
+    return true;
+}
+
+void
+RangeTransfer::readData() {
+    if (_parser.isNull()) {
+        auto status = _reply->attribute(
+            QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status == 200) {
+            // a server that does not support ranges sends the whole file,
+            // the data out of the ranges is skipped
+            _parser.reset(new ByteRangesParser(0,
+                std::numeric_limits<qint64>::max()));
+        } else if (status != 206) {
+            fail(QString("Unexpected status code: %1").arg(status));
+            return;
+        } else {
+            auto boundary = HeaderParser::boundaryFromContentType(
+                _reply->rawHeader(CONTENT_TYPE));
+            if (!boundary.isEmpty()) {
+                _parser.reset(new ByteRangesParser(boundary));
+            } else {
+                // a single range is sent without a multipart body
+                qint64 first = 0;
+                qint64 last = 0;
+                if (!HeaderParser::rangeFromContentRange(
+                        _reply->rawHeader(CONTENT_RANGE), first, last)) {
+                    fail("Missing Content-Range.");
+                    return;
+                }
+                _parser.reset(new ByteRangesParser(first, last - first + 1));
+            }
+        }
+    }
+
+    QList<ByteRangesParser::Part> parts;
+    if (!_parser->feed(_reply->readAll(), parts)) {
+        fail(_parser->lastError());
+        return;
+    }
+
+    foreach(const ByteRangesParser::Part& part, parts) {
+        if (!writePart(part)) {
+            return;
+        }
+    }
+}
+
+void
+RangeTransfer::onDownloadProgress(qint64 received, qint64 total) {
+    Q_UNUSED(received);
+    Q_UNUSED(total);
+    readData();
+    if (!_running) {
+        return;
+    }
+    emit progress(_received, _total);
+
+    if (_missing.isEmpty()) {
+        // do not wait for the rest of a whole file
+        disconnect(_reply, nullptr, this, nullptr);
+        _reply->abort();
+        releaseReply();
+        requestRanges();
+    }
+}
+
+void
+RangeTransfer::onFinished() {
+    // the last chunk of data might not have been read
+    readData();
+    if (!_running) {
+        return;
+    }
+    releaseReply();
+
+    if (!_missing.isEmpty() && _received == _requestStart) {
+        fail("The server did not send the requested ranges.");
+        return;
+    }
+    requestRanges();
+}
+
+void
+RangeTransfer::onError(QNetworkReply::NetworkError code) {
+    fail(QString("Network error %1: %2").arg(code).arg(
+        _reply->errorString()));
+}
+
+void
+RangeTransfer::onSslErrors(const QList<QSslError>& errors) {
+    if (!_reply->canIgnoreSslErrors(errors)) {
+        fail("SSL error.");
+    }
+}
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
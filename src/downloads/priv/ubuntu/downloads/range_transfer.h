@@ -0,0 +1,120 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_RANGE_TRANSFER_H
+#define DOWNLOADER_LIB_RANGE_TRANSFER_H
+
+#include <QList>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QScopedPointer>
+#include <QSslError>
+#include <QStringList>
+#include <ubuntu/transfers/system/file_manager.h>
+#include <ubuntu/transfers/system/network_reply.h>
+#include "byte_ranges_parser.h"
+
+namespace Ubuntu {
+
+using namespace Transfers::System;
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+struct ByteRange {
+    qint64 first = 0;
+    qint64 last = 0;
+
+    qint64 length() const {
+        return last - first + 1;
+    }
+};
+
+// Downloads the given byte ranges of a file using multi range requests.
+// The data of each range is written at its offset so that the output is a
+// sparse file with the layout of the remote one. The ranges that were not
+// received are requested again when the transfer is started after a stop.
+class RangeTransfer : public QObject {
+    Q_OBJECT
+
+ public:
+    RangeTransfer(const QNetworkRequest& request,
+                  const QList<ByteRange>& ranges,
+                  File* output,
+                  QObject* parent = 0);
+    virtual ~RangeTransfer();
+
+    void start();
+    // writes the data that was already received and aborts the request
+    void stop();
+    bool isRunning() const;
+
+    void setThrottle(qulonglong speed);
+    qulonglong received() const;
+    // bytes at the start of the file that were received, the holes
+    // between the ranges are not data
+    qulonglong contiguous() const;
+    // bytes of all the ranges
+    qulonglong totalSize() const;
+
+    // parses ranges in the "first-last" form, the result is sorted and
+    // the ranges that overlap or touch are merged
+    static bool parse(const QStringList& specs, QList<ByteRange>& ranges);
+
+ signals:
+    void progress(qulonglong received, qulonglong total);
+    void finished();
+    void failed(const QString& reason);
+
+ private:
+    NetworkReply* get(const QNetworkRequest& request);
+    void releaseReply();
+    void fail(const QString& reason);
+    void requestRanges();
+    bool writePart(const ByteRangesParser::Part& part);
+    void readData();
+
+    // slots used to react to signals
+    void onDownloadProgress(qint64 received, qint64 total);
+    void onFinished();
+    void onError(QNetworkReply::NetworkError code);
+    void onSslErrors(const QList<QSslError>& errors);
+
+ private:
+    QNetworkRequest _request;
+    File* _output = nullptr;
+    NetworkReply* _reply = nullptr;
+    qulonglong _throttle = 0;
+    bool _running = false;
+    QList<ByteRange> _ranges;  // sorted ranges that were asked for
+    QList<ByteRange> _missing;  // sorted ranges that were not received
+    qulonglong _total = 0;
+    qulonglong _received = 0;
+    qulonglong _requestStart = 0;  // received when the ranges were requested
+    QScopedPointer<ByteRangesParser> _parser;
+};
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_RANGE_TRANSFER_H
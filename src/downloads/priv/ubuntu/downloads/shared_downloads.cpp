@@ -0,0 +1,128 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QCryptographicHash>
+#include "shared_downloads.h"
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+SharedDownloads* SharedDownloads::_instance = nullptr;
+QMutex SharedDownloads::_mutex;
+
+SharedDownloads::SharedDownloads(QObject* parent)
+    : QObject(parent) {
+}
+
+QString
+SharedDownloads::key(const QUrl& url,
+                     const QMap<QString, QString>& headers,
+                     const QString& hash,
+                     int algo) {
+    QCryptographicHash key(QCryptographicHash::Sha256);
+    key.addData(url.toEncoded());
+    key.addData("\n");
+
+    // header names are case insensitive, the map keeps them sorted
+    QMap<QString, QString> normalized;
+    foreach(const QString& name, headers.keys()) {
+        normalized[name.toLower()] = headers[name];
+    }
+    foreach(const QString& name, normalized.keys()) {
+        key.addData(name.toUtf8() + ": " + normalized[name].toUtf8() + "\n");
+    }
+
+    if (!hash.isEmpty()) {
+        key.addData(QByteArray::number(algo) + ":" + hash.toLower().toUtf8());
+    }
+    return QString(key.result().toHex());
+}
+
+bool
+SharedDownloads::isEnabled() const {
+    return _enabled;
+}
+
+void
+SharedDownloads::setEnabled(bool enabled) {
+    _enabled = enabled;
+    if (!_enabled) {
+        _leaders.clear();
+    }
+}
+
+FileDownload*
+SharedDownloads::leader(const QString& key) {
+    return _leaders.value(key, nullptr);
+}
+
+void
+SharedDownloads::setLeader(const QString& key, FileDownload* download) {
+    if (_enabled) {
+        _leaders[key] = download;
+    }
+}
+
+void
+SharedDownloads::removeLeader(FileDownload* download) {
+    auto it = _leaders.begin();
+    while (it != _leaders.end()) {
+        if (it.value() == download) {
+            it = _leaders.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+SharedDownloads*
+SharedDownloads::instance() {
+    if(_instance == nullptr) {
+        _mutex.lock();
+        if(_instance == nullptr)
+            _instance = new SharedDownloads();
+        _mutex.unlock();
+    }
+    return _instance;
+}
+
+void
+SharedDownloads::setInstance(SharedDownloads* instance) {
+    _instance = instance;
+}
+
+void
+SharedDownloads::deleteInstance() {
+    if(_instance != nullptr) {
+        _mutex.lock();
+        if(_instance != nullptr) {
+            delete _instance;
+            _instance = nullptr;
+        }
+        _mutex.unlock();
+    }
+}
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOWNLOADER_LIB_SHARED_DOWNLOADS_H
+#define DOWNLOADER_LIB_SHARED_DOWNLOADS_H
+
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QUrl>
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Daemon {
+
+class FileDownload;
+
+// Keeps track of the downloads that are receiving data from the network
+// so that identical downloads, even from diff apps, follow a single
+// transfer instead of each of them opening its own connection.
+class SharedDownloads : public QObject {
+    Q_OBJECT
+
+ public:
+    explicit SharedDownloads(QObject* parent = 0);
+
+    // identifies the data that a request returns, the headers are part
+    // of it because they can change the response (auth, cookies, etc..)
+    static QString key(const QUrl& url,
+                       const QMap<QString, QString>& headers,
+                       const QString& hash,
+                       int algo);
+
+    virtual bool isEnabled() const;
+    virtual void setEnabled(bool enabled);
+
+    // download that is receiving the data of the key, null if none
+    virtual FileDownload* leader(const QString& key);
+    virtual void setLeader(const QString& key, FileDownload* download);
+    virtual void removeLeader(FileDownload* download);
+
+    static SharedDownloads* instance();
+
+    // only used for testing so that we can inject a fake
+    static void setInstance(SharedDownloads* instance);
+    static void deleteInstance();
+
+ private:
+    // used for the singleton
+    static SharedDownloads* _instance;
+    static QMutex _mutex;
+
+    bool _enabled = true;
+    QHash<QString, FileDownload*> _leaders;
+};
+
+}  // Daemon
+
+}  // DownloadManager
+
+}  // Ubuntu
+
+#endif  // DOWNLOADER_LIB_SHARED_DOWNLOADS_H
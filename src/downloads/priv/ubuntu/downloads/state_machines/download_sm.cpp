@@ -16,15 +16,11 @@
  * Boston, MA 02110-1301, USA.
  */
 
-#include <QFinalState>
-#include <QState>
 #include <QStateMachine>
 #include <QSslError>
 #include <glog/logging.h>
 #include "ubuntu/transfers/system/logger.h"
 #include "download_sm.h"
-#include "final_state.h"
-#include "state.h"
 
 namespace Ubuntu {
 
@@ -200,6 +196,150 @@ QString DownloadSM::FINISHED = "FINISHED";
  * PRIVATE IMPLEMENTATION
  */
 
+namespace {
+
+enum class StateId : quint8 {
+    Idle,
+    Init,
+    Downloading,
+    DownloadingNotConnected,
+    Paused,
+    PausedNotConnected,
+    Downloaded,
+    Hashing,
+    PostProcessing,
+    Error,
+    Canceled,
+    Finished
+};
+
+// one event per signal of the SMFileDownload
+enum class Event : quint8 {
+    HeadRequestCompleted,
+    NetworkError,
+    SslErrors,
+    ConnectionEnabled,
+    ConnectionDisabled,
+    DownloadingStarted,
+    Paused,
+    Completed,
+    HashingStarted,
+    HashingError,
+    PostProcessingStarted,
+    PostProcessingError,
+    Finished,
+    Canceled
+};
+
+// the work that the transition classes do in onTransition
+enum class Action : quint8 {
+    None,
+    NetworkError,
+    SslError,
+    Start,
+    Pause,
+    Resume,
+    Cancel
+};
+
+struct Transition {
+    StateId source;
+    Event event;
+    StateId target;
+    Action action;
+};
+
+constexpr Transition TRANSITIONS[] = {
+    // idle
+    {StateId::Idle, Event::HeadRequestCompleted, StateId::Init, Action::None},
+    {StateId::Idle, Event::NetworkError, StateId::Error, Action::NetworkError},
+    {StateId::Idle, Event::SslErrors, StateId::Error, Action::SslError},
+    // init
+    {StateId::Init, Event::DownloadingStarted, StateId::Downloading,
+        Action::Start},
+    {StateId::Init, Event::NetworkError, StateId::Error, Action::NetworkError},
+    {StateId::Init, Event::SslErrors, StateId::Error, Action::SslError},
+    // downloading
+    {StateId::Downloading, Event::ConnectionDisabled,
+        StateId::DownloadingNotConnected, Action::Pause},
+    {StateId::Downloading, Event::Paused, StateId::Paused, Action::Pause},
+    {StateId::Downloading, Event::Canceled, StateId::Canceled, Action::Cancel},
+    {StateId::Downloading, Event::NetworkError, StateId::Error,
+        Action::NetworkError},
+    {StateId::Downloading, Event::SslErrors, StateId::Error, Action::SslError},
+    {StateId::Downloading, Event::Completed, StateId::Downloaded,
+        Action::None},
+    // downloading not connected
+    {StateId::DownloadingNotConnected, Event::ConnectionEnabled,
+        StateId::Downloading, Action::Resume},
+    {StateId::DownloadingNotConnected, Event::Canceled, StateId::Canceled,
+        Action::Cancel},
+    {StateId::DownloadingNotConnected, Event::Paused,
+        StateId::PausedNotConnected, Action::None},
+    // paused
+    {StateId::Paused, Event::DownloadingStarted, StateId::Downloading,
+        Action::Resume},
+    {StateId::Paused, Event::Canceled, StateId::Canceled, Action::Cancel},
+    {StateId::Paused, Event::ConnectionDisabled, StateId::PausedNotConnected,
+        Action::None},
+    // paused not connected
+    {StateId::PausedNotConnected, Event::Canceled, StateId::Canceled,
+        Action::Cancel},
+    {StateId::PausedNotConnected, Event::DownloadingStarted,
+        StateId::DownloadingNotConnected, Action::None},
+    {StateId::PausedNotConnected, Event::ConnectionEnabled, StateId::Paused,
+        Action::None},
+    // downloaded
+    {StateId::Downloaded, Event::Canceled, StateId::Canceled, Action::Cancel},
+    {StateId::Downloaded, Event::Finished, StateId::Finished, Action::None},
+    {StateId::Downloaded, Event::HashingStarted, StateId::Hashing,
+        Action::None},
+    {StateId::Downloaded, Event::PostProcessingStarted,
+        StateId::PostProcessing, Action::None},
+    // hashing
+    {StateId::Hashing, Event::Finished, StateId::Finished, Action::None},
+    {StateId::Hashing, Event::HashingError, StateId::Error, Action::None},
+    {StateId::Hashing, Event::PostProcessingStarted, StateId::PostProcessing,
+        Action::None},
+    // post processing
+    {StateId::PostProcessing, Event::Finished, StateId::Finished,
+        Action::None},
+    {StateId::PostProcessing, Event::PostProcessingError, StateId::Error,
+        Action::None},
+};
+
+constexpr int TRANSITIONS_COUNT = sizeof(TRANSITIONS) / sizeof(Transition);
+
+// the table is small enough for a linear search to be cheaper than any
+// kind of index
+constexpr int
+findTransition(StateId source, Event event, int index = 0) {
+    return index >= TRANSITIONS_COUNT ? -1
+        : (TRANSITIONS[index].source == source
+                && TRANSITIONS[index].event == event) ? index
+            : findTransition(source, event, index + 1);
+}
+
+constexpr bool
+isFinal(StateId state) {
+    return state == StateId::Error || state == StateId::Canceled
+        || state == StateId::Finished;
+}
+
+// every transition must be reachable and final states cannot be left
+constexpr bool
+isValid(int index = 0) {
+    return index >= TRANSITIONS_COUNT ||
+        (findTransition(TRANSITIONS[index].source,
+                TRANSITIONS[index].event) == index
+            && !isFinal(TRANSITIONS[index].source)
+            && isValid(index + 1));
+}
+
+static_assert(isValid(), "Ambiguous download state machine transitions");
+
+}
+
 class DownloadSMPrivate {
     Q_DECLARE_PUBLIC(DownloadSM)
 
@@ -208,220 +348,155 @@ class DownloadSMPrivate {
         : _down(down),
           q_ptr(parent) {
         Q_Q(DownloadSM);
-        _idleState = new State(q, "state", DownloadSM::IDLE);
-        _initState = new State(q, "state", DownloadSM::INIT);
-        _downloadingState = new State(q, "state", DownloadSM::DOWNLOADING);
-        _downloadingNotConnectedState = new State(q, "state",
-            DownloadSM::DOWNLOADING_NOT_CONNECTED);
-        _pausedState = new State(q, "state", DownloadSM::PAUSED);
-        _pausedNotConnectedState = new State(q, "state",
-		    DownloadSM::PAUSED_NOT_CONNECTED);
-        _downloadedState = new State(q, "state", DownloadSM::DOWNLOADED);
-        _hashingState = new State(q, "state", DownloadSM::HASHING);
-        _postProcessingState = new State(q, "state", DownloadSM::POST_PROCESSING);
-        _errorState = new FinalState(q, "state", DownloadSM::ERROR);
-        _canceledState = new FinalState(q, "state", DownloadSM::CANCELED);
-        _finishedState = new FinalState(q, "state", DownloadSM::FINISHED);
-
-        // add the idle state transitions
-        _transitions.append(new HeaderTransition(_down, _idleState,
-	    _initState));
-        _idleState->addTransition(_transitions.last());
-
-        _transitions.append(new NetworkErrorTransition(_down, _idleState,
-	    _errorState));
-        _idleState->addTransition(_transitions.last());
-
-        _transitions.append(new SslErrorTransition(_down, _idleState,
-	    _errorState));
-        _idleState->addTransition(_transitions.last());
-
-        // add the init state transtions
-        _transitions.append(new StartDownloadTransition(_down,
-            _initState, _downloadingState));
-        _initState->addTransition(_transitions.last());
-
-        _transitions.append(new NetworkErrorTransition(_down,
-            _initState, _errorState));
-        _initState->addTransition(_transitions.last());
-
-        _transitions.append(new SslErrorTransition(_down,
-            _initState, _errorState));
-        _initState->addTransition(_transitions.last());
-
-        // add the downloading transitions
-        _transitions.append(new PauseRequestTransition(_down,
-            SIGNAL(connectionDisabled()), _downloadingState,
-            _downloadingNotConnectedState));
-        _downloadingState->addTransition(_transitions.last());
-
-        _transitions.append(new PauseRequestTransition(_down,
-            SIGNAL(paused()), _downloadingState, _pausedState));
-        _downloadingState->addTransition(_transitions.last());
-
-        _transitions.append(new CancelDownloadTransition(_down,
-            _downloadingState, _canceledState));
-        _downloadingState->addTransition(_transitions.last());
-
-        _transitions.append(new NetworkErrorTransition(_down,
-            _downloadingState, _errorState));
-        _downloadingState->addTransition(_transitions.last());
-
-        _transitions.append(new SslErrorTransition(_down,
-            _downloadingState, _errorState));
-        _downloadingState->addTransition(_transitions.last());
-
-        _transitions.append(_downloadingState->addTransition(_down,
-            SIGNAL(completed()), _downloadedState));
-
-        // add the downloading not connected transitions
-        _transitions.append(new ResumeDownloadTransition(_down,
-            SIGNAL(connectionEnabled()),
-            _downloadingNotConnectedState,
-            _downloadingState));
-        _downloadingNotConnectedState->addTransition(_transitions.last());
-
-        _transitions.append(new CancelDownloadTransition(_down,
-            _downloadingNotConnectedState, _canceledState));
-        _downloadingNotConnectedState->addTransition(_transitions.last());
-
-        _transitions.append(_downloadingNotConnectedState->addTransition(_down,
-            SIGNAL(paused()), _pausedNotConnectedState));
-
-        // add the pause transitions
-        _transitions.append(new ResumeDownloadTransition(_down,
-            SIGNAL(downloadingStarted()), _pausedState, _downloadingState));
-        _pausedState->addTransition(_transitions.last());
-
-        _transitions.append(new CancelDownloadTransition(_down,
-            _pausedState, _canceledState));
-        _pausedState->addTransition(_transitions.last());
-
-        _transitions.append(_pausedState->addTransition(
-            _down, SIGNAL(connectionDisabled()), _pausedNotConnectedState));
-
-        // paused not connected transitions
-        _transitions.append(new CancelDownloadTransition(
-            _down, _pausedNotConnectedState, _canceledState));
-        _pausedNotConnectedState->addTransition(_transitions.last());
-
-        _transitions.append(_pausedNotConnectedState->addTransition(
-            _down, SIGNAL(downloadingStarted()), _downloadingNotConnectedState));
-
-        _transitions.append(_pausedNotConnectedState->addTransition(_down,
-            SIGNAL(connectionEnabled()), _pausedState));
-
-        _transitions.append(_pausedNotConnectedState->addTransition(
-            _down, SIGNAL(resumed()), _downloadingNotConnectedState));
-
-        _transitions.append(_pausedNotConnectedState->addTransition(_down,
-            SIGNAL(connectionEnabled()), _pausedState));
-
-        // downloaded transitions
-        _transitions.append(new CancelDownloadTransition(
-            _down, _downloadedState, _canceledState));
-        _downloadedState->addTransition(_transitions.last());
-
-        _transitions.append(_downloadedState->addTransition(_down,
-            SIGNAL(finished()), _finishedState));
-
-        _transitions.append(_downloadedState->addTransition(_down,
-            SIGNAL(hashingStarted()), _hashingState));
-
-        _transitions.append(_downloadedState->addTransition(_down,
-            SIGNAL(postProcessingStarted()), _postProcessingState));
-
-        // hashing transitions
-        _transitions.append(_hashingState->addTransition(_down,
-            SIGNAL(finished()), _finishedState));
-        _transitions.append(_hashingState->addTransition(_down,
-            SIGNAL(hashingError()), _errorState));
-        _transitions.append(_hashingState->addTransition(_down,
-            SIGNAL(postProcessingStarted()), _postProcessingState));
-
-        // post processing transitions
-        _transitions.append(_postProcessingState->addTransition(
-            _down, SIGNAL(finished()), _finishedState));
-        _transitions.append(_postProcessingState->addTransition(
-            _down, SIGNAL(postProcessingError()), _errorState));
-
-        // add states set init state
-        _stateMachine.addState(_idleState);
-        _stateMachine.addState(_initState);
-        _stateMachine.addState(_downloadingState);
-        _stateMachine.addState(_downloadingNotConnectedState);
-        _stateMachine.addState(_pausedState);
-        _stateMachine.addState(_pausedNotConnectedState);
-        _stateMachine.addState(_downloadedState);
-        _stateMachine.addState(_hashingState);
-        _stateMachine.addState(_postProcessingState);
-        _stateMachine.addState(_errorState);
-        _stateMachine.addState(_canceledState);
-        _stateMachine.addState(_finishedState);
-
-        _stateMachine.setInitialState(_idleState);
-
-        // connect the signals
-        CHECK(q->connect(&_stateMachine, SIGNAL(started()),
-            q, SIGNAL(started())))
-                << "Could not connect to signal";
-        CHECK(q->connect(&_stateMachine, SIGNAL(stopped()),
-            q, SIGNAL(stopped())))
-                << "Could not connect to signal";
-        CHECK(q->connect(&_stateMachine, SIGNAL(finished()),
-            q, SIGNAL(finished())))
-                << "Could not connect to signal";
+        connectEvent(&SMFileDownload::headRequestCompleted,
+            Event::HeadRequestCompleted);
+        connectEvent(&SMFileDownload::connectionEnabled,
+            Event::ConnectionEnabled);
+        connectEvent(&SMFileDownload::connectionDisabled,
+            Event::ConnectionDisabled);
+        connectEvent(&SMFileDownload::downloadingStarted,
+            Event::DownloadingStarted);
+        connectEvent(&SMFileDownload::paused, Event::Paused);
+        connectEvent(&SMFileDownload::completed, Event::Completed);
+        connectEvent(&SMFileDownload::hashingStarted, Event::HashingStarted);
+        connectEvent(&SMFileDownload::hashingError, Event::HashingError);
+        connectEvent(&SMFileDownload::postProcessingStarted,
+            Event::PostProcessingStarted);
+        connectEvent(&SMFileDownload::postProcessingError,
+            Event::PostProcessingError);
+        connectEvent(&SMFileDownload::finished, Event::Finished);
+        connectEvent(&SMFileDownload::canceled, Event::Canceled);
+
+        CHECK(q->connect(_down, &SMFileDownload::error, q,
+            [this](QNetworkReply::NetworkError code) {
+                process(Event::NetworkError, code);
+            })) << "Could not connect to signal";
+        CHECK(q->connect(_down, &SMFileDownload::sslErrors, q,
+            [this](const QList<QSslError>& errors) {
+                process(Event::SslErrors, QNetworkReply::NoError, errors);
+            })) << "Could not connect to signal";
     }
 
     QString state() {
-        return _state;
+        return name(_current);
     }
 
     void setState(QString state) {
         TRACE << state;
-        Q_Q(DownloadSM);
-        _state = state;
-        emit q->stateChanged(_state);
+        for (quint8 id = 0; id <= static_cast<quint8>(StateId::Finished);
+                id++) {
+            if (name(static_cast<StateId>(id)) == state) {
+                enter(static_cast<StateId>(id));
+                return;
+            }
+        }
+        LOG(WARNING) << "Unknown download state" << state;
     }
 
     void start() {
-        _stateMachine.start();
+        Q_Q(DownloadSM);
+        if (_running) {
+            return;
+        }
+        _running = true;
+        enter(StateId::Idle);
+        emit q->started();
     }
 
-    ~DownloadSMPrivate() {
-        qDeleteAll(_transitions);
-        delete _idleState;
-        delete _initState;
-        delete _downloadingState;
-        delete _downloadingNotConnectedState;
-        delete _pausedState;
-        delete _pausedNotConnectedState;
-        delete _downloadedState;
-        delete _hashingState;
-        delete _postProcessingState;
-        delete _errorState;
-        delete _canceledState;
-        delete _finishedState;
+ private:
+    static const QString& name(StateId state) {
+        switch (state) {
+            case StateId::Init:
+                return DownloadSM::INIT;
+            case StateId::Downloading:
+                return DownloadSM::DOWNLOADING;
+            case StateId::DownloadingNotConnected:
+                return DownloadSM::DOWNLOADING_NOT_CONNECTED;
+            case StateId::Paused:
+                return DownloadSM::PAUSED;
+            case StateId::PausedNotConnected:
+                return DownloadSM::PAUSED_NOT_CONNECTED;
+            case StateId::Downloaded:
+                return DownloadSM::DOWNLOADED;
+            case StateId::Hashing:
+                return DownloadSM::HASHING;
+            case StateId::PostProcessing:
+                return DownloadSM::POST_PROCESSING;
+            case StateId::Error:
+                return DownloadSM::ERROR;
+            case StateId::Canceled:
+                return DownloadSM::CANCELED;
+            case StateId::Finished:
+                return DownloadSM::FINISHED;
+            default:
+                return DownloadSM::IDLE;
+        }
+    }
+
+    void connectEvent(void (SMFileDownload::*signal)(), Event event) {
+        Q_Q(DownloadSM);
+        CHECK(q->connect(_down, signal, q, [this, event]() {
+            process(event);
+        })) << "Could not connect to signal";
+    }
+
+    void process(Event event,
+                 QNetworkReply::NetworkError code = QNetworkReply::NoError,
+                 const QList<QSslError>& errors = QList<QSslError>()) {
+        // like with QStateMachine, the events that are not handled by the
+        // current state are ignored
+        if (!_running) {
+            return;
+        }
+        auto index = findTransition(_current, event);
+        if (index < 0) {
+            return;
+        }
+
+        const Transition& transition = TRANSITIONS[index];
+        switch (transition.action) {
+            case Action::NetworkError:
+                _down->emitNetworkError(code);
+                break;
+            case Action::SslError:
+                _down->emitSslError(errors);
+                break;
+            case Action::Start:
+                _down->requestDownload();
+                _down->setState(Download::START);
+                break;
+            case Action::Pause:
+                _down->pauseRequestDownload();
+                _down->setState(Download::PAUSE);
+                break;
+            case Action::Resume:
+                _down->requestDownload();
+                _down->setState(Download::RESUME);
+                break;
+            case Action::Cancel:
+                _down->cancelRequestDownload();
+                _down->setState(Download::CANCEL);
+                break;
+            default:
+                break;
+        }
+        enter(transition.target);
+    }
+
+    void enter(StateId state) {
+        Q_Q(DownloadSM);
+        TRACE << name(state);
+        _current = state;
+        emit q->stateChanged(name(state));
+        if (_running && isFinal(state)) {
+            _running = false;
+            emit q->finished();
+        }
     }
 
  private:
-    QString _state = DownloadSM::IDLE;
-    QStateMachine _stateMachine;
-    QList<QSignalTransition*> _transitions;
-    // states
-    State* _idleState;
-    State* _initState;
-    State* _downloadingState;
-    State* _downloadingNotConnectedState;
-    State* _pausedState;
-    State* _pausedNotConnectedState;
-    State* _downloadedState;
-    State* _hashingState;
-    State* _postProcessingState;
-    // final states
-    FinalState* _errorState;
-    FinalState* _canceledState;
-    FinalState* _finishedState;
+    StateId _current = StateId::Idle;
+    bool _running = false;
 
     SMFileDownload* _down;
     DownloadSM* q_ptr;
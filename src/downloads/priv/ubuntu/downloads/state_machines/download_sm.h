@@ -130,6 +130,10 @@ class ResumeDownloadTransition : public DownloadSMTransition {
     virtual void onTransition(QEvent * event) override;
 };
 
+// State machine of a SMFileDownload. Transitions are looked up in a static
+// table and executed synchronously when the download emits the signal,
+// which keeps the per download cost to a couple of bytes of state plus the
+// signal connections.
 class DownloadSMPrivate;
 class DownloadSM : public QObject {
     Q_OBJECT
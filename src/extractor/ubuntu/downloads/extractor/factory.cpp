@@ -18,6 +18,7 @@
 
 #include <ubuntu/downloads/extractor/deflator.h>
 #include <ubuntu/downloads/extractor/factory.h>
+#include <ubuntu/downloads/extractor/parallel_unzip.h>
 #include <ubuntu/downloads/extractor/unzip.h>
 
 namespace Ubuntu {
@@ -34,9 +35,19 @@ Factory::Factory(QObject* parent)
 Deflator*
 Factory::deflator(const QString& id, const QString& path,
         const QString& destination) {
+    return deflator(id, path, destination, 1);
+}
+
+Deflator*
+Factory::deflator(const QString& id, const QString& path,
+        const QString& destination, int jobs) {
     Deflator* instance = nullptr;
     if (id == "unzip") {
-        instance = new UnZip(path, destination);
+        if (jobs > 1) {
+            instance = new ParallelUnZip(path, destination, jobs);
+        } else {
+            instance = new UnZip(path, destination);
+        }
     } else {
         _error = QString("Deflator '%1' type not known.").arg(id);
     }
@@ -35,6 +35,8 @@ class Factory : public QObject {
 
     Deflator* deflator(const QString& id, const QString& path,
             const QString& destination);
+    Deflator* deflator(const QString& id, const QString& path,
+            const QString& destination, int jobs);
 
     bool isError() const;
     QString lastError() const;
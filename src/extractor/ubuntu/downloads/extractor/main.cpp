@@ -17,6 +17,7 @@
  */
 
 #include <QCoreApplication>
+#include <QThread>
 #include <QTimer>
 
 #include <iostream>
@@ -42,6 +43,8 @@ int main(int argc, char *argv[]) {
         ("untar", "untar will be used to extract the data.")
         ("path", po::value<std::string>(), "The path to be extracted.")
 	("destination", po::value<std::string>(), "The path to be extracted.")
+        ("jobs", po::value<int>(),
+            "Number of entries extracted in parallel, 1 uses a single unzip process.")
     ;
 
     po::variables_map vm;
@@ -56,6 +59,7 @@ int main(int argc, char *argv[]) {
     std::string destination;
     std::string path;
     std::string extractor;
+    int jobs = QThread::idealThreadCount();
 
     if (vm.count("path")) {
         path = vm["path"].as<std::string>();
@@ -83,10 +87,14 @@ int main(int argc, char *argv[]) {
         extractor = std::string("untar");
     }
 
+    if (vm.count("jobs")) {
+        jobs = vm["jobs"].as<int>();
+    }
+
     auto factory = new ude::Factory();
     auto deflator = factory->deflator(QString::fromStdString(extractor),
         QString::fromStdString(path),
-        QString::fromStdString(destination));
+        QString::fromStdString(destination), jobs);
 
     if (factory->isError()) {
         std::cout << factory->lastError().toStdString() << std::endl;
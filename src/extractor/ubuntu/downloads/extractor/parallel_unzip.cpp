@@ -0,0 +1,428 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSet>
+#include <QThreadPool>
+#include <ubuntu/downloads/extractor/parallel_unzip.h>
+
+namespace {
+    const qint64 CHUNK_SIZE = 256 * 1024;
+
+    typedef std::function<bool(const char*, qint64)> DataSink;
+
+    struct ExtractionState {
+        std::atomic<bool> failed {false};
+        QMutex mutex;
+        QString error;
+
+        void fail(const QString& reason) {
+            QMutexLocker locker(&mutex);
+            if (!failed) {
+                error = reason;
+                failed = true;
+            }
+        }
+    };
+
+    bool isSafePath(const QString& name) {
+        auto clean = QDir::cleanPath(name);
+        return !QDir::isAbsolutePath(clean) && clean != ".."
+            && !clean.startsWith("../");
+    }
+
+    // decompresses the data of the entry passing it to the sink in chunks
+    // so that large entries are never fully loaded in memory
+    bool readEntry(QFile& archive,
+                   const Ubuntu::DownloadManager::Extractor::ZipEntry& entry,
+                   const DataSink& sink,
+                   QString& error) {
+        using Ubuntu::DownloadManager::Extractor::ZipArchive;
+        using Ubuntu::DownloadManager::Extractor::ZipEntry;
+
+        auto offset = ZipArchive::dataOffset(&archive, entry);
+        if (offset < 0 || !archive.seek(offset)) {
+            error = QString("Local header of '%1' is corrupted.").arg(
+                entry.name);
+            return false;
+        }
+
+        QByteArray input(CHUNK_SIZE, Qt::Uninitialized);
+        QByteArray output(CHUNK_SIZE, Qt::Uninitialized);
+        auto remaining = entry.compressedSize;
+        quint64 written = 0;
+        uLong crc = crc32(0L, Z_NULL, 0);
+        bool inflating = entry.method == ZipEntry::Deflated;
+
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (inflating && inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            error = "Could not initialize zlib.";
+            return false;
+        }
+
+        bool ok = true;
+        int ret = Z_OK;
+        while (ok && remaining > 0 && ret != Z_STREAM_END) {
+            auto read = archive.read(input.data(),
+                qMin<quint64>(CHUNK_SIZE, remaining));
+            if (read <= 0) {
+                error = QString("Unexpected end of data in '%1'.").arg(
+                    entry.name);
+                ok = false;
+                break;
+            }
+            remaining -= read;
+
+            if (!inflating) {
+                crc = crc32(crc,
+                    reinterpret_cast<const Bytef*>(input.constData()), read);
+                written += read;
+                ok = sink(input.constData(), read);
+                continue;
+            }
+
+            stream.next_in = reinterpret_cast<Bytef*>(input.data());
+            stream.avail_in = read;
+            do {
+                stream.next_out = reinterpret_cast<Bytef*>(output.data());
+                stream.avail_out = CHUNK_SIZE;
+                ret = inflate(&stream, Z_NO_FLUSH);
+                if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                    error = QString("Data of '%1' is corrupted.").arg(
+                        entry.name);
+                    ok = false;
+                    break;
+                }
+                auto have = CHUNK_SIZE - stream.avail_out;
+                if (have > 0) {
+                    crc = crc32(crc,
+                        reinterpret_cast<const Bytef*>(output.constData()),
+                        have);
+                    written += have;
+                    ok = sink(output.constData(), have);
+                }
+            } while (ok && stream.avail_out == 0 && ret != Z_STREAM_END);
+        }
+
+        if (inflating) {
+            inflateEnd(&stream);
+        }
+
+        if (!ok) {
+            if (error.isEmpty()) {
+                error = QString("Could not write '%1'.").arg(entry.name);
+            }
+            return false;
+        }
+
+        if (written != entry.uncompressedSize || crc != entry.crc) {
+            error = QString("CRC error in '%1'.").arg(entry.name);
+            return false;
+        }
+        return true;
+    }
+
+    class ExtractEntryTask : public QRunnable {
+     public:
+        ExtractEntryTask(const QString& archivePath,
+                         const Ubuntu::DownloadManager::Extractor::ZipEntry& entry,
+                         const QString& filePath,
+                         ExtractionState* state)
+            : _archivePath(archivePath),
+              _entry(entry),
+              _filePath(filePath),
+              _state(state) {
+        }
+
+        void run() override {
+            // do not waste time if another entry already failed
+            if (_state->failed) {
+                return;
+            }
+
+            QFile archive(_archivePath);
+            if (!archive.open(QIODevice::ReadOnly)) {
+                _state->fail(archive.errorString());
+                return;
+            }
+
+            QFile out(_filePath);
+            if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate
+                    | QIODevice::Unbuffered)) {
+                _state->fail(QString("Could not create '%1': %2").arg(
+                    _filePath, out.errorString()));
+                return;
+            }
+
+            // reserve the space up front so that the file is not fragmented
+            // and we fail early when the disk is full
+            if (_entry.uncompressedSize > 0
+                    && fallocate(out.handle(), 0, 0, _entry.uncompressedSize) != 0
+                    && errno != EOPNOTSUPP && errno != ENOSYS) {
+                _state->fail(QString("Could not allocate '%1': %2").arg(
+                    _filePath, QString::fromLocal8Bit(strerror(errno))));
+                return;
+            }
+
+            QString error;
+            auto written = readEntry(archive, _entry,
+                [&out](const char* data, qint64 size) {
+                    return out.write(data, size) == size;
+                }, error);
+
+            if (!written) {
+                _state->fail(error);
+                return;
+            }
+
+            // like unzip, the setuid, setgid and sticky bits of the
+            // archive are never applied
+            if (_entry.mode & 0777) {
+                fchmod(out.handle(), _entry.mode & 0777);
+            }
+
+            if (_entry.modified.isValid()) {
+                struct timespec times[2];
+                times[0].tv_sec = 0;
+                times[0].tv_nsec = UTIME_OMIT;
+                times[1].tv_sec = _entry.modified.toMSecsSinceEpoch() / 1000;
+                times[1].tv_nsec = 0;
+                futimens(out.handle(), times);
+            }
+        }
+
+     private:
+        QString _archivePath;
+        Ubuntu::DownloadManager::Extractor::ZipEntry _entry;
+        QString _filePath;
+        ExtractionState* _state;
+    };
+}
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Extractor {
+
+ParallelUnZip::ParallelUnZip(const QString& path, const QString& destination,
+        int jobs, QObject* parent)
+    : UnZip(path, destination, parent),
+      _jobs(qMax(1, jobs)) {
+}
+
+int
+ParallelUnZip::jobs() const {
+    return _jobs;
+}
+
+void
+ParallelUnZip::deflate() {
+    ZipArchive archive(_path);
+    QString reason;
+    QList<ZipEntry> entries;
+
+    if (archive.open()) {
+        entries = archive.entries();
+        canExtract(entries, reason);
+    } else {
+        reason = archive.lastError();
+    }
+
+    if (!reason.isEmpty()) {
+        std::cout << "Falling back to unzip: " << reason.toStdString()
+            << std::endl;
+        UnZip::deflate();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!createDirs(entries)) {
+        QCoreApplication::instance()->exit(1);
+        return;
+    }
+
+    // start with the largest entries so that a big file does not end up
+    // being extracted alone once all the small ones are done
+    QList<ZipEntry> files;
+    quint64 totalBytes = 0;
+    foreach(const ZipEntry& entry, entries) {
+        if (!entry.isDir() && !entry.isSymLink()) {
+            files.append(entry);
+            totalBytes += entry.uncompressedSize;
+        }
+    }
+    std::sort(files.begin(), files.end(),
+        [](const ZipEntry& a, const ZipEntry& b) {
+            return a.uncompressedSize > b.uncompressedSize;
+        });
+
+    ExtractionState state;
+    QThreadPool pool;
+    pool.setMaxThreadCount(_jobs);
+    QDir destination(_destination);
+
+    foreach(const ZipEntry& entry, files) {
+        pool.start(new ExtractEntryTask(_path, entry,
+            destination.filePath(entry.name), &state));
+    }
+    pool.waitForDone();
+
+    if (state.failed) {
+        std::cout << state.error.toStdString() << std::endl;
+        QCoreApplication::instance()->exit(1);
+        return;
+    }
+
+    // symlinks are created once all the files are present so that no
+    // entry can be written through one of them
+    if (!createSymLinks(entries)) {
+        QCoreApplication::instance()->exit(1);
+        return;
+    }
+
+    auto elapsed = qMax<qint64>(1, timer.elapsed());
+    auto throughput = (totalBytes / (1024.0 * 1024.0)) / (elapsed / 1000.0);
+    std::cout << "Extracted " << files.count() << " entries ("
+        << totalBytes << " bytes) in " << elapsed << " ms using "
+        << _jobs << " threads: " << throughput << " MiB/s" << std::endl;
+    QCoreApplication::instance()->exit(0);
+}
+
+bool
+ParallelUnZip::canExtract(const QList<ZipEntry>& entries, QString& reason) {
+    // entries with the same path would be written concurrently, unzip
+    // extracts them one after the other
+    QSet<QString> paths;
+    foreach(const ZipEntry& entry, entries) {
+        if (entry.isEncrypted()) {
+            reason = QString("Entry '%1' is encrypted.").arg(entry.name);
+            return false;
+        }
+        if (entry.method != ZipEntry::Stored
+                && entry.method != ZipEntry::Deflated) {
+            reason = QString("Entry '%1' uses compression method %2.").arg(
+                entry.name).arg(entry.method);
+            return false;
+        }
+        if (!isSafePath(entry.name)) {
+            reason = QString("Entry '%1' is outside the destination.").arg(
+                entry.name);
+            return false;
+        }
+        auto path = QDir::cleanPath(entry.name);
+        if (paths.contains(path)) {
+            reason = QString("Entry '%1' is duplicated.").arg(entry.name);
+            return false;
+        }
+        paths.insert(path);
+    }
+    return true;
+}
+
+bool
+ParallelUnZip::createDirs(const QList<ZipEntry>& entries) {
+    // create all the dirs before the workers start so that they do not
+    // race creating the same parents
+    QSet<QString> dirs;
+    dirs.insert(QDir::cleanPath(_destination));
+    QDir destination(_destination);
+
+    foreach(const ZipEntry& entry, entries) {
+        auto path = destination.filePath(entry.name);
+        if (entry.isDir()) {
+            dirs.insert(QDir::cleanPath(path));
+        } else {
+            dirs.insert(QFileInfo(path).absolutePath());
+        }
+    }
+
+    foreach(const QString& dir, dirs) {
+        if (!QDir().mkpath(dir)) {
+            std::cout << "Could not create dir '" << dir.toStdString()
+                << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+ParallelUnZip::createSymLinks(const QList<ZipEntry>& entries) {
+    QDir destination(_destination);
+    foreach(const ZipEntry& entry, entries) {
+        if (!entry.isSymLink()) {
+            continue;
+        }
+
+        QFile archive(_path);
+        if (!archive.open(QIODevice::ReadOnly)) {
+            std::cout << archive.errorString().toStdString() << std::endl;
+            return false;
+        }
+
+        QByteArray target;
+        QString error;
+        auto read = readEntry(archive, entry,
+            [&target](const char* data, qint64 size) {
+                target.append(data, size);
+                return true;
+            }, error);
+
+        if (!read) {
+            std::cout << error.toStdString() << std::endl;
+            return false;
+        }
+
+        auto path = destination.filePath(entry.name);
+        QFile::remove(path);
+        if (!QFile::link(QString::fromLocal8Bit(target), path)) {
+            std::cout << "Could not create link '" << path.toStdString()
+                << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef UDM_EXTRACTOR_PARALLEL_UNZIP_H
+#define UDM_EXTRACTOR_PARALLEL_UNZIP_H
+
+#include <ubuntu/downloads/extractor/unzip.h>
+#include <ubuntu/downloads/extractor/zip_archive.h>
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Extractor {
+
+// Extracts the entries of a zip file concurrently using a thread pool. Those
+// archives that use features that are not supported (zip64, encryption,
+// unknown compression methods or unsafe paths) are handed to the unzip
+// process used by the parent class.
+class ParallelUnZip : public UnZip {
+    Q_OBJECT
+
+ public:
+    ParallelUnZip(const QString& path, const QString& destination,
+            int jobs, QObject* parent=0);
+
+    int jobs() const;
+
+    // whether the entries can be extracted concurrently, otherwise the
+    // reason is set and the archive is handed to unzip
+    static bool canExtract(const QList<ZipEntry>& entries, QString& reason);
+
+ public slots:  // NOLINT (whitespace/indent)
+    void deflate() override;
+
+ private:
+    bool createDirs(const QList<ZipEntry>& entries);
+    bool createSymLinks(const QList<ZipEntry>& entries);
+
+ private:
+    int _jobs = 1;
+};
+
+}
+
+}
+
+}
+
+#endif
@@ -31,7 +31,9 @@ UnZip::UnZip(const QString& path, const QString& destination,
 }
 
 UnZip::~UnZip() {
-    _process->deleteLater();
+    if (_process != nullptr) {
+        _process->deleteLater();
+    }
 }
 
 void
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <sys/stat.h>
+
+#include <QFile>
+#include <QtEndian>
+#include <ubuntu/downloads/extractor/zip_archive.h>
+
+namespace {
+    const quint32 END_OF_CENTRAL_DIR_SIGNATURE = 0x06054b50;
+    const quint32 CENTRAL_DIR_SIGNATURE = 0x02014b50;
+    const quint32 LOCAL_HEADER_SIGNATURE = 0x04034b50;
+    const int END_OF_CENTRAL_DIR_SIZE = 22;
+    const int CENTRAL_DIR_HEADER_SIZE = 46;
+    const int LOCAL_HEADER_SIZE = 30;
+    const int MAX_COMMENT_SIZE = 0xFFFF;
+    const quint16 ZIP64_COUNT = 0xFFFF;
+    const quint32 ZIP64_VALUE = 0xFFFFFFFF;
+    const quint16 UTF8_NAME_FLAG = 0x0800;
+    const quint16 ENCRYPTED_FLAG = 0x0001;
+    const int UNIX_HOST = 3;
+
+    quint16 readUInt16(const char* data) {
+        return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(data));
+    }
+
+    quint32 readUInt32(const char* data) {
+        return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data));
+    }
+
+    QDateTime fromDosTime(quint16 date, quint16 time) {
+        QDate d(1980 + (date >> 9), (date >> 5) & 0x0F, date & 0x1F);
+        QTime t(time >> 11, (time >> 5) & 0x3F, (time & 0x1F) * 2);
+        return QDateTime(d, t);
+    }
+}
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Extractor {
+
+bool
+ZipEntry::isDir() const {
+    return name.endsWith('/');
+}
+
+bool
+ZipEntry::isSymLink() const {
+    return S_ISLNK(mode);
+}
+
+bool
+ZipEntry::isEncrypted() const {
+    return flags & ENCRYPTED_FLAG;
+}
+
+ZipArchive::ZipArchive(const QString& path)
+    : _path(path) {
+}
+
+bool
+ZipArchive::open() {
+    QFile file(_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setLastError(QString("File '%1' could not be opened: %2").arg(
+            _path, file.errorString()));
+        return false;
+    }
+
+    // the end of central directory record is at the end of the file
+    // followed by an optional comment, look for its signature backwards
+    auto size = file.size();
+    auto tailSize = qMin<qint64>(size,
+        END_OF_CENTRAL_DIR_SIZE + MAX_COMMENT_SIZE);
+    file.seek(size - tailSize);
+    auto tail = file.read(tailSize);
+
+    int eocd = -1;
+    for (int pos = tail.size() - END_OF_CENTRAL_DIR_SIZE; pos >= 0; pos--) {
+        if (readUInt32(tail.constData() + pos)
+                == END_OF_CENTRAL_DIR_SIGNATURE) {
+            eocd = pos;
+            break;
+        }
+    }
+
+    if (eocd == -1) {
+        setLastError(QString("File '%1' is not a zip file.").arg(_path));
+        return false;
+    }
+
+    auto record = tail.constData() + eocd;
+    auto count = readUInt16(record + 10);
+    auto cdSize = readUInt32(record + 12);
+    auto cdOffset = readUInt32(record + 16);
+
+    if (count == ZIP64_COUNT || cdSize == ZIP64_VALUE
+            || cdOffset == ZIP64_VALUE) {
+        setLastError("Zip64 archives are not supported.");
+        return false;
+    }
+
+    if (static_cast<qint64>(cdOffset) + cdSize > size) {
+        setLastError("Central directory is out of bounds.");
+        return false;
+    }
+
+    file.seek(cdOffset);
+    auto centralDir = file.read(cdSize);
+    if (centralDir.size() != static_cast<int>(cdSize)) {
+        setLastError("Central directory could not be read.");
+        return false;
+    }
+    return parseCentralDirectory(centralDir, count);
+}
+
+QList<ZipEntry>
+ZipArchive::entries() const {
+    return _entries;
+}
+
+QString
+ZipArchive::lastError() const {
+    return _error;
+}
+
+qint64
+ZipArchive::dataOffset(QIODevice* device, const ZipEntry& entry) {
+    if (!device->seek(entry.localHeaderOffset)) {
+        return -1;
+    }
+    auto header = device->read(LOCAL_HEADER_SIZE);
+    if (header.size() != LOCAL_HEADER_SIZE
+            || readUInt32(header.constData()) != LOCAL_HEADER_SIGNATURE) {
+        return -1;
+    }
+    auto nameLength = readUInt16(header.constData() + 26);
+    auto extraLength = readUInt16(header.constData() + 28);
+    return entry.localHeaderOffset + LOCAL_HEADER_SIZE + nameLength
+        + extraLength;
+}
+
+bool
+ZipArchive::parseCentralDirectory(const QByteArray& data, int count) {
+    _entries.clear();
+    auto raw = data.constData();
+    int pos = 0;
+
+    for (int index = 0; index < count; index++) {
+        if (pos + CENTRAL_DIR_HEADER_SIZE > data.size()
+                || readUInt32(raw + pos) != CENTRAL_DIR_SIGNATURE) {
+            setLastError(QString("Corrupted central directory entry %1.").arg(
+                index));
+            return false;
+        }
+
+        auto header = raw + pos;
+        auto madeBy = readUInt16(header + 4);
+        auto nameLength = readUInt16(header + 28);
+        auto extraLength = readUInt16(header + 30);
+        auto commentLength = readUInt16(header + 32);
+
+        if (pos + CENTRAL_DIR_HEADER_SIZE + nameLength > data.size()) {
+            setLastError(QString("Corrupted central directory entry %1.").arg(
+                index));
+            return false;
+        }
+
+        ZipEntry entry;
+        entry.flags = readUInt16(header + 8);
+        entry.method = readUInt16(header + 10);
+        entry.modified = fromDosTime(readUInt16(header + 14),
+            readUInt16(header + 12));
+        entry.crc = readUInt32(header + 16);
+        entry.compressedSize = readUInt32(header + 20);
+        entry.uncompressedSize = readUInt32(header + 24);
+        entry.localHeaderOffset = readUInt32(header + 42);
+
+        if (entry.compressedSize == ZIP64_VALUE
+                || entry.uncompressedSize == ZIP64_VALUE
+                || entry.localHeaderOffset == ZIP64_VALUE) {
+            setLastError("Zip64 archives are not supported.");
+            return false;
+        }
+
+        if ((madeBy >> 8) == UNIX_HOST) {
+            entry.mode = readUInt32(header + 38) >> 16;
+        }
+
+        auto name = QByteArray(header + CENTRAL_DIR_HEADER_SIZE, nameLength);
+        entry.name = (entry.flags & UTF8_NAME_FLAG)?
+            QString::fromUtf8(name) : QString::fromLocal8Bit(name);
+
+        _entries.append(entry);
+        pos += CENTRAL_DIR_HEADER_SIZE + nameLength + extraLength
+            + commentLength;
+    }
+    return true;
+}
+
+void
+ZipArchive::setLastError(const QString& error) {
+    _error = error;
+}
+
+}
+
+}
+
+}
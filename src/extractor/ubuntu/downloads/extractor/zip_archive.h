@@ -0,0 +1,86 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef UDM_EXTRACTOR_ZIP_ARCHIVE_H
+#define UDM_EXTRACTOR_ZIP_ARCHIVE_H
+
+#include <QDateTime>
+#include <QIODevice>
+#include <QList>
+#include <QString>
+
+namespace Ubuntu {
+
+namespace DownloadManager {
+
+namespace Extractor {
+
+struct ZipEntry {
+    enum Method {
+        Stored = 0,
+        Deflated = 8
+    };
+
+    QString name;
+    quint16 flags = 0;
+    quint16 method = Stored;
+    quint32 crc = 0;
+    quint64 compressedSize = 0;
+    quint64 uncompressedSize = 0;
+    quint64 localHeaderOffset = 0;
+    quint32 mode = 0;  // unix mode bits, 0 when not created on unix
+    QDateTime modified;
+
+    bool isDir() const;
+    bool isSymLink() const;
+    bool isEncrypted() const;
+};
+
+// Minimal reader of the central directory of a zip file. It does not
+// perform any decompression, it only provides the information that is
+// needed to extract each of the entries independently.
+class ZipArchive {
+
+ public:
+    explicit ZipArchive(const QString& path);
+
+    bool open();
+    QList<ZipEntry> entries() const;
+    QString lastError() const;
+
+    // returns the offset of the data of the entry, the local header has
+    // to be read because its extra field can differ from the central one
+    static qint64 dataOffset(QIODevice* device, const ZipEntry& entry);
+
+ private:
+    bool parseCentralDirectory(const QByteArray& data, int count);
+    void setLastError(const QString& error);
+
+ private:
+    QString _path;
+    QString _error = QString();
+    QList<ZipEntry> _entries;
+};
+
+}
+
+}
+
+}
+
+#endif
@@ -21,6 +21,7 @@
 #include <ubuntu/transfers/i18n.h>
 #include <ubuntu/transfers/system/logger.h>
 #include <ubuntu/transfers/system/filename_mutex.h>
+#include <ubuntu/transfers/system/metrics.h>
 
 #include "file_upload.h"
 
@@ -127,6 +128,11 @@ namespace {
     const QString PROXY_AUTH_ERROR = "PROXY_AUTHENTICATION ERROR";
     const QString UNEXPECTED_ERROR = "UNEXPECTED_ERROR";
     const QString RESPONSE_EXTENSION = ".response";
+    const QString UPLOADED_BYTES_METRIC = "udm_uploaded_bytes_total";
+    const QString NETWORK_ERRORS_METRIC = "udm_network_errors_total";
+    const QString APP_LABEL = "app";
+    const QString BEARER_LABEL = "bearer";
+    const QString ERROR_LABEL = "error";
 }
 
 namespace Ubuntu {
@@ -337,6 +343,14 @@ FileUpload::emitError(const QString& errorStr) {
 
 void
 FileUpload::onUploadProgress(qint64 currentProgress, qint64 total) {
+    auto sent = static_cast<qulonglong>(qMax<qint64>(0, currentProgress));
+    if (sent > _progress) {
+        auto bearer = Metrics::bearerName(
+            NetworkSession::instance()->sessionType());
+        Metrics::instance()->increment(UPLOADED_BYTES_METRIC,
+            {{APP_LABEL, transferAppId()}, {BEARER_LABEL, bearer}},
+            sent - _progress);
+    }
     _progress = currentProgress;
     emit progress(_progress, total);
 }
@@ -345,6 +359,8 @@ void
 FileUpload::onError(QNetworkReply::NetworkError code) {
     UP_LOG(ERROR) << _url << " ERROR:" << ":" << code << " " <<
         QString(_reply->readAll());
+    Metrics::instance()->increment(NETWORK_ERRORS_METRIC,
+        {{ERROR_LABEL, Metrics::errorName(code)}});
 
     QString msg;
     QString errStr;
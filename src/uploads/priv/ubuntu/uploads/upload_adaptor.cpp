@@ -6,6 +6,8 @@
  *
  * This is an auto-generated file.
  * Do not edit! All changes made to it will be lost.
+ *
+ * HAND-EDIT: the method calls are timed in the metrics of the daemon
  */
 
 #include "upload_adaptor.h"
@@ -16,6 +18,7 @@
 #include <QtCore/QString>
 #include <QtCore/QStringList>
 #include <QtCore/QVariant>
+#include <ubuntu/transfers/system/metrics.h>
 
 namespace Ubuntu {
 
@@ -23,6 +26,8 @@ using namespace Transfers::Errors;
 
 namespace UploadManager {
 
+using Ubuntu::Transfers::System::DBusCallTimer;
+
 /*
  * Implementation of adaptor class UploadAdaptor
  */
@@ -42,18 +47,21 @@ UploadAdaptor::~UploadAdaptor()
 void UploadAdaptor::allowMobileUpload(bool allowed)
 {
     // handle method call com.canonical.applications.Upload.allowMobileUpload
+    DBusCallTimer timer("Upload.allowMobileUpload");
     QMetaObject::invokeMethod(parent(), "allowMobileUpload", Q_ARG(bool, allowed));
 }
 
 void UploadAdaptor::cancel()
 {
     // handle method call com.canonical.applications.Upload.cancel
+    DBusCallTimer timer("Upload.cancel");
     QMetaObject::invokeMethod(parent(), "cancel");
 }
 
 bool UploadAdaptor::isMobileUploadAllowed()
 {
     // handle method call com.canonical.applications.Upload.isMobileUploadAllowed
+    DBusCallTimer timer("Upload.isMobileUploadAllowed");
     bool allowed;
     QMetaObject::invokeMethod(parent(), "isMobileUploadAllowed", Q_RETURN_ARG(bool, allowed));
     return allowed;
@@ -62,6 +70,7 @@ bool UploadAdaptor::isMobileUploadAllowed()
 QVariantMap UploadAdaptor::metadata()
 {
     // handle method call com.canonical.applications.Upload.metadata
+    DBusCallTimer timer("Upload.metadata");
     QVariantMap data;
     QMetaObject::invokeMethod(parent(), "metadata", Q_RETURN_ARG(QVariantMap, data));
     return data;
@@ -70,6 +79,7 @@ QVariantMap UploadAdaptor::metadata()
 qulonglong UploadAdaptor::progress()
 {
     // handle method call com.canonical.applications.Upload.progress
+    DBusCallTimer timer("Upload.progress");
     qulonglong uploaded;
     QMetaObject::invokeMethod(parent(), "progress", Q_RETURN_ARG(qulonglong, uploaded));
     return uploaded;
@@ -78,18 +88,21 @@ qulonglong UploadAdaptor::progress()
 void UploadAdaptor::setThrottle(qulonglong speed)
 {
     // handle method call com.canonical.applications.Upload.setThrottle
+    DBusCallTimer timer("Upload.setThrottle");
     QMetaObject::invokeMethod(parent(), "setThrottle", Q_ARG(qulonglong, speed));
 }
 
 void UploadAdaptor::start()
 {
     // handle method call com.canonical.applications.Upload.start
+    DBusCallTimer timer("Upload.start");
     QMetaObject::invokeMethod(parent(), "start");
 }
 
 qulonglong UploadAdaptor::throttle()
 {
     // handle method call com.canonical.applications.Upload.throttle
+    DBusCallTimer timer("Upload.throttle");
     qulonglong speed;
     QMetaObject::invokeMethod(parent(), "throttle", Q_RETURN_ARG(qulonglong, speed));
     return speed;
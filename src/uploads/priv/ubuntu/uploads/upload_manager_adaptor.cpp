@@ -6,6 +6,8 @@
  *
  * This is an auto-generated file.
  * Do not edit! All changes made to it will be lost.
+ *
+ * HAND-EDIT: the method calls are timed in the metrics of the daemon
  */
 
 #include "upload_manager_adaptor.h"
@@ -16,12 +18,15 @@
 #include <QtCore/QString>
 #include <QtCore/QStringList>
 #include <QtCore/QVariant>
+#include <ubuntu/transfers/system/metrics.h>
 
 namespace Ubuntu {
 
 using namespace Transfers::Errors;
 
 namespace UploadManager {
+using Ubuntu::Transfers::System::DBusCallTimer;
+
 /*
  * Implementation of adaptor class UploadManagerAdaptor
  */
@@ -41,12 +46,14 @@ UploadManagerAdaptor::~UploadManagerAdaptor()
 void UploadManagerAdaptor::allowMobileUpload(bool allowed)
 {
     // handle method call com.canonical.applications.UploadManager.allowMobileUpload
+    DBusCallTimer timer("UploadManager.allowMobileUpload");
     QMetaObject::invokeMethod(parent(), "allowMobileUpload", Q_ARG(bool, allowed));
 }
 
 QDBusObjectPath UploadManagerAdaptor::createMmsUpload(const QString &url, const QString &file, const QString &hostname, int port)
 {
     // handle method call com.canonical.applications.UploadManager.createMmsUpload
+    DBusCallTimer timer("UploadManager.createMmsUpload");
     QDBusObjectPath uploadPath;
     QMetaObject::invokeMethod(parent(), "createMmsUpload", Q_RETURN_ARG(QDBusObjectPath, uploadPath), Q_ARG(QString, url), Q_ARG(QString, file), Q_ARG(QString, hostname), Q_ARG(int, port));
     return uploadPath;
@@ -55,6 +62,7 @@ QDBusObjectPath UploadManagerAdaptor::createMmsUpload(const QString &url, const
 QDBusObjectPath UploadManagerAdaptor::createUpload(UploadStruct upload)
 {
     // handle method call com.canonical.applications.UploadManager.createUpload
+    DBusCallTimer timer("UploadManager.createUpload");
     QDBusObjectPath uploadPath;
     QMetaObject::invokeMethod(parent(), "createUpload", Q_RETURN_ARG(QDBusObjectPath, uploadPath), Q_ARG(UploadStruct, upload));
     return uploadPath;
@@ -63,6 +71,7 @@ QDBusObjectPath UploadManagerAdaptor::createUpload(UploadStruct upload)
 qulonglong UploadManagerAdaptor::defaultThrottle()
 {
     // handle method call com.canonical.applications.UploadManager.defaultThrottle
+    DBusCallTimer timer("UploadManager.defaultThrottle");
     qulonglong speed;
     QMetaObject::invokeMethod(parent(), "defaultThrottle", Q_RETURN_ARG(qulonglong, speed));
     return speed;
@@ -71,12 +80,14 @@ qulonglong UploadManagerAdaptor::defaultThrottle()
 void UploadManagerAdaptor::exit()
 {
     // handle method call com.canonical.applications.UploadManager.exit
+    DBusCallTimer timer("UploadManager.exit");
     QMetaObject::invokeMethod(parent(), "exit");
 }
 
 QList<QDBusObjectPath> UploadManagerAdaptor::getAllUploads()
 {
     // handle method call com.canonical.applications.UploadManager.getAllUploads
+    DBusCallTimer timer("UploadManager.getAllUploads");
     QList<QDBusObjectPath> uploads;
     QMetaObject::invokeMethod(parent(), "getAllUploads", Q_RETURN_ARG(QList<QDBusObjectPath>, uploads));
     return uploads;
@@ -85,6 +96,7 @@ QList<QDBusObjectPath> UploadManagerAdaptor::getAllUploads()
 QList<QDBusObjectPath> UploadManagerAdaptor::getAllUploadsWithMetadata(const QString &name, const QString &value)
 {
     // handle method call com.canonical.applications.UploadManager.getAllUploadsWithMetadata
+    DBusCallTimer timer("UploadManager.getAllUploadsWithMetadata");
     QList<QDBusObjectPath> uploads;
     QMetaObject::invokeMethod(parent(), "getAllUploadsWithMetadata", Q_RETURN_ARG(QList<QDBusObjectPath>, uploads), Q_ARG(QString, name), Q_ARG(QString, value));
     return uploads;
@@ -93,6 +105,7 @@ QList<QDBusObjectPath> UploadManagerAdaptor::getAllUploadsWithMetadata(const QSt
 bool UploadManagerAdaptor::isMobileUploadAllowed()
 {
     // handle method call com.canonical.applications.UploadManager.isMobileUploadAllowed
+    DBusCallTimer timer("UploadManager.isMobileUploadAllowed");
     bool allowed;
     QMetaObject::invokeMethod(parent(), "isMobileUploadAllowed", Q_RETURN_ARG(bool, allowed));
     return allowed;
@@ -101,6 +114,7 @@ bool UploadManagerAdaptor::isMobileUploadAllowed()
 void UploadManagerAdaptor::setDefaultThrottle(qulonglong speed)
 {
     // handle method call com.canonical.applications.UploadManager.setDefaultThrottle
+    DBusCallTimer timer("UploadManager.setDefaultThrottle");
     QMetaObject::invokeMethod(parent(), "setDefaultThrottle", Q_ARG(qulonglong, speed));
 }
 
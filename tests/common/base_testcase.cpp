@@ -20,6 +20,7 @@
 #include <QtGlobal>
 #include <QStandardPaths>
 #include <string.h>
+#include <unistd.h>
 #include "base_testcase.h"
 
 void
@@ -64,6 +65,20 @@ BaseTestCase::dataDirectory() {
     return dir.path() + "/data";
 }
 
+qint64
+BaseTestCase::residentMemory() {
+    // second field of statm is the resident set in pages
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    auto fields = statm.readAll().split(' ');
+    if (fields.count() < 2) {
+        return -1;
+    }
+    return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+}
+
 bool
 BaseTestCase::removeDir(const QString& dirName) {
     bool result = true;
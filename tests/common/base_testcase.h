@@ -68,6 +68,9 @@ class BaseTestCase : public QObject {
     QString testDirectory();
     QString dataDirectory();
 
+    // bytes of the resident set of the test process
+    static qint64 residentMemory();
+
  protected slots:  // NOLINT(whitespace/indent)
 
     virtual void init();
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef FAKE_CONTENT_CACHE_H
+#define FAKE_CONTENT_CACHE_H
+
+#include <QObject>
+#include <ubuntu/transfers/system/content_cache.h>
+#include <gmock/gmock.h>
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+using namespace System;
+
+namespace Tests {
+
+class MockContentCache : public ContentCache {
+ public:
+    explicit MockContentCache(QObject *parent = 0)
+        : ContentCache(parent) {}
+
+    MOCK_CONST_METHOD0(isEnabled, bool());
+    MOCK_METHOD2(findContent, QString(const QString&, const QString&));
+    MOCK_METHOD3(findResponse, QString(const QString&, QByteArray&,
+        QByteArray&));
+    MOCK_METHOD6(insert, bool(const QString&, const QString&, const QString&,
+        const QString&, const QByteArray&, const QByteArray&));
+};
+
+}  // Ubuntu
+
+}  // Transfers
+
+}  // Tests
+
+#endif  // FAKE_CONTENT_CACHE_H
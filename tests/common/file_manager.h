@@ -34,7 +34,13 @@ namespace Tests {
 class MockFile : public File {
  public:
     explicit MockFile(const QString& name)
-        : File(name) {}
+        : File(name) {
+        // most of the tests do not care about the preallocation
+        ON_CALL(*this, allocate(testing::_))
+            .WillByDefault(testing::Return(true));
+        ON_CALL(*this, truncate(testing::_))
+            .WillByDefault(testing::Return(true));
+    }
 
     MOCK_METHOD0(close, void());
     MOCK_CONST_METHOD0(error, QFile::FileError());
@@ -48,15 +54,27 @@ class MockFile : public File {
     MOCK_CONST_METHOD0(size, qint64());
     MOCK_METHOD1(write, qint64(const QByteArray&));
     MOCK_METHOD0(device, QIODevice*());
+    MOCK_METHOD1(allocate, bool(qint64));
+    MOCK_METHOD1(truncate, bool(qint64));
+    MOCK_METHOD1(copyFrom, bool(const QString&));
 };
 
 class MockFileManager : public FileManager {
  public:
     explicit MockFileManager(QObject *parent = 0)
-        : FileManager(parent) {}
+        : FileManager(parent) {
+        ON_CALL(*this, bytesAvailable(testing::An<const QString&>()))
+            .WillByDefault(testing::Return(-1));
+        ON_CALL(*this, bytesAvailable(testing::An<int>()))
+            .WillByDefault(testing::Return(-1));
+    }
 
     MOCK_METHOD1(createFile, File*(const QString&));
     MOCK_METHOD1(remove, bool(const QString&));
+    MOCK_METHOD1(bytesAvailable, qint64(const QString&));
+    MOCK_METHOD1(fileSystemId, qulonglong(const QString&));
+    MOCK_METHOD1(bytesAvailable, qint64(int));
+    MOCK_METHOD1(fileSystemId, qulonglong(int));
 };
 
 }  // Ubuntu
@@ -52,6 +52,8 @@ class MockNetworkReply : public NetworkReply {
     using NetworkReply::error;
     using NetworkReply::finished;
     using NetworkReply::sslErrors;
+    using NetworkReply::encrypted;
+    using NetworkReply::metaDataChanged;
 };
 
 }  // Tests
@@ -37,6 +37,7 @@ class MockProcess : public Process {
 
     MOCK_METHOD3(start,
         void(const QString&, const QStringList&, QProcess::OpenMode));
+    MOCK_METHOD0(kill, void());
     MOCK_CONST_METHOD0(arguments, QStringList());
     MOCK_CONST_METHOD0(program, QString());
     MOCK_METHOD0(readAllStandardOutput, QByteArray());
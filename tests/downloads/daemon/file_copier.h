@@ -0,0 +1,47 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef FAKE_FILE_COPIER_H
+#define FAKE_FILE_COPIER_H
+
+#include <ubuntu/transfers/system/file_copier.h>
+#include <gmock/gmock.h>
+
+namespace Ubuntu {
+
+namespace Transfers {
+
+using namespace System;
+
+namespace Tests {
+
+class MockFileCopier : public FileCopier {
+ public:
+    explicit MockFileCopier(QObject* parent = 0)
+        : FileCopier(parent) {}
+
+    MOCK_METHOD1(copy, void(CopyJob*));
+    MOCK_METHOD1(cancel, void(CopyJob*));
+};
+
+}  // Ubuntu
+
+}  // Transfers
+
+}  // Tests
+#endif
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <time.h>
+#include <QDir>
+#include "test_async_logger.h"
+
+namespace {
+
+    class FakeLogger : public google::base::Logger {
+     public:
+        void Write(bool forceFlush,
+                   time_t timestamp,
+                   const char* message,
+                   int length) override {
+            Q_UNUSED(forceFlush);
+            Q_UNUSED(timestamp);
+            // the test can block the writer by holding the gate
+            std::lock_guard<std::mutex> gate(this->gate);
+            std::lock_guard<std::mutex> lock(_mutex);
+            _messages.push_back(std::string(message, length));
+        }
+
+        void Flush() override {}
+
+        google::uint32 LogSize() override {
+            return 0;
+        }
+
+        std::vector<std::string> messages() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _messages;
+        }
+
+        std::mutex gate;
+
+     private:
+        std::mutex _mutex;
+        std::vector<std::string> _messages;
+    };
+
+    // writes the messages as glog does when it is asked to flush every
+    // message, which is the case of the warnings and errors
+    class FileLogger : public google::base::Logger {
+     public:
+        explicit FileLogger(const QString& path)
+            : _file(fopen(path.toUtf8().constData(), "w")) {
+        }
+
+        ~FileLogger() {
+            fclose(_file);
+        }
+
+        void Write(bool forceFlush,
+                   time_t timestamp,
+                   const char* message,
+                   int length) override {
+            Q_UNUSED(forceFlush);
+            Q_UNUSED(timestamp);
+            fwrite(message, 1, length, _file);
+            fflush(_file);
+        }
+
+        void Flush() override {
+            fflush(_file);
+        }
+
+        google::uint32 LogSize() override {
+            return 0;
+        }
+
+     private:
+        FILE* _file;
+    };
+
+    std::string message(int index) {
+        return "I1019 10:00:00.000000  1234 file_download.cpp:749] "
+            "Download ID{ /com/canonical/applications/download/"
+            + std::to_string(index) + " } progress "
+            + std::to_string(index * 4096) + " of 1073741824 bytes\n";
+    }
+
+    void logMessage(google::base::Logger* logger, int index,
+                    bool forceFlush = false) {
+        auto msg = message(index);
+        logger->Write(forceFlush, time(nullptr), msg.c_str(),
+            static_cast<int>(msg.size()));
+    }
+
+    qint64 threadCpuTime() {
+        struct timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return static_cast<qint64>(time.tv_sec) * 1000000000
+            + time.tv_nsec;
+    }
+
+}
+
+void
+TestAsyncLogger::init() {
+    BaseTestCase::init();
+    _interval = LogRateLimiter::interval();
+}
+
+void
+TestAsyncLogger::cleanup() {
+    BaseTestCase::cleanup();
+    LogRateLimiter::setInterval(_interval);
+}
+
+void
+TestAsyncLogger::testWritesInOrder() {
+    FakeLogger fake;
+    AsyncLogger logger(&fake, 4096);
+    logger.start();
+    QVERIFY(logger.isRunning());
+
+    // several times the capacity so that the records wrap around
+    for (int index = 0; index < 200; index++) {
+        logMessage(&logger, index, true);
+    }
+    logger.Flush();
+
+    auto messages = fake.messages();
+    QCOMPARE(static_cast<int>(messages.size()), 200);
+    for (int index = 0; index < 200; index++) {
+        QCOMPARE(messages[index], message(index));
+    }
+    QCOMPARE(logger.dropped(), 0ull);
+
+    logger.stop();
+    QVERIFY(!logger.isRunning());
+}
+
+void
+TestAsyncLogger::testWritesWhenNotRunning() {
+    FakeLogger fake;
+    AsyncLogger logger(&fake);
+
+    logMessage(&logger, 1);
+
+    auto messages = fake.messages();
+    QCOMPARE(static_cast<int>(messages.size()), 1);
+    QCOMPARE(messages[0], message(1));
+}
+
+void
+TestAsyncLogger::testDropsWhenFull() {
+    FakeLogger fake;
+    AsyncLogger logger(&fake, 1024);
+    logger.start();
+
+    // the writer blocks on the first message while the buffer fills up
+    {
+        std::lock_guard<std::mutex> gate(fake.gate);
+        for (int index = 0; index < 100; index++) {
+            logMessage(&logger, index);
+        }
+        QVERIFY(logger.dropped() > 0);
+    }
+    logger.stop();
+
+    auto messages = fake.messages();
+    auto dropped = logger.dropped();
+    QCOMPARE(static_cast<unsigned long long>(messages.size()),
+        100 - dropped + 1);
+    QCOMPARE(messages.back(), "Dropped " + std::to_string(dropped)
+        + " log messages, the log buffer was full.\n");
+}
+
+void
+TestAsyncLogger::testNeverDropsFlushed() {
+    FakeLogger fake;
+    AsyncLogger logger(&fake, 1024);
+    logger.start();
+
+    std::unique_lock<std::mutex> gate(fake.gate);
+    std::thread producer([&logger]() {
+        for (int index = 0; index < 100; index++) {
+            logMessage(&logger, index, true);
+        }
+    });
+    QTest::qWait(100);
+    gate.unlock();
+    producer.join();
+    logger.Flush();
+
+    QCOMPARE(static_cast<int>(fake.messages().size()), 100);
+    QCOMPARE(logger.dropped(), 0ull);
+}
+
+void
+TestAsyncLogger::testRateLimiter() {
+    int object = 0;
+    LogRateLimiter::setInterval(60000);
+
+    QCOMPARE(LogRateLimiter::acquire(&object, __FILE__, 1), 0);
+    QCOMPARE(LogRateLimiter::acquire(&object, __FILE__, 1), -1);
+    QCOMPARE(LogRateLimiter::acquire(&object, __FILE__, 1), -1);
+    // other call sites are not affected
+    QCOMPARE(LogRateLimiter::acquire(&object, __FILE__, 2), 0);
+
+    LogRateLimiter::setInterval(0);
+    auto skipped = LogRateLimiter::acquire(&object, __FILE__, 1);
+    QCOMPARE(skipped, 2);
+    QCOMPARE(LogRateLimiter::skipped(skipped),
+        std::string("(2 similar messages skipped) "));
+    QCOMPARE(LogRateLimiter::skipped(0), std::string());
+}
+
+void
+TestAsyncLogger::testRateLimiterPerObject() {
+    int first = 0;
+    int second = 0;
+    const void* objects[] = {&first, &second};
+    LogRateLimiter::setInterval(60000);
+
+    // the message is only built when it is logged
+    int logged = 0;
+    for (int index = 0; index < 10; index++) {
+        LOG_RATE_LIMITED(INFO, objects[index % 2]) << "Retrying "
+            << ++logged;
+    }
+    QCOMPARE(logged, 2);
+}
+
+void
+TestAsyncLogger::benchmarkLogging_data() {
+    QTest::addColumn<bool>("async");
+
+    QTest::newRow("sync") << false;
+    QTest::newRow("async") << true;
+}
+
+void
+TestAsyncLogger::benchmarkLogging() {
+    QFETCH(bool, async);
+    const int count = 10000;
+    FileLogger file(QDir(testDirectory()).filePath("benchmark.log"));
+    AsyncLogger logger(&file);
+    if (async) {
+        logger.start();
+    }
+
+    // what matters is the time the threads that log spend doing it, the
+    // writes done by the background thread are not in the way of the
+    // downloads
+    qint64 cpuTime = 0;
+    QBENCHMARK_ONCE {
+        auto start = threadCpuTime();
+        for (int index = 0; index < count; index++) {
+            logMessage(&logger, index);
+        }
+        cpuTime = threadCpuTime() - start;
+    }
+    logger.stop();
+
+    qDebug() << (async ? "async" : "sync") << "logging used"
+        << cpuTime / count << "nsecs of cpu per message in the caller,"
+        << logger.dropped() << "messages dropped";
+}
+
+QTEST_MAIN(TestAsyncLogger)
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QTest>
+#include <ubuntu/downloads/header_parser.h>
+#include "test_byte_ranges_parser.h"
+
+QByteArray
+TestByteRangesParser::multipart() {
+    return QByteArray("preamble\r\n")
+        + "--THIS_STRING_SEPARATES\r\n"
+        + "Content-Type: application/octet-stream\r\n"
+        + "Content-Range: bytes 0-4/100\r\n\r\n"
+        + "first\r\n"
+        + "--THIS_STRING_SEPARATES\r\n"
+        + "Content-Type: application/octet-stream\r\n"
+        + "Content-Range: bytes 50-55/100\r\n\r\n"
+        + "second\r\n"
+        + "--THIS_STRING_SEPARATES--\r\n";
+}
+
+void
+TestByteRangesParser::testBoundaryFromContentType_data() {
+    QTest::addColumn<QString>("contentType");
+    QTest::addColumn<QString>("boundary");
+
+    QTest::newRow("Plain") << "multipart/byteranges; boundary=abc" << "abc";
+    QTest::newRow("Quoted") << "multipart/byteranges; boundary=\"abc\""
+        << "abc";
+    QTest::newRow("Other params") << "Multipart/Byteranges; q=1; Boundary=abc"
+        << "abc";
+    QTest::newRow("Not multipart") << "text/plain; boundary=abc" << "";
+    QTest::newRow("No boundary") << "multipart/byteranges" << "";
+}
+
+void
+TestByteRangesParser::testBoundaryFromContentType() {
+    QFETCH(QString, contentType);
+    QFETCH(QString, boundary);
+    QCOMPARE(HeaderParser::boundaryFromContentType(contentType), boundary);
+}
+
+void
+TestByteRangesParser::testRangeFromContentRange_data() {
+    QTest::addColumn<QString>("contentRange");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<qint64>("first");
+    QTest::addColumn<qint64>("last");
+
+    QTest::newRow("Total") << "bytes 0-499/1234" << true << 0LL << 499LL;
+    QTest::newRow("Unknown total") << "bytes 500-999/*" << true << 500LL
+        << 999LL;
+    QTest::newRow("Unsatisfied") << "bytes */1234" << false << 0LL << 0LL;
+    QTest::newRow("Other unit") << "items 0-1/2" << false << 0LL << 0LL;
+    QTest::newRow("Reversed") << "bytes 9-1/10" << false << 0LL << 0LL;
+}
+
+void
+TestByteRangesParser::testRangeFromContentRange() {
+    QFETCH(QString, contentRange);
+    QFETCH(bool, valid);
+    QFETCH(qint64, first);
+    QFETCH(qint64, last);
+
+    qint64 resultFirst = 0;
+    qint64 resultLast = 0;
+    QCOMPARE(HeaderParser::rangeFromContentRange(contentRange, resultFirst,
+        resultLast), valid);
+    if (valid) {
+        QCOMPARE(resultFirst, first);
+        QCOMPARE(resultLast, last);
+    }
+}
+
+void
+TestByteRangesParser::testSingleRange() {
+    ByteRangesParser parser(10, 5);
+    QList<ByteRangesParser::Part> parts;
+
+    QVERIFY(parser.feed("abc", parts));
+    QVERIFY(!parser.isDone());
+    QVERIFY(parser.feed("de", parts));
+    QVERIFY(parser.isDone());
+
+    QCOMPARE(parts.count(), 2);
+    QCOMPARE(parts[0].offset, 10LL);
+    QCOMPARE(parts[0].data, QByteArray("abc"));
+    QCOMPARE(parts[1].offset, 13LL);
+    QCOMPARE(parts[1].data, QByteArray("de"));
+}
+
+void
+TestByteRangesParser::testMultipleRanges() {
+    ByteRangesParser parser("THIS_STRING_SEPARATES");
+    QList<ByteRangesParser::Part> parts;
+
+    QVERIFY(parser.feed(multipart(), parts));
+    QVERIFY(parser.isDone());
+    QCOMPARE(parts.count(), 2);
+    QCOMPARE(parts[0].offset, 0LL);
+    QCOMPARE(parts[0].data, QByteArray("first"));
+    QCOMPARE(parts[1].offset, 50LL);
+    QCOMPARE(parts[1].data, QByteArray("second"));
+}
+
+void
+TestByteRangesParser::testMultipleRangesSplitFeed() {
+    // the network can split the body at any point, even in the middle of
+    // a delimiter
+    ByteRangesParser parser("THIS_STRING_SEPARATES");
+    QList<ByteRangesParser::Part> parts;
+    auto body = multipart();
+    for (int index = 0; index < body.size(); index++) {
+        QVERIFY(parser.feed(body.mid(index, 1), parts));
+    }
+    QVERIFY(parser.isDone());
+
+    QByteArray first;
+    QByteArray second;
+    foreach(const ByteRangesParser::Part& part, parts) {
+        if (part.offset < 50) {
+            QCOMPARE(part.offset, static_cast<qint64>(first.size()));
+            first += part.data;
+        } else {
+            QCOMPARE(part.offset, 50LL + second.size());
+            second += part.data;
+        }
+    }
+    QCOMPARE(first, QByteArray("first"));
+    QCOMPARE(second, QByteArray("second"));
+}
+
+void
+TestByteRangesParser::testMissingContentRange() {
+    ByteRangesParser parser("abc");
+    QList<ByteRangesParser::Part> parts;
+    QVERIFY(!parser.feed("--abc\r\nContent-Type: text/plain\r\n\r\ndata", parts));
+    QVERIFY(!parser.lastError().isEmpty());
+    QVERIFY(parts.isEmpty());
+}
+
+void
+TestByteRangesParser::testHeadersTooLarge() {
+    ByteRangesParser parser("abc");
+    QList<ByteRangesParser::Part> parts;
+    QVERIFY(parser.feed("--abc\r\n", parts));
+    QVERIFY(!parser.feed(QByteArray(16 * 1024, 'a'), parts));
+}
+
+QTEST_MAIN(TestByteRangesParser)
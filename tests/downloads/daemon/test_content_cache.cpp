@@ -0,0 +1,178 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QTest>
+#include "test_content_cache.h"
+
+void
+TestContentCache::init() {
+    BaseTestCase::init();
+    _cachePath = testDirectory() + QDir::separator() + "cache";
+    _cache = new ContentCache();
+    _cache->setPath(_cachePath);
+    _cache->setMaxSize(1024);
+}
+
+void
+TestContentCache::cleanup() {
+    BaseTestCase::cleanup();
+    delete _cache;
+}
+
+QString
+TestContentCache::writeFile(const QString& name, const QByteArray& data) {
+    auto path = testDirectory() + QDir::separator() + name;
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+    return path;
+}
+
+void
+TestContentCache::testDisabledByDefault() {
+    auto path = writeFile("data", "data");
+    ContentCache cache;
+    cache.setPath(_cachePath);
+
+    QVERIFY(!cache.isEnabled());
+    QVERIFY(!cache.insert(path, "sha256", "abcd"));
+    QVERIFY(cache.findContent("sha256", "abcd").isEmpty());
+}
+
+void
+TestContentCache::testInsertWithDigest() {
+    QByteArray data("data");
+    auto path = writeFile("data", data);
+
+    QVERIFY(_cache->insert(path, "sha256", "abcd"));
+    QCOMPARE(_cache->size(), static_cast<qulonglong>(data.size()));
+
+    // neither the algo nor the digest are case sensitive
+    auto cached = _cache->findContent("SHA256", "ABCD");
+    QVERIFY(!cached.isEmpty());
+    QVERIFY(cached != path);
+
+    QFile file(cached);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), data);
+
+    QVERIFY(_cache->findContent("md5", "abcd").isEmpty());
+}
+
+void
+TestContentCache::testInsertCalculatesDigest() {
+    QByteArray data("data");
+    auto path = writeFile("data", data);
+    auto digest = QString(QCryptographicHash::hash(data,
+        QCryptographicHash::Sha256).toHex());
+
+    QVERIFY(_cache->insert(path, QString(), QString()));
+    QVERIFY(!_cache->findContent("sha256", digest).isEmpty());
+}
+
+void
+TestContentCache::testInsertInvalidDigest() {
+    auto path = writeFile("data", "data");
+
+    // the digest is used as a path
+    QVERIFY(!_cache->insert(path, "sha256", "../../data"));
+    QVERIFY(!_cache->insert(path, "../sha256", "abcd"));
+    QVERIFY(_cache->findContent("sha256", "../../data").isEmpty());
+    QCOMPARE(_cache->size(), 0ULL);
+}
+
+void
+TestContentCache::testInsertTooLarge() {
+    auto path = writeFile("data", QByteArray(2048, 'a'));
+
+    QVERIFY(!_cache->insert(path, "sha256", "abcd"));
+    QCOMPARE(_cache->size(), 0ULL);
+}
+
+void
+TestContentCache::testFindResponse() {
+    auto path = writeFile("data", "data");
+    QByteArray etag = "\"v1\"";
+    QByteArray lastModified = "Wed, 21 Oct 2015 07:28:00 GMT";
+
+    QVERIFY(_cache->insert(path, "sha256", "abcd", "request", etag,
+        lastModified));
+
+    QByteArray cachedEtag, cachedLastModified;
+    auto cached = _cache->findResponse("request", cachedEtag,
+        cachedLastModified);
+    QCOMPARE(cached, _cache->findContent("sha256", "abcd"));
+    QCOMPARE(cachedEtag, etag);
+    QCOMPARE(cachedLastModified, lastModified);
+
+    QVERIFY(_cache->findResponse("other", cachedEtag,
+        cachedLastModified).isEmpty());
+}
+
+void
+TestContentCache::testFindResponseEvicted() {
+    auto first = writeFile("first", QByteArray(600, 'a'));
+    auto second = writeFile("second", QByteArray(600, 'b'));
+
+    QVERIFY(_cache->insert(first, "sha256", "abcd", "request", "\"v1\""));
+    QTest::qWait(10);
+    QVERIFY(_cache->insert(second, "sha256", "dcba"));
+
+    QByteArray etag, lastModified;
+    QVERIFY(_cache->findResponse("request", etag, lastModified).isEmpty());
+}
+
+void
+TestContentCache::testEvictLeastRecentlyUsed() {
+    auto first = writeFile("first", QByteArray(400, 'a'));
+    auto second = writeFile("second", QByteArray(400, 'b'));
+    auto third = writeFile("third", QByteArray(400, 'c'));
+
+    QVERIFY(_cache->insert(first, "sha256", "aaaa"));
+    QTest::qWait(10);
+    QVERIFY(_cache->insert(second, "sha256", "bbbb"));
+    QTest::qWait(10);
+    // using the first one makes the second the least recently used
+    QVERIFY(!_cache->findContent("sha256", "aaaa").isEmpty());
+    QTest::qWait(10);
+    QVERIFY(_cache->insert(third, "sha256", "cccc"));
+
+    QCOMPARE(_cache->size(), 800ULL);
+    QVERIFY(!_cache->findContent("sha256", "aaaa").isEmpty());
+    QVERIFY(_cache->findContent("sha256", "bbbb").isEmpty());
+    QVERIFY(!_cache->findContent("sha256", "cccc").isEmpty());
+}
+
+void
+TestContentCache::testLoadExistingData() {
+    auto path = writeFile("data", "data");
+    QVERIFY(_cache->insert(path, "sha256", "abcd"));
+
+    ContentCache cache;
+    cache.setPath(_cachePath);
+    cache.setMaxSize(1024);
+
+    QCOMPARE(cache.size(), 4ULL);
+    QVERIFY(!cache.findContent("sha256", "abcd").isEmpty());
+}
+
+QTEST_MAIN(TestContentCache)
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_CONTENT_CACHE_H
+#define TEST_CONTENT_CACHE_H
+
+#include <QObject>
+#include <ubuntu/transfers/system/content_cache.h>
+
+#include "base_testcase.h"
+
+using namespace Ubuntu::Transfers::System;
+using namespace Ubuntu::Transfers::Tests;
+
+class TestContentCache : public BaseTestCase {
+    Q_OBJECT
+
+ public:
+    explicit TestContentCache(QObject *parent = 0)
+        : BaseTestCase("TestContentCache", parent) {}
+
+ private slots:  // NOLINT(whitespace/indent)
+
+    void init() override;
+    void cleanup() override;
+
+    void testDisabledByDefault();
+    void testInsertWithDigest();
+    void testInsertCalculatesDigest();
+    void testInsertInvalidDigest();
+    void testInsertTooLarge();
+    void testFindResponse();
+    void testFindResponseEvicted();
+    void testEvictLeastRecentlyUsed();
+    void testLoadExistingData();
+
+ private:
+    QString writeFile(const QString& name, const QByteArray& data);
+
+ private:
+    QString _cachePath;
+    ContentCache* _cache;
+};
+
+#endif  // TEST_CONTENT_CACHE_H
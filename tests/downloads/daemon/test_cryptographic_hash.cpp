@@ -0,0 +1,309 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QBuffer>
+#include <QFile>
+#include <QTest>
+#include <QThread>
+#include "test_cryptographic_hash.h"
+
+namespace {
+    const int BENCHMARK_SIZE = 16 * 1024 * 1024;
+    const int TRUNCATED_FILE_SIZE = 64 * 1024 * 1024;
+    const int LARGE_FILE_SIZE = 256 * 1024 * 1024;
+
+    // shrinks the file the way a client can shrink its own file
+    class Truncator : public QThread {
+     public:
+        Truncator(const QString& path, qint64 size)
+            : _path(path),
+              _size(size) {}
+
+     protected:
+        void run() override {
+            QFile::resize(_path, _size);
+        }
+
+     private:
+        QString _path;
+        qint64 _size;
+    };
+}
+
+QByteArray
+TestCryptographicHash::data(int size) {
+    QByteArray result;
+    result.reserve(size);
+    quint32 seed = 42;
+    for (int index = 0; index < size; index++) {
+        seed = seed * 1103515245 + 12345;
+        result.append(static_cast<char>(seed >> 16));
+    }
+    return result;
+}
+
+QString
+TestCryptographicHash::writeFile(const QByteArray& bytes) {
+    auto path = testDirectory() + "/hashed_file";
+    QFile file(path);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    file.write(bytes);
+    file.close();
+    return path;
+}
+
+void
+TestCryptographicHash::testMatchesQt_data() {
+    QTest::addColumn<int>("algo");
+
+    QTest::newRow("md4") << static_cast<int>(QCryptographicHash::Md4);
+    QTest::newRow("md5") << static_cast<int>(QCryptographicHash::Md5);
+    QTest::newRow("sha1") << static_cast<int>(QCryptographicHash::Sha1);
+    QTest::newRow("sha224") << static_cast<int>(QCryptographicHash::Sha224);
+    QTest::newRow("sha256") << static_cast<int>(QCryptographicHash::Sha256);
+    QTest::newRow("sha384") << static_cast<int>(QCryptographicHash::Sha384);
+    QTest::newRow("sha512") << static_cast<int>(QCryptographicHash::Sha512);
+}
+
+void
+TestCryptographicHash::testMatchesQt() {
+    QFETCH(int, algo);
+    auto method = static_cast<QCryptographicHash::Algorithm>(algo);
+    // larger than a read so that several chunks are used
+    auto bytes = data(3 * 1024 * 1024 + 7);
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    CryptographicHash hash(method);
+    QVERIFY(hash.addData(&buffer));
+    QCOMPARE(hash.result(), QCryptographicHash::hash(bytes, method));
+}
+
+void
+TestCryptographicHash::testEmptyDevice() {
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    CryptographicHash hash(QCryptographicHash::Sha256);
+    QVERIFY(hash.addData(&buffer));
+    QCOMPARE(hash.result(), QCryptographicHash::hash(bytes,
+        QCryptographicHash::Sha256));
+}
+
+void
+TestCryptographicHash::testResultCanBeRepeated() {
+    CryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addBytes("abc");
+    auto first = hash.result();
+    QCOMPARE(hash.result(), first);
+
+    // more data can be added after the result
+    hash.addBytes("def");
+    QCOMPARE(hash.result(), QCryptographicHash::hash("abcdef",
+        QCryptographicHash::Sha256));
+}
+
+void
+TestCryptographicHash::testMultipleDigests() {
+    auto bytes = data(1024 * 1024 + 3);
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    QList<QCryptographicHash::Algorithm> methods;
+    methods << QCryptographicHash::Sha256 << QCryptographicHash::Md5
+        << QCryptographicHash::Sha1;
+    CryptographicHash hash(methods);
+    QVERIFY(hash.addData(&buffer));
+
+    auto results = hash.results();
+    QCOMPARE(results.count(), 3);
+    QCOMPARE(hash.result(), results[0]);
+    for (int index = 0; index < methods.count(); index++) {
+        QCOMPARE(results[index], QCryptographicHash::hash(bytes,
+            methods[index]));
+    }
+}
+
+void
+TestCryptographicHash::testExtraAlgorithm() {
+    if (!CryptographicHash::isSupported("blake2b512")) {
+        QSKIP("BLAKE2 is not supported by the OpenSSL of the system.");
+    }
+    CryptographicHash hash(QStringList() << "blake2b512");
+    QVERIFY(hash.isValid());
+    hash.addBytes("abc");
+    QCOMPARE(hash.result().toHex(), QByteArray(
+        "ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d1"
+        "7d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923"));
+}
+
+void
+TestCryptographicHash::testUnsupportedName() {
+    CryptographicHash hash(QStringList() << "not-a-hash");
+    QVERIFY(!hash.isValid());
+    QVERIFY(!CryptographicHash::isSupported("not-a-hash"));
+}
+
+void
+TestCryptographicHash::testAddFileMatchesStream_data() {
+    QTest::addColumn<int>("size");
+
+    QTest::newRow("empty") << 0;
+    QTest::newRow("one byte") << 1;
+    QTest::newRow("not page aligned") << 5 * 4096 + 17;
+    // larger than the threshold so that addData maps it
+    QTest::newRow("mapped") << 17 * 1024 * 1024 + 3;
+    // larger than a mapped window
+    QTest::newRow("several windows") << 65 * 1024 * 1024 + 11;
+}
+
+void
+TestCryptographicHash::testAddFileMatchesStream() {
+    QFETCH(int, size);
+    auto bytes = data(size);
+    QFile file(writeFile(bytes));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    CryptographicHash mapped(QCryptographicHash::Sha256);
+    QVERIFY(mapped.addFile(&file));
+    QVERIFY(file.atEnd());
+    QCOMPARE(mapped.result(), QCryptographicHash::hash(bytes,
+        QCryptographicHash::Sha256));
+
+    QVERIFY(file.reset());
+    CryptographicHash selected(QCryptographicHash::Sha256);
+    QVERIFY(selected.addData(&file));
+    QCOMPARE(selected.result(), mapped.result());
+}
+
+void
+TestCryptographicHash::testAddFileFromPosition() {
+    // the offset is not page aligned, only the rest of the file is used
+    auto bytes = data(3 * 4096 + 5);
+    QFile file(writeFile(bytes));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY(file.seek(4099));
+
+    CryptographicHash hash(QCryptographicHash::Md5);
+    QVERIFY(hash.addFile(&file));
+    QCOMPARE(hash.result(), QCryptographicHash::hash(bytes.mid(4099),
+        QCryptographicHash::Md5));
+}
+
+void
+TestCryptographicHash::testAddFileTruncated() {
+    // the file shrinks while it is hashed, depending on when that happens
+    // the hash fails or uses one of the two versions but never crashes
+    auto bytes = data(TRUNCATED_FILE_SIZE);
+    auto path = writeFile(bytes);
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    Truncator truncator(path, bytes.size() / 2);
+    truncator.start();
+    CryptographicHash hash(QCryptographicHash::Sha1);
+    auto added = hash.addFile(&file);
+    truncator.wait();
+
+    if (added) {
+        auto result = hash.result();
+        QVERIFY(result == QCryptographicHash::hash(bytes,
+                QCryptographicHash::Sha1)
+            || result == QCryptographicHash::hash(bytes.left(bytes.size() / 2),
+                QCryptographicHash::Sha1));
+    }
+    QCOMPARE(file.size(), static_cast<qint64>(bytes.size() / 2));
+}
+
+void
+TestCryptographicHash::benchmarkAlgorithms_data() {
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<bool>("qt");
+
+    QTest::newRow("qt md5") << "md5" << true;
+    QTest::newRow("qt sha1") << "sha1" << true;
+    QTest::newRow("qt sha256") << "sha256" << true;
+    QTest::newRow("qt sha512") << "sha512" << true;
+    QTest::newRow("engine md5") << "md5" << false;
+    QTest::newRow("engine sha1") << "sha1" << false;
+    QTest::newRow("engine sha256") << "sha256" << false;
+    QTest::newRow("engine sha512") << "sha512" << false;
+    QTest::newRow("engine md5+sha256") << "md5,sha256" << false;
+    foreach(const QString& name, CryptographicHash::extraAlgorithms()) {
+        QTest::newRow(qPrintable("engine " + name)) << name << false;
+    }
+}
+
+void
+TestCryptographicHash::benchmarkAlgorithms() {
+    QFETCH(QString, name);
+    QFETCH(bool, qt);
+    auto bytes = data(BENCHMARK_SIZE);
+
+    QMap<QString, QCryptographicHash::Algorithm> algorithms;
+    algorithms["md5"] = QCryptographicHash::Md5;
+    algorithms["sha1"] = QCryptographicHash::Sha1;
+    algorithms["sha256"] = QCryptographicHash::Sha256;
+    algorithms["sha512"] = QCryptographicHash::Sha512;
+
+    if (qt) {
+        QBENCHMARK {
+            QCryptographicHash hash(algorithms[name]);
+            hash.addData(bytes);
+            hash.result();
+        }
+        return;
+    }
+
+    QBENCHMARK {
+        CryptographicHash hash(name.split(','));
+        hash.addBytes(bytes);
+        hash.results();
+    }
+}
+
+void
+TestCryptographicHash::benchmarkLargeFile_data() {
+    QTest::addColumn<bool>("preads");
+
+    QTest::newRow("stream") << false;
+    QTest::newRow("preads") << true;
+}
+
+void
+TestCryptographicHash::benchmarkLargeFile() {
+    // the file is in the page cache, the results show the overhead of the
+    // copies and syscalls rather than the disk bandwidth
+    QFETCH(bool, preads);
+    QFile file(writeFile(data(LARGE_FILE_SIZE)));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    QBENCHMARK {
+        file.reset();
+        CryptographicHash hash(QCryptographicHash::Sha1);
+        if (preads) {
+            hash.addFile(&file);
+        } else {
+            hash.addStream(&file);
+        }
+        hash.result();
+    }
+}
+
+QTEST_MAIN(TestCryptographicHash)
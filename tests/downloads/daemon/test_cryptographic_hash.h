@@ -0,0 +1,63 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_CRYPTOGRAPHIC_HASH_H
+#define TEST_CRYPTOGRAPHIC_HASH_H
+
+#include <QObject>
+#include <ubuntu/transfers/system/cryptographic_hash.h>
+
+#include "base_testcase.h"
+
+using namespace Ubuntu::Transfers::System;
+using namespace Ubuntu::Transfers::Tests;
+
+class TestCryptographicHash : public BaseTestCase {
+    Q_OBJECT
+
+ public:
+    explicit TestCryptographicHash(QObject *parent = 0)
+        : BaseTestCase("TestCryptographicHash", parent) {}
+
+ private slots:  // NOLINT(whitespace/indent)
+
+    void testMatchesQt_data();
+    void testMatchesQt();
+    void testEmptyDevice();
+    void testResultCanBeRepeated();
+    void testMultipleDigests();
+    void testExtraAlgorithm();
+    void testUnsupportedName();
+    void testAddFileMatchesStream_data();
+    void testAddFileMatchesStream();
+    void testAddFileFromPosition();
+    void testAddFileTruncated();
+
+    // compare the diff implementations on the same buffer
+    void benchmarkAlgorithms_data();
+    void benchmarkAlgorithms();
+    // compare reading a large file through the device and with preads
+    void benchmarkLargeFile_data();
+    void benchmarkLargeFile();
+
+ private:
+    QByteArray data(int size);
+    QString writeFile(const QByteArray& bytes);
+};
+
+#endif  // TEST_CRYPTOGRAPHIC_HASH_H
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QTest>
+#include "test_delta_control.h"
+
+QByteArray
+TestDeltaControl::target(int size) {
+    // data without repeated blocks so that the offsets are predictable
+    QByteArray data;
+    data.reserve(size);
+    quint32 seed = 42;
+    for (int index = 0; index < size; index++) {
+        seed = seed * 1103515245 + 12345;
+        data.append(static_cast<char>(seed >> 16));
+    }
+    return data;
+}
+
+QByteArray
+TestDeltaControl::control(const QByteArray& data,
+                          int blockSize,
+                          int seqMatches,
+                          int weakBytes,
+                          int strongBytes) {
+    QByteArray result;
+    result += "zsync: 0.6.2\n";
+    result += "Filename: data\n";
+    result += "Blocksize: " + QByteArray::number(blockSize) + "\n";
+    result += "Length: " + QByteArray::number(data.size()) + "\n";
+    result += "Hash-Lengths: " + QByteArray::number(seqMatches) + ","
+        + QByteArray::number(weakBytes) + ","
+        + QByteArray::number(strongBytes) + "\n";
+    result += "URL: data\n";
+    result += "SHA-1: " + QCryptographicHash::hash(data,
+        QCryptographicHash::Sha1).toHex() + "\n\n";
+
+    auto raw = reinterpret_cast<const uchar*>(data.constData());
+    for (int offset = 0; offset < data.size(); offset += blockSize) {
+        auto length = qMin(blockSize, data.size() - offset);
+        QByteArray block(blockSize, '\0');
+        memcpy(block.data(), raw + offset, length);
+        auto paddedBlock = reinterpret_cast<const uchar*>(block.constData());
+
+        auto weak = DeltaControl::weakSum(paddedBlock, blockSize);
+        for (int index = weakBytes - 1; index >= 0; index--) {
+            result.append(static_cast<char>((weak >> (8 * index)) & 0xff));
+        }
+        result += DeltaControl::strongSum(paddedBlock, blockSize,
+            blockSize).left(strongBytes);
+    }
+    return result;
+}
+
+QString
+TestDeltaControl::writeSeed(const QByteArray& data) {
+    auto path = testDirectory() + QDir::separator() + "seed";
+    QFile file(path);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    file.write(data);
+    file.close();
+    return path;
+}
+
+void
+TestDeltaControl::testParse() {
+    auto data = target(1000);
+    DeltaControl delta;
+
+    QVERIFY(delta.parse(control(data, 64)));
+    QCOMPARE(delta.blockSize(), 64LL);
+    QCOMPARE(delta.length(), 1000LL);
+    QCOMPARE(delta.blockCount(), 16);
+    QCOMPARE(delta.sha1(), QString(QCryptographicHash::hash(data,
+        QCryptographicHash::Sha1).toHex()));
+}
+
+void
+TestDeltaControl::testParseNotZsync() {
+    DeltaControl delta;
+    QVERIFY(!delta.parse("Blocksize: 64\nLength: 0\n\n"));
+    QVERIFY(!delta.lastError().isEmpty());
+}
+
+void
+TestDeltaControl::testParseCompressed() {
+    auto data = control(target(100), 64);
+    data.replace("URL: data\n", "Z-Map2: 1\n");
+    DeltaControl delta;
+    QVERIFY(!delta.parse(data));
+}
+
+void
+TestDeltaControl::testParseInvalidBlockSize_data() {
+    QTest::addColumn<QByteArray>("blockSize");
+
+    QTest::newRow("Not a number") << QByteArray("abc");
+    QTest::newRow("Too small") << QByteArray("8");
+    QTest::newRow("Too large") << QByteArray("2097152");
+    QTest::newRow("Not a power of two") << QByteArray("1000");
+}
+
+void
+TestDeltaControl::testParseInvalidBlockSize() {
+    QFETCH(QByteArray, blockSize);
+    auto data = control(target(100), 64);
+    data.replace("Blocksize: 64", "Blocksize: " + blockSize);
+
+    DeltaControl delta;
+    QVERIFY(!delta.parse(data));
+}
+
+void
+TestDeltaControl::testParseTruncated() {
+    auto data = control(target(1000), 64);
+    data.chop(1);
+    DeltaControl delta;
+    QVERIFY(!delta.parse(data));
+}
+
+void
+TestDeltaControl::testRollingWeakSum() {
+    // the sum of a block must not depend on how it was calculated, this
+    // is what the rolling search relies on
+    auto data = target(200);
+    auto raw = reinterpret_cast<const uchar*>(data.constData());
+    auto first = DeltaControl::weakSum(raw, 64);
+    quint16 a = first >> 16;
+    quint16 b = first & 0xffff;
+    for (int position = 0; position + 64 < data.size(); position++) {
+        uchar out = raw[position];
+        uchar in = raw[position + 64];
+        a += in - out;
+        b += a - (out << 6);
+        QCOMPARE((static_cast<quint32>(a) << 16) | b,
+            DeltaControl::weakSum(raw + position + 1, 64));
+    }
+}
+
+void
+TestDeltaControl::testMatchMissingSeed() {
+    DeltaControl delta;
+    QVERIFY(delta.parse(control(target(1000), 64)));
+
+    auto segments = delta.match(testDirectory() + QDir::separator()
+        + "missing");
+    QCOMPARE(segments.count(), 1);
+    QVERIFY(segments[0].isRemote());
+    QCOMPARE(segments[0].offset, 0LL);
+    QCOMPARE(segments[0].length, 1000LL);
+}
+
+void
+TestDeltaControl::testMatchIdenticalSeed() {
+    auto data = target(1000);
+    DeltaControl delta;
+    QVERIFY(delta.parse(control(data, 64)));
+
+    auto segments = delta.match(writeSeed(data));
+    QCOMPARE(segments.count(), 1);
+    QVERIFY(!segments[0].isRemote());
+    QCOMPARE(segments[0].seedOffset, 0LL);
+    QCOMPARE(segments[0].length, 1000LL);
+}
+
+void
+TestDeltaControl::testMatchShiftedSeed() {
+    auto data = target(1024);
+    DeltaControl delta;
+    QVERIFY(delta.parse(control(data, 64)));
+
+    // data was inserted at the start of the seed
+    auto segments = delta.match(writeSeed("prefix" + data));
+    QCOMPARE(segments.count(), 1);
+    QVERIFY(!segments[0].isRemote());
+    QCOMPARE(segments[0].seedOffset, 6LL);
+    QCOMPARE(segments[0].length, 1024LL);
+}
+
+void
+TestDeltaControl::testMatchModifiedBlock() {
+    auto data = target(1000);
+    DeltaControl delta;
+    QVERIFY(delta.parse(control(data, 64)));
+
+    auto seed = data;
+    seed[200] = ~seed[200];
+    auto segments = delta.match(writeSeed(seed));
+
+    // the block with the modified byte is the only one to download
+    QCOMPARE(segments.count(), 3);
+    QVERIFY(!segments[0].isRemote());
+    QCOMPARE(segments[0].offset, 0LL);
+    QCOMPARE(segments[0].length, 192LL);
+    QVERIFY(segments[1].isRemote());
+    QCOMPARE(segments[1].offset, 192LL);
+    QCOMPARE(segments[1].length, 64LL);
+    QVERIFY(!segments[2].isRemote());
+    QCOMPARE(segments[2].offset, 256LL);
+    QCOMPARE(segments[2].seedOffset, 256LL);
+    QCOMPARE(segments[2].length, 744LL);
+}
+
+void
+TestDeltaControl::testMatchSequentialBlocks() {
+    auto data = target(1024);
+    DeltaControl delta;
+    QVERIFY(delta.parse(control(data, 64, 2, 2, 4)));
+
+    auto segments = delta.match(writeSeed(data));
+    QCOMPARE(segments.count(), 1);
+    QVERIFY(!segments[0].isRemote());
+    QCOMPARE(segments[0].length, 1024LL);
+}
+
+QTEST_MAIN(TestDeltaControl)
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_DELTA_CONTROL_H
+#define TEST_DELTA_CONTROL_H
+
+#include <QObject>
+#include <ubuntu/downloads/delta_control.h>
+
+#include "base_testcase.h"
+
+using namespace Ubuntu::DownloadManager::Daemon;
+using namespace Ubuntu::Transfers::Tests;
+
+class TestDeltaControl : public BaseTestCase {
+    Q_OBJECT
+
+ public:
+    explicit TestDeltaControl(QObject *parent = 0)
+        : BaseTestCase("TestDeltaControl", parent) {}
+
+ private slots:  // NOLINT(whitespace/indent)
+
+    void testParse();
+    void testParseNotZsync();
+    void testParseCompressed();
+    void testParseInvalidBlockSize_data();
+    void testParseInvalidBlockSize();
+    void testParseTruncated();
+    void testRollingWeakSum();
+    void testMatchMissingSeed();
+    void testMatchIdenticalSeed();
+    void testMatchShiftedSeed();
+    void testMatchModifiedBlock();
+    void testMatchSequentialBlocks();
+
+ private:
+    QByteArray target(int size);
+    QByteArray control(const QByteArray& data, int blockSize,
+                       int seqMatches = 1, int weakBytes = 4,
+                       int strongBytes = 16);
+    QString writeSeed(const QByteArray& data);
+};
+
+#endif  // TEST_DELTA_CONTROL_H
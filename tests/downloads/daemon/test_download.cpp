@@ -16,12 +16,20 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QNetworkRequest>
 #include <QSslError>
 #include <ubuntu/download_manager/metatypes.h>
 #include <ubuntu/transfers/metadata.h>
 #include <ubuntu/transfers/system/hash_algorithm.h>
+#include <ubuntu/transfers/system/metrics.h>
+#include <ubuntu/transfers/system/timeline.h>
 #include <ubuntu/transfers/system/uuid_utils.h>
 #include <network_reply.h>
 #include "filename_mutex.h"
@@ -34,6 +42,10 @@ using ::testing::Mock;
 using ::testing::AnyNumber;
 using ::testing::Return;
 using ::testing::AnyOf;
+using ::testing::DoAll;
+using ::testing::InvokeWithoutArgs;
+using ::testing::SaveArg;
+using ::testing::SetArgReferee;
 
 using namespace Ubuntu::Transfers::Tests;
 using namespace Ubuntu::Transfers::System;
@@ -60,6 +72,19 @@ TestDownload::init() {
     FileManager::setInstance(_fileManager);
     _cryptoFactory = new MockCryptographicHashFactory();
     CryptographicHashFactory::setInstance(_cryptoFactory);
+    // retries and stalls are tested on their own, the rest of the tests
+    // expect the errors to be reported right away
+    _retryPolicy = new RetryPolicy();
+    _retryPolicy->setMaxAttempts(0);
+    _retryPolicy->setStallTimeout(0);
+    RetryPolicy::setInstance(_retryPolicy);
+    // most of the tests use the same url, do not let them share transfers
+    _sharedDownloads = new SharedDownloads();
+    _sharedDownloads->setEnabled(false);
+    SharedDownloads::setInstance(_sharedDownloads);
+    // the cache is disabled unless a test says otherwise
+    _contentCache = new MockContentCache();
+    ContentCache::setInstance(_contentCache);
 }
 
 void
@@ -69,6 +94,7 @@ TestDownload::verifyMocks() {
     QVERIFY(Mock::VerifyAndClearExpectations(_processFactory));
     QVERIFY(Mock::VerifyAndClearExpectations(_fileManager));
     QVERIFY(Mock::VerifyAndClearExpectations(_cryptoFactory));
+    QVERIFY(Mock::VerifyAndClearExpectations(_contentCache));
 }
 
 void
@@ -81,6 +107,11 @@ TestDownload::cleanup() {
     FileManager::deleteInstance();
     FileNameMutex::deleteInstance();
     CryptographicHashFactory::deleteInstance();
+    RetryPolicy::deleteInstance();
+    SharedDownloads::deleteInstance();
+    ContentCache::deleteInstance();
+    Timeline::setEnabled(false);
+    Metrics::deleteInstance();
 }
 
 void
@@ -435,6 +466,72 @@ TestDownload::testProgressNotKnownSize() {
     verifyMocks();
 }
 
+void
+TestDownload::testDownloadedBytesMetrics() {
+    QByteArray fileData(200, 'm');
+    auto file = new MockFile("test");
+    auto reply = new MockNetworkReply();
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*_networkSession, sessionType())
+        .WillRepeatedly(Return(QNetworkConfiguration::BearerWLAN));
+
+    EXPECT_CALL(*_reqFactory, get(_))
+        .Times(1)
+        .WillOnce(Return(reply));
+
+    EXPECT_CALL(*reply, readAll())
+        .Times(1)
+        .WillOnce(Return(fileData));
+
+    EXPECT_CALL(*reply, setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file));
+
+    EXPECT_CALL(*file, open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file, write(fileData))
+        .Times(1)
+        .WillOnce(Return(fileData.size()));
+
+    EXPECT_CALL(*file, flush())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*file, size())
+        .WillRepeatedly(Return(fileData.size()));
+
+    EXPECT_CALL(*file, close())
+        .Times(1);
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    SignalBarrier spy(download,
+        SIGNAL(progress(qulonglong, qulonglong)));
+
+    download->start();  // change state
+    download->startTransfer();
+
+    emit reply->downloadProgress(fileData.size(), -1);
+    QVERIFY(spy.ensureSignalEmitted());
+
+    MetricLabels labels {{"app", _appId}, {"bearer", "wlan"}};
+    QCOMPARE(Metrics::instance()->counter("udm_downloaded_bytes_total",
+        labels), static_cast<qulonglong>(fileData.size()));
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file));
+    QVERIFY(Mock::VerifyAndClearExpectations(reply));
+    verifyMocks();
+}
+
 void
 TestDownload::testTotalSize() {
     qulonglong received = 30ULL;
@@ -545,6 +642,19 @@ TestDownload::testSetThrottleNoReply() {
     verifyMocks();
 }
 
+void
+TestDownload::testWaitingForSpaceStateInt() {
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers));
+    download->setState(Download::WAITING_FOR_SPACE);
+    QCOMPARE(download->state(), Download::WAITING_FOR_SPACE);
+    QCOMPARE(download->stateInt(), static_cast<int>(Download::START));
+    verifyMocks();
+}
+
 void
 TestDownload::testSetThrottle_data() {
     QTest::addColumn<uint>("speed");
@@ -1351,20 +1461,14 @@ TestDownload::testOnSuccessHashError() {
         .Times(1)
         .WillOnce(Return(true));
 
-    EXPECT_CALL(*file.data(), reset())
-        .Times(1);
-
     EXPECT_CALL(*file.data(), remove())
         .Times(1)
         .WillOnce(Return(true));
 
-    EXPECT_CALL(*file.data(), device())
-        .Times(1)
-        .WillOnce(Return(nullptr));
-
+    // the data is flushed again before the worker hashes the file
     EXPECT_CALL(*file, flush())
-        .Times(1)
-        .WillOnce(Return(true));
+        .Times(2)
+        .WillRepeatedly(Return(true));
 
     EXPECT_CALL(*_cryptoFactory, createCryptographicHash(_, _))
         .Times(1)
@@ -1447,12 +1551,10 @@ TestDownload::testOnSuccessHash() {
         .Times(1)
         .WillOnce(Return(true));
 
-    EXPECT_CALL(*file, reset())
-        .Times(1);
-
+    // the data is flushed again before the worker hashes the file
     EXPECT_CALL(*file, flush())
-        .Times(1)
-        .WillOnce(Return(true));
+        .Times(2)
+        .WillRepeatedly(Return(true));
 
     EXPECT_CALL(*file, remove())
         .Times(0);
@@ -1460,10 +1562,6 @@ TestDownload::testOnSuccessHash() {
     EXPECT_CALL(*file, close())
         .Times(1);
 
-    EXPECT_CALL(*file, device())
-        .Times(1)
-        .WillOnce(Return(nullptr));
-
     EXPECT_CALL(*_cryptoFactory, createCryptographicHash(_, _))
         .Times(1)
         .WillOnce(Return(hash));
@@ -3235,12 +3333,10 @@ TestDownload::testProcessingJustOnce() {
         .Times(1)
         .WillOnce(Return(true));
 
-    EXPECT_CALL(*file, reset())
-        .Times(1);
-
+    // the data is flushed again before the worker hashes the file
     EXPECT_CALL(*file, flush())
-        .Times(1)
-        .WillOnce(Return(true));
+        .Times(2)
+        .WillRepeatedly(Return(true));
 
     EXPECT_CALL(*file, remove())
         .Times(0);
@@ -3248,10 +3344,6 @@ TestDownload::testProcessingJustOnce() {
     EXPECT_CALL(*file, close())
         .Times(1);
 
-    EXPECT_CALL(*file, device())
-        .Times(1)
-        .WillOnce(Return(nullptr));
-
     EXPECT_CALL(*_cryptoFactory, createCryptographicHash(_, _))
         .Times(1)
         .WillOnce(Return(hash));
@@ -3462,6 +3554,150 @@ TestDownload::testFileSystemErrorPause() {
     verifyMocks();
 }
 
+void
+TestDownload::testPreallocateExpectedSize() {
+    qint64 received = 30;
+    qint64 total = 200;
+    qint64 alreadyStored = 100;  // data from a previous range request
+    QScopedPointer<MockFile> file(new MockFile("test"));
+    QScopedPointer<MockNetworkReply> reply(new MockNetworkReply());
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    // set expectations to get the request and the reply correctly
+
+    EXPECT_CALL(*_reqFactory, get(_))
+        .Times(1)
+        .WillOnce(Return(reply.data()));
+
+    EXPECT_CALL(*reply.data(), readAll())
+        .Times(2)
+        .WillRepeatedly(Return(QByteArray()));
+
+    EXPECT_CALL(*reply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    // file system expectations
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file.data()));
+
+    EXPECT_CALL(*file.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), write(_))
+        .Times(2)
+        .WillRepeatedly(Return(0));
+
+    EXPECT_CALL(*file.data(), size())
+        .Times(2)
+        .WillRepeatedly(Return(alreadyStored + received));
+
+    // the space is reserved just once, for the complete file
+    EXPECT_CALL(*file.data(), allocate(alreadyStored + total))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), close())
+        .Times(1);
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    SignalBarrier spy(download,
+        SIGNAL(progress(qulonglong, qulonglong)));
+
+    download->start();  // change state
+    download->startTransfer();
+
+    emit reply->downloadProgress(received, total);
+    emit reply->downloadProgress(received, total);
+
+    QVERIFY(spy.ensureSignalEmitted());
+    QCOMPARE(spy.count(), 2);
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(reply.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testPreallocateNoSpace() {
+    QScopedPointer<MockFile> file(new MockFile("test"));
+    QScopedPointer<MockNetworkReply> reply(new MockNetworkReply());
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    // set expectations to get the request and the reply correctly
+
+    EXPECT_CALL(*_reqFactory, get(_))
+        .Times(1)
+        .WillOnce(Return(reply.data()));
+
+    EXPECT_CALL(*reply.data(), readAll())
+        .Times(1)
+        .WillOnce(Return(QByteArray()));
+
+    EXPECT_CALL(*reply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    // file system expectations
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file.data()));
+
+    EXPECT_CALL(*file.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), write(_))
+        .Times(1)
+        .WillOnce(Return(0));
+
+    EXPECT_CALL(*file.data(), size())
+        .Times(1)
+        .WillOnce(Return(0));
+
+    EXPECT_CALL(*file.data(), allocate(_))
+        .Times(1)
+        .WillOnce(Return(false));
+
+    EXPECT_CALL(*file.data(), remove())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    SignalBarrier spy(download, SIGNAL(error(QString)));
+    SignalBarrier progressSpy(download,
+        SIGNAL(progress(qulonglong, qulonglong)));
+
+    download->start();
+    download->startTransfer();
+
+    reply->downloadProgress(0, 13);
+
+    // the error is raised before any progress is reported
+    QVERIFY(spy.ensureSignalEmitted());
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(progressSpy.count(), 0);
+    QCOMPARE(download->state(), Download::ERROR);
+
+    auto arguments = spy.takeFirst();
+    QCOMPARE(arguments.at(0).toString(),
+        QString("FILE SYSTEM ERROR: %1").arg(QFile::ResourceError));
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(reply.data()));
+    verifyMocks();
+}
+
 void
 TestDownload::testRedirectCycle() {
     QUrl redirectUrl("http://one.ubuntu.com");
@@ -4239,4 +4475,1564 @@ TestDownload::testDataUriPostProcessing() {
     verifyMocks();
 }
 
+void
+TestDownload::testRetryTransientError() {
+    QScopedPointer<MockFile> file(new MockFile("test"));
+    // released by the download once it gives up on the connection
+    auto firstReply = new MockNetworkReply();
+    auto secondReply = new MockNetworkReply();
+    QByteArray data(50, 'a');
+    qint64 size = 50;
+
+    _retryPolicy->setMaxAttempts(1);
+    _retryPolicy->setBaseDelay(0);
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    // the retry resumes from the data that was already received
+    QPair<QString, QString> rangeHeader("Range", "bytes=50-");
+    EXPECT_CALL(*_reqFactory, get(RequestDoesNotHaveHeader(QString("Range"))))
+        .Times(1)
+        .WillOnce(Return(firstReply));
+
+    EXPECT_CALL(*_reqFactory, get(RequestHasHeader(rangeHeader)))
+        .Times(1)
+        .WillOnce(Return(secondReply));
+
+    EXPECT_CALL(*firstReply, setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*secondReply, setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*firstReply, attribute(_))
+        .Times(1)
+        .WillOnce(Return(QVariant()));  // not an http error
+
+    EXPECT_CALL(*firstReply, readAll())
+        .Times(1)
+        .WillOnce(Return(data));
+
+    // the error is never reported to the client
+    EXPECT_CALL(*firstReply, errorString())
+        .Times(0);
+
+    // file system expectations, the partial data is kept
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file.data()));
+
+    EXPECT_CALL(*file.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), write(data))
+        .Times(1)
+        .WillOnce(Return(data.size()));
+
+    EXPECT_CALL(*file.data(), flush())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), size())
+        .Times(1)
+        .WillOnce(Return(size));
+
+    EXPECT_CALL(*file.data(), remove())
+        .Times(0);
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+    SignalBarrier resumedSpy(download, SIGNAL(resumed(bool)));
+    QSignalSpy errorSpy(download, SIGNAL(error(QString)));
+
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+
+    firstReply->error(QNetworkReply::RemoteHostClosedError);
+    QVERIFY(resumedSpy.ensureSignalEmitted());
+    QCOMPARE(errorSpy.count(), 0);
+    QCOMPARE(download->retries(), 1u);
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testRetryGivesUp() {
+    QScopedPointer<MockFile> file(new MockFile("test"));
+    QScopedPointer<MockNetworkReply> reply(new MockNetworkReply());
+
+    // retries are enabled but a permanent error is reported right away
+    _retryPolicy->setMaxAttempts(3);
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*_reqFactory, get(_))
+        .Times(1)
+        .WillOnce(Return(reply.data()));
+
+    EXPECT_CALL(*reply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*reply.data(), attribute(_))
+        .Times(1)
+        .WillOnce(Return(QVariant()));  // invalid variant
+
+    EXPECT_CALL(*reply.data(), errorString())
+        .Times(1)
+        .WillOnce(Return(QString("error")));
+
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file.data()));
+
+    EXPECT_CALL(*file.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), remove())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    SignalBarrier errorSpy(download, SIGNAL(error(QString)));
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+
+    reply->error(QNetworkReply::HostNotFoundError);
+    QVERIFY(errorSpy.ensureSignalEmitted());
+    QCOMPARE(download->retries(), 0u);
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(reply.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testRetryDropsErrorBody() {
+    QScopedPointer<MockFile> file(new MockFile("test"));
+    // released by the download once it gives up on the connection
+    auto firstReply = new MockNetworkReply();
+    QScopedPointer<MockNetworkReply> secondReply(new MockNetworkReply());
+    QByteArray body("<html>Service Unavailable</html>");
+
+    _retryPolicy->setMaxAttempts(1);
+    _retryPolicy->setBaseDelay(0);
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    // nothing was stored so the retry starts from the beginning
+    QPair<QString, QString> rangeHeader("Range", "bytes=0-");
+    EXPECT_CALL(*_reqFactory, get(RequestDoesNotHaveHeader(QString("Range"))))
+        .Times(1)
+        .WillOnce(Return(firstReply));
+
+    EXPECT_CALL(*_reqFactory, get(RequestHasHeader(rangeHeader)))
+        .Times(1)
+        .WillOnce(Return(secondReply.data()));
+
+    EXPECT_CALL(*firstReply, setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*secondReply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    // the status is checked with the headers and again with the error
+    EXPECT_CALL(*firstReply,
+            attribute(QNetworkRequest::HttpStatusCodeAttribute))
+        .Times(2)
+        .WillRepeatedly(Return(QVariant(503)));
+
+    EXPECT_CALL(*firstReply, rawHeader(_))
+        .Times(1)
+        .WillOnce(Return(QByteArray()));
+
+    EXPECT_CALL(*firstReply, readAll())
+        .Times(1)
+        .WillOnce(Return(body));
+
+    // the body of the error does not reset the attempts
+    EXPECT_CALL(*secondReply.data(),
+            attribute(QNetworkRequest::HttpStatusCodeAttribute))
+        .Times(2)
+        .WillRepeatedly(Return(QVariant(503)));
+
+    EXPECT_CALL(*secondReply.data(),
+            attribute(QNetworkRequest::HttpReasonPhraseAttribute))
+        .Times(1)
+        .WillOnce(Return(QVariant(QString("Service Unavailable"))));
+
+    EXPECT_CALL(*secondReply.data(), readAll())
+        .Times(1)
+        .WillOnce(Return(body));
+
+    // file system expectations, the body never reaches the file
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file.data()));
+
+    EXPECT_CALL(*file.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), write(_))
+        .Times(0);
+
+    EXPECT_CALL(*file.data(), truncate(0))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), flush())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), size())
+        .Times(1)
+        .WillOnce(Return(0));
+
+    EXPECT_CALL(*file.data(), remove())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+    SignalBarrier resumedSpy(download, SIGNAL(resumed(bool)));
+    SignalBarrier errorSpy(download, SIGNAL(error(QString)));
+
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+
+    firstReply->metaDataChanged();
+    firstReply->downloadProgress(body.size(), body.size());
+    firstReply->error(QNetworkReply::ServiceUnavailableError);
+    QVERIFY(resumedSpy.ensureSignalEmitted());
+    QCOMPARE(download->retries(), 1u);
+
+    secondReply->metaDataChanged();
+    secondReply->downloadProgress(body.size(), body.size());
+    secondReply->error(QNetworkReply::ServiceUnavailableError);
+    QVERIFY(errorSpy.ensureSignalEmitted());
+    QCOMPARE(download->retries(), 1u);
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(secondReply.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testResumeRangeIgnored() {
+    QScopedPointer<MockFile> file(new MockFile("test"));
+    // released by the download once it gives up on the connection
+    auto firstReply = new MockNetworkReply();
+    QScopedPointer<MockNetworkReply> secondReply(new MockNetworkReply());
+    QByteArray partial(50, 'a');
+    QByteArray data(100, 'a');
+
+    _retryPolicy->setMaxAttempts(1);
+    _retryPolicy->setBaseDelay(0);
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    QPair<QString, QString> rangeHeader("Range", "bytes=50-");
+    EXPECT_CALL(*_reqFactory, get(RequestDoesNotHaveHeader(QString("Range"))))
+        .Times(1)
+        .WillOnce(Return(firstReply));
+
+    EXPECT_CALL(*_reqFactory, get(RequestHasHeader(rangeHeader)))
+        .Times(1)
+        .WillOnce(Return(secondReply.data()));
+
+    EXPECT_CALL(*firstReply, setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*secondReply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*firstReply, attribute(_))
+        .Times(1)
+        .WillOnce(Return(QVariant()));  // not an http error
+
+    EXPECT_CALL(*firstReply, readAll())
+        .Times(1)
+        .WillOnce(Return(partial));
+
+    // the server sends the whole data instead of the range
+    EXPECT_CALL(*secondReply.data(),
+            attribute(QNetworkRequest::HttpStatusCodeAttribute))
+        .Times(1)
+        .WillOnce(Return(QVariant(200)));
+
+    EXPECT_CALL(*secondReply.data(), readAll())
+        .Times(1)
+        .WillOnce(Return(data));
+
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file.data()));
+
+    EXPECT_CALL(*file.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), write(partial))
+        .Times(1)
+        .WillOnce(Return(partial.size()));
+
+    // the partial data is dropped before the new data is written
+    EXPECT_CALL(*file.data(), truncate(0))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), write(data))
+        .Times(1)
+        .WillOnce(Return(data.size()));
+
+    EXPECT_CALL(*file.data(), flush())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), size())
+        .Times(2)
+        .WillOnce(Return(partial.size()))
+        .WillOnce(Return(data.size()));
+
+    EXPECT_CALL(*file.data(), remove())
+        .Times(0);
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+    SignalBarrier resumedSpy(download, SIGNAL(resumed(bool)));
+    QSignalSpy progressSpy(download,
+        SIGNAL(progress(qulonglong, qulonglong)));
+    QSignalSpy errorSpy(download, SIGNAL(error(QString)));
+
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+
+    firstReply->error(QNetworkReply::RemoteHostClosedError);
+    QVERIFY(resumedSpy.ensureSignalEmitted());
+
+    secondReply->metaDataChanged();
+    secondReply->downloadProgress(data.size(), data.size());
+    QCOMPARE(errorSpy.count(), 0);
+    QCOMPARE(progressSpy.count(), 1);
+    QCOMPARE(progressSpy.takeFirst().at(0).toULongLong(),
+        static_cast<qulonglong>(data.size()));
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(secondReply.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testResumeUnexpectedRange() {
+    QScopedPointer<MockFile> file(new MockFile("test"));
+    // released by the download once it gives up on the connection
+    auto firstReply = new MockNetworkReply();
+    auto secondReply = new MockNetworkReply();
+    QScopedPointer<MockNetworkReply> thirdReply(new MockNetworkReply());
+    QByteArray partial(50, 'a');
+
+    _retryPolicy->setMaxAttempts(1);
+    _retryPolicy->setBaseDelay(0);
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    // the range that was sent does not continue the file, all the data
+    // is requested again
+    QPair<QString, QString> rangeHeader("Range", "bytes=50-");
+    QPair<QString, QString> allHeader("Range", "bytes=0-");
+    EXPECT_CALL(*_reqFactory, get(RequestDoesNotHaveHeader(QString("Range"))))
+        .Times(1)
+        .WillOnce(Return(firstReply));
+
+    EXPECT_CALL(*_reqFactory, get(RequestHasHeader(rangeHeader)))
+        .Times(1)
+        .WillOnce(Return(secondReply));
+
+    EXPECT_CALL(*_reqFactory, get(RequestHasHeader(allHeader)))
+        .Times(1)
+        .WillOnce(Return(thirdReply.data()));
+
+    EXPECT_CALL(*firstReply, setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*secondReply, setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*thirdReply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*firstReply, attribute(_))
+        .Times(1)
+        .WillOnce(Return(QVariant()));  // not an http error
+
+    EXPECT_CALL(*firstReply, readAll())
+        .Times(1)
+        .WillOnce(Return(partial));
+
+    EXPECT_CALL(*secondReply,
+            attribute(QNetworkRequest::HttpStatusCodeAttribute))
+        .Times(1)
+        .WillOnce(Return(QVariant(206)));
+
+    EXPECT_CALL(*secondReply, rawHeader(QByteArray("Content-Range")))
+        .Times(1)
+        .WillOnce(Return(QByteArray("bytes 40-99/100")));
+
+    EXPECT_CALL(*secondReply, abort())
+        .Times(1);
+
+    EXPECT_CALL(*secondReply, readAll())
+        .Times(0);
+
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file.data()));
+
+    EXPECT_CALL(*file.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), write(partial))
+        .Times(1)
+        .WillOnce(Return(partial.size()));
+
+    EXPECT_CALL(*file.data(), truncate(0))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), flush())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), size())
+        .Times(1)
+        .WillOnce(Return(partial.size()));
+
+    EXPECT_CALL(*file.data(), remove())
+        .Times(0);
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+    SignalBarrier resumedSpy(download, SIGNAL(resumed(bool)));
+    QSignalSpy errorSpy(download, SIGNAL(error(QString)));
+
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+
+    firstReply->error(QNetworkReply::RemoteHostClosedError);
+    QVERIFY(resumedSpy.ensureSignalEmitted());
+
+    secondReply->metaDataChanged();
+    QCOMPARE(errorSpy.count(), 0);
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(thirdReply.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testFailOverToMirror() {
+    QScopedPointer<MockFile> file(new MockFile("test"));
+    QScopedPointer<MockNetworkReply> firstReply(new MockNetworkReply());
+    auto secondReply = new MockNetworkReply();
+    QByteArray data(50, 'a');
+    qint64 size = 50;
+    QUrl mirror("http://mirror.ubuntu.com/data.txt");
+    Ubuntu::Transfers::Metadata metadata;
+    metadata.setMirrors(QStringList() << mirror.toString());
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    // the mirror sends the data we are missing
+    QPair<QString, QString> rangeHeader("Range", "bytes=50-");
+    EXPECT_CALL(*_reqFactory, get(RequestDoesNotHaveHeader(QString("Range"))))
+        .Times(1)
+        .WillOnce(Return(firstReply.data()));
+
+    EXPECT_CALL(*_reqFactory, get(RequestHasHeader(rangeHeader)))
+        .Times(1)
+        .WillOnce(Return(secondReply));
+
+    EXPECT_CALL(*firstReply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*secondReply, setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*firstReply.data(), attribute(_))
+        .Times(1)
+        .WillOnce(Return(QVariant()));  // not an http error
+
+    EXPECT_CALL(*firstReply.data(), readAll())
+        .Times(1)
+        .WillOnce(Return(data));
+
+    EXPECT_CALL(*firstReply.data(), errorString())
+        .Times(0);
+
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file.data()));
+
+    EXPECT_CALL(*file.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), write(data))
+        .Times(1)
+        .WillOnce(Return(data.size()));
+
+    EXPECT_CALL(*file.data(), flush())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), size())
+        .Times(1)
+        .WillOnce(Return(size));
+
+    EXPECT_CALL(*file.data(), remove())
+        .Times(0);
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, metadata, _headers);
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+    QSignalSpy errorSpy(download, SIGNAL(error(QString)));
+
+    QVERIFY(download->isValid());
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+
+    firstReply->error(QNetworkReply::HostNotFoundError);
+    QCOMPARE(errorSpy.count(), 0);
+    QCOMPARE(download->url(), mirror);
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(firstReply.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testFailOverNoMirrorsLeft() {
+    QScopedPointer<MockFile> file(new MockFile("test"));
+    QScopedPointer<MockNetworkReply> firstReply(new MockNetworkReply());
+    QScopedPointer<MockNetworkReply> secondReply(new MockNetworkReply());
+    QUrl mirror("http://mirror.ubuntu.com/data.txt");
+    Ubuntu::Transfers::Metadata metadata;
+    metadata.setMirrors(QStringList() << mirror.toString());
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*_reqFactory, get(_))
+        .Times(2)
+        .WillOnce(Return(firstReply.data()))
+        .WillOnce(Return(secondReply.data()));
+
+    EXPECT_CALL(*firstReply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*secondReply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    // both servers do not have the data
+    EXPECT_CALL(*firstReply.data(), attribute(_))
+        .Times(1)
+        .WillOnce(Return(QVariant(404)));
+
+    EXPECT_CALL(*firstReply.data(), readAll())
+        .Times(0);
+
+    EXPECT_CALL(*secondReply.data(), attribute(_))
+        .Times(2)
+        .WillOnce(Return(QVariant(404)))
+        .WillOnce(Return(QVariant(QString("Not Found"))));
+
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file.data()));
+
+    EXPECT_CALL(*file.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), flush())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), size())
+        .Times(1)
+        .WillOnce(Return(0));
+
+    EXPECT_CALL(*file.data(), remove())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, metadata, _headers);
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+    SignalBarrier errorSpy(download, SIGNAL(error(QString)));
+    QSignalSpy httpErrorSpy(download, SIGNAL(httpError(HttpErrorStruct)));
+
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+
+    firstReply->error(QNetworkReply::ContentNotFoundError);
+    secondReply->error(QNetworkReply::ContentNotFoundError);
+    QVERIFY(errorSpy.ensureSignalEmitted());
+    QCOMPARE(httpErrorSpy.count(), 1);
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(firstReply.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(secondReply.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testFailOverDropsErrorBody() {
+    QScopedPointer<MockFile> file(new MockFile("test"));
+    QScopedPointer<MockNetworkReply> firstReply(new MockNetworkReply());
+    auto secondReply = new MockNetworkReply();
+    QByteArray body("<html>Internal Server Error</html>");
+    QUrl mirror("http://mirror.ubuntu.com/data.txt");
+    Ubuntu::Transfers::Metadata metadata;
+    metadata.setMirrors(QStringList() << mirror.toString());
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    // nothing was stored so the mirror is asked for all the data
+    QPair<QString, QString> rangeHeader("Range", "bytes=0-");
+    EXPECT_CALL(*_reqFactory, get(RequestDoesNotHaveHeader(QString("Range"))))
+        .Times(1)
+        .WillOnce(Return(firstReply.data()));
+
+    EXPECT_CALL(*_reqFactory, get(RequestHasHeader(rangeHeader)))
+        .Times(1)
+        .WillOnce(Return(secondReply));
+
+    EXPECT_CALL(*firstReply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*secondReply, setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*firstReply.data(),
+            attribute(QNetworkRequest::HttpStatusCodeAttribute))
+        .Times(2)
+        .WillRepeatedly(Return(QVariant(500)));
+
+    EXPECT_CALL(*firstReply.data(), readAll())
+        .Times(1)
+        .WillOnce(Return(body));
+
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file.data()));
+
+    EXPECT_CALL(*file.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), write(_))
+        .Times(0);
+
+    EXPECT_CALL(*file.data(), truncate(0))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), flush())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), size())
+        .Times(1)
+        .WillOnce(Return(0));
+
+    EXPECT_CALL(*file.data(), remove())
+        .Times(0);
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, metadata, _headers);
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+    QSignalSpy errorSpy(download, SIGNAL(error(QString)));
+
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+
+    firstReply->metaDataChanged();
+    firstReply->downloadProgress(body.size(), body.size());
+    firstReply->error(QNetworkReply::InternalServerError);
+    QCOMPARE(errorSpy.count(), 0);
+    QCOMPARE(download->url(), mirror);
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(firstReply.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testInvalidMirror() {
+    Ubuntu::Transfers::Metadata metadata;
+    metadata.setMirrors(QStringList() << "http://mirror.ubuntu.com/data.txt"
+        << "not a url");
+
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId,
+        _path, _isConfined, _rootPath, _url, metadata, _headers));
+    QVERIFY(!download->isValid());
+    QVERIFY(download->lastError().contains("not a url"));
+}
+
+void
+TestDownload::testStallReconnects() {
+    QScopedPointer<MockFile> file(new MockFile("test"));
+    // released by the download once it gives up on the connection
+    auto firstReply = new MockNetworkReply();
+    auto secondReply = new MockNetworkReply();
+    QByteArray data;  // the connection does not send anything
+
+    _retryPolicy->setStallTimeout(50);
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    // disable the watchdog once we reconnected so that the second
+    // connection is not recycled as well
+    QPair<QString, QString> rangeHeader("Range", "bytes=0-");
+    EXPECT_CALL(*_reqFactory, get(RequestDoesNotHaveHeader(QString("Range"))))
+        .Times(1)
+        .WillOnce(Return(firstReply));
+
+    EXPECT_CALL(*_reqFactory, get(RequestHasHeader(rangeHeader)))
+        .Times(1)
+        .WillOnce(DoAll(
+            InvokeWithoutArgs([this]() {
+                _retryPolicy->setStallTimeout(0);
+            }),
+            Return(secondReply)));
+
+    EXPECT_CALL(*firstReply, setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*secondReply, setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*firstReply, abort())
+        .Times(1);
+
+    EXPECT_CALL(*firstReply, readAll())
+        .Times(1)
+        .WillOnce(Return(data));
+
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file.data()));
+
+    EXPECT_CALL(*file.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), write(data))
+        .Times(1)
+        .WillOnce(Return(0));
+
+    EXPECT_CALL(*file.data(), size())
+        .Times(1)
+        .WillOnce(Return(0));
+
+    EXPECT_CALL(*file.data(), flush())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file.data(), remove())
+        .Times(0);
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+    QSignalSpy errorSpy(download, SIGNAL(error(QString)));
+
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+
+    QTRY_COMPARE(download->stalls(), 1u);
+    QCOMPARE(errorSpy.count(), 0);
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testFollowIdenticalDownload() {
+    QScopedPointer<MockFile> leaderFile(new MockFile("leader"));
+    QScopedPointer<MockFile> followerFile(new MockFile("follower"));
+    QScopedPointer<MockNetworkReply> reply(new MockNetworkReply());
+    QByteArray data(50, 'a');
+
+    _sharedDownloads->setEnabled(true);
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    // a single connection is used by both downloads
+    EXPECT_CALL(*_reqFactory, get(_))
+        .Times(1)
+        .WillOnce(Return(reply.data()));
+
+    EXPECT_CALL(*reply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*reply.data(), readAll())
+        .Times(1)
+        .WillOnce(Return(data));
+
+    // each download has its own file
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(2)
+        .WillOnce(Return(leaderFile.data()))
+        .WillOnce(Return(followerFile.data()));
+
+    EXPECT_CALL(*leaderFile.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*leaderFile.data(), write(data))
+        .Times(1)
+        .WillOnce(Return(data.size()));
+
+    EXPECT_CALL(*leaderFile.data(), size())
+        .Times(1)
+        .WillOnce(Return(data.size()));
+
+    EXPECT_CALL(*followerFile.data(),
+            open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*followerFile.data(), write(_))
+        .Times(0);
+
+    auto leader = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    auto follower = new FileDownload(
+        UuidUtils::getDBusString(QUuid::createUuid()), "OtherApplication",
+        _path + "/follower", true, _rootPath, _url, _metadata, _headers);
+    SignalBarrier followerStartedSpy(follower, SIGNAL(started(bool)));
+    QSignalSpy progressSpy(follower,
+        SIGNAL(progress(qulonglong, qulonglong)));
+
+    leader->start();  // change state
+    leader->startTransfer();
+    follower->start();  // change state
+    follower->startTransfer();
+    QVERIFY(followerStartedSpy.ensureSignalEmitted());
+
+    reply->downloadProgress(data.size(), 100);
+    QCOMPARE(progressSpy.count(), 1);
+    auto arguments = progressSpy.takeFirst();
+    QCOMPARE(arguments.at(0).toULongLong(), 50ULL);
+    QCOMPARE(arguments.at(1).toULongLong(), 100ULL);
+    QCOMPARE(follower->totalSize(), 100ULL);
+
+    delete follower;
+    delete leader;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(leaderFile.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(followerFile.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(reply.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testFollowerTakesOverCanceledLeader() {
+    QScopedPointer<MockFile> leaderFile(new MockFile("leader"));
+    QScopedPointer<MockFile> followerFile(new MockFile("follower"));
+    QScopedPointer<MockNetworkReply> firstReply(new MockNetworkReply());
+    auto secondReply = new MockNetworkReply();
+
+    _sharedDownloads->setEnabled(true);
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    // the follower gets the data on its own once the leader is gone
+    QPair<QString, QString> rangeHeader("Range", "bytes=0-");
+    EXPECT_CALL(*_reqFactory, get(RequestDoesNotHaveHeader(QString("Range"))))
+        .Times(1)
+        .WillOnce(Return(firstReply.data()));
+
+    EXPECT_CALL(*_reqFactory, get(RequestHasHeader(rangeHeader)))
+        .Times(1)
+        .WillOnce(Return(secondReply));
+
+    EXPECT_CALL(*firstReply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*firstReply.data(), abort())
+        .Times(1);
+
+    EXPECT_CALL(*secondReply, setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(2)
+        .WillOnce(Return(leaderFile.data()))
+        .WillOnce(Return(followerFile.data()));
+
+    EXPECT_CALL(*leaderFile.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*leaderFile.data(), remove())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*followerFile.data(),
+            open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*followerFile.data(), size())
+        .Times(1)
+        .WillOnce(Return(0));
+
+    EXPECT_CALL(*followerFile.data(), remove())
+        .Times(0);
+
+    auto leader = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    auto follower = new FileDownload(
+        UuidUtils::getDBusString(QUuid::createUuid()), "OtherApplication",
+        _path + "/follower", true, _rootPath, _url, _metadata, _headers);
+    SignalBarrier canceledSpy(leader, SIGNAL(canceled(bool)));
+    QSignalSpy errorSpy(follower, SIGNAL(error(QString)));
+
+    leader->start();  // change state
+    leader->startTransfer();
+    follower->start();  // change state
+    follower->startTransfer();
+
+    leader->cancel();  // change state
+    leader->cancelTransfer();
+    QVERIFY(canceledSpy.ensureSignalEmitted());
+    QCOMPARE(errorSpy.count(), 0);
+
+    delete follower;
+    delete leader;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(leaderFile.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(followerFile.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(firstReply.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testFollowerCopiesInThePool() {
+    QScopedPointer<MockFile> leaderFile(new MockFile("leader"));
+    QScopedPointer<MockFile> followerFile(new MockFile("follower"));
+    QScopedPointer<MockNetworkReply> reply(new MockNetworkReply());
+    auto copier = new MockFileCopier();
+    FileCopier::setInstance(copier);
+    CopyJob* job = nullptr;
+    auto sharedPath = testDirectory() + QDir::separator() + "shared";
+
+    QFile shared(sharedPath);
+    shared.open(QIODevice::WriteOnly);
+    shared.write(QByteArray(50, 'a'));
+    shared.close();
+
+    _sharedDownloads->setEnabled(true);
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*_reqFactory, get(_))
+        .Times(1)
+        .WillOnce(Return(reply.data()));
+
+    EXPECT_CALL(*reply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(2)
+        .WillOnce(Return(leaderFile.data()))
+        .WillOnce(Return(followerFile.data()));
+
+    EXPECT_CALL(*leaderFile.data(), open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*followerFile.data(),
+            open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    // the data is not copied in the event loop
+    EXPECT_CALL(*followerFile.data(), copyFrom(_))
+        .Times(0);
+
+    EXPECT_CALL(*copier, copy(_))
+        .Times(1)
+        .WillOnce(SaveArg<0>(&job));
+
+    auto leader = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    auto follower = new FileDownload(
+        UuidUtils::getDBusString(QUuid::createUuid()), "OtherApplication",
+        _path + "/follower", true, _rootPath, _url, _metadata, _headers);
+    SignalBarrier followerStartedSpy(follower, SIGNAL(started(bool)));
+    QSignalSpy finishedSpy(follower, SIGNAL(finished(QString)));
+
+    leader->start();  // change state
+    leader->startTransfer();
+    follower->start();  // change state
+    follower->startTransfer();
+    QVERIFY(followerStartedSpy.ensureSignalEmitted());
+
+    // the leader moves its file right after the signal
+    leader->sharedDataReady(sharedPath, "text/plain");
+    QVERIFY(job != nullptr);
+    QVERIFY(QFile::remove(sharedPath));
+    QCOMPARE(finishedSpy.count(), 0);
+
+    // the post processing continues once the worker is done
+    job->finished(true);
+    QCOMPARE(finishedSpy.count(), 1);
+
+    delete follower;
+    delete leader;
+    // released by the follower, the fake never ran it
+    delete job;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(leaderFile.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(followerFile.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(reply.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(copier));
+    FileCopier::deleteInstance();
+    verifyMocks();
+}
+
+void
+TestDownload::testCachedContent() {
+    auto file = new MockFile("test");
+    QByteArray hashData(100, 'f');
+    auto hashString = QString(hashData.toHex());
+    auto hash = new MockCryptographicHash();
+    QByteArray data("data");
+    auto cachedPath = testDirectory() + QDir::separator() + "cached";
+
+    QFile cached(cachedPath);
+    cached.open(QIODevice::WriteOnly);
+    cached.write(data);
+    cached.close();
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*_contentCache, isEnabled())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*_contentCache, findContent(QString("sha256"), hashString))
+        .Times(1)
+        .WillOnce(Return(cachedPath));
+
+    // the data is already in the cache
+    EXPECT_CALL(*_contentCache, insert(_, _, _, _, _, _))
+        .Times(0);
+
+    // the network is not used at all
+    EXPECT_CALL(*_reqFactory, get(_))
+        .Times(0);
+
+    // file system expectations
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file));
+
+    EXPECT_CALL(*file, open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file, copyFrom(cachedPath))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    // the data is flushed before the worker hashes the file
+    EXPECT_CALL(*file, flush())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file, remove())
+        .Times(0);
+
+    EXPECT_CALL(*file, close())
+        .Times(1);
+
+    // the hash of the cached data is checked again
+    EXPECT_CALL(*_cryptoFactory, createCryptographicHash(_, _))
+        .Times(1)
+        .WillOnce(Return(hash));
+
+    EXPECT_CALL(*hash, addData(_))
+        .Times(1);
+
+    EXPECT_CALL(*hash, result())
+        .Times(1)
+        .WillOnce(Return(hashData));
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, hashString, _algo, _metadata,
+        _headers);
+    SignalBarrier spy(download, SIGNAL(finished(QString)));
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+    QVERIFY(spy.ensureSignalEmitted());
+    QCOMPARE(download->state(), Download::UNCOLLECTED);
+    QCOMPARE(download->totalSize(), static_cast<qulonglong>(data.size()));
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(hash));
+    QVERIFY(Mock::VerifyAndClearExpectations(file));
+    verifyMocks();
+}
+
+void
+TestDownload::testCachedResponseNotModified() {
+    auto file = new MockFile("test");
+    QScopedPointer<MockNetworkReply> reply(new MockNetworkReply());
+    QByteArray data("data");
+    QByteArray etag("\"v1\"");
+    auto cachedPath = testDirectory() + QDir::separator() + "cached";
+    QMap<QString, QString> conditionalHeaders;
+    conditionalHeaders["If-None-Match"] = etag;
+
+    QFile cached(cachedPath);
+    cached.open(QIODevice::WriteOnly);
+    cached.write(data);
+    cached.close();
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*_contentCache, isEnabled())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*_contentCache, findResponse(_, _, _))
+        .Times(1)
+        .WillOnce(DoAll(SetArgReferee<1>(etag), Return(cachedPath)));
+
+    // the data is already in the cache
+    EXPECT_CALL(*_contentCache, insert(_, _, _, _, _, _))
+        .Times(0);
+
+    // the request is made conditional with the validators of the cache
+    EXPECT_CALL(*_reqFactory, get(RequestHeadersEq(conditionalHeaders)))
+        .Times(1)
+        .WillOnce(Return(reply.data()));
+
+    EXPECT_CALL(*reply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*reply.data(),
+            attribute(QNetworkRequest::RedirectionTargetAttribute))
+        .Times(1)
+        .WillOnce(Return(QVariant()));
+
+    EXPECT_CALL(*reply.data(),
+            attribute(QNetworkRequest::HttpStatusCodeAttribute))
+        .Times(1)
+        .WillOnce(Return(QVariant(304)));
+
+    EXPECT_CALL(*reply.data(), hasRawHeader(_))
+        .Times(2)
+        .WillRepeatedly(Return(false));
+
+    EXPECT_CALL(*reply.data(), rawHeader(_))
+        .Times(2)
+        .WillRepeatedly(Return(QByteArray()));
+
+    // file system expectations
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file));
+
+    EXPECT_CALL(*file, open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file, flush())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file, copyFrom(cachedPath))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file, remove())
+        .Times(0);
+
+    EXPECT_CALL(*file, close())
+        .Times(1);
+
+    EXPECT_CALL(*_cryptoFactory, createCryptographicHash(_, _))
+        .Times(0);
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    SignalBarrier spy(download, SIGNAL(finished(QString)));
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+
+    emit reply->finished();
+    QVERIFY(spy.ensureSignalEmitted());
+    QCOMPARE(download->state(), Download::UNCOLLECTED);
+    QCOMPARE(download->totalSize(), static_cast<qulonglong>(data.size()));
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file));
+    QVERIFY(Mock::VerifyAndClearExpectations(reply.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testOpenReadDescriptorNotStarted() {
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId,
+        _path, _isConfined, _rootPath, _url, _metadata, _headers));
+
+    // there is no data to read yet
+    auto descriptor = download->openReadDescriptor();
+    QVERIFY(!descriptor.isValid());
+    QCOMPARE(download->contiguousBytes(), 0ULL);
+}
+
+void
+TestDownload::testOpenReadDescriptorFinished() {
+    QByteArray data("data");
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId,
+        _path, _isConfined, _rootPath, _url, _metadata, _headers));
+    download->setState(Download::FINISH);
+
+    QFile finished(download->filePath());
+    QVERIFY(finished.open(QIODevice::WriteOnly));
+    finished.write(data);
+    finished.close();
+
+    auto descriptor = download->openReadDescriptor();
+    QVERIFY(descriptor.isValid());
+
+    // the descriptor is read only
+    QFile read;
+    QVERIFY(read.open(descriptor.fileDescriptor(), QIODevice::ReadOnly));
+    QCOMPARE(read.readAll(), data);
+    QCOMPARE(read.write("more"), -1LL);
+}
+
+void
+TestDownload::testOpenReadDescriptorAfterFinished() {
+    QByteArray data("data");
+    auto file = new MockFile("test");
+    QScopedPointer<MockNetworkReply> reply(new MockNetworkReply());
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*_reqFactory, get(_))
+        .Times(1)
+        .WillOnce(Return(reply.data()));
+
+    EXPECT_CALL(*reply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*reply.data(), attribute(_))
+        .WillRepeatedly(Return(QVariant(200)));
+
+    EXPECT_CALL(*reply.data(), hasRawHeader(_))
+        .WillRepeatedly(Return(false));
+
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file));
+
+    EXPECT_CALL(*file, open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file, flush())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*file, size())
+        .WillRepeatedly(Return(data.size()));
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    SignalBarrier spy(download, SIGNAL(finished(QString)));
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+
+    // the data that the mocked file would have written
+    QFile temp(download->filePath() + ".tmp");
+    QVERIFY(temp.open(QIODevice::WriteOnly));
+    temp.write(data);
+    temp.close();
+
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+
+    emit reply->finished();
+    QVERIFY(spy.ensureSignalEmitted());
+    QCOMPARE(download->state(), Download::UNCOLLECTED);
+    QVERIFY(!QFile::exists(temp.fileName()));
+
+    // the data is read from the path it was moved to
+    auto descriptor = download->openReadDescriptor();
+    QVERIFY(descriptor.isValid());
+    QFile read;
+    QVERIFY(read.open(descriptor.fileDescriptor(), QIODevice::ReadOnly));
+    QCOMPARE(read.readAll(), data);
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file));
+    QVERIFY(Mock::VerifyAndClearExpectations(reply.data()));
+    verifyMocks();
+}
+
+void
+TestDownload::testOutputDescriptorNotRegularFile() {
+    int fds[2];
+    QVERIFY(pipe(fds) == 0);
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId,
+        _path, _isConfined, _rootPath, _url, _metadata, _headers));
+
+    QVERIFY(!download->setOutputDescriptor(fds[1]));
+    QVERIFY(!download->isValid());
+    QVERIFY(!download->hasOutputDescriptor());
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+void
+TestDownload::testOutputDescriptorWriteOnly() {
+    auto path = testDirectory() + QDir::separator() + "output";
+    int fd = ::open(QFile::encodeName(path).constData(),
+        O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+    QVERIFY(fd != -1);
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId,
+        _path, _isConfined, _rootPath, _url, _metadata, _headers));
+
+    // the data could not be read back to verify the hash
+    QVERIFY(!download->setOutputDescriptor(fd));
+    QVERIFY(!download->isValid());
+    ::close(fd);
+}
+
+void
+TestDownload::testOutputDescriptorPostProcessing() {
+    auto path = testDirectory() + QDir::separator() + "output";
+    int fd = ::open(QFile::encodeName(path).constData(),
+        O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    QVERIFY(fd != -1);
+    QVariantMap metadata;
+    metadata[Metadata::EXTRACT_KEY] = true;
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId,
+        _path, _isConfined, _rootPath, _url, metadata, _headers));
+
+    QVERIFY(!download->setOutputDescriptor(fd));
+    QVERIFY(!download->isValid());
+    ::close(fd);
+}
+
+void
+TestDownload::testOutputDescriptor() {
+    auto path = testDirectory() + QDir::separator() + "output";
+    QFile output(path);
+    QVERIFY(output.open(QIODevice::ReadWrite));
+    output.write("old data");
+    output.flush();
+
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId,
+        _path, _isConfined, _rootPath, _url, _metadata, _headers));
+    QVERIFY(download->setOutputDescriptor(output.handle()));
+    QVERIFY(download->isValid());
+    QVERIFY(download->hasOutputDescriptor());
+
+    // no file of the daemon is used and the old data is dropped
+    QVERIFY(download->filePath().isEmpty());
+    QCOMPARE(QFileInfo(path).size(), 0LL);
+    QVERIFY(download->storagePath().startsWith("/proc/self/fd/"));
+}
+
+void
+TestDownload::testInvalidByteRanges() {
+    QVariantMap metadata;
+    metadata[Metadata::BYTE_RANGES_KEY] = QStringList() << "-500";
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId,
+        _path, _isConfined, _rootPath, _url, metadata, _headers));
+    QVERIFY(!download->isValid());
+}
+
+void
+TestDownload::testByteRangesWithHash() {
+    // the hash is the one of the whole file
+    QVariantMap metadata;
+    metadata[Metadata::BYTE_RANGES_KEY] = QStringList() << "0-99";
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId,
+        _path, _isConfined, _rootPath, _url, "hash", "md5", metadata,
+        _headers));
+    QVERIFY(!download->isValid());
+}
+
+void
+TestDownload::testInvalidDurability() {
+    QVariantMap metadata;
+    metadata[Metadata::DURABILITY_KEY] = "always";
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId,
+        _path, _isConfined, _rootPath, _url, metadata, _headers));
+    QVERIFY(!download->isValid());
+}
+
+void
+TestDownload::testPeriodicDurability() {
+    QVariantMap metadata;
+    metadata[Metadata::DURABILITY_KEY] = "periodic";
+    metadata[Metadata::DURABILITY_INTERVAL_KEY] = 1024;
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId,
+        _path, _isConfined, _rootPath, _url, metadata, _headers));
+    QVERIFY(download->isValid());
+}
+
+void
+TestDownload::testTimelineDisabled() {
+    QScopedPointer<FileDownload> download(new FileDownload(_id, _appId,
+        _path, _isConfined, _rootPath, _url, _metadata, _headers));
+    QVERIFY(download->timeline().isEmpty());
+    QVERIFY(download->chromeTrace().isEmpty());
+}
+
+void
+TestDownload::testTimeline() {
+    Timeline::setEnabled(true);
+    auto file = new MockFile("test");
+    QScopedPointer<MockNetworkReply> reply(new MockNetworkReply());
+
+    EXPECT_CALL(*_networkSession, isOnline())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*_reqFactory, get(_))
+        .Times(1)
+        .WillOnce(Return(reply.data()));
+
+    EXPECT_CALL(*reply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*reply.data(), attribute(_))
+        .WillRepeatedly(Return(QVariant(200)));
+
+    EXPECT_CALL(*reply.data(), hasRawHeader(_))
+        .WillRepeatedly(Return(false));
+
+    EXPECT_CALL(*_fileManager, createFile(_))
+        .Times(1)
+        .WillOnce(Return(file));
+
+    EXPECT_CALL(*file, open(QIODevice::ReadWrite | QFile::Append))
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*file, flush())
+        .WillRepeatedly(Return(true));
+
+    EXPECT_CALL(*file, size())
+        .WillRepeatedly(Return(0));
+
+    auto download = new FileDownload(_id, _appId, _path,
+        _isConfined, _rootPath, _url, _metadata, _headers);
+    SignalBarrier spy(download, SIGNAL(finished(QString)));
+    SignalBarrier startedSpy(download, SIGNAL(started(bool)));
+
+    download->start();  // change state
+    download->startTransfer();
+    QVERIFY(startedSpy.ensureSignalEmitted());
+
+    emit reply->encrypted();
+    emit reply->metaDataChanged();
+    emit reply->finished();
+    QVERIFY(spy.ensureSignalEmitted());
+
+    QStringList names;
+    foreach(const QVariant& span, download->timeline()) {
+        auto data = span.toMap();
+        names << data["name"].toString();
+        // all the spans are closed once the download is done
+        QVERIFY(data["end"].toLongLong() >= data["start"].toLongLong());
+        QVERIFY(data["error"].toString().isEmpty());
+    }
+    QStringList expected;
+    expected << "download" << "connect" << "first byte" << "receive"
+        << "post processing";
+    QCOMPARE(names, expected);
+
+    auto trace = QJsonDocument::fromJson(download->chromeTrace().toUtf8());
+    QVERIFY(trace.isObject());
+    // one event per span plus the name of the row
+    QCOMPARE(trace.object()["traceEvents"].toArray().count(),
+        expected.count() + 1);
+
+    delete download;
+
+    QVERIFY(Mock::VerifyAndClearExpectations(file));
+    QVERIFY(Mock::VerifyAndClearExpectations(reply.data()));
+    verifyMocks();
+}
+
 QTEST_MAIN(TestDownload)
@@ -23,8 +23,11 @@
 #include <QObject>
 #include <QTest>
 #include <ubuntu/downloads/file_download.h>
+#include <ubuntu/downloads/shared_downloads.h>
 #include <ubuntu/download_manager/metatypes.h>
+#include <ubuntu/transfers/system/retry_policy.h>
 #include <ubuntu/transfers/system/uuid_utils.h>
+#include <content_cache.h>
 #include <file_manager.h>
 #include <process_factory.h>
 #include <request_factory.h>
@@ -32,6 +35,7 @@
 
 #include "base_testcase.h"
 #include "cryptographic_hash.h"
+#include "file_copier.h"
 
 using namespace Ubuntu::Transfers::System;
 using namespace Ubuntu::Transfers::Tests;
@@ -82,9 +86,11 @@ class TestDownload: public BaseTestCase {
     void testUrl();
     void testProgress();
     void testProgressNotKnownSize();
+    void testDownloadedBytesMetrics();
     void testTotalSize();
     void testTotalSizeNoProgress();
     void testSetThrottleNoReply();
+    void testWaitingForSpaceStateInt();
     void testSetThrottle();
     void testSetGSMDownloadSame();
     void testSetGSMDownloadDiff();
@@ -162,6 +168,10 @@ class TestDownload: public BaseTestCase {
     void testFileSystemErrorProgress();
     void testFileSystemErrorPause();
 
+    // preallocation of the temp file
+    void testPreallocateExpectedSize();
+    void testPreallocateNoSpace();
+
     // test different redirects
     void testRedirectCycle();
     void testSingleRedirect();
@@ -194,6 +204,34 @@ class TestDownload: public BaseTestCase {
     void testDataUriMimeType();
     void testDataUriPostProcessing_data();
     void testDataUriPostProcessing();
+    void testRetryTransientError();
+    void testRetryGivesUp();
+    void testRetryDropsErrorBody();
+    void testResumeRangeIgnored();
+    void testResumeUnexpectedRange();
+    void testFailOverToMirror();
+    void testFailOverNoMirrorsLeft();
+    void testFailOverDropsErrorBody();
+    void testInvalidMirror();
+    void testStallReconnects();
+    void testFollowIdenticalDownload();
+    void testFollowerTakesOverCanceledLeader();
+    void testFollowerCopiesInThePool();
+    void testCachedContent();
+    void testCachedResponseNotModified();
+    void testOpenReadDescriptorNotStarted();
+    void testOpenReadDescriptorFinished();
+    void testOpenReadDescriptorAfterFinished();
+    void testOutputDescriptorNotRegularFile();
+    void testOutputDescriptorWriteOnly();
+    void testOutputDescriptorPostProcessing();
+    void testOutputDescriptor();
+    void testInvalidByteRanges();
+    void testByteRangesWithHash();
+    void testInvalidDurability();
+    void testPeriodicDurability();
+    void testTimelineDisabled();
+    void testTimeline();
 
  private:
     QString _id = QString();
@@ -210,6 +248,9 @@ class TestDownload: public BaseTestCase {
     MockProcessFactory* _processFactory = nullptr;
     MockFileManager* _fileManager = nullptr;
     MockCryptographicHashFactory* _cryptoFactory = nullptr;
+    RetryPolicy* _retryPolicy = nullptr;
+    SharedDownloads* _sharedDownloads = nullptr;
+    MockContentCache* _contentCache = nullptr;
 };
 
 Q_DECLARE_METATYPE(QNetworkConfiguration::BearerType)
@@ -16,6 +16,7 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <ubuntu/transfers/queue.h>
 #include <ubuntu/downloads/file_download.h>
 #include <ubuntu/downloads/mms_file_download.h>
 #include <ubuntu/downloads/group_download.h>
@@ -29,6 +30,8 @@
 #include "test_download_factory.h"
 
 using ::testing::_;
+using ::testing::Invoke;
+using ::testing::InvokeWithoutArgs;
 using ::testing::Mock;
 using ::testing::Return;
 
@@ -285,4 +288,89 @@ TestDownloadFactory::testCreateDownloadForGroupWithHash() {
     QVERIFY(Mock::VerifyAndClearExpectations(_apparmor));
 }
 
+void
+TestDownloadFactory::testShareHeaders() {
+    EXPECT_CALL(*_apparmor, getSecurityDetails(_))
+        .Times(2)
+        .WillRepeatedly(InvokeWithoutArgs([]() {
+            auto details = new SecurityDetails(
+                UuidUtils::getDBusString(QUuid::createUuid()));
+            details->dbusPath = "/com/dbus/path/%1";
+            details->localPath = "/local/path";
+            return details;
+        }));
+
+    // each request carries its own copy of the same headers
+    QMap<QString, QString> firstHeaders;
+    firstHeaders["Authorization"] = "Bearer token";
+    QMap<QString, QString> secondHeaders;
+    secondHeaders["Authorization"] = QString("Bearer ") + "token";
+
+    QScopedPointer<Download> first(_downFactory->createDownload("",
+        QUrl("http://example.com/first"), QVariantMap(), firstHeaders));
+    QScopedPointer<Download> second(_downFactory->createDownload("",
+        QUrl("http://example.com/second"), QVariantMap(), secondHeaders));
+
+    auto firstResult = first->headers();
+    auto secondResult = second->headers();
+    QCOMPARE(firstResult, secondResult);
+    QVERIFY(&firstResult.constBegin().value()
+        == &secondResult.constBegin().value());
+
+    QVERIFY(Mock::VerifyAndClearExpectations(_apparmor));
+}
+
+void
+TestDownloadFactory::testQueuedDownloadsMemory() {
+    // the downloads point to a local stub but are never started
+    const int count = 10000;
+    const qint64 budget = 4096;
+    auto localPath = testDirectory();
+
+    EXPECT_CALL(*_apparmor, getSecurityDetails(_, _))
+        .WillRepeatedly(Invoke([localPath](QString caller, QString id) {
+            Q_UNUSED(caller);
+            auto details = new SecurityDetails(id);
+            details->appId = "stub-app";
+            details->dbusPath = "/com/canonical/applications/download/"
+                + id + "/%1";
+            details->localPath = localPath;
+            details->isConfined = true;
+            return details;
+        }));
+
+    auto createDownload = [this](int index) {
+        QVariantMap metadata;
+        metadata[Metadata::OBJECT_PATH_KEY] =
+            UuidUtils::getDBusString(QUuid::createUuid());
+        metadata[Metadata::TITLE_KEY] = QString("Download %1").arg(index);
+        QMap<QString, QString> headers;
+        headers["User-Agent"] = "ubuntu-download-manager";
+        return _downFactory->createDownload("",
+            QUrl(QString("http://127.0.0.1:8080/file%1.bin").arg(index)),
+            metadata, headers);
+    };
+
+    // the first download creates the singletons it uses
+    Queue queue;
+    QList<Download*> downloads;
+    downloads.append(createDownload(count));
+    queue.add(downloads.last());
+
+    auto before = residentMemory();
+    QVERIFY(before > 0);
+    for (int index = 0; index < count; index++) {
+        downloads.append(createDownload(index));
+        queue.add(downloads.last());
+    }
+    auto perDownload = (residentMemory() - before) / count;
+
+    qDebug() << "Bytes per queued download:" << perDownload;
+    QCOMPARE(queue.size(), count + 1);
+    QVERIFY(perDownload < budget);
+
+    qDeleteAll(downloads);
+    QVERIFY(Mock::VerifyAndClearExpectations(_apparmor));
+}
+
 QTEST_MAIN(TestDownloadFactory)
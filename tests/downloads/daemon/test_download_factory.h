@@ -28,6 +28,7 @@
 #include "request_factory.h"
 #include "uuid_factory.h"
 
+using namespace Ubuntu::Transfers;
 using namespace Ubuntu::Transfers::System;
 using namespace Ubuntu::Transfers::Tests;
 using namespace Ubuntu::DownloadManager;
@@ -54,6 +55,8 @@ class TestDownloadFactory : public BaseTestCase {
     void testCreateGroupDownloadWithValidUuid();
     void testCreateDownloadForGroup();
     void testCreateDownloadForGroupWithHash();
+    void testShareHeaders();
+    void testQueuedDownloadsMemory();
 
  private:
     MockAppArmor* _apparmor;
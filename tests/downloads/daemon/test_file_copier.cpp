@@ -0,0 +1,109 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include "test_file_copier.h"
+
+void
+TestFileCopier::init() {
+    BaseTestCase::init();
+    _copier = new FileCopier();
+}
+
+void
+TestFileCopier::cleanup() {
+    BaseTestCase::cleanup();
+    delete _copier;
+}
+
+QString
+TestFileCopier::writeFile(const QString& name, const QByteArray& data) {
+    auto path = testDirectory() + QDir::separator() + name;
+    QFile file(path);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    file.write(data);
+    file.close();
+    return path;
+}
+
+int
+TestFileCopier::openFile(const QString& path) {
+    return ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+}
+
+void
+TestFileCopier::testCopy() {
+    QByteArray data(2 * 1024 * 1024 + 3, 'c');
+    auto source = writeFile("source", data);
+    // the destination already has data that is replaced
+    auto destination = writeFile("destination", QByteArray(10, 'd'));
+
+    auto job = new CopyJob(openFile(source), destination);
+    QSignalSpy spy(job, SIGNAL(finished(bool)));
+    _copier->copy(job);
+
+    QTRY_COMPARE(spy.count(), 1);
+    QVERIFY(spy.at(0).at(0).toBool());
+    job->release();
+
+    QFile result(destination);
+    QVERIFY(result.open(QIODevice::ReadOnly));
+    QCOMPARE(result.readAll(), data);
+}
+
+void
+TestFileCopier::testSourceMovedAway() {
+    QByteArray data(64 * 1024, 'm');
+    auto source = writeFile("source", data);
+    auto destination = writeFile("destination", QByteArray());
+
+    // the data is read through the descriptor opened with the job
+    auto job = new CopyJob(openFile(source), destination);
+    QVERIFY(QFile::remove(source));
+    QSignalSpy spy(job, SIGNAL(finished(bool)));
+    _copier->copy(job);
+
+    QTRY_COMPARE(spy.count(), 1);
+    QVERIFY(spy.at(0).at(0).toBool());
+    job->release();
+
+    QFile result(destination);
+    QVERIFY(result.open(QIODevice::ReadOnly));
+    QCOMPARE(result.readAll(), data);
+}
+
+void
+TestFileCopier::testMissingDestination() {
+    auto source = writeFile("source", QByteArray("missing"));
+    auto destination = testDirectory() + QDir::separator() + "missing"
+        + QDir::separator() + "destination";
+
+    auto job = new CopyJob(openFile(source), destination);
+    QSignalSpy spy(job, SIGNAL(finished(bool)));
+    _copier->copy(job);
+
+    QTRY_COMPARE(spy.count(), 1);
+    QVERIFY(!spy.at(0).at(0).toBool());
+    job->release();
+}
+
+QTEST_MAIN(TestFileCopier)
@@ -16,10 +16,117 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <QFinalState>
 #include <QNetworkReply>
 #include <QSslError>
 #include "test_file_download_sm.h"
 
+using ::testing::NiceMock;
+
+namespace {
+
+// the QStateMachine that used to back the DownloadSM, kept so that the cost
+// of both implementations can be compared
+class LegacyDownloadSM {
+ public:
+    explicit LegacyDownloadSM(SMFileDownload* down) {
+        auto idle = addState(DownloadSM::IDLE);
+        auto init = addState(DownloadSM::INIT);
+        auto downloading = addState(DownloadSM::DOWNLOADING);
+        auto downloadingNotConnected = addState(
+            DownloadSM::DOWNLOADING_NOT_CONNECTED);
+        auto paused = addState(DownloadSM::PAUSED);
+        auto pausedNotConnected = addState(DownloadSM::PAUSED_NOT_CONNECTED);
+        auto downloaded = addState(DownloadSM::DOWNLOADED);
+        auto hashing = addState(DownloadSM::HASHING);
+        auto postProcessing = addState(DownloadSM::POST_PROCESSING);
+        auto error = addFinalState(DownloadSM::ERROR);
+        auto canceled = addFinalState(DownloadSM::CANCELED);
+        auto finished = addFinalState(DownloadSM::FINISHED);
+
+        new HeaderTransition(down, idle, init);
+        new NetworkErrorTransition(down, idle, error);
+        new SslErrorTransition(down, idle, error);
+
+        new StartDownloadTransition(down, init, downloading);
+        new NetworkErrorTransition(down, init, error);
+        new SslErrorTransition(down, init, error);
+
+        new PauseRequestTransition(down, SIGNAL(connectionDisabled()),
+            downloading, downloadingNotConnected);
+        new PauseRequestTransition(down, SIGNAL(paused()), downloading,
+            paused);
+        new CancelDownloadTransition(down, downloading, canceled);
+        new NetworkErrorTransition(down, downloading, error);
+        new SslErrorTransition(down, downloading, error);
+        downloading->addTransition(down, SIGNAL(completed()), downloaded);
+
+        new ResumeDownloadTransition(down, SIGNAL(connectionEnabled()),
+            downloadingNotConnected, downloading);
+        new CancelDownloadTransition(down, downloadingNotConnected, canceled);
+        downloadingNotConnected->addTransition(down, SIGNAL(paused()),
+            pausedNotConnected);
+
+        new ResumeDownloadTransition(down, SIGNAL(downloadingStarted()),
+            paused, downloading);
+        new CancelDownloadTransition(down, paused, canceled);
+        paused->addTransition(down, SIGNAL(connectionDisabled()),
+            pausedNotConnected);
+
+        new CancelDownloadTransition(down, pausedNotConnected, canceled);
+        pausedNotConnected->addTransition(down, SIGNAL(downloadingStarted()),
+            downloadingNotConnected);
+        pausedNotConnected->addTransition(down, SIGNAL(connectionEnabled()),
+            paused);
+
+        new CancelDownloadTransition(down, downloaded, canceled);
+        downloaded->addTransition(down, SIGNAL(finished()), finished);
+        downloaded->addTransition(down, SIGNAL(hashingStarted()), hashing);
+        downloaded->addTransition(down, SIGNAL(postProcessingStarted()),
+            postProcessing);
+
+        hashing->addTransition(down, SIGNAL(finished()), finished);
+        hashing->addTransition(down, SIGNAL(hashingError()), error);
+        hashing->addTransition(down, SIGNAL(postProcessingStarted()),
+            postProcessing);
+
+        postProcessing->addTransition(down, SIGNAL(finished()), finished);
+        postProcessing->addTransition(down, SIGNAL(postProcessingError()),
+            error);
+
+        _machine.setInitialState(idle);
+    }
+
+    QString state() {
+        return _target.property("state").toString();
+    }
+
+    void start() {
+        _machine.start();
+    }
+
+ private:
+    QState* addState(const QString& name) {
+        auto state = new QState();
+        state->assignProperty(&_target, "state", name);
+        _machine.addState(state);
+        return state;
+    }
+
+    QFinalState* addFinalState(const QString& name) {
+        auto state = new QFinalState();
+        state->assignProperty(&_target, "state", name);
+        _machine.addState(state);
+        return state;
+    }
+
+ private:
+    QObject _target;
+    QStateMachine _machine;
+};
+
+}
+
 void
 TestFileDownloadSM::init() {
     BaseTestCase::init();
@@ -660,4 +767,79 @@ TestFileDownloadSM::testPostProcessingFinished() {
     QCOMPARE(_stateMachine->state(), DownloadSM::FINISHED);
 }
 
+void
+TestFileDownloadSM::testInstanceMemory() {
+    const int count = 1000;
+    QList<SMFileDownload*> downloads;
+    for (int index = 0; index < count; index++) {
+        downloads.append(new NiceMock<MockSMFileDownload>());
+    }
+
+    auto before = residentMemory();
+    QVERIFY(before > 0);
+    QList<DownloadSM*> machines;
+    foreach(SMFileDownload* down, downloads) {
+        machines.append(new DownloadSM(down));
+        machines.last()->start();
+    }
+    auto tableBytes = (residentMemory() - before) / count;
+
+    before = residentMemory();
+    QList<LegacyDownloadSM*> legacyMachines;
+    foreach(SMFileDownload* down, downloads) {
+        legacyMachines.append(new LegacyDownloadSM(down));
+        legacyMachines.last()->start();
+    }
+    QCoreApplication::processEvents();
+    auto legacyBytes = (residentMemory() - before) / count;
+
+    qDebug() << "Bytes per instance, table:" << tableBytes
+        << "QStateMachine:" << legacyBytes;
+    QVERIFY(tableBytes < legacyBytes);
+
+    qDeleteAll(legacyMachines);
+    qDeleteAll(machines);
+    qDeleteAll(downloads);
+}
+
+void
+TestFileDownloadSM::benchmarkTransitions_data() {
+    QTest::addColumn<bool>("legacy");
+
+    QTest::newRow("table") << false;
+    QTest::newRow("QStateMachine") << true;
+}
+
+void
+TestFileDownloadSM::benchmarkTransitions() {
+    QFETCH(bool, legacy);
+    NiceMock<MockSMFileDownload> down;
+    DownloadSM table(&down);
+    LegacyDownloadSM qsm(&down);
+
+    // only the machine being measured has to process the signals
+    if (legacy) {
+        qsm.start();
+    } else {
+        table.start();
+    }
+    QCoreApplication::processEvents();
+
+    down.headRequestCompleted();
+    down.downloadingStarted();
+    QCoreApplication::processEvents();
+
+    // the QStateMachine needs the event loop to move, do the same with the
+    // table so that both measure a complete transition
+    QBENCHMARK {
+        down.paused();
+        QCoreApplication::processEvents();
+        down.downloadingStarted();
+        QCoreApplication::processEvents();
+    }
+
+    auto state = legacy ? qsm.state() : table.state();
+    QCOMPARE(state, DownloadSM::DOWNLOADING);
+}
+
 QTEST_MAIN(TestFileDownloadSM)
@@ -98,6 +98,11 @@ class TestFileDownloadSM : public BaseTestCase {
     void testPostProcessingError();
     void testPostProcessingFinished();
 
+    // cost compared with the QStateMachine implementation
+    void testInstanceMemory();
+    void benchmarkTransitions_data();
+    void benchmarkTransitions();
+
  private:
     MockSMFileDownload* _down;
     DownloadSM* _stateMachine;
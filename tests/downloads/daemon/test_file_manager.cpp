@@ -0,0 +1,155 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QScopedPointer>
+#include <ubuntu/transfers/system/file_manager.h>
+#include "test_file_manager.h"
+
+using namespace Ubuntu::Transfers::System;
+
+void
+TestFileManager::cleanup() {
+    BaseTestCase::cleanup();
+    FileManager::deleteInstance();
+}
+
+void
+TestFileManager::writeFile(const QString& path, const QByteArray& data) {
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+}
+
+void
+TestFileManager::testRename_data() {
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("Empty") << QByteArray();
+    QTest::newRow("Small") << QByteArray(10, 'a');
+    QTest::newRow("Large") << QByteArray(4 * 1024 * 1024, 'b');
+}
+
+void
+TestFileManager::testRename() {
+    QFETCH(QByteArray, data);
+    auto oldPath = testDirectory() + QDir::separator() + "test.zip.tmp";
+    auto newPath = testDirectory() + QDir::separator() + "test.zip";
+    writeFile(oldPath, data);
+
+    QVERIFY(FileManager::instance()->rename(oldPath, newPath));
+    QVERIFY(!QFile::exists(oldPath));
+
+    QFile file(newPath);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), data);
+    QCOMPARE(FileManager::instance()->copyFallbacks(), 0ULL);
+}
+
+void
+TestFileManager::testRenameDoesNotReplace() {
+    auto oldPath = testDirectory() + QDir::separator() + "test.zip.tmp";
+    auto newPath = testDirectory() + QDir::separator() + "test.zip";
+    writeFile(oldPath, QByteArray(10, 'a'));
+    writeFile(newPath, QByteArray(10, 'b'));
+
+    QVERIFY(!FileManager::instance()->rename(oldPath, newPath));
+    QVERIFY(QFile::exists(oldPath));
+
+    QFile file(newPath);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray(10, 'b'));
+}
+
+void
+TestFileManager::testRenameMissingFile() {
+    auto oldPath = testDirectory() + QDir::separator() + "missing.tmp";
+    auto newPath = testDirectory() + QDir::separator() + "missing";
+
+    QVERIFY(!FileManager::instance()->rename(oldPath, newPath));
+    QVERIFY(!QFile::exists(newPath));
+}
+
+void
+TestFileManager::testAllocateKeepsSize() {
+    auto path = testDirectory() + QDir::separator() + "allocated.tmp";
+    QScopedPointer<File> file(FileManager::instance()->createFile(path));
+    QVERIFY(file->open(QIODevice::ReadWrite | QFile::Append));
+
+    // the reserved space must not be taken into account as progress
+    QVERIFY(file->allocate(1024 * 1024));
+    QCOMPARE(file->size(), 0LL);
+
+    QByteArray data(10, 'a');
+    QCOMPARE(file->write(data), 10LL);
+    QVERIFY(file->flush());
+    QCOMPARE(file->size(), 10LL);
+    file->close();
+}
+
+void
+TestFileManager::testBytesAvailable() {
+    auto missing = testDirectory() + QDir::separator() + "missing";
+    auto available = FileManager::instance()->bytesAvailable(testDirectory());
+    QVERIFY(available > 0);
+    // files that do not exist yet use the file system of the parent dir
+    QVERIFY(FileManager::instance()->bytesAvailable(missing) > 0);
+}
+
+void
+TestFileManager::testBytesAvailableDescriptor() {
+    auto path = testDirectory() + QDir::separator() + "descriptor.tmp";
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    auto fd = file.handle();
+
+    // the file system of the descriptor and not the one of its link
+    auto manager = FileManager::instance();
+    QVERIFY(manager->bytesAvailable(fd) > 0);
+    QCOMPARE(manager->fileSystemId(fd),
+        manager->fileSystemId(testDirectory()));
+    QVERIFY(manager->fileSystemId(fd) != manager->fileSystemId(
+        QString("/proc/self/fd/%1").arg(fd)));
+    file.close();
+}
+
+void
+TestFileManager::testCopyFromAppendedFile() {
+    auto sourcePath = testDirectory() + QDir::separator() + "source.tmp";
+    auto path = testDirectory() + QDir::separator() + "copy.tmp";
+    QByteArray data(4096, 'a');
+
+    QFile source(sourcePath);
+    QVERIFY(source.open(QIODevice::WriteOnly));
+    QCOMPARE(source.write(data), 4096LL);
+    source.close();
+
+    // downloads open their files to append
+    QScopedPointer<File> file(FileManager::instance()->createFile(path));
+    QVERIFY(file->open(QIODevice::ReadWrite | QFile::Append));
+    QVERIFY(file->copyFrom(sourcePath));
+    QCOMPARE(file->size(), 4096LL);
+    QVERIFY(file->reset());
+    QCOMPARE(file->readAll(), data);
+    file->close();
+}
+
+QTEST_MAIN(TestFileManager)
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_FILE_MANAGER_H
+#define TEST_FILE_MANAGER_H
+
+#include <QObject>
+#include "base_testcase.h"
+
+class TestFileManager : public BaseTestCase {
+    Q_OBJECT
+
+ public:
+    explicit TestFileManager(QObject *parent = 0)
+        : BaseTestCase("TestFileManager", parent) { }
+
+ private slots:  // NOLINT(whitespace/indent)
+
+    void cleanup() override;
+
+    void testRename_data();
+    void testRename();
+    void testRenameDoesNotReplace();
+    void testRenameMissingFile();
+    void testAllocateKeepsSize();
+    void testBytesAvailable();
+    void testBytesAvailableDescriptor();
+    void testCopyFromAppendedFile();
+
+ private:
+    void writeFile(const QString& path, const QByteArray& data);
+};
+
+#endif // TEST_FILE_MANAGER_H
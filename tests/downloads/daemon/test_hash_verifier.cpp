@@ -0,0 +1,216 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QPointer>
+#include <QScopedPointer>
+#include <QSemaphore>
+#include <QSignalSpy>
+#include "test_hash_verifier.h"
+
+namespace {
+
+    // buffer that keeps the worker in the first read until released
+    class BlockingBuffer : public QBuffer {
+     public:
+        explicit BlockingBuffer(QByteArray* data)
+            : QBuffer(data) {}
+
+        QSemaphore reading;
+        QSemaphore proceed;
+
+     protected:
+        qint64 readData(char* data, qint64 size) override {
+            reading.release();
+            proceed.acquire();
+            return QBuffer::readData(data, size);
+        }
+    };
+
+}
+
+void
+TestHashVerifier::init() {
+    BaseTestCase::init();
+    _verifier = new HashVerifier();
+}
+
+void
+TestHashVerifier::cleanup() {
+    BaseTestCase::cleanup();
+    delete _verifier;
+}
+
+void
+TestHashVerifier::testDigestMatchesQt() {
+    QByteArray bytes(3 * 1024 * 1024 + 7, 'x');
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    QScopedPointer<HashJob> job(new HashJob());
+    _verifier->hash(job.data(), &buffer, QCryptographicHash::Sha256);
+    job->wait();
+
+    QVERIFY(job->isDone());
+    QCOMPARE(job->digest(),
+        QCryptographicHash::hash(bytes, QCryptographicHash::Sha256));
+}
+
+void
+TestHashVerifier::testEmptyDevice() {
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    QScopedPointer<HashJob> job(new HashJob());
+    _verifier->hash(job.data(), &buffer, QCryptographicHash::Md5);
+    job->wait();
+
+    QCOMPARE(job->digest(),
+        QCryptographicHash::hash(bytes, QCryptographicHash::Md5));
+}
+
+void
+TestHashVerifier::testFinishedEmitted() {
+    QByteArray bytes("finished");
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    QScopedPointer<HashJob> job(new HashJob());
+    QSignalSpy startedSpy(job.data(), SIGNAL(started()));
+    QSignalSpy finishedSpy(job.data(), SIGNAL(finished(QByteArray)));
+    _verifier->hash(job.data(), &buffer, QCryptographicHash::Sha1);
+    job->wait();
+
+    QCOMPARE(startedSpy.count(), 1);
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.at(0).at(0).toByteArray(),
+        QCryptographicHash::hash(bytes, QCryptographicHash::Sha1));
+}
+
+void
+TestHashVerifier::testSeveralJobs() {
+    QList<QByteArray> data;
+    QList<QBuffer*> buffers;
+    QList<HashJob*> jobs;
+
+    for (int index = 0; index < 8; index++) {
+        data.append(QByteArray(64 * 1024 + index, 'a' + index));
+    }
+    for (int index = 0; index < data.count(); index++) {
+        auto buffer = new QBuffer(&data[index]);
+        buffer->open(QIODevice::ReadOnly);
+        buffers.append(buffer);
+        auto job = new HashJob();
+        jobs.append(job);
+        _verifier->hash(job, buffer, QCryptographicHash::Sha1);
+    }
+
+    for (int index = 0; index < jobs.count(); index++) {
+        jobs[index]->wait();
+        QCOMPARE(jobs[index]->digest(),
+            QCryptographicHash::hash(data[index], QCryptographicHash::Sha1));
+    }
+
+    qDeleteAll(jobs);
+    qDeleteAll(buffers);
+}
+
+void
+TestHashVerifier::testMaxConcurrencyBounded() {
+    _verifier->setMaxConcurrency(4);
+    QCOMPARE(_verifier->maxConcurrency(), 4);
+    _verifier->setMaxConcurrency(0);
+    QCOMPARE(_verifier->maxConcurrency(), 1);
+}
+
+void
+TestHashVerifier::testHashPath() {
+    QByteArray bytes(1024 * 1024 + 3, 'p');
+    auto path = testDirectory() + QDir::separator() + "hashed";
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(bytes);
+    file.close();
+
+    QScopedPointer<HashJob> job(new HashJob());
+    _verifier->hash(job.data(), path, QCryptographicHash::Sha256);
+    job->wait();
+
+    QCOMPARE(job->digest(),
+        QCryptographicHash::hash(bytes, QCryptographicHash::Sha256));
+}
+
+void
+TestHashVerifier::testCancelQueued() {
+    _verifier->setMaxConcurrency(1);
+    QByteArray blocked(1024, 'b');
+    BlockingBuffer blocking(&blocked);
+    blocking.open(QIODevice::ReadOnly);
+    QByteArray bytes("queued");
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    // keep the only worker busy so that the second job stays queued
+    QScopedPointer<HashJob> busy(new HashJob());
+    _verifier->hash(busy.data(), &blocking, QCryptographicHash::Md5);
+    blocking.reading.acquire();
+
+    QPointer<HashJob> job(new HashJob());
+    QSignalSpy startedSpy(job.data(), SIGNAL(started()));
+    QSignalSpy finishedSpy(job.data(), SIGNAL(finished(QByteArray)));
+    _verifier->hash(job.data(), &buffer, QCryptographicHash::Md5);
+    _verifier->cancel(job.data());
+
+    // the job was taken out of the queue and is deleted right away
+    QTRY_VERIFY(job.isNull());
+
+    blocking.proceed.release(1024);
+    busy->wait();
+    QCOMPARE(startedSpy.count(), 0);
+    QCOMPARE(finishedSpy.count(), 0);
+    QCOMPARE(buffer.pos(), 0);
+}
+
+void
+TestHashVerifier::testCancelRunning() {
+    QByteArray bytes(4 * 1024 * 1024, 'r');
+    BlockingBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    QPointer<HashJob> job(new HashJob());
+    QSignalSpy startedSpy(job.data(), SIGNAL(started()));
+    QSignalSpy finishedSpy(job.data(), SIGNAL(finished(QByteArray)));
+    _verifier->hash(job.data(), &buffer, QCryptographicHash::Sha256);
+
+    // cancel does not wait for the worker that is in the first read
+    buffer.reading.acquire();
+    _verifier->cancel(job.data());
+    QVERIFY(!job.isNull());
+
+    // the worker stops at the next chunk and deletes the job
+    buffer.proceed.release(1024);
+    QTRY_VERIFY(job.isNull());
+    QCOMPARE(startedSpy.count(), 1);
+    QCOMPARE(finishedSpy.count(), 0);
+    QVERIFY(!buffer.atEnd());
+}
+
+QTEST_MAIN(TestHashVerifier)
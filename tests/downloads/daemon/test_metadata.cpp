@@ -353,6 +353,220 @@ TestMetadata::testHasDeflateFalse() {
     QVERIFY(!metadata.hasDeflate());
 }
 
+void
+TestMetadata::testPostProcessingPriority_data() {
+    QTest::addColumn<int>("priority");
+
+    QTest::newRow("Low") << -10;
+    QTest::newRow("Default") << 0;
+    QTest::newRow("High") << 10;
+}
+
+void
+TestMetadata::testPostProcessingPriority() {
+    QFETCH(int, priority);
+
+    Metadata metadata;
+    metadata[Metadata::POST_PROCESSING_PRIORITY_KEY] = priority;
+    QCOMPARE(priority, metadata.postProcessingPriority());
+}
+
+void
+TestMetadata::testSetPostProcessingPriority_data() {
+    QTest::addColumn<int>("priority");
+
+    QTest::newRow("Low") << -10;
+    QTest::newRow("Default") << 0;
+    QTest::newRow("High") << 10;
+}
+
+void
+TestMetadata::testSetPostProcessingPriority() {
+    QFETCH(int, priority);
+
+    Metadata metadata;
+    metadata.setPostProcessingPriority(priority);
+    QCOMPARE(metadata[Metadata::POST_PROCESSING_PRIORITY_KEY].toInt(),
+        priority);
+}
+
+void
+TestMetadata::testHasPostProcessingPriorityTrue() {
+    Metadata metadata;
+    metadata.setPostProcessingPriority(1);
+
+    QVERIFY(metadata.hasPostProcessingPriority());
+}
+
+void
+TestMetadata::testHasPostProcessingPriorityFalse() {
+    Metadata metadata;
+    QVERIFY(!metadata.hasPostProcessingPriority());
+    QCOMPARE(metadata.postProcessingPriority(), 0);
+}
+
+void
+TestMetadata::testMirrors() {
+    QStringList mirrors;
+    mirrors << "http://mirror.ubuntu.com/data" << "http://ubuntu.com/data";
+
+    Metadata metadata;
+    metadata[Metadata::MIRRORS_KEY] = mirrors;
+    QCOMPARE(metadata.mirrors(), mirrors);
+}
+
+void
+TestMetadata::testSetMirrors() {
+    QStringList mirrors;
+    mirrors << "http://mirror.ubuntu.com/data" << "http://ubuntu.com/data";
+
+    Metadata metadata;
+    metadata.setMirrors(mirrors);
+    QVERIFY(metadata.hasMirrors());
+    QCOMPARE(metadata[Metadata::MIRRORS_KEY].toStringList(), mirrors);
+}
+
+void
+TestMetadata::testHasMirrorsFalse() {
+    Metadata metadata;
+    QVERIFY(!metadata.hasMirrors());
+    QVERIFY(metadata.mirrors().isEmpty());
+}
+
+void
+TestMetadata::testMirrorMinSpeed() {
+    Metadata metadata;
+    metadata.setMirrorMinSpeed(1024);
+    QVERIFY(metadata.hasMirrorMinSpeed());
+    QCOMPARE(metadata.mirrorMinSpeed(), 1024ULL);
+}
+
+void
+TestMetadata::testHasMirrorMinSpeedFalse() {
+    Metadata metadata;
+    QVERIFY(!metadata.hasMirrorMinSpeed());
+    QCOMPARE(metadata.mirrorMinSpeed(), 0ULL);
+}
+
+void
+TestMetadata::testDeltaControl() {
+    QString control("http://ubuntu.com/data.zsync");
+
+    Metadata metadata;
+    metadata.setDeltaControl(control);
+    QVERIFY(metadata.hasDeltaControl());
+    QCOMPARE(metadata.deltaControl(), control);
+    QCOMPARE(metadata[Metadata::DELTA_CONTROL_KEY].toString(), control);
+}
+
+void
+TestMetadata::testHasDeltaControlFalse() {
+    Metadata metadata;
+    QVERIFY(!metadata.hasDeltaControl());
+    QVERIFY(metadata.deltaControl().isEmpty());
+}
+
+void
+TestMetadata::testDeltaSeed() {
+    QString seed("/home/ubuntu/data.old");
+
+    Metadata metadata;
+    metadata.setDeltaSeed(seed);
+    QVERIFY(metadata.hasDeltaSeed());
+    QCOMPARE(metadata.deltaSeed(), seed);
+    QCOMPARE(metadata[Metadata::DELTA_SEED_KEY].toString(), seed);
+}
+
+void
+TestMetadata::testHasDeltaSeedFalse() {
+    Metadata metadata;
+    QVERIFY(!metadata.hasDeltaSeed());
+    QVERIFY(metadata.deltaSeed().isEmpty());
+}
+
+void
+TestMetadata::testMetalink() {
+    Metadata metadata;
+    metadata.setMetalink(true);
+    QVERIFY(metadata.hasMetalink());
+    QVERIFY(metadata.metalink());
+    QVERIFY(metadata[Metadata::METALINK_KEY].toBool());
+}
+
+void
+TestMetadata::testHasMetalinkFalse() {
+    Metadata metadata;
+    QVERIFY(!metadata.hasMetalink());
+    QVERIFY(!metadata.metalink());
+}
+
+void
+TestMetadata::testSequential() {
+    Metadata metadata;
+    metadata.setSequential(true);
+    QVERIFY(metadata.hasSequential());
+    QVERIFY(metadata.sequential());
+    QVERIFY(metadata[Metadata::SEQUENTIAL_KEY].toBool());
+}
+
+void
+TestMetadata::testHasSequentialFalse() {
+    Metadata metadata;
+    QVERIFY(!metadata.hasSequential());
+    QVERIFY(!metadata.sequential());
+}
+
+void
+TestMetadata::testByteRanges() {
+    QStringList ranges;
+    ranges << "0-99" << "1024-2047";
+
+    Metadata metadata;
+    metadata.setByteRanges(ranges);
+    QVERIFY(metadata.hasByteRanges());
+    QCOMPARE(metadata.byteRanges(), ranges);
+    QCOMPARE(metadata[Metadata::BYTE_RANGES_KEY].toStringList(), ranges);
+}
+
+void
+TestMetadata::testHasByteRangesFalse() {
+    Metadata metadata;
+    QVERIFY(!metadata.hasByteRanges());
+    QVERIFY(metadata.byteRanges().isEmpty());
+}
+
+void
+TestMetadata::testDurability() {
+    Metadata metadata;
+    metadata.setDurability("periodic");
+    QVERIFY(metadata.hasDurability());
+    QCOMPARE(metadata.durability(), QString("periodic"));
+    QCOMPARE(metadata[Metadata::DURABILITY_KEY].toString(),
+        QString("periodic"));
+}
+
+void
+TestMetadata::testHasDurabilityFalse() {
+    Metadata metadata;
+    QVERIFY(!metadata.hasDurability());
+    QVERIFY(metadata.durability().isEmpty());
+}
+
+void
+TestMetadata::testDurabilityInterval() {
+    Metadata metadata;
+    metadata.setDurabilityInterval(4096);
+    QVERIFY(metadata.hasDurabilityInterval());
+    QCOMPARE(metadata.durabilityInterval(), 4096ULL);
+}
+
+void
+TestMetadata::testHasDurabilityIntervalFalse() {
+    Metadata metadata;
+    QVERIFY(!metadata.hasDurabilityInterval());
+    QCOMPARE(metadata.durabilityInterval(), 0ULL);
+}
+
 void
 TestMetadata::testDownloadOwner_data() {
     QTest::addColumn<QString>("owner");
@@ -71,6 +71,31 @@ class TestMetadata : public BaseTestCase {
     void testSetDeflate();
     void testHasDeflateTrue();
     void testHasDeflateFalse();
+    void testPostProcessingPriority_data();
+    void testPostProcessingPriority();
+    void testSetPostProcessingPriority_data();
+    void testSetPostProcessingPriority();
+    void testHasPostProcessingPriorityTrue();
+    void testHasPostProcessingPriorityFalse();
+    void testMirrors();
+    void testSetMirrors();
+    void testHasMirrorsFalse();
+    void testMirrorMinSpeed();
+    void testHasMirrorMinSpeedFalse();
+    void testDeltaControl();
+    void testHasDeltaControlFalse();
+    void testDeltaSeed();
+    void testHasDeltaSeedFalse();
+    void testMetalink();
+    void testHasMetalinkFalse();
+    void testSequential();
+    void testHasSequentialFalse();
+    void testByteRanges();
+    void testHasByteRangesFalse();
+    void testDurability();
+    void testHasDurabilityFalse();
+    void testDurabilityInterval();
+    void testHasDurabilityIntervalFalse();
     void testDownloadOwner_data();
     void testDownloadOwner();
     void testSetDownloadDestinationApp_data();
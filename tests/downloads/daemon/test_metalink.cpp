@@ -0,0 +1,215 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QTest>
+#include "test_metalink.h"
+
+namespace {
+    const QByteArray SHA1_A = "da39a3ee5e6b4b0d3255bfef95601890afd80709";
+    const QByteArray SHA1_B = "a9993e364706816aba3e25717850c26c9cd0d89d";
+    const QByteArray SHA256 =
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+}
+
+QByteArray
+TestMetalink::document(const QByteArray& file) {
+    return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<metalink xmlns=\"urn:ietf:params:xml:ns:metalink\">\n"
+        "  <published>2016-05-15T12:23:23Z</published>\n"
+        + file +
+        "</metalink>\n";
+}
+
+void
+TestMetalink::testParse() {
+    Metalink metalink;
+    QVERIFY(metalink.parse(document(
+        "<file name=\"example.ext\">\n"
+        "  <size>14471447</size>\n"
+        "  <identity>Example</identity>\n"
+        "  <hash type=\"sha-1\">" + SHA1_A + "</hash>\n"
+        "  <pieces length=\"8388608\" type=\"sha-1\">\n"
+        "    <hash>" + SHA1_A + "</hash>\n"
+        "    <hash>" + SHA1_B + "</hash>\n"
+        "  </pieces>\n"
+        "  <url location=\"de\" priority=\"1\">http://ftp.example.com/example.ext</url>\n"
+        "</file>\n")));
+
+    QCOMPARE(metalink.name(), QString("example.ext"));
+    QCOMPARE(metalink.size(), 14471447LL);
+    QCOMPARE(metalink.urls().count(), 1);
+    QCOMPARE(metalink.urls()[0].url,
+        QUrl("http://ftp.example.com/example.ext"));
+    QCOMPARE(metalink.urls()[0].priority, 1);
+    QCOMPARE(metalink.hash(), QString(SHA1_A));
+    QCOMPARE(metalink.hashAlgorithm(), QCryptographicHash::Sha1);
+    QCOMPARE(metalink.pieceLength(), 8388608LL);
+    QCOMPARE(metalink.pieceAlgorithm(), QCryptographicHash::Sha1);
+    QCOMPARE(metalink.pieceHashes(),
+        QStringList() << SHA1_A << SHA1_B);
+}
+
+void
+TestMetalink::testParseNotMetalink() {
+    Metalink metalink;
+    QVERIFY(!metalink.parse("<html><body>Not found</body></html>"));
+    QVERIFY(!metalink.lastError().isEmpty());
+    QVERIFY(!metalink.parse("not xml"));
+    QVERIFY(!metalink.parse(document("")));
+}
+
+void
+TestMetalink::testParseMissingSize() {
+    Metalink metalink;
+    QVERIFY(!metalink.parse(document(
+        "<file name=\"example.ext\">\n"
+        "  <url>http://ftp.example.com/example.ext</url>\n"
+        "</file>\n")));
+}
+
+void
+TestMetalink::testParseUrlsSortedByPriority() {
+    Metalink metalink;
+    QVERIFY(metalink.parse(document(
+        "<file name=\"example.ext\">\n"
+        "  <size>10</size>\n"
+        "  <url>http://third.example.com/example.ext</url>\n"
+        "  <url priority=\"2\">http://second.example.com/example.ext</url>\n"
+        "  <url priority=\"1\">http://first.example.com/example.ext</url>\n"
+        "</file>\n")));
+
+    auto urls = metalink.urls();
+    QCOMPARE(urls.count(), 3);
+    QCOMPARE(urls[0].url.host(), QString("first.example.com"));
+    QCOMPARE(urls[1].url.host(), QString("second.example.com"));
+    QCOMPARE(urls[2].url.host(), QString("third.example.com"));
+}
+
+void
+TestMetalink::testParseUnsupportedUrls() {
+    // a document must not be able to make the daemon read local files
+    Metalink metalink;
+    QVERIFY(!metalink.parse(document(
+        "<file name=\"example.ext\">\n"
+        "  <size>10</size>\n"
+        "  <url>file:///etc/shadow</url>\n"
+        "  <metaurl mediatype=\"torrent\">http://example.com/example.ext.torrent</metaurl>\n"
+        "</file>\n")));
+}
+
+void
+TestMetalink::testParseStrongestHash() {
+    Metalink metalink;
+    QVERIFY(metalink.parse(document(
+        "<file name=\"example.ext\">\n"
+        "  <size>10</size>\n"
+        "  <hash type=\"sha-256\">" + SHA256 + "</hash>\n"
+        "  <hash type=\"whirlpool\">abcd</hash>\n"
+        "  <hash type=\"sha-1\">" + SHA1_A + "</hash>\n"
+        "  <url>http://ftp.example.com/example.ext</url>\n"
+        "</file>\n")));
+
+    QCOMPARE(metalink.hash(), QString(SHA256));
+    QCOMPARE(metalink.hashAlgorithm(), QCryptographicHash::Sha256);
+}
+
+void
+TestMetalink::testParseInvalidHash() {
+    Metalink metalink;
+    QVERIFY(!metalink.parse(document(
+        "<file name=\"example.ext\">\n"
+        "  <size>10</size>\n"
+        "  <hash type=\"sha-1\">abcd</hash>\n"
+        "  <url>http://ftp.example.com/example.ext</url>\n"
+        "</file>\n")));
+}
+
+void
+TestMetalink::testParsePiecesCount() {
+    // 3 pieces are needed for 20 bytes
+    Metalink metalink;
+    QVERIFY(!metalink.parse(document(
+        "<file name=\"example.ext\">\n"
+        "  <size>20</size>\n"
+        "  <pieces length=\"8\" type=\"sha-1\">\n"
+        "    <hash>" + SHA1_A + "</hash>\n"
+        "    <hash>" + SHA1_B + "</hash>\n"
+        "  </pieces>\n"
+        "  <url>http://ftp.example.com/example.ext</url>\n"
+        "</file>\n")));
+}
+
+void
+TestMetalink::testParseUnknownPiecesType() {
+    Metalink metalink;
+    QVERIFY(metalink.parse(document(
+        "<file name=\"example.ext\">\n"
+        "  <size>20</size>\n"
+        "  <pieces length=\"8\" type=\"tiger\">\n"
+        "    <hash>abcd</hash>\n"
+        "  </pieces>\n"
+        "  <url>http://ftp.example.com/example.ext</url>\n"
+        "</file>\n")));
+    QVERIFY(metalink.pieceHashes().isEmpty());
+}
+
+void
+TestMetalink::testParsePieceLengthTooLarge() {
+    Metalink metalink;
+    QVERIFY(!metalink.parse(document(
+        "<file name=\"example.ext\">\n"
+        "  <size>20</size>\n"
+        "  <pieces length=\"1073741824\" type=\"sha-1\">\n"
+        "    <hash>" + SHA1_A + "</hash>\n"
+        "  </pieces>\n"
+        "  <url>http://ftp.example.com/example.ext</url>\n"
+        "</file>\n")));
+}
+
+void
+TestMetalink::testAlgorithmFromName_data() {
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<bool>("known");
+    QTest::addColumn<int>("algo");
+
+    QTest::newRow("md5") << "md5" << true
+        << static_cast<int>(QCryptographicHash::Md5);
+    QTest::newRow("sha-1") << "SHA-1" << true
+        << static_cast<int>(QCryptographicHash::Sha1);
+    QTest::newRow("sha-256") << "sha-256" << true
+        << static_cast<int>(QCryptographicHash::Sha256);
+    QTest::newRow("sha-512") << "sha-512" << true
+        << static_cast<int>(QCryptographicHash::Sha512);
+    QTest::newRow("sha256") << "sha256" << false << 0;
+    QTest::newRow("tiger") << "tiger" << false << 0;
+}
+
+void
+TestMetalink::testAlgorithmFromName() {
+    QFETCH(QString, name);
+    QFETCH(bool, known);
+    QFETCH(int, algo);
+
+    QCryptographicHash::Algorithm result;
+    QCOMPARE(Metalink::algorithmFromName(name, result), known);
+    if (known) {
+        QCOMPARE(static_cast<int>(result), algo);
+    }
+}
+
+QTEST_MAIN(TestMetalink)
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QFile>
+#include <QThread>
+#include "test_metrics.h"
+
+void
+TestMetrics::cleanup() {
+    BaseTestCase::cleanup();
+    Metrics::deleteInstance();
+}
+
+void
+TestMetrics::testCounter() {
+    Metrics metrics;
+    QCOMPARE(metrics.counter("udm_retries_total"), 0ULL);
+
+    metrics.increment("udm_retries_total");
+    metrics.increment("udm_retries_total", MetricLabels(), 4);
+    QCOMPARE(metrics.counter("udm_retries_total"), 5ULL);
+}
+
+void
+TestMetrics::testCounterLabels() {
+    Metrics metrics;
+    MetricLabels wlan {{"app", "test"}, {"bearer", "wlan"}};
+    MetricLabels lte {{"app", "test"}, {"bearer", "lte"}};
+
+    metrics.increment("udm_downloaded_bytes_total", wlan, 100);
+    metrics.increment("udm_downloaded_bytes_total", lte, 30);
+    metrics.increment("udm_downloaded_bytes_total", wlan, 20);
+
+    QCOMPARE(metrics.counter("udm_downloaded_bytes_total", wlan), 120ULL);
+    QCOMPARE(metrics.counter("udm_downloaded_bytes_total", lte), 30ULL);
+
+    auto samples = metrics.samples();
+    QCOMPARE(samples.count(), 2);
+    // the labels are sorted by name
+    QCOMPARE(samples[
+        "udm_downloaded_bytes_total{app=\"test\",bearer=\"wlan\"}"]
+            .toULongLong(), 120ULL);
+    QCOMPARE(samples[
+        "udm_downloaded_bytes_total{app=\"test\",bearer=\"lte\"}"]
+            .toULongLong(), 30ULL);
+}
+
+void
+TestMetrics::testGauge() {
+    Metrics metrics;
+    MetricLabels active {{"state", "active"}};
+
+    metrics.setGauge("udm_transfers", active, 3);
+    metrics.setGauge("udm_transfers", active, 1);
+    QCOMPARE(metrics.gauge("udm_transfers", active), 1LL);
+    QCOMPARE(metrics.samples()["udm_transfers{state=\"active\"}"]
+        .toLongLong(), 1LL);
+}
+
+void
+TestMetrics::testHistogram() {
+    Metrics metrics;
+    MetricLabels labels {{"query", "store"}};
+
+    metrics.observe("udm_db_write_seconds", labels, 0.003);
+    metrics.observe("udm_db_write_seconds", labels, 0.02);
+    metrics.observe("udm_db_write_seconds", labels, 120);
+    QCOMPARE(metrics.observations("udm_db_write_seconds", labels), 3ULL);
+
+    auto samples = metrics.samples();
+    // one sample per bucket plus +Inf, the sum and the count
+    QCOMPARE(samples.count(), Metrics::buckets().count() + 3);
+
+    // the buckets are cumulative
+    QString bucket = "udm_db_write_seconds_bucket{query=\"store\",le=\"%1\"}";
+    QCOMPARE(samples[bucket.arg("0.001")].toULongLong(), 0ULL);
+    QCOMPARE(samples[bucket.arg("0.005")].toULongLong(), 1ULL);
+    QCOMPARE(samples[bucket.arg("0.025")].toULongLong(), 2ULL);
+    QCOMPARE(samples[bucket.arg("60")].toULongLong(), 2ULL);
+    QCOMPARE(samples[bucket.arg("+Inf")].toULongLong(), 3ULL);
+    QCOMPARE(samples["udm_db_write_seconds_count{query=\"store\"}"]
+        .toULongLong(), 3ULL);
+    QVERIFY(qAbs(samples["udm_db_write_seconds_sum{query=\"store\"}"]
+        .toDouble() - 120.023) < 0.000001);
+}
+
+void
+TestMetrics::testTypeMismatch() {
+    Metrics metrics;
+    metrics.setGauge("udm_transfers", MetricLabels(), 2);
+
+    // the first type wins, the rest of the calls are ignored
+    metrics.increment("udm_transfers");
+    metrics.observe("udm_transfers", MetricLabels(), 1);
+    QCOMPARE(metrics.gauge("udm_transfers"), 2LL);
+    QCOMPARE(metrics.counter("udm_transfers"), 0ULL);
+    QCOMPARE(metrics.samples().count(), 1);
+}
+
+void
+TestMetrics::testText() {
+    Metrics metrics;
+    metrics.increment("udm_retries_total", {{"app", "test"}}, 2);
+    metrics.setGauge("udm_transfers", {{"state", "queued"}}, 4);
+    metrics.observe("udm_hash_seconds", {{"algorithm", "sha256"}}, 0.5);
+
+    auto lines = metrics.text().split("\n", QString::SkipEmptyParts);
+
+    // the families are sorted by name
+    QCOMPARE(lines.first(), QString("# TYPE udm_hash_seconds histogram"));
+    QVERIFY(lines.contains(
+        "udm_hash_seconds_bucket{algorithm=\"sha256\",le=\"0.5\"} 1"));
+    QVERIFY(lines.contains(
+        "udm_hash_seconds_bucket{algorithm=\"sha256\",le=\"0.25\"} 0"));
+    QVERIFY(lines.contains("udm_hash_seconds_sum{algorithm=\"sha256\"} 0.5"));
+    QVERIFY(lines.contains("udm_hash_seconds_count{algorithm=\"sha256\"} 1"));
+    QVERIFY(lines.contains("# TYPE udm_retries_total counter"));
+    QVERIFY(lines.contains("udm_retries_total{app=\"test\"} 2"));
+    QVERIFY(lines.contains("# TYPE udm_transfers gauge"));
+    QCOMPARE(lines.last(), QString("udm_transfers{state=\"queued\"} 4"));
+    QVERIFY(metrics.text().endsWith("\n"));
+}
+
+void
+TestMetrics::testTextEscapesLabels() {
+    Metrics metrics;
+    metrics.increment("udm_retries_total", {{"app", "a\"b\\c\nd"}});
+    QCOMPARE(metrics.text(), QString("# TYPE udm_retries_total counter\n"
+        "udm_retries_total{app=\"a\\\"b\\\\c\\nd\"} 1\n"));
+}
+
+void
+TestMetrics::testDump() {
+    Metrics metrics;
+    metrics.increment("udm_retries_total", {{"app", "test"}});
+    auto path = testDirectory() + "/metrics.prom";
+
+    QVERIFY(metrics.dump(path));
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(QString::fromUtf8(file.readAll()), metrics.text());
+    file.close();
+
+    // the dump replaces the previous one
+    metrics.increment("udm_retries_total", {{"app", "test"}});
+    QVERIFY(metrics.dump(path));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(QString::fromUtf8(file.readAll()), metrics.text());
+}
+
+void
+TestMetrics::testClear() {
+    Metrics metrics;
+    metrics.increment("udm_retries_total");
+    metrics.clear();
+    QVERIFY(metrics.samples().isEmpty());
+    QVERIFY(metrics.text().isEmpty());
+}
+
+void
+TestMetrics::testTimer() {
+    MetricLabels labels {{"method", "Download.start"}};
+    {
+        DBusCallTimer timer("Download.start");
+        QThread::msleep(5);
+    }
+    auto metrics = Metrics::instance();
+    QCOMPARE(metrics->observations("udm_dbus_call_seconds", labels), 1ULL);
+    auto sum = metrics->samples()[
+        "udm_dbus_call_seconds_sum{method=\"Download.start\"}"].toDouble();
+    QVERIFY(sum >= 0.005);
+}
+
+void
+TestMetrics::testBearerName() {
+    QCOMPARE(Metrics::bearerName(QNetworkConfiguration::BearerWLAN),
+        QString("wlan"));
+    QCOMPARE(Metrics::bearerName(QNetworkConfiguration::BearerEthernet),
+        QString("ethernet"));
+    QCOMPARE(Metrics::bearerName(QNetworkConfiguration::Bearer3G),
+        QString("3g"));
+    QCOMPARE(Metrics::bearerName(QNetworkConfiguration::BearerUnknown),
+        QString("unknown"));
+}
+
+void
+TestMetrics::testErrorName() {
+    QCOMPARE(Metrics::errorName(QNetworkReply::TimeoutError),
+        QString("TimeoutError"));
+    QCOMPARE(Metrics::errorName(QNetworkReply::HostNotFoundError),
+        QString("HostNotFoundError"));
+}
+
+QTEST_MAIN(TestMetrics)
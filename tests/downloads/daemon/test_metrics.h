@@ -0,0 +1,55 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_METRICS_H
+#define TEST_METRICS_H
+
+#include <QObject>
+#include <ubuntu/transfers/system/metrics.h>
+
+#include "base_testcase.h"
+
+using namespace Ubuntu::Transfers::System;
+using namespace Ubuntu::Transfers::Tests;
+
+class TestMetrics : public BaseTestCase {
+    Q_OBJECT
+
+ public:
+    explicit TestMetrics(QObject *parent = 0)
+        : BaseTestCase("TestMetrics", parent) {}
+
+ private slots:  // NOLINT(whitespace/indent)
+
+    void cleanup() override;
+
+    void testCounter();
+    void testCounterLabels();
+    void testGauge();
+    void testHistogram();
+    void testTypeMismatch();
+    void testText();
+    void testTextEscapesLabels();
+    void testDump();
+    void testClear();
+    void testTimer();
+    void testBearerName();
+    void testErrorName();
+};
+
+#endif  // TEST_METRICS_H
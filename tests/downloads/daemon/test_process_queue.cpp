@@ -0,0 +1,246 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QScopedPointer>
+#include <QSignalSpy>
+#include "matchers.h"
+#include "test_process_queue.h"
+
+using ::testing::_;
+using ::testing::Mock;
+
+void
+TestProcessQueue::init() {
+    BaseTestCase::init();
+    _queue = new ProcessQueue();
+    _queue->setMaxConcurrency(1);
+}
+
+void
+TestProcessQueue::cleanup() {
+    BaseTestCase::cleanup();
+    delete _queue;
+}
+
+void
+TestProcessQueue::testStartWhenSlotFree() {
+    QScopedPointer<MockProcess> first(new MockProcess());
+    QScopedPointer<MockProcess> second(new MockProcess());
+    QStringList args;
+    args << "--unzip";
+
+    EXPECT_CALL(*first.data(), start(QString("first"), StringListEq(args), _))
+        .Times(1);
+    EXPECT_CALL(*second.data(), start(_, _, _))
+        .Times(0);
+
+    _queue->enqueue(first.data(), "first", args);
+    _queue->enqueue(second.data(), "second", args);
+
+    QCOMPARE(_queue->running(), 1);
+    QCOMPARE(_queue->pending(), 1);
+
+    QVERIFY(Mock::VerifyAndClearExpectations(first.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(second.data()));
+}
+
+void
+TestProcessQueue::testStartPendingOnFinished() {
+    QScopedPointer<MockProcess> first(new MockProcess());
+    QScopedPointer<MockProcess> second(new MockProcess());
+
+    EXPECT_CALL(*first.data(), start(_, _, _))
+        .Times(1);
+    EXPECT_CALL(*second.data(), start(QString("second"), _, _))
+        .Times(1);
+
+    _queue->enqueue(first.data(), "first", QStringList());
+    _queue->enqueue(second.data(), "second", QStringList());
+
+    emit first->finished(0, QProcess::NormalExit);
+
+    QCOMPARE(_queue->running(), 1);
+    QCOMPARE(_queue->pending(), 0);
+
+    QVERIFY(Mock::VerifyAndClearExpectations(first.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(second.data()));
+}
+
+void
+TestProcessQueue::testStartPendingOnFailedToStart() {
+    QScopedPointer<MockProcess> first(new MockProcess());
+    QScopedPointer<MockProcess> second(new MockProcess());
+
+    EXPECT_CALL(*first.data(), start(_, _, _))
+        .Times(1);
+    EXPECT_CALL(*second.data(), start(_, _, _))
+        .Times(1);
+
+    _queue->enqueue(first.data(), "first", QStringList());
+    _queue->enqueue(second.data(), "second", QStringList());
+
+    emit first->error(QProcess::FailedToStart);
+
+    QCOMPARE(_queue->running(), 1);
+    QCOMPARE(_queue->pending(), 0);
+
+    QVERIFY(Mock::VerifyAndClearExpectations(first.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(second.data()));
+}
+
+void
+TestProcessQueue::testStartPendingOnDestroyed() {
+    auto first = new MockProcess();
+    QScopedPointer<MockProcess> second(new MockProcess());
+
+    EXPECT_CALL(*first, start(_, _, _))
+        .Times(1);
+    EXPECT_CALL(*second.data(), start(_, _, _))
+        .Times(1);
+
+    _queue->enqueue(first, "first", QStringList());
+    _queue->enqueue(second.data(), "second", QStringList());
+
+    delete first;
+
+    QCOMPARE(_queue->running(), 1);
+    QCOMPARE(_queue->pending(), 0);
+
+    QVERIFY(Mock::VerifyAndClearExpectations(second.data()));
+}
+
+void
+TestProcessQueue::testPriorityOrder() {
+    QScopedPointer<MockProcess> running(new MockProcess());
+    QScopedPointer<MockProcess> low(new MockProcess());
+    QScopedPointer<MockProcess> high(new MockProcess());
+
+    EXPECT_CALL(*running.data(), start(_, _, _))
+        .Times(1);
+    EXPECT_CALL(*high.data(), start(_, _, _))
+        .Times(1);
+    EXPECT_CALL(*low.data(), start(_, _, _))
+        .Times(0);
+
+    _queue->enqueue(running.data(), "running", QStringList());
+    _queue->enqueue(low.data(), "low", QStringList(), 0);
+    _queue->enqueue(high.data(), "high", QStringList(), 10);
+
+    emit running->finished(0, QProcess::NormalExit);
+
+    QCOMPARE(_queue->pending(), 1);
+
+    QVERIFY(Mock::VerifyAndClearExpectations(running.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(low.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(high.data()));
+}
+
+void
+TestProcessQueue::testSamePriorityFifo() {
+    QScopedPointer<MockProcess> running(new MockProcess());
+    QScopedPointer<MockProcess> first(new MockProcess());
+    QScopedPointer<MockProcess> second(new MockProcess());
+
+    EXPECT_CALL(*running.data(), start(_, _, _))
+        .Times(1);
+    EXPECT_CALL(*first.data(), start(_, _, _))
+        .Times(1);
+    EXPECT_CALL(*second.data(), start(_, _, _))
+        .Times(0);
+
+    _queue->enqueue(running.data(), "running", QStringList());
+    _queue->enqueue(first.data(), "first", QStringList(), 5);
+    _queue->enqueue(second.data(), "second", QStringList(), 5);
+
+    emit running->finished(0, QProcess::NormalExit);
+
+    QVERIFY(Mock::VerifyAndClearExpectations(running.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(first.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(second.data()));
+}
+
+void
+TestProcessQueue::testSetMaxConcurrencyStartsPending() {
+    QScopedPointer<MockProcess> first(new MockProcess());
+    QScopedPointer<MockProcess> second(new MockProcess());
+
+    EXPECT_CALL(*first.data(), start(_, _, _))
+        .Times(1);
+    EXPECT_CALL(*second.data(), start(_, _, _))
+        .Times(1);
+
+    _queue->enqueue(first.data(), "first", QStringList());
+    _queue->enqueue(second.data(), "second", QStringList());
+    _queue->setMaxConcurrency(2);
+
+    QCOMPARE(_queue->running(), 2);
+    QCOMPARE(_queue->pending(), 0);
+
+    QVERIFY(Mock::VerifyAndClearExpectations(first.data()));
+    QVERIFY(Mock::VerifyAndClearExpectations(second.data()));
+}
+
+void
+TestProcessQueue::testTimeoutKillsProcess() {
+    QScopedPointer<MockProcess> process(new MockProcess());
+    QSignalSpy spy(_queue, SIGNAL(processCompleted(ProcessMetrics)));
+
+    EXPECT_CALL(*process.data(), start(_, _, _))
+        .Times(1);
+    EXPECT_CALL(*process.data(), kill())
+        .Times(1);
+
+    _queue->setTimeout(10);
+    _queue->enqueue(process.data(), "slow", QStringList());
+
+    QTest::qWait(100);
+    QVERIFY(Mock::VerifyAndClearExpectations(process.data()));
+
+    // a killed process is reported as a crash
+    emit process->finished(9, QProcess::CrashExit);
+
+    QCOMPARE(spy.count(), 1);
+    auto metrics = spy.takeFirst().at(0).value<ProcessMetrics>();
+    QVERIFY(metrics.timedOut);
+    QCOMPARE(_queue->running(), 0);
+}
+
+void
+TestProcessQueue::testProcessCompletedMetrics() {
+    QScopedPointer<MockProcess> process(new MockProcess());
+    QSignalSpy spy(_queue, SIGNAL(processCompleted(ProcessMetrics)));
+
+    EXPECT_CALL(*process.data(), start(_, _, _))
+        .Times(1);
+
+    _queue->enqueue(process.data(), "command", QStringList(), 3);
+    emit process->finished(2, QProcess::NormalExit);
+
+    QCOMPARE(spy.count(), 1);
+    auto metrics = spy.takeFirst().at(0).value<ProcessMetrics>();
+    QCOMPARE(metrics.program, QString("command"));
+    QCOMPARE(metrics.priority, 3);
+    QCOMPARE(metrics.exitCode, 2);
+    QVERIFY(!metrics.timedOut);
+    QVERIFY(metrics.queueWait >= 0);
+    QVERIFY(metrics.runTime >= 0);
+
+    QVERIFY(Mock::VerifyAndClearExpectations(process.data()));
+}
+
+QTEST_MAIN(TestProcessQueue)
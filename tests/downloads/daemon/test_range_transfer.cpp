@@ -0,0 +1,148 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QDir>
+#include <QTest>
+#include "test_range_transfer.h"
+
+using ::testing::_;
+using ::testing::Mock;
+using ::testing::Return;
+
+void
+TestRangeTransfer::testParse() {
+    QList<ByteRange> ranges;
+    QVERIFY(RangeTransfer::parse(QStringList() << "0-99" << "200-299",
+        ranges));
+    QCOMPARE(ranges.count(), 2);
+    QCOMPARE(ranges[0].first, 0LL);
+    QCOMPARE(ranges[0].last, 99LL);
+    QCOMPARE(ranges[0].length(), 100LL);
+    QCOMPARE(ranges[1].first, 200LL);
+    QCOMPARE(ranges[1].last, 299LL);
+}
+
+void
+TestRangeTransfer::testParseSorts() {
+    QList<ByteRange> ranges;
+    QVERIFY(RangeTransfer::parse(QStringList() << "500-599" << "0-9",
+        ranges));
+    QCOMPARE(ranges.count(), 2);
+    QCOMPARE(ranges[0].first, 0LL);
+    QCOMPARE(ranges[1].first, 500LL);
+}
+
+void
+TestRangeTransfer::testParseMerges() {
+    // overlapping and adjacent ranges are requested once
+    QList<ByteRange> ranges;
+    QVERIFY(RangeTransfer::parse(QStringList() << "0-99" << "50-149"
+        << "150-199" << "300-300", ranges));
+    QCOMPARE(ranges.count(), 2);
+    QCOMPARE(ranges[0].first, 0LL);
+    QCOMPARE(ranges[0].last, 199LL);
+    QCOMPARE(ranges[1].first, 300LL);
+    QCOMPARE(ranges[1].length(), 1LL);
+}
+
+void
+TestRangeTransfer::testParseInvalid_data() {
+    QTest::addColumn<QStringList>("specs");
+
+    QTest::newRow("Empty") << QStringList();
+    QTest::newRow("Suffix") << (QStringList() << "-500");
+    QTest::newRow("Open") << (QStringList() << "500-");
+    QTest::newRow("Reversed") << (QStringList() << "100-10");
+    QTest::newRow("Not a number") << (QStringList() << "a-b");
+    QTest::newRow("Several") << (QStringList() << "0-1-2");
+    QTest::newRow("One invalid") << (QStringList() << "0-10" << "x");
+}
+
+void
+TestRangeTransfer::testParseInvalid() {
+    QFETCH(QStringList, specs);
+    QList<ByteRange> ranges;
+    QVERIFY(!RangeTransfer::parse(specs, ranges));
+}
+
+void
+TestRangeTransfer::testContiguousNotAPrefix() {
+    QList<ByteRange> ranges;
+    QVERIFY(RangeTransfer::parse(QStringList() << "100-199", ranges));
+    RangeTransfer transfer(QNetworkRequest(), ranges, nullptr);
+
+    // the hole before the range is not data
+    QCOMPARE(transfer.contiguous(), 0ULL);
+}
+
+void
+TestRangeTransfer::testContiguous() {
+    auto factory = new MockRequestFactory();
+    RequestFactory::setInstance(factory);
+    QScopedPointer<MockNetworkReply> reply(new MockNetworkReply());
+    QScopedPointer<File> output(FileManager::instance()->createFile(
+        testDirectory() + QDir::separator() + "ranges"));
+    QVERIFY(output->open(QIODevice::ReadWrite));
+
+    QList<ByteRange> ranges;
+    QVERIFY(RangeTransfer::parse(QStringList() << "0-99" << "200-299",
+        ranges));
+
+    EXPECT_CALL(*factory, get(_))
+        .Times(1)
+        .WillOnce(Return(reply.data()));
+
+    EXPECT_CALL(*reply.data(), setReadBufferSize(_))
+        .Times(1);
+
+    EXPECT_CALL(*reply.data(),
+            attribute(QNetworkRequest::HttpStatusCodeAttribute))
+        .Times(1)
+        .WillOnce(Return(QVariant(206)));
+
+    // the first range is sent on its own
+    EXPECT_CALL(*reply.data(), rawHeader(QByteArray("Content-Type")))
+        .Times(1)
+        .WillOnce(Return(QByteArray("application/octet-stream")));
+
+    EXPECT_CALL(*reply.data(), rawHeader(QByteArray("Content-Range")))
+        .Times(1)
+        .WillOnce(Return(QByteArray("bytes 0-99/1000")));
+
+    EXPECT_CALL(*reply.data(), readAll())
+        .Times(1)
+        .WillOnce(Return(QByteArray(50, 'a')));
+
+    {
+        RangeTransfer transfer(QNetworkRequest(QUrl("http://ubuntu.com")),
+            ranges, output.data());
+        QCOMPARE(transfer.contiguous(), 0ULL);
+
+        transfer.start();
+        emit reply->downloadProgress(50, 100);
+
+        // the size of the file is not used, the second range is missing
+        QCOMPARE(transfer.received(), 50ULL);
+        QCOMPARE(transfer.contiguous(), 50ULL);
+    }
+
+    QVERIFY(Mock::VerifyAndClearExpectations(reply.data()));
+    RequestFactory::deleteInstance();
+}
+
+QTEST_MAIN(TestRangeTransfer)
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_RANGE_TRANSFER_H
+#define TEST_RANGE_TRANSFER_H
+
+#include <QObject>
+#include <ubuntu/downloads/range_transfer.h>
+#include <network_reply.h>
+#include <request_factory.h>
+
+#include "base_testcase.h"
+
+using namespace Ubuntu::DownloadManager::Daemon;
+using namespace Ubuntu::Transfers::Tests;
+
+class TestRangeTransfer : public BaseTestCase {
+    Q_OBJECT
+
+ public:
+    explicit TestRangeTransfer(QObject *parent = 0)
+        : BaseTestCase("TestRangeTransfer", parent) {}
+
+ private slots:  // NOLINT(whitespace/indent)
+
+    void testParse();
+    void testParseSorts();
+    void testParseMerges();
+    void testParseInvalid_data();
+    void testParseInvalid();
+    void testContiguousNotAPrefix();
+    void testContiguous();
+};
+
+#endif  // TEST_RANGE_TRANSFER_H
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QDateTime>
+#include <QLocale>
+#include "test_retry_policy.h"
+
+void
+TestRetryPolicy::init() {
+    BaseTestCase::init();
+    _policy = new RetryPolicy();
+    _policy->setBaseDelay(1000);
+    _policy->setMaxDelay(60000);
+}
+
+void
+TestRetryPolicy::cleanup() {
+    BaseTestCase::cleanup();
+    delete _policy;
+}
+
+void
+TestRetryPolicy::testIsTransient_data() {
+    QTest::addColumn<int>("code");
+    QTest::addColumn<int>("httpStatus");
+    QTest::addColumn<bool>("result");
+
+    QTest::newRow("Remote host closed")
+        << static_cast<int>(QNetworkReply::RemoteHostClosedError) << 0
+        << true;
+    QTest::newRow("Timeout")
+        << static_cast<int>(QNetworkReply::TimeoutError) << 0 << true;
+    QTest::newRow("Temporary failure")
+        << static_cast<int>(QNetworkReply::TemporaryNetworkFailureError) << 0
+        << true;
+    QTest::newRow("Host not found")
+        << static_cast<int>(QNetworkReply::HostNotFoundError) << 0 << false;
+    QTest::newRow("Canceled")
+        << static_cast<int>(QNetworkReply::OperationCanceledError) << 0
+        << false;
+    QTest::newRow("Too many requests")
+        << static_cast<int>(QNetworkReply::UnknownContentError) << 429
+        << true;
+    QTest::newRow("Service unavailable")
+        << static_cast<int>(QNetworkReply::ServiceUnavailableError) << 503
+        << true;
+    QTest::newRow("Not found")
+        << static_cast<int>(QNetworkReply::ContentNotFoundError) << 404
+        << false;
+    QTest::newRow("Forbidden")
+        << static_cast<int>(QNetworkReply::ContentAccessDenied) << 403
+        << false;
+}
+
+void
+TestRetryPolicy::testIsTransient() {
+    QFETCH(int, code);
+    QFETCH(int, httpStatus);
+    QFETCH(bool, result);
+
+    QCOMPARE(_policy->isTransient(
+        static_cast<QNetworkReply::NetworkError>(code), httpStatus), result);
+}
+
+void
+TestRetryPolicy::testDelayBackoff_data() {
+    QTest::addColumn<int>("attempt");
+    QTest::addColumn<int>("backoff");
+
+    QTest::newRow("First attempt") << 0 << 1000;
+    QTest::newRow("Second attempt") << 1 << 2000;
+    QTest::newRow("Third attempt") << 2 << 4000;
+    QTest::newRow("Fifth attempt") << 4 << 16000;
+}
+
+void
+TestRetryPolicy::testDelayBackoff() {
+    QFETCH(int, attempt);
+    QFETCH(int, backoff);
+
+    // the jitter keeps the delay in the upper half of the backoff
+    for (int index = 0; index < 100; index++) {
+        auto delay = _policy->delay(attempt);
+        QVERIFY(delay >= backoff / 2);
+        QVERIFY(delay <= backoff);
+    }
+}
+
+void
+TestRetryPolicy::testDelayCapped() {
+    for (int index = 0; index < 100; index++) {
+        auto delay = _policy->delay(40);
+        QVERIFY(delay >= 30000);
+        QVERIFY(delay <= 60000);
+    }
+}
+
+void
+TestRetryPolicy::testRetryAfterSeconds() {
+    QCOMPARE(_policy->delay(0, "120"), 120000);
+    // capped to an hour
+    QCOMPARE(_policy->delay(0, "999999"), 3600 * 1000);
+}
+
+void
+TestRetryPolicy::testRetryAfterDate() {
+    auto date = QDateTime::currentDateTimeUtc().addSecs(30);
+    auto value = QLocale::c().toString(date,
+        "ddd, dd MMM yyyy hh:mm:ss 'GMT'").toLatin1();
+    auto delay = _policy->delay(0, value);
+    QVERIFY(delay > 25000);
+    QVERIFY(delay <= 30000);
+
+    // dates in the past mean right away
+    date = QDateTime::currentDateTimeUtc().addSecs(-30);
+    value = QLocale::c().toString(date,
+        "ddd, dd MMM yyyy hh:mm:ss 'GMT'").toLatin1();
+    QCOMPARE(_policy->delay(0, value), 0);
+}
+
+void
+TestRetryPolicy::testRetryAfterInvalid() {
+    // falls back to the backoff
+    auto delay = _policy->delay(0, "tomorrow");
+    QVERIFY(delay >= 500);
+    QVERIFY(delay <= 1000);
+}
+
+void
+TestRetryPolicy::testIsStalled_data() {
+    QTest::addColumn<qulonglong>("speed");
+    QTest::addColumn<qulonglong>("received");
+    QTest::addColumn<qulonglong>("throttle");
+    QTest::addColumn<bool>("result");
+
+    QTest::newRow("No data") << 0ULL << 0ULL << 0ULL << true;
+    QTest::newRow("Some data") << 0ULL << 1ULL << 0ULL << false;
+    QTest::newRow("Under the speed") << 1024ULL << 1000ULL << 0ULL << true;
+    QTest::newRow("Over the speed") << 1024ULL << 2048ULL << 0ULL << false;
+    QTest::newRow("Throttled") << 1024ULL << 1000ULL << 512ULL << false;
+    QTest::newRow("Throttled no data") << 1024ULL << 0ULL << 512ULL << true;
+}
+
+void
+TestRetryPolicy::testIsStalled() {
+    QFETCH(qulonglong, speed);
+    QFETCH(qulonglong, received);
+    QFETCH(qulonglong, throttle);
+    QFETCH(bool, result);
+
+    _policy->setStallSpeed(speed);
+    // the data received in a second
+    QCOMPARE(_policy->isStalled(received, 1000, throttle), result);
+}
+
+QTEST_MAIN(TestRetryPolicy)
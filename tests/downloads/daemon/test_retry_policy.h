@@ -0,0 +1,57 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_RETRY_POLICY_H
+#define TEST_RETRY_POLICY_H
+
+#include <QObject>
+#include <ubuntu/transfers/system/retry_policy.h>
+
+#include "base_testcase.h"
+
+using namespace Ubuntu::Transfers::System;
+using namespace Ubuntu::Transfers::Tests;
+
+class TestRetryPolicy : public BaseTestCase {
+    Q_OBJECT
+
+ public:
+    explicit TestRetryPolicy(QObject *parent = 0)
+        : BaseTestCase("TestRetryPolicy", parent) {}
+
+ private slots:  // NOLINT(whitespace/indent)
+
+    void init() override;
+    void cleanup() override;
+
+    void testIsTransient_data();
+    void testIsTransient();
+    void testDelayBackoff_data();
+    void testDelayBackoff();
+    void testDelayCapped();
+    void testRetryAfterSeconds();
+    void testRetryAfterDate();
+    void testRetryAfterInvalid();
+    void testIsStalled_data();
+    void testIsStalled();
+
+ private:
+    RetryPolicy* _policy;
+};
+
+#endif  // TEST_RETRY_POLICY_H
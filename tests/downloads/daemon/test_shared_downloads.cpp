@@ -0,0 +1,84 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QCryptographicHash>
+#include "test_shared_downloads.h"
+
+void
+TestSharedDownloads::testKeyIgnoresHeaderCase() {
+    QUrl url("http://ubuntu.com/data.txt");
+    QMap<QString, QString> first, second;
+    first["Accept"] = "text/plain";
+    first["User-Agent"] = "udm";
+    second["user-agent"] = "udm";
+    second["accept"] = "text/plain";
+
+    QCOMPARE(SharedDownloads::key(url, first, "", QCryptographicHash::Md5),
+        SharedDownloads::key(url, second, "", QCryptographicHash::Md5));
+}
+
+void
+TestSharedDownloads::testKeyUsesHeaders() {
+    QUrl url("http://ubuntu.com/data.txt");
+    QMap<QString, QString> first, second;
+    first["Cookie"] = "session=1";
+    second["Cookie"] = "session=2";
+
+    // diff credentials can return diff data
+    QVERIFY(SharedDownloads::key(url, first, "", QCryptographicHash::Md5)
+        != SharedDownloads::key(url, second, "", QCryptographicHash::Md5));
+}
+
+void
+TestSharedDownloads::testKeyUsesHash() {
+    QUrl url("http://ubuntu.com/data.txt");
+    QMap<QString, QString> headers;
+
+    QVERIFY(SharedDownloads::key(url, headers, "abcd",
+            QCryptographicHash::Md5)
+        != SharedDownloads::key(url, headers, "abce",
+            QCryptographicHash::Md5));
+    QVERIFY(SharedDownloads::key(url, headers, "abcd",
+            QCryptographicHash::Md5)
+        != SharedDownloads::key(url, headers, "abcd",
+            QCryptographicHash::Sha1));
+    QCOMPARE(SharedDownloads::key(url, headers, "ABCD",
+            QCryptographicHash::Md5),
+        SharedDownloads::key(url, headers, "abcd",
+            QCryptographicHash::Md5));
+}
+
+void
+TestSharedDownloads::testKeyUsesUrl() {
+    QMap<QString, QString> headers;
+    QVERIFY(SharedDownloads::key(QUrl("http://ubuntu.com/data.txt"),
+            headers, "", QCryptographicHash::Md5)
+        != SharedDownloads::key(QUrl("http://ubuntu.com/other.txt"),
+            headers, "", QCryptographicHash::Md5));
+}
+
+void
+TestSharedDownloads::testNoLeader() {
+    SharedDownloads shared;
+    QMap<QString, QString> headers;
+    auto key = SharedDownloads::key(QUrl("http://ubuntu.com/data.txt"),
+        headers, "", QCryptographicHash::Md5);
+    QVERIFY(shared.leader(key) == nullptr);
+}
+
+QTEST_MAIN(TestSharedDownloads)
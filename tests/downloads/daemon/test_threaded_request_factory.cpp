@@ -0,0 +1,156 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QFile>
+#include <QScopedPointer>
+#include <QSignalSpy>
+#include <QUrl>
+#include "test_threaded_request_factory.h"
+
+void
+TestThreadedRequestFactory::init() {
+    BaseTestCase::init();
+    _factory = new ThreadedRequestFactory(2);
+}
+
+void
+TestThreadedRequestFactory::cleanup() {
+    BaseTestCase::cleanup();
+    delete _factory;
+}
+
+QString
+TestThreadedRequestFactory::writeFile(const QByteArray& data) {
+    auto path = testDirectory() + "/served_file";
+    QFile file(path);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    file.write(data);
+    file.close();
+    return path;
+}
+
+void
+TestThreadedRequestFactory::testThreadsCreated() {
+    QCOMPARE(_factory->threads(), 2);
+
+    // at least one thread is always used
+    QScopedPointer<ThreadedRequestFactory> factory(
+        new ThreadedRequestFactory(0));
+    QCOMPARE(factory->threads(), 1);
+}
+
+void
+TestThreadedRequestFactory::testGetData() {
+    QNetworkRequest request(QUrl("data:text/plain,threaded"));
+    QScopedPointer<NetworkReply> reply(_factory->get(request));
+    SignalBarrier spy(reply.data(), SIGNAL(finished()));
+
+    QVERIFY(spy.ensureSignalEmitted());
+    QCOMPARE(reply->readAll(), QByteArray("threaded"));
+    QVERIFY(reply->hasRawHeader("Content-Type"));
+    QVERIFY(reply->rawHeader("content-type").startsWith("text/plain"));
+}
+
+void
+TestThreadedRequestFactory::testGetFile() {
+    QByteArray data(512 * 1024, 'd');
+    auto path = writeFile(data);
+    QNetworkRequest request(QUrl::fromLocalFile(path));
+    QScopedPointer<NetworkReply> reply(_factory->get(request));
+    SignalBarrier spy(reply.data(), SIGNAL(finished()));
+
+    // the data is received in several chunks
+    QByteArray received;
+    connect(reply.data(), &NetworkReply::downloadProgress,
+        [&received, &reply](qint64, qint64) {
+            received.append(reply->readAll());
+        });
+
+    QVERIFY(spy.ensureSignalEmitted());
+    received.append(reply->readAll());
+    QCOMPARE(received, data);
+}
+
+void
+TestThreadedRequestFactory::testGetFileSmallReadBuffer() {
+    QByteArray data(512 * 1024, 's');
+    auto path = writeFile(data);
+    QNetworkRequest request(QUrl::fromLocalFile(path));
+    QScopedPointer<NetworkReply> reply(_factory->get(request));
+    reply->setReadBufferSize(16 * 1024);
+    SignalBarrier spy(reply.data(), SIGNAL(finished()));
+
+    // the data is forwarded as it is read, nothing is lost or reordered
+    QByteArray received;
+    connect(reply.data(), &NetworkReply::downloadProgress,
+        [&received, &reply](qint64, qint64) {
+            received.append(reply->readAll());
+        });
+
+    QVERIFY(spy.ensureSignalEmitted());
+    received.append(reply->readAll());
+    QCOMPARE(received, data);
+}
+
+void
+TestThreadedRequestFactory::testGetMissingFile() {
+    QNetworkRequest request(QUrl::fromLocalFile(
+        testDirectory() + "/missing_file"));
+    QScopedPointer<NetworkReply> reply(_factory->get(request));
+    SignalBarrier errorSpy(reply.data(),
+        SIGNAL(error(QNetworkReply::NetworkError)));
+
+    QVERIFY(errorSpy.ensureSignalEmitted());
+    QVERIFY(!reply->errorString().isEmpty());
+}
+
+void
+TestThreadedRequestFactory::testAbortEmitsSignals() {
+    QNetworkRequest request(QUrl("data:text/plain,aborted"));
+    QScopedPointer<NetworkReply> reply(_factory->get(request));
+    QSignalSpy errorSpy(reply.data(),
+        SIGNAL(error(QNetworkReply::NetworkError)));
+    QSignalSpy finishedSpy(reply.data(), SIGNAL(finished()));
+
+    // the signals are emitted before abort returns, as with QNetworkReply
+    reply->abort();
+    QCOMPARE(errorSpy.count(), 1);
+    QCOMPARE(finishedSpy.count(), 1);
+
+    // the signals of the network thread are ignored
+    QTest::qWait(100);
+    QCOMPARE(finishedSpy.count(), 1);
+}
+
+void
+TestThreadedRequestFactory::testRepliesSpreadAcrossThreads() {
+    // the second reply goes to the idle thread, both must finish
+    QScopedPointer<NetworkReply> first(_factory->get(
+        QNetworkRequest(QUrl("data:text/plain,first"))));
+    QScopedPointer<NetworkReply> second(_factory->get(
+        QNetworkRequest(QUrl("data:text/plain,second"))));
+    QSignalSpy firstSpy(first.data(), SIGNAL(finished()));
+    QSignalSpy secondSpy(second.data(), SIGNAL(finished()));
+
+    QTRY_COMPARE(firstSpy.count(), 1);
+    QTRY_COMPARE(secondSpy.count(), 1);
+    QCOMPARE(first->readAll(), QByteArray("first"));
+    QCOMPARE(second->readAll(), QByteArray("second"));
+}
+
+QTEST_MAIN(TestThreadedRequestFactory)
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "test_timeline.h"
+
+void
+TestTimeline::testBeginEnd() {
+    Timeline timeline("/download/1");
+    auto before = Timeline::now();
+    timeline.begin("receive");
+    QVERIFY(timeline.isOpen("receive"));
+
+    timeline.end("receive", 1024);
+    QVERIFY(!timeline.isOpen("receive"));
+
+    auto spans = timeline.spans();
+    QCOMPARE(spans.count(), 1);
+    QCOMPARE(spans[0].name, QString("receive"));
+    QVERIFY(spans[0].start >= before);
+    QVERIFY(spans[0].end >= spans[0].start);
+    QCOMPARE(spans[0].bytes, 1024ull);
+    QVERIFY(spans[0].error.isEmpty());
+}
+
+void
+TestTimeline::testEndClosesLastOpen() {
+    Timeline timeline("/download/1");
+    timeline.begin("receive");
+    timeline.begin("receive");
+    timeline.end("receive", 0, "error");
+
+    auto spans = timeline.spans();
+    QCOMPARE(spans.count(), 2);
+    QCOMPARE(spans[0].end, -1LL);
+    QVERIFY(spans[1].end >= 0);
+    QCOMPARE(spans[1].error, QString("error"));
+}
+
+void
+TestTimeline::testEndNotOpen() {
+    Timeline timeline("/download/1");
+    timeline.begin("connect");
+    timeline.end("receive", 10);
+
+    auto spans = timeline.spans();
+    QCOMPARE(spans.count(), 1);
+    QCOMPARE(spans[0].end, -1LL);
+    QCOMPARE(spans[0].bytes, 0ull);
+}
+
+void
+TestTimeline::testMark() {
+    Timeline timeline("/download/1");
+    timeline.mark("paused");
+
+    auto spans = timeline.spans();
+    QCOMPARE(spans.count(), 1);
+    QVERIFY(spans[0].end >= spans[0].start);
+    QVERIFY(!timeline.isOpen("paused"));
+}
+
+void
+TestTimeline::testEndAll() {
+    Timeline timeline("/download/1");
+    timeline.begin("download");
+    timeline.begin("hash");
+    timeline.end("hash");
+    timeline.begin("process");
+    timeline.endAll("COMMAND ERROR");
+
+    auto spans = timeline.spans();
+    QCOMPARE(spans.count(), 3);
+    QCOMPARE(spans[0].error, QString("COMMAND ERROR"));
+    // the spans that were already closed are not modified
+    QVERIFY(spans[1].error.isEmpty());
+    QCOMPARE(spans[2].error, QString("COMMAND ERROR"));
+    foreach(const TimelineSpan& span, spans) {
+        QVERIFY(span.end >= span.start);
+    }
+}
+
+void
+TestTimeline::testMaxSpans() {
+    Timeline timeline("/download/1");
+    for (int index = 0; index < 2000; index++) {
+        timeline.mark("retry wait");
+    }
+    QCOMPARE(timeline.spans().count(), 1024);
+    QCOMPARE(timeline.dropped(), 2000 - 1024);
+}
+
+void
+TestTimeline::testToVariantList() {
+    Timeline timeline("/download/1");
+    timeline.begin("receive");
+    timeline.end("receive", 42, "NETWORK ERROR 5");
+
+    auto spans = timeline.toVariantList();
+    QCOMPARE(spans.count(), 1);
+    auto span = spans[0].toMap();
+    QCOMPARE(span["name"].toString(), QString("receive"));
+    QVERIFY(span.contains("start"));
+    QVERIFY(span.contains("end"));
+    QCOMPARE(span["bytes"].toULongLong(), 42ull);
+    QCOMPARE(span["error"].toString(), QString("NETWORK ERROR 5"));
+}
+
+void
+TestTimeline::testChromeTrace() {
+    Timeline timeline("/download/1");
+    timeline.begin("receive");
+    timeline.end("receive", 42);
+    timeline.mark("paused");
+    // open spans are drawn up to now
+    timeline.begin("download");
+
+    auto trace = QJsonDocument::fromJson(timeline.toChromeTrace());
+    QVERIFY(trace.isObject());
+    auto events = trace.object()["traceEvents"].toArray();
+    QCOMPARE(events.count(), 4);
+
+    auto metadata = events[0].toObject();
+    QCOMPARE(metadata["ph"].toString(), QString("M"));
+    QCOMPARE(metadata["args"].toObject()["name"].toString(),
+        QString("/download/1"));
+
+    QStringList names;
+    for (int index = 1; index < events.count(); index++) {
+        auto event = events[index].toObject();
+        names << event["name"].toString();
+        QVERIFY(event.contains("ts"));
+        if (event["ph"].toString() == "X") {
+            QVERIFY(event["dur"].toDouble() >= 0);
+        } else {
+            QCOMPARE(event["ph"].toString(), QString("i"));
+        }
+    }
+    QCOMPARE(names, QStringList() << "receive" << "paused" << "download");
+    QCOMPARE(events[1].toObject()["args"].toObject()["bytes"].toInt(), 42);
+}
+
+void
+TestTimeline::testSave() {
+    Timeline timeline("/com/canonical/applications/download/1");
+    timeline.mark("paused");
+
+    auto dir = testDirectory() + QDir::separator() + "traces";
+    QVERIFY(timeline.save(dir));
+
+    QFile file(QDir(dir).filePath(
+        "com_canonical_applications_download_1.json"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), timeline.toChromeTrace());
+}
+
+QTEST_MAIN(TestTimeline)
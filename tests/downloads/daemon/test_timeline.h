@@ -0,0 +1,50 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_TIMELINE_H
+#define TEST_TIMELINE_H
+
+#include <QObject>
+#include <ubuntu/transfers/system/timeline.h>
+
+#include "base_testcase.h"
+
+using namespace Ubuntu::Transfers::System;
+using namespace Ubuntu::Transfers::Tests;
+
+class TestTimeline : public BaseTestCase {
+    Q_OBJECT
+
+ public:
+    explicit TestTimeline(QObject *parent = 0)
+        : BaseTestCase("TestTimeline", parent) {}
+
+ private slots:  // NOLINT(whitespace/indent)
+
+    void testBeginEnd();
+    void testEndClosesLastOpen();
+    void testEndNotOpen();
+    void testMark();
+    void testEndAll();
+    void testMaxSpans();
+    void testToVariantList();
+    void testChromeTrace();
+    void testSave();
+};
+
+#endif  // TEST_TIMELINE_H
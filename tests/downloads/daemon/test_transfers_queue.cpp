@@ -25,10 +25,13 @@ using ::testing::AnyNumber;
 using ::testing::Return;
 using ::testing::Return;
 using ::testing::AnyOf;
+using ::testing::An;
+using ::testing::Matcher;
 
 void
 TestTransferQueue::verifyMocks() {
     QVERIFY(Mock::VerifyAndClearExpectations(_networkInfo));
+    QVERIFY(Mock::VerifyAndClearExpectations(_fileManager));
     QVERIFY(Mock::VerifyAndClearExpectations(_first));
     QVERIFY(Mock::VerifyAndClearExpectations(_second));
 }
@@ -40,6 +43,8 @@ TestTransferQueue::init() {
     _rootPath = "/random/root/path";
     _networkInfo = new MockNetworkSession();
     NetworkSession::setInstance(_networkInfo);
+    _fileManager = new MockFileManager();
+    FileManager::setInstance(_fileManager);
     _first = new MockTransfer(UuidUtils::getDBusString(QUuid::createUuid()),
         "first-path", _isConfined, "/root/path");
     _second = new MockTransfer(UuidUtils::getDBusString(QUuid::createUuid()),
@@ -52,6 +57,7 @@ TestTransferQueue::cleanup() {
     BaseTestCase::cleanup();
 
     NetworkSession::deleteInstance();
+    FileManager::deleteInstance();
     delete _first;
     delete _second;
     delete _q;
@@ -948,6 +954,243 @@ TestTransferQueue::testTransferErrorWithOtherReady() {
     verifyMocks();
 }
 
+void
+TestTransferQueue::testStartTransferWithSpace() {
+    auto path = QString("path");
+    auto storagePath = QString("/downloads/file");
+    qulonglong required = 1000;
+
+    EXPECT_CALL(*_first, addToQueue())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*_first, state())
+        .Times(2)
+        .WillRepeatedly(Return(Transfer::START));
+
+    EXPECT_CALL(*_first, path())
+        .Times(1)
+        .WillRepeatedly(Return(path));
+
+    EXPECT_CALL(*_first, canTransfer())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*_first, storagePath())
+        .Times(1)
+        .WillOnce(Return(storagePath));
+
+    EXPECT_CALL(*_first, requiredSpace())
+        .Times(1)
+        .WillOnce(Return(required));
+
+    EXPECT_CALL(*_fileManager, bytesAvailable(storagePath))
+        .Times(1)
+        .WillOnce(Return(static_cast<qint64>(
+            required + _q->spaceWatermark())));
+
+    EXPECT_CALL(*_first, setState(Transfer::WAITING_FOR_SPACE))
+        .Times(0);
+
+    EXPECT_CALL(*_first, startTransfer())
+        .Times(1);
+
+    SignalBarrier spy(_q, SIGNAL(currentChanged(QString, QString)));
+    _q->add(_first);
+
+    _first->stateChanged();
+    QVERIFY(spy.ensureSignalEmitted());
+    QCOMPARE(spy.count(), 1);
+
+    QList<QVariant> arguments = spy.takeFirst();
+    QCOMPARE(arguments.at(1).toString(), path);
+    verifyMocks();
+}
+
+void
+TestTransferQueue::testStartTransferWaitsForSpace() {
+    auto path = QString("path");
+    auto storagePath = QString("/downloads/file");
+    qulonglong required = 1000;
+
+    EXPECT_CALL(*_first, addToQueue())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*_first, state())
+        .Times(2)
+        .WillRepeatedly(Return(Transfer::START));
+
+    EXPECT_CALL(*_first, path())
+        .Times(1)
+        .WillRepeatedly(Return(path));
+
+    EXPECT_CALL(*_first, canTransfer())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*_first, storagePath())
+        .Times(1)
+        .WillOnce(Return(storagePath));
+
+    EXPECT_CALL(*_first, requiredSpace())
+        .Times(1)
+        .WillOnce(Return(required));
+
+    // the watermark is not available
+    EXPECT_CALL(*_fileManager, bytesAvailable(storagePath))
+        .Times(1)
+        .WillOnce(Return(static_cast<qint64>(
+            required + _q->spaceWatermark() - 1)));
+
+    EXPECT_CALL(*_first, setState(Transfer::WAITING_FOR_SPACE))
+        .Times(1);
+
+    EXPECT_CALL(*_first, startTransfer())
+        .Times(0);
+
+    SignalBarrier spy(_q, SIGNAL(currentChanged(QString, QString)));
+    _q->add(_first);
+
+    _first->stateChanged();
+    QVERIFY(spy.ensureSignalEmitted());
+    QCOMPARE(spy.count(), 1);
+
+    QList<QVariant> arguments = spy.takeFirst();
+    QCOMPARE(arguments.at(1).toString(), QString(""));
+    verifyMocks();
+}
+
+void
+TestTransferQueue::testStartTransferWithDescriptor() {
+    auto path = QString("path");
+    int fd = 7;
+    qulonglong required = 1000;
+
+    EXPECT_CALL(*_first, addToQueue())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*_first, state())
+        .Times(2)
+        .WillRepeatedly(Return(Transfer::START));
+
+    EXPECT_CALL(*_first, path())
+        .Times(1)
+        .WillRepeatedly(Return(path));
+
+    EXPECT_CALL(*_first, canTransfer())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*_first, storageDescriptor())
+        .Times(AnyNumber())
+        .WillRepeatedly(Return(fd));
+
+    EXPECT_CALL(*_first, storagePath())
+        .Times(AnyNumber())
+        .WillRepeatedly(Return(QString("/proc/self/fd/%1").arg(fd)));
+
+    EXPECT_CALL(*_first, requiredSpace())
+        .Times(AnyNumber())
+        .WillRepeatedly(Return(required));
+
+    // the link of the descriptor is in procfs which has no free space
+    EXPECT_CALL(*_fileManager, bytesAvailable(An<const QString&>()))
+        .Times(0);
+
+    EXPECT_CALL(*_fileManager, bytesAvailable(fd))
+        .Times(1)
+        .WillOnce(Return(static_cast<qint64>(
+            required + _q->spaceWatermark())));
+
+    EXPECT_CALL(*_fileManager, fileSystemId(fd))
+        .Times(AnyNumber())
+        .WillRepeatedly(Return(1));
+
+    EXPECT_CALL(*_first, setState(Transfer::WAITING_FOR_SPACE))
+        .Times(0);
+
+    EXPECT_CALL(*_first, startTransfer())
+        .Times(1);
+
+    SignalBarrier spy(_q, SIGNAL(currentChanged(QString, QString)));
+    _q->add(_first);
+
+    _first->stateChanged();
+    QVERIFY(spy.ensureSignalEmitted());
+    QCOMPARE(spy.count(), 1);
+
+    QList<QVariant> arguments = spy.takeFirst();
+    QCOMPARE(arguments.at(1).toString(), path);
+
+    // the space is reserved in the file system of the descriptor
+    EXPECT_CALL(*_fileManager, fileSystemId(Matcher<const QString&>(_)))
+        .WillRepeatedly(Return(1));
+    QCOMPARE(_q->reservedSpace("/downloads/file"), required);
+    verifyMocks();
+}
+
+void
+TestTransferQueue::testReservedSpace() {
+    auto path = QString("path");
+    auto storagePath = QString("/downloads/file");
+    auto otherPath = QString("/downloads/other");
+    auto diffFileSystemPath = QString("/media/other");
+    qulonglong required = 1000;
+
+    EXPECT_CALL(*_first, addToQueue())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*_first, state())
+        .Times(2)
+        .WillRepeatedly(Return(Transfer::START));
+
+    EXPECT_CALL(*_first, path())
+        .Times(1)
+        .WillRepeatedly(Return(path));
+
+    EXPECT_CALL(*_first, canTransfer())
+        .Times(1)
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*_first, storagePath())
+        .Times(AnyNumber())
+        .WillRepeatedly(Return(storagePath));
+
+    EXPECT_CALL(*_first, requiredSpace())
+        .Times(AnyNumber())
+        .WillRepeatedly(Return(required));
+
+    EXPECT_CALL(*_fileManager, bytesAvailable(storagePath))
+        .Times(1)
+        .WillOnce(Return(-1));  // unknown, do not block
+
+    EXPECT_CALL(*_fileManager, fileSystemId(
+            Matcher<const QString&>(AnyOf(storagePath, otherPath))))
+        .Times(AnyNumber())
+        .WillRepeatedly(Return(1));
+
+    EXPECT_CALL(*_fileManager, fileSystemId(diffFileSystemPath))
+        .Times(AnyNumber())
+        .WillRepeatedly(Return(2));
+
+    EXPECT_CALL(*_first, startTransfer())
+        .Times(1);
+
+    SignalBarrier spy(_q, SIGNAL(currentChanged(QString, QString)));
+    _q->add(_first);
+
+    _first->stateChanged();
+    QVERIFY(spy.ensureSignalEmitted());
+
+    // the current transfer reserves the space in its file system
+    QCOMPARE(_q->reservedSpace(otherPath), required);
+    QCOMPARE(_q->reservedSpace(diffFileSystemPath), 0ULL);
+    verifyMocks();
+}
+
 void
 TestTransferQueue::testNewUnmanagedIncreasesNumber() {
     EXPECT_CALL(*_first, addToQueue())
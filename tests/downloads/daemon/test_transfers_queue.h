@@ -24,6 +24,7 @@
 #include <process_factory.h>
 #include <request_factory.h>
 #include <network_session.h>
+#include <file_manager.h>
 
 #include "base_testcase.h"
 #include "transfer.h"
@@ -64,6 +65,12 @@ class TestTransferQueue : public BaseTestCase {
     void testTransferFinishedOtherReady();
     void testTransferErrorWithOtherReady();
 
+    // space admission tests
+    void testStartTransferWithSpace();
+    void testStartTransferWaitsForSpace();
+    void testStartTransferWithDescriptor();
+    void testReservedSpace();
+
     // unmanaged downloads tests
     void testNewUnmanagedIncreasesNumber();
     void testErrorUnmanagedDecreasesNumber();
@@ -74,6 +81,7 @@ class TestTransferQueue : public BaseTestCase {
     bool _isConfined;
     QString _rootPath;
     MockNetworkSession* _networkInfo;
+    MockFileManager* _fileManager;
     MockTransfer* _first;
     MockTransfer* _second;
     Queue* _q;
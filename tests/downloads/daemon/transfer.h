@@ -35,7 +35,11 @@ class MockTransfer : public Transfer {
              bool isConfined,
              const QString& rootPath,
              QObject* parent = 0)
-        : Transfer(id, "", path, isConfined, rootPath, parent) {}
+        : Transfer(id, "", path, isConfined, rootPath, parent) {
+        // the data is not written to a descriptor unless a test says so
+        ON_CALL(*this, storageDescriptor())
+            .WillByDefault(testing::Return(-1));
+    }
 
     MOCK_CONST_METHOD0(transferId, QString());
     MOCK_CONST_METHOD0(path, QString());
@@ -51,6 +55,9 @@ class MockTransfer : public Transfer {
     MOCK_METHOD0(pauseTransfer, void());
     MOCK_METHOD0(resumeTransfer, void());
     MOCK_METHOD0(startTransfer, void());
+    MOCK_METHOD0(storagePath, QString());
+    MOCK_METHOD0(storageDescriptor, int());
+    MOCK_METHOD0(requiredSpace, qulonglong());
     MOCK_METHOD1(setThrottle, void(qulonglong));
     MOCK_METHOD0(throttle, qulonglong());
     MOCK_METHOD1(allowGSMDownload, void(bool));
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <sys/stat.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include "zip_builder.h"
+#include "test_parallel_unzip.h"
+
+QString
+TestParallelUnZip::archivePath() {
+    return testDirectory() + QDir::separator() + "test.zip";
+}
+
+QString
+TestParallelUnZip::destination() {
+    return testDirectory() + QDir::separator() + "out";
+}
+
+QByteArray
+TestParallelUnZip::readFile(const QString& name) {
+    QFile file(destination() + QDir::separator() + name);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+void
+TestParallelUnZip::testExtractStored() {
+    ZipBuilder builder;
+    builder.addFile("a.txt", "first stored entry");
+    builder.addFile("b.txt", "second stored entry");
+    QVERIFY(builder.write(archivePath()));
+
+    ParallelUnZip unzip(archivePath(), destination(), 2);
+    unzip.deflate();
+
+    QCOMPARE(readFile("a.txt"), QByteArray("first stored entry"));
+    QCOMPARE(readFile("b.txt"), QByteArray("second stored entry"));
+}
+
+void
+TestParallelUnZip::testExtractDeflated() {
+    // larger than the chunks used to inflate the data
+    QByteArray large;
+    for (int index = 0; large.size() < 1024 * 1024; index++) {
+        large += QByteArray::number(index);
+    }
+    ZipBuilder builder;
+    builder.addFile("large.bin", large, true);
+    builder.addFile("small.txt", "small deflated entry", true);
+    QVERIFY(builder.write(archivePath()));
+
+    ParallelUnZip unzip(archivePath(), destination(), 4);
+    unzip.deflate();
+
+    QCOMPARE(readFile("large.bin"), large);
+    QCOMPARE(readFile("small.txt"), QByteArray("small deflated entry"));
+}
+
+void
+TestParallelUnZip::testExtractDirsAndSymLinks() {
+    ZipBuilder builder;
+    builder.addDir("dir");
+    builder.addFile("dir/nested/file.txt", "nested", true);
+    builder.addSymLink("link", "dir/nested/file.txt");
+    QVERIFY(builder.write(archivePath()));
+
+    ParallelUnZip unzip(archivePath(), destination(), 2);
+    unzip.deflate();
+
+    QVERIFY(QFileInfo(destination() + "/dir").isDir());
+    QCOMPARE(readFile("dir/nested/file.txt"), QByteArray("nested"));
+    QFileInfo link(destination() + "/link");
+    QVERIFY(link.isSymLink());
+    QCOMPARE(readFile("link"), QByteArray("nested"));
+}
+
+void
+TestParallelUnZip::testStripsSpecialBits() {
+    ZipBuilder builder;
+    builder.addFile("setuid", "data", false, 0106755);
+    builder.addFile("sticky", "data", false, 0101640);
+    QVERIFY(builder.write(archivePath()));
+
+    ParallelUnZip unzip(archivePath(), destination(), 2);
+    unzip.deflate();
+
+    struct stat info;
+    auto setuid = QFile::encodeName(destination() + "/setuid");
+    QCOMPARE(stat(setuid.constData(), &info), 0);
+    QCOMPARE(info.st_mode & 07777, 0755U);
+
+    auto sticky = QFile::encodeName(destination() + "/sticky");
+    QCOMPARE(stat(sticky.constData(), &info), 0);
+    QCOMPARE(info.st_mode & 07777, 0640U);
+}
+
+void
+TestParallelUnZip::testCanExtract() {
+    ZipEntry dir;
+    dir.name = "dir/";
+    ZipEntry file;
+    file.name = "dir/file.txt";
+    file.method = ZipEntry::Deflated;
+
+    QString reason;
+    QVERIFY(ParallelUnZip::canExtract(QList<ZipEntry>() << dir << file,
+        reason));
+    QVERIFY(reason.isEmpty());
+}
+
+void
+TestParallelUnZip::testCanExtractPathTraversal_data() {
+    QTest::addColumn<QString>("name");
+
+    QTest::newRow("Parent") << "../evil.txt";
+    QTest::newRow("Nested parent") << "dir/../../evil.txt";
+    QTest::newRow("Absolute") << "/tmp/evil.txt";
+    QTest::newRow("Only parent") << "..";
+}
+
+void
+TestParallelUnZip::testCanExtractPathTraversal() {
+    QFETCH(QString, name);
+    ZipEntry entry;
+    entry.name = name;
+
+    QString reason;
+    QVERIFY(!ParallelUnZip::canExtract(QList<ZipEntry>() << entry, reason));
+    QVERIFY(reason.contains("outside the destination"));
+}
+
+void
+TestParallelUnZip::testCanExtractDuplicates_data() {
+    QTest::addColumn<QString>("first");
+    QTest::addColumn<QString>("second");
+
+    QTest::newRow("Same name") << "file.txt" << "file.txt";
+    QTest::newRow("Same clean path") << "dir/file.txt" << "dir/./file.txt";
+    QTest::newRow("Dir and file") << "dir/" << "dir";
+}
+
+void
+TestParallelUnZip::testCanExtractDuplicates() {
+    QFETCH(QString, first);
+    QFETCH(QString, second);
+    ZipEntry firstEntry;
+    firstEntry.name = first;
+    ZipEntry secondEntry;
+    secondEntry.name = second;
+
+    QString reason;
+    QVERIFY(!ParallelUnZip::canExtract(
+        QList<ZipEntry>() << firstEntry << secondEntry, reason));
+    QVERIFY(reason.contains("duplicated"));
+}
+
+QTEST_MAIN(TestParallelUnZip)
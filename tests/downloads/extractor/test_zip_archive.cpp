@@ -0,0 +1,125 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <zlib.h>
+#include <QDir>
+#include <QFile>
+#include "zip_builder.h"
+#include "test_zip_archive.h"
+
+QString
+TestZipArchive::archivePath() {
+    return testDirectory() + QDir::separator() + "test.zip";
+}
+
+void
+TestZipArchive::testStoredEntry() {
+    QByteArray data("stored data");
+    ZipBuilder builder;
+    builder.addFile("dir/stored.txt", data, false, 0100640);
+    QVERIFY(builder.write(archivePath()));
+
+    ZipArchive archive(archivePath());
+    QVERIFY(archive.open());
+    auto entries = archive.entries();
+    QCOMPARE(entries.count(), 1);
+
+    auto entry = entries.first();
+    QCOMPARE(entry.name, QString("dir/stored.txt"));
+    QCOMPARE(entry.method, static_cast<quint16>(ZipEntry::Stored));
+    QCOMPARE(entry.compressedSize, static_cast<quint64>(data.size()));
+    QCOMPARE(entry.uncompressedSize, static_cast<quint64>(data.size()));
+    QCOMPARE(entry.crc, static_cast<quint32>(crc32(0L,
+        reinterpret_cast<const Bytef*>(data.constData()), data.size())));
+    QCOMPARE(entry.mode, 0100640U);
+    QVERIFY(!entry.isDir());
+    QVERIFY(!entry.isSymLink());
+    QVERIFY(!entry.isEncrypted());
+}
+
+void
+TestZipArchive::testDeflatedEntry() {
+    QByteArray data(64 * 1024, 'd');
+    ZipBuilder builder;
+    builder.addFile("deflated.txt", data, true);
+    QVERIFY(builder.write(archivePath()));
+
+    ZipArchive archive(archivePath());
+    QVERIFY(archive.open());
+    auto entry = archive.entries().first();
+    QCOMPARE(entry.method, static_cast<quint16>(ZipEntry::Deflated));
+    QCOMPARE(entry.uncompressedSize, static_cast<quint64>(data.size()));
+    QVERIFY(entry.compressedSize < entry.uncompressedSize);
+}
+
+void
+TestZipArchive::testDirAndSymLink() {
+    ZipBuilder builder;
+    builder.addDir("dir");
+    builder.addSymLink("link", "dir");
+    QVERIFY(builder.write(archivePath()));
+
+    ZipArchive archive(archivePath());
+    QVERIFY(archive.open());
+    auto entries = archive.entries();
+    QCOMPARE(entries.count(), 2);
+    QVERIFY(entries[0].isDir());
+    QVERIFY(!entries[0].isSymLink());
+    QVERIFY(!entries[1].isDir());
+    QVERIFY(entries[1].isSymLink());
+}
+
+void
+TestZipArchive::testDataOffset() {
+    ZipBuilder builder;
+    builder.addFile("first.txt", "first");
+    builder.addFile("second.txt", "second");
+    QVERIFY(builder.write(archivePath()));
+
+    ZipArchive archive(archivePath());
+    QVERIFY(archive.open());
+
+    QFile file(archivePath());
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    auto entry = archive.entries()[1];
+    auto offset = ZipArchive::dataOffset(&file, entry);
+    QVERIFY(offset > 0);
+    QVERIFY(file.seek(offset));
+    QCOMPARE(file.read(entry.compressedSize), QByteArray("second"));
+}
+
+void
+TestZipArchive::testNotZip() {
+    QFile file(archivePath());
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(QByteArray(1024, 'x'));
+    file.close();
+
+    ZipArchive archive(archivePath());
+    QVERIFY(!archive.open());
+    QVERIFY(!archive.lastError().isEmpty());
+}
+
+void
+TestZipArchive::testMissingFile() {
+    ZipArchive archive(testDirectory() + QDir::separator() + "missing.zip");
+    QVERIFY(!archive.open());
+    QVERIFY(!archive.lastError().isEmpty());
+}
+
+QTEST_MAIN(TestZipArchive)
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <cstring>
+
+#include <zlib.h>
+#include <QDataStream>
+#include <QFile>
+#include "zip_builder.h"
+
+namespace {
+    const quint32 LOCAL_HEADER_SIGNATURE = 0x04034b50;
+    const quint32 CENTRAL_DIR_SIGNATURE = 0x02014b50;
+    const quint32 END_OF_CENTRAL_DIR_SIGNATURE = 0x06054b50;
+    const quint16 VERSION = 20;
+    const quint16 UNIX_MADE_BY = (3 << 8) | VERSION;
+    const quint16 UTF8_NAME_FLAG = 0x0800;
+    const quint16 DOS_DATE = (1 << 5) | 1;  // 1980-01-01
+    const quint16 DOS_TIME = 0;
+}
+
+void
+ZipBuilder::addFile(const QString& name,
+                    const QByteArray& data,
+                    bool deflated,
+                    quint32 mode) {
+    add(name, data, deflated, mode);
+}
+
+void
+ZipBuilder::addDir(const QString& name, quint32 mode) {
+    add(name.endsWith('/') ? name : name + '/', QByteArray(), false, mode);
+}
+
+void
+ZipBuilder::addSymLink(const QString& name, const QString& target) {
+    add(name, target.toUtf8(), false, 0120777);
+}
+
+bool
+ZipBuilder::write(const QString& path) const {
+    QByteArray archive;
+    QDataStream out(&archive, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    QList<quint32> offsets;
+    foreach(const Entry& entry, _entries) {
+        auto name = entry.name.toUtf8();
+        offsets << static_cast<quint32>(archive.size());
+        out << LOCAL_HEADER_SIGNATURE << VERSION << UTF8_NAME_FLAG
+            << entry.method << DOS_TIME << DOS_DATE << entry.crc
+            << static_cast<quint32>(entry.data.size()) << entry.size
+            << static_cast<quint16>(name.size()) << quint16(0);
+        out.writeRawData(name.constData(), name.size());
+        out.writeRawData(entry.data.constData(), entry.data.size());
+    }
+
+    auto centralDirOffset = static_cast<quint32>(archive.size());
+    for (int index = 0; index < _entries.count(); index++) {
+        auto entry = _entries[index];
+        auto name = entry.name.toUtf8();
+        out << CENTRAL_DIR_SIGNATURE << UNIX_MADE_BY << VERSION
+            << UTF8_NAME_FLAG << entry.method << DOS_TIME << DOS_DATE
+            << entry.crc << static_cast<quint32>(entry.data.size())
+            << entry.size << static_cast<quint16>(name.size())
+            << quint16(0) << quint16(0) << quint16(0) << quint16(0)
+            << (entry.mode << 16) << offsets[index];
+        out.writeRawData(name.constData(), name.size());
+    }
+    auto centralDirSize = static_cast<quint32>(archive.size())
+        - centralDirOffset;
+
+    auto count = static_cast<quint16>(_entries.count());
+    out << END_OF_CENTRAL_DIR_SIGNATURE << quint16(0) << quint16(0)
+        << count << count << centralDirSize << centralDirOffset
+        << quint16(0);
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return file.write(archive) == archive.size();
+}
+
+QByteArray
+ZipBuilder::rawDeflate(const QByteArray& data) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+        Z_DEFAULT_STRATEGY);
+
+    QByteArray result(deflateBound(&stream, data.size()), Qt::Uninitialized);
+    stream.next_in = reinterpret_cast<Bytef*>(
+        const_cast<char*>(data.constData()));
+    stream.avail_in = data.size();
+    stream.next_out = reinterpret_cast<Bytef*>(result.data());
+    stream.avail_out = result.size();
+    deflate(&stream, Z_FINISH);
+    result.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result;
+}
+
+void
+ZipBuilder::add(const QString& name,
+                const QByteArray& data,
+                bool deflated,
+                quint32 mode) {
+    Entry entry;
+    entry.name = name;
+    entry.method = deflated ? 8 : 0;
+    entry.data = deflated ? rawDeflate(data) : data;
+    entry.crc = crc32(crc32(0L, Z_NULL, 0),
+        reinterpret_cast<const Bytef*>(data.constData()), data.size());
+    entry.size = data.size();
+    entry.mode = mode;
+    _entries << entry;
+}
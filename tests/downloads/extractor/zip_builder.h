@@ -0,0 +1,61 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of version 3 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEST_ZIP_BUILDER_H
+#define TEST_ZIP_BUILDER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// Writes small zip files so that the tests do not depend on binary
+// fixtures nor on the zip tool.
+class ZipBuilder {
+
+ public:
+    void addFile(const QString& name,
+                 const QByteArray& data,
+                 bool deflated = false,
+                 quint32 mode = 0100644);
+    void addDir(const QString& name, quint32 mode = 040755);
+    void addSymLink(const QString& name, const QString& target);
+
+    bool write(const QString& path) const;
+
+    static QByteArray rawDeflate(const QByteArray& data);
+
+ private:
+    struct Entry {
+        QString name;
+        QByteArray data;  // as stored in the archive
+        quint16 method = 0;
+        quint32 crc = 0;
+        quint32 size = 0;
+        quint32 mode = 0;
+    };
+
+    void add(const QString& name,
+             const QByteArray& data,
+             bool deflated,
+             quint32 mode);
+
+ private:
+    QList<Entry> _entries;
+};
+
+#endif  // TEST_ZIP_BUILDER_H